@@ -74,16 +74,12 @@ void CHistogramViewer::Update()
 
 	C3DImage* im = m_img->GetImageSource()->Get3DImage();
 
+	// the image bins the values over its full precision range
+	int pdf[256];
+	im->Histogram(pdf);
+
 	vector<double> h(256, 0.0);
-	for (int k = 0; k < im->Depth(); ++k)
-	{
-		for (int j = 0; j < im->Height(); ++j)
-			for (int i = 0; i < im->Width(); ++i)
-			{
-				int n = im->value(i, j, k);
-				h[n]++;
-			}
-	}
+	for (int i = 0; i < 256; ++i) h[i] = pdf[i];
 
 	if (m_logMode)
 	{
@@ -2809,17 +2809,18 @@ void FEBioExport3::WriteGeometryNodes()
 
 		m_xml.add_branch(tagNodes);
 		{
-			XMLElement el("node");
-			int nid = el.add_attribute("id", 0);
-			for (int j = 0; j<pm->Nodes(); ++j, ++n)
+			int NN = pm->Nodes();
+			vector<int> ids(NN);
+			vector<double> r(3 * NN);
+			for (int j = 0; j<NN; ++j, ++n)
 			{
 				FENode& node = pm->Node(j);
 				node.m_nid = n;
-				el.set_attribute(nid, n);
-				vec3d r = po->GetTransform().LocalToGlobal(node.r);
-				el.value(r);
-				m_xml.add_leaf(el, false);
+				ids[j] = n;
+				vec3d rj = po->GetTransform().LocalToGlobal(node.r);
+				r[3 * j] = rj.x; r[3 * j + 1] = rj.y; r[3 * j + 2] = rj.z;
 			}
+			if (NN > 0) m_xml.add_leaf_array("node", "id", &ids[0], &r[0], NN, 3);
 		}
 		m_xml.close_branch();
 	}
@@ -2955,7 +2956,6 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 	// loop over unprocessed elements
 	int nset = 0;
 	int ncount = 0;
-	int nn[FEElement::MAX_NODES];
 	char szname[128] = { 0 };
 	for (int i = 0; ncount<NEP; ++i)
 	{
@@ -3000,21 +3000,18 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 			xe.add_attribute("name", szname);
 			m_xml.add_branch(xe);
 			{
-				XMLElement xej("elem");
-				int n1 = xej.add_attribute("id", (int)0);
-
+				// collect the connectivity and write it in one go
+				int ne = el.Nodes();
+				vector<int> ids, nodes;
 				for (int j = i; j<NE; ++j)
 				{
 					FEElement_& ej = pm->ElementRef(j);
 					if ((ej.m_ntag == 1) && (ej.Type() == ntype))
 					{
 						int eid = m_ntotelem + ncount + 1;
-						xej.set_attribute(n1, eid);
-						int ne = ej.Nodes();
-						assert(ne == el.Nodes());
-						for (int k = 0; k<ne; ++k) nn[k] = pm->Node(ej.m_node[k]).m_nid;
-						xej.value(nn, ne);
-						m_xml.add_leaf(xej, false);
+						ids.push_back(eid);
+						assert(ej.Nodes() == ne);
+						for (int k = 0; k<ne; ++k) nodes.push_back(pm->Node(ej.m_node[k]).m_nid);
 						ej.m_ntag = -1;	// mark as processed
 						ej.m_nid = eid;
 						ncount++;
@@ -3022,6 +3019,7 @@ void FEBioExport3::WriteGeometryPart(Part* part, GPart* pg, bool writeMats, bool
 						es.m_elem.push_back(j);
 					}
 				}
+				if (ids.empty() == false) m_xml.add_leaf_array("elem", "id", &ids[0], &nodes[0], (int)ids.size(), ne);
 			}
 			m_xml.close_branch();
 
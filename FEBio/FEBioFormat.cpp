@@ -115,6 +115,96 @@ void FEBioFormat::ParseUnknownAttribute(XMLTag& tag, const char* szatt)
 	m_fileReader->ParseUnknownAttribute(tag, szatt);
 }
 
+//-----------------------------------------------------------------------------
+//! Read the nodes of a Nodes section. When the section only contains leaf
+//! elements, the nodes are parsed in parallel.
+void FEBioFormat::ReadNodes(XMLTag& tag, std::vector<FEBioModel::NODE>& nodes)
+{
+	nodes.clear();
+
+	std::vector<XMLLeaf> leaves;
+	if (tag.m_preader->ReadLeafBlock(tag, leaves))
+	{
+		int nn = (int)leaves.size();
+		nodes.resize(nn);
+#pragma omp parallel for
+		for (int i = 0; i < nn; ++i)
+		{
+			const XMLLeaf& leaf = leaves[i];
+			FEBioModel::NODE& node = nodes[i];
+			node.r = vec3d(0, 0, 0);
+			leaf.value(node.r);
+			node.id = leaf.AttributeValue("id", -1); assert(node.id != -1);
+		}
+	}
+	else
+	{
+		nodes.reserve(10000);
+		++tag;
+		do
+		{
+			FEBioModel::NODE node;
+			tag.value(node.r);
+			int nid = tag.AttributeValue<int>("id", -1); assert(nid != -1);
+			node.id = nid;
+
+			nodes.push_back(node);
+			++tag;
+		}
+		while (!tag.isend());
+	}
+}
+
+//-----------------------------------------------------------------------------
+//! Read the elements of an Elements section. When the section only contains leaf
+//! elements, the elements are parsed in parallel.
+void FEBioFormat::ReadElements(XMLTag& tag, std::vector<FEBioModel::ELEM>& elems, bool allowShortTag)
+{
+	elems.clear();
+
+	std::vector<XMLLeaf> leaves;
+	if (tag.m_preader->ReadLeafBlock(tag, leaves))
+	{
+		int ne = (int)leaves.size();
+		elems.resize(ne);
+		int nerr = 0;
+#pragma omp parallel for reduction(+:nerr)
+		for (int i = 0; i < ne; ++i)
+		{
+			const XMLLeaf& leaf = leaves[i];
+			FEBioModel::ELEM& el = elems[i];
+			if ((leaf == "elem") || (allowShortTag && (leaf == "e")))
+			{
+				el.id = leaf.AttributeValue("id", -1);
+				leaf.value(el.n, FEElement::MAX_NODES);
+			}
+			else nerr++;
+		}
+
+		// the tag now points to the end of the section
+		if (nerr > 0) throw XMLReader::InvalidTag(tag);
+	}
+	else
+	{
+		elems.reserve(25000);
+		++tag;
+		do
+		{
+			FEBioModel::ELEM el;
+			if ((tag == "elem") || (allowShortTag && (tag == "e")))
+			{
+				el.id = tag.AttributeValue<int>("id", -1);
+				tag.value(el.n, FEElement::MAX_NODES);
+				elems.push_back(el);
+			}
+			else throw XMLReader::InvalidTag(tag);
+
+			++tag;
+		}
+		while (!tag.isend());
+	}
+}
+
 //-----------------------------------------------------------------------------
 //! Create a new step
 FEAnalysisStep* FEBioFormat::NewStep(FEModel& fem, int nanalysis, const char* szname)
@@ -1562,7 +1652,7 @@ FEReactionMaterial* FEBioFormat::ParseReaction2(XMLTag &tag)
 		{
 			if (tag == "equation")
 			{
-				ProcessReactionEquation(GetFEModel(), pm, tag.m_sval.c_str());
+				ProcessReactionEquation(GetFEModel(), pm, tag.szvalue());
 			}
 			else if (tag == "rate_constant")
 			{
@@ -97,6 +97,10 @@ protected:
 
 	void ParseMappedParameter(XMLTag& tag, Param* param);
 
+	// mesh section helper functions (these parse large sections in parallel)
+	void ReadNodes(XMLTag& tag, std::vector<FEBioModel::NODE>& nodes);
+	void ReadElements(XMLTag& tag, std::vector<FEBioModel::ELEM>& elems, bool allowShortTag);
+
 private:
 	FEBioModel&		m_febio;
 	FEBioImport*	m_fileReader;
@@ -166,26 +166,14 @@ void FEBioFormat25::ParseGeometryNodes(FEBioModel::Part* part, XMLTag& tag)
 {
 	if (part == 0) throw XMLReader::InvalidTag(tag);
 
-	vector<FEBioModel::NODE> nodes; nodes.reserve(10000);
-
 	// create a node set if the name is definde
 	const char* szname = tag.AttributeValue("name", true);
 	std::string name;
 	if (szname) name = szname;
 
 	// read nodal coordinates
-	++tag;
-	do
-	{
-		FEBioModel::NODE node;
-		tag.value(node.r);
-		int nid = tag.AttributeValue<int>("id", -1); assert(nid != -1);
-		node.id = nid;
-
-		nodes.push_back(node);
-		++tag;
-	}
-	while (!tag.isend());
+	vector<FEBioModel::NODE> nodes;
+	ReadNodes(tag, nodes);
 
 	// create nodes
 	int nn = nodes.size();
@@ -306,25 +294,7 @@ void FEBioFormat25::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 
 	// read the elements
 	vector<FEBioModel::ELEM> elem;
-	elem.reserve(25000);
-
-	++tag;
-	do
-	{
-		FEBioModel::ELEM el;
-		if (tag == "elem")
-		{
-			int id = tag.AttributeValue<int>("id", -1);
-			el.id = id;
-			tag.value(el.n, FEElement::MAX_NODES);
-			elem.push_back(el);
-		}
-		else throw XMLReader::InvalidTag(tag);
-
-		++tag;
-	}
-	while (!tag.isend());
-
+	ReadElements(tag, elem, false);
 
 	// create elements
 	FEMesh& mesh = *part->GetFEMesh();
@@ -455,25 +455,14 @@ void FEBioFormat3::ParseGeometryNodes(FEBioModel::Part* part, XMLTag& tag)
 {
 	if (part == 0) throw XMLReader::InvalidTag(tag);
 
-	vector<FEBioModel::NODE> nodes; nodes.reserve(10000);
-
 	// create a node set if the name is definde
 	const char* szname = tag.AttributeValue("name", true);
 	std::string name;
 	if (szname) name = szname;
 
 	// read nodal coordinates
-	++tag;
-	do
-	{
-		FEBioModel::NODE node;
-		tag.value(node.r);
-		int nid = tag.AttributeValue<int>("id", -1); assert(nid != -1);
-		node.id = nid;
-
-		nodes.push_back(node);
-		++tag;
-	} while (!tag.isend());
+	vector<FEBioModel::NODE> nodes;
+	ReadNodes(tag, nodes);
 
 	// create nodes
 	int nn = (int)nodes.size();
@@ -504,9 +493,6 @@ void FEBioFormat3::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 {
 	if (part == 0) throw XMLReader::InvalidTag(tag);
 
-	// first we need to figure out how many elements there are
-	int elems = tag.children();
-
 	// get the required type attribute
 	const char* sztype = tag.AttributeValue("type");
 	FEElementType ntype = FE_INVALID_ELEMENT_TYPE;
@@ -595,6 +581,11 @@ void FEBioFormat3::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 	FEBioModel::Domain* dom = part->AddDomain(name, matID);
 	dom->m_bshellNodalNormals = GetFEBioModel().m_shellNodalNormals;
 
+	// read element data
+	vector<FEBioModel::ELEM> elem;
+	ReadElements(tag, elem, true);
+	int elems = (int)elem.size();
+
 	// create elements
 	FEMesh& mesh = *part->GetFEMesh();
 	int NTE = mesh.Elements();
@@ -603,25 +594,17 @@ void FEBioFormat3::ParseGeometryElements(FEBioModel::Part* part, XMLTag& tag)
 	// generate the part id
 	int pid = part->Domains() - 1;
 
-	// read element data
-	++tag;
-	vector<int> elemSet; elemSet.reserve(elems);
+	vector<int> elemSet(elems);
 	for (int i = NTE; i<elems + NTE; ++i)
 	{
 		FEElement& el = mesh.Element(i);
+		FEBioModel::ELEM& els = elem[i - NTE];
 		el.SetType(ntype);
 		el.m_gid = pid;
 		dom->AddElement(i);
-		if ((tag == "e") || (tag == "elem"))
-		{
-			int id = tag.AttributeValue<int>("id", -1);
-			el.m_nid = id;
-			tag.value(el.m_node, el.Nodes());
-			elemSet.push_back(id);
-		}
-		else throw XMLReader::InvalidTag(tag);
-
-		++tag;
+		el.m_nid = els.id;
+		for (int j = 0; j < el.Nodes(); ++j) el.m_node[j] = els.n[j];
+		elemSet[i - NTE] = els.id;
 	}
 
 	// create new element set
@@ -93,6 +93,13 @@ void CCmdGroup::UnExecute()
 
 int CCmdGroup::GetCount() const { return (int)m_Cmd.size(); }
 
+size_t CCmdGroup::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (int i = 0; i < m_Cmd.size(); i++) mem += m_Cmd[i]->MemoryUsage();
+	return mem;
+}
+
 void CCmdGroup::SetViewState(VIEW_STATE state)
 {
 	CCommand::SetViewState(state);
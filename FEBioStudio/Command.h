@@ -69,6 +69,9 @@ public:
 	virtual void SetViewState(VIEW_STATE state);
 	VIEW_STATE GetViewState();
 
+	// approximate memory (in bytes) that this command holds on to for undo/redo
+	virtual size_t MemoryUsage() const { return 0; }
+
 protected:
 	// doc/view state variables
 	VIEW_STATE	m_state;
@@ -101,6 +104,8 @@ public:
 
 	void SetViewState(VIEW_STATE state) override;
 
+	size_t MemoryUsage() const override;
+
 protected:
 	CCmdPtrArray	m_Cmd;	// array of pointer to commands
 };
@@ -31,9 +31,11 @@ SOFTWARE.*/
 #include <GeomLib/GObject.h>
 
 std::string CBasicCmdManager::m_err;
+size_t CBasicCmdManager::m_memBudget = 0;
 
 CBasicCmdManager::CBasicCmdManager()
 {
+	m_discarded = 0;
 }
 
 CBasicCmdManager::~CBasicCmdManager()
@@ -43,12 +45,7 @@ CBasicCmdManager::~CBasicCmdManager()
 
 void CBasicCmdManager::AddCommand(CCommand* pcmd)
 {
-	// push the command
-	m_Undo.push(pcmd);
-
-	// clear the redo stack
-	int N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	PushUndo(pcmd);
 }
 
 bool CBasicCmdManager::DoCommand(CCommand* pcmd)
@@ -78,11 +75,7 @@ bool CBasicCmdManager::DoCommand(CCommand* pcmd)
 	}
 
 	// add it to the undo stack
-	m_Undo.push(pcmd);
-
-	// clear the redo stack
-	int N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	PushUndo(pcmd);
 
 	return true;
 }
@@ -92,13 +85,13 @@ void CBasicCmdManager::UndoCommand()
 	if (m_Undo.empty() == false)
 	{
 		// pop the command from the undo stack
-		CCommand* pcmd = m_Undo.top(); m_Undo.pop();
+		CCommand* pcmd = m_Undo.back(); m_Undo.pop_back();
 
 		// unexecute it
 		pcmd->UnExecute();
 
 		// push it on the redo stack
-		m_Redo.push(pcmd);
+		m_Redo.push_back(pcmd);
 	}
 }
 
@@ -107,13 +100,13 @@ void CBasicCmdManager::RedoCommand()
 	if (m_Redo.empty() == false)
 	{
 		// pop the command from the redo stack
-		CCommand* pcmd = m_Redo.top(); m_Redo.pop();
+		CCommand* pcmd = m_Redo.back(); m_Redo.pop_back();
 
 		// execute it
 		pcmd->Execute();
 
 		// push it on the undo stack
-		m_Undo.push(pcmd);
+		m_Undo.push_back(pcmd);
 	}
 }
 
@@ -121,15 +114,52 @@ void CBasicCmdManager::Clear()
 {
 	// clear undo stack
 	int N = (int)m_Undo.size();
-	for (int i = 0; i<N; i++) { delete m_Undo.top(); m_Undo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Undo.back(); m_Undo.pop_back(); }
 
 	// clear redo stack
 	N = (int)m_Redo.size();
-	for (int i = 0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	for (int i = 0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
 }
 
-const char* CBasicCmdManager::GetUndoCmdName() { return (m_Undo.size() ? m_Undo.top()->GetName() : 0); }
-const char* CBasicCmdManager::GetRedoCmdName() { return (m_Redo.size() ? m_Redo.top()->GetName() : 0); }
+void CBasicCmdManager::PushUndo(CCommand* pcmd)
+{
+	// push the command
+	m_Undo.push_back(pcmd);
+
+	// clear the redo stack
+	int N = (int)m_Redo.size();
+	for (int i = 0; i<N; i++) { delete m_Redo.back(); m_Redo.pop_back(); }
+
+	// make sure we stay within the memory budget
+	EnforceMemoryBudget();
+}
+
+size_t CBasicCmdManager::MemoryUsage() const
+{
+	size_t mem = 0;
+	for (CCommand* pcmd : m_Undo) mem += pcmd->MemoryUsage();
+	for (CCommand* pcmd : m_Redo) mem += pcmd->MemoryUsage();
+	return mem;
+}
+
+void CBasicCmdManager::EnforceMemoryBudget()
+{
+	if (m_memBudget == 0) return;
+
+	// The oldest commands are dropped first, but we always keep the last one, 
+	// even if it doesn't fit in the budget by itself.
+	size_t mem = MemoryUsage();
+	while ((mem > m_memBudget) && (m_Undo.size() > 1))
+	{
+		CCommand* pcmd = m_Undo.front(); m_Undo.pop_front();
+		mem -= pcmd->MemoryUsage();
+		delete pcmd;
+		m_discarded++;
+	}
+}
+
+const char* CBasicCmdManager::GetUndoCmdName() { return (m_Undo.size() ? m_Undo.back()->GetName() : 0); }
+const char* CBasicCmdManager::GetRedoCmdName() { return (m_Redo.size() ? m_Redo.back()->GetName() : 0); }
 
 //////////////////////////////////////////////////////////////////////
 // CCommandManager
@@ -192,11 +222,7 @@ bool CCommandManager::DoCommand(CCommand* pcmd)
 	}
 		
 	// add it to the undo stack
-	m_Undo.push(pcmd);
-
-	// clear the redo stack
-	int N = (int)m_Redo.size();
-	for (int i=0; i<N; i++) { delete m_Redo.top(); m_Redo.pop(); }
+	PushUndo(pcmd);
 
 	return true;
 }
@@ -204,7 +230,7 @@ bool CCommandManager::DoCommand(CCommand* pcmd)
 void CCommandManager::UndoCommand()
 {
 	// pop the command from the undo stack
-	CCommand* pcmd = m_Undo.top(); m_Undo.pop();
+	CCommand* pcmd = m_Undo.back(); m_Undo.pop_back();
 
 	// reset the view state
 	m_pDoc->SetViewState(pcmd->GetViewState());
@@ -213,13 +239,13 @@ void CCommandManager::UndoCommand()
 	pcmd->UnExecute();
 
 	// push it on the redo stack
-	m_Redo.push(pcmd);
+	m_Redo.push_back(pcmd);
 }
 
 void CCommandManager::RedoCommand()
 {
 	// pop the command from the redo stack
-	CCommand* pcmd = m_Redo.top(); m_Redo.pop();
+	CCommand* pcmd = m_Redo.back(); m_Redo.pop_back();
 
 	// reset the view state
 	m_pDoc->SetViewState(pcmd->GetViewState());
@@ -228,5 +254,5 @@ void CCommandManager::RedoCommand()
 	pcmd->Execute();
 
 	// push it on the undo stack
-	m_Undo.push(pcmd);
+	m_Undo.push_back(pcmd);
 }
@@ -25,13 +25,15 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
 #pragma once
-#include <stack>
+#include <deque>
 #include <string>
 
 class CCommand;
 class CGLDocument;
 
-typedef std::stack<CCommand*> CCmdStack;
+// The top of the stack is at the back. A deque is used so that the oldest 
+// commands can be dropped when the undo stack exceeds its memory budget.
+typedef std::deque<CCommand*> CCmdStack;
 
 class CBasicCmdManager
 {
@@ -55,9 +57,30 @@ public:
 	const char* GetUndoCmdName();
 	const char* GetRedoCmdName();
 
+	// memory used by the commands on the undo and redo stacks
+	size_t MemoryUsage() const;
+
+	// set/get the max memory (in bytes) the undo and redo stacks can use (0 = no limit)
+	static void SetMemoryBudget(size_t bytes) { m_memBudget = bytes; }
+	static size_t GetMemoryBudget() { return m_memBudget; }
+
+	// number of undo records that were discarded to stay within the memory
+	// budget since the last call
+	int TakeDiscardedCount() { int n = m_discarded; m_discarded = 0; return n; }
+
+protected:
+	// push an executed command on the undo stack and clear the redo stack
+	void PushUndo(CCommand* pcmd);
+
+	// drop the oldest commands until the stacks fit in the memory budget
+	void EnforceMemoryBudget();
+
 protected:
 	CCmdStack	m_Undo;	// the undo stack
 	CCmdStack	m_Redo;	// the redo stack
+	int			m_discarded;	// nr of undo records dropped by EnforceMemoryBudget
+
+	static size_t	m_memBudget;	// memory budget of the command stacks
 
 public:
 	static const std::string& GetErrorString() { return m_err; }
@@ -1477,8 +1477,7 @@ CCmdSelectElements::CCmdSelectElements(FEMesh* pm, int* pe, int N, bool badd) :
 	int M = pm->Elements();
 
 	// store the elements selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Element(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Element(i).IsSelected(); });
 
 	// store the elements we need to select
 	if (N != 0)
@@ -1503,8 +1502,7 @@ CCmdSelectElements::CCmdSelectElements(FEMesh* pm, vector<int>& el, bool badd) :
 	int M = pm->Elements();
 
 	// store the elements selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Element(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Element(i).IsSelected(); });
 
 	// store the elements we need to select
 	if (N != 0)
@@ -1537,14 +1535,10 @@ void CCmdSelectElements::Execute()
 
 void CCmdSelectElements::UnExecute()
 {
-	for (int i = 0; i<m_pm->Elements(); ++i)
-	{
+	m_tag.apply(m_pm->Elements(), [=](int i, bool sel) {
 		FEElement& el = m_pm->Element(i);
-		if (m_ptag[i])
-			el.Select();
-		else
-			el.Unselect();
-	}
+		if (sel) el.Select(); else el.Unselect();
+	});
 
 	m_pm->UpdateSelection();
 }
@@ -1561,8 +1555,7 @@ CCmdUnselectElements::CCmdUnselectElements(FEMesh* mesh, int* pe, int N) : CComm
 	int M = pm->Elements();
 
 	// store the elements selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Element(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Element(i).IsSelected(); });
 
 	// store the elements we need to select
 	m_N = N;
@@ -1580,8 +1573,7 @@ CCmdUnselectElements::CCmdUnselectElements(FEMesh* mesh, const vector<int>& elem
 	int M = pm->Elements();
 
 	// store the elements selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Element(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Element(i).IsSelected(); });
 
 	// store the elements we need to select
 	m_N = N;
@@ -1601,14 +1593,10 @@ void CCmdUnselectElements::Execute()
 void CCmdUnselectElements::UnExecute()
 {
 	FEMesh* pm = m_mesh;
-	for (int i = 0; i<pm->Elements(); ++i)
-	{
+	m_tag.apply(pm->Elements(), [=](int i, bool sel) {
 		FEElement& el = pm->Element(i);
-		if (m_ptag[i])
-			el.Select();
-		else
-			el.Unselect();
-	}
+		if (sel) el.Select(); else el.Unselect();
+	});
 	pm->UpdateSelection();
 }
 
@@ -1629,8 +1617,7 @@ CCmdSelectFaces::CCmdSelectFaces(FEMeshBase* pm, int* pf, int N, bool badd) : CC
 	int M = pm->Faces();
 
 	// store the faces selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Face(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Face(i).IsSelected(); });
 
 	// store the faces we need to select
 	if (N != 0)
@@ -1655,8 +1642,7 @@ CCmdSelectFaces::CCmdSelectFaces(FEMeshBase* pm, vector<int>& fl, bool badd) : C
 	int M = pm->Faces();
 
 	// store the faces selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Face(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Face(i).IsSelected(); });
 
 	// store the faces we need to select
 	if (N != 0)
@@ -1687,14 +1673,10 @@ void CCmdSelectFaces::Execute()
 
 void CCmdSelectFaces::UnExecute()
 {
-	for (int i = 0; i<m_pm->Faces(); ++i)
-	{
+	m_tag.apply(m_pm->Faces(), [=](int i, bool sel) {
 		FEFace& face = m_pm->Face(i);
-		if (m_ptag[i])
-			face.Select();
-		else
-			face.Unselect();
-	}
+		if (sel) face.Select(); else face.Unselect();
+	});
 	m_pm->UpdateSelection();
 }
 
@@ -1709,8 +1691,7 @@ CCmdUnselectFaces::CCmdUnselectFaces(FEMeshBase* pm, int* pf, int N) : CCommand(
 
 	// store the faces selection state
 	int M = pm->Faces();
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Face(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Face(i).IsSelected(); });
 
 	// store the faces we need to select
 	m_N = N;
@@ -1725,8 +1706,7 @@ CCmdUnselectFaces::CCmdUnselectFaces(FEMeshBase* pm, const vector<int>& face) :
 
 	// store the faces selection state
 	int M = pm->Faces();
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Face(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Face(i).IsSelected(); });
 
 	// store the faces we need to select
 	m_N = (int)face.size();
@@ -1743,14 +1723,10 @@ void CCmdUnselectFaces::Execute()
 
 void CCmdUnselectFaces::UnExecute()
 {
-	for (int i = 0; i<m_pm->Faces(); ++i)
-	{
+	m_tag.apply(m_pm->Faces(), [=](int i, bool sel) {
 		FEFace& face = m_pm->Face(i);
-		if (m_ptag[i])
-			face.Select();
-		else
-			face.Unselect();
-	}
+		if (sel) face.Select(); else face.Unselect();
+	});
 	m_pm->UpdateSelection();
 }
 
@@ -1770,8 +1746,7 @@ CCmdSelectFEEdges::CCmdSelectFEEdges(FELineMesh* pm, int* pe, int N, bool badd)
 	int M = pm->Edges();
 
 	// store the edges selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Edge(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Edge(i).IsSelected(); });
 
 	// store the faces we need to select
 	if (N != 0)
@@ -1795,8 +1770,7 @@ CCmdSelectFEEdges::CCmdSelectFEEdges(FELineMesh* pm, vector<int>& el, bool badd)
 	int M = pm->Edges();
 
 	// store the edge selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Edge(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Edge(i).IsSelected(); });
 
 	// store the edges we need to select
 	if (N != 0)
@@ -1825,14 +1799,10 @@ void CCmdSelectFEEdges::Execute()
 
 void CCmdSelectFEEdges::UnExecute()
 {
-	for (int i = 0; i<m_pm->Edges(); ++i)
-	{
+	m_tag.apply(m_pm->Edges(), [=](int i, bool sel) {
 		FEEdge& edge = m_pm->Edge(i);
-		if (m_ptag[i])
-			edge.Select();
-		else
-			edge.Unselect();
-	}
+		if (sel) edge.Select(); else edge.Unselect();
+	});
 	m_pm->UpdateSelection();
 }
 
@@ -1848,8 +1818,7 @@ CCmdUnselectFEEdges::CCmdUnselectFEEdges(FELineMesh* pm, int* pe, int N) : CComm
 	int M = m_pm->Edges();
 
 	// store the edges selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Edge(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Edge(i).IsSelected(); });
 
 	// store the edges we need to select
 	m_N = N;
@@ -1867,8 +1836,7 @@ CCmdUnselectFEEdges::CCmdUnselectFEEdges(FELineMesh* pm, const vector<int>& edge
 	int M = pm->Edges();
 
 	// store the edges selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Edge(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Edge(i).IsSelected(); });
 
 	// store the edges we need to select
 	m_N = N;
@@ -1885,14 +1853,10 @@ void CCmdUnselectFEEdges::Execute()
 
 void CCmdUnselectFEEdges::UnExecute()
 {
-	for (int i = 0; i<m_pm->Edges(); ++i)
-	{
+	m_tag.apply(m_pm->Edges(), [=](int i, bool sel) {
 		FEEdge& edge = m_pm->Edge(i);
-		if (m_ptag[i])
-			edge.Select();
-		else
-			edge.Unselect();
-	}
+		if (sel) edge.Select(); else edge.Unselect();
+	});
 	m_pm->UpdateSelection();
 }
 
@@ -1913,8 +1877,7 @@ CCmdSelectFENodes::CCmdSelectFENodes(FELineMesh* pm, int* pn, int N, bool badd)
 	int M = pm->Nodes();
 
 	// store the nodes selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Node(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Node(i).IsSelected(); });
 
 	// store the nodes we need to select
 	if (N != 0)
@@ -1939,8 +1902,7 @@ CCmdSelectFENodes::CCmdSelectFENodes(FELineMesh* pm, vector<int>& nl, bool badd)
 	int M = pm->Nodes();
 
 	// store the nodes selection state
-	m_ptag = new bool[M];
-	for (i = 0; i<M; ++i) m_ptag[i] = pm->Node(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Node(i).IsSelected(); });
 
 	// store the nodes we need to select
 	if (N != 0)
@@ -1970,14 +1932,10 @@ void CCmdSelectFENodes::Execute()
 
 void CCmdSelectFENodes::UnExecute()
 {
-	for (int i = 0; i<m_pm->Nodes(); ++i)
-	{
+	m_tag.apply(m_pm->Nodes(), [=](int i, bool sel) {
 		FENode& node = m_pm->Node(i);
-		if (m_ptag[i])
-			node.Select();
-		else
-			node.Unselect();
-	}
+		if (sel) node.Select(); else node.Unselect();
+	});
 	m_pm->UpdateSelection();
 }
 
@@ -1992,8 +1950,7 @@ CCmdUnselectNodes::CCmdUnselectNodes(FELineMesh* pm, int* pn, int N) : CCommand(
 	int M = pm->Nodes();
 
 	// store the nodes selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Node(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Node(i).IsSelected(); });
 
 	// store the nodes we need to select
 	m_N = N;
@@ -2010,8 +1967,7 @@ CCmdUnselectNodes::CCmdUnselectNodes(FELineMesh* pm, const vector<int>& node) :
 	int M = pm->Nodes();
 
 	// store the nodes selection state
-	m_ptag = new bool[M];
-	for (int i = 0; i<M; ++i) m_ptag[i] = pm->Node(i).IsSelected();
+	m_tag.capture(M, [=](int i) { return pm->Node(i).IsSelected(); });
 
 	// store the nodes we need to select
 	m_N = N;
@@ -2030,14 +1986,10 @@ void CCmdUnselectNodes::Execute()
 void CCmdUnselectNodes::UnExecute()
 {
 	FELineMesh* pm = m_mesh;
-	for (int i = 0; i<pm->Nodes(); ++i)
-	{
+	m_tag.apply(pm->Nodes(), [=](int i, bool sel) {
 		FENode& node = pm->Node(i);
-		if (m_ptag[i])
-			node.Select();
-		else
-			node.Unselect();
-	}
+		if (sel) node.Select(); else node.Unselect();
+	});
 	pm->UpdateSelection();
 }
 
@@ -2716,6 +2668,20 @@ void CCmdUnhideAll::UnExecute()
 	m_bunhide = true;
 }
 
+//=============================================================================
+// approximate memory used by a mesh that is kept on the undo stack
+static size_t MeshMemoryUsage(const FEMeshBase* pm)
+{
+	if (pm == nullptr) return 0;
+	return pm->Nodes()*sizeof(FENode) + pm->Faces()*sizeof(FEFace) + pm->Edges()*sizeof(FEEdge);
+}
+
+static size_t MeshMemoryUsage(const FEMesh* pm)
+{
+	if (pm == nullptr) return 0;
+	return MeshMemoryUsage(static_cast<const FEMeshBase*>(pm)) + pm->Elements()*sizeof(FEElement) + pm->CompressedSize();
+}
+
 //=============================================================================
 // CCmdApplyFEModifier
 //-----------------------------------------------------------------------------
@@ -2753,6 +2719,9 @@ void CCmdApplyFEModifier::Execute()
 
 	if (m_pnew)
 	{
+		// the mesh was compressed while it was on the undo stack
+		if (m_pnew->IsCompressed()) m_pnew->Expand();
+
 		// replace the old mesh with the new
 		try
 		{
@@ -2771,6 +2740,9 @@ void CCmdApplyFEModifier::Execute()
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FEMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+		// the replaced mesh is only needed for undo
+		if (m_pnew) m_pnew->Compress();
 	}
 }
 
@@ -2779,16 +2751,26 @@ void CCmdApplyFEModifier::UnExecute()
 	// get the FEModel
 	if (m_pnew)
 	{
+		if (m_pnew->IsCompressed()) m_pnew->Expand();
+
 		// replace the old mesh with the new
 		m_pobj->ReplaceFEMesh(m_pnew);
 
 		// swap old and new
 		// we do this so that we can always delete m_pnew
 		FEMesh* pm = m_pnew; m_pnew = m_pold; m_pold = pm;
+
+		// the replaced mesh is only needed for redo
+		if (m_pnew) m_pnew->Compress();
 	}
 }
 
 
+size_t CCmdApplyFEModifier::MemoryUsage() const
+{
+	return MeshMemoryUsage(m_pnew);
+}
+
 //=============================================================================
 // CCmdApplySurfaceModifier
 //-----------------------------------------------------------------------------
@@ -2868,6 +2850,11 @@ void CCmdApplySurfaceModifier::UnExecute()
 	}
 }
 
+size_t CCmdApplySurfaceModifier::MemoryUsage() const
+{
+	return MeshMemoryUsage(m_pnew);
+}
+
 //=============================================================================
 // CCmdChangeFEMesh
 //-----------------------------------------------------------------------------
@@ -2882,10 +2869,15 @@ CCmdChangeFEMesh::CCmdChangeFEMesh(GObject* po, FEMesh* pm, bool bup) : CCommand
 
 void CCmdChangeFEMesh::Execute()
 {
+	// the mesh was compressed while it was on the undo stack
+	if (m_pnew && m_pnew->IsCompressed()) m_pnew->Expand();
+
 	FEMesh* pm = m_po->GetFEMesh();
 	m_po->ReplaceFEMesh(m_pnew, m_update);
 
+	// the replaced mesh is only needed for undo/redo
 	m_pnew = pm;
+	if (m_pnew) m_pnew->Compress();
 }
 
 void CCmdChangeFEMesh::UnExecute()
@@ -2893,6 +2885,11 @@ void CCmdChangeFEMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFEMesh::MemoryUsage() const
+{
+	return MeshMemoryUsage(m_pnew);
+}
+
 //=============================================================================
 // CCmdChangeFESurfaceMesh
 //-----------------------------------------------------------------------------
@@ -2924,6 +2921,11 @@ void CCmdChangeFESurfaceMesh::UnExecute()
 	Execute();
 }
 
+size_t CCmdChangeFESurfaceMesh::MemoryUsage() const
+{
+	return MeshMemoryUsage(m_pnew);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // CCmdChangeView
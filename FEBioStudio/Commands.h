@@ -42,6 +42,7 @@ SOFTWARE.*/
 #include <MeshTools/FESurfaceModifier.h>
 #include <GeomLib/GSurfaceMeshObject.h>
 #include <GLLib/GLCamera.h>
+#include <MeshLib/FESelectionBits.h>
 
 class ObjectMeshList;
 class MeshLayer;
@@ -734,14 +735,14 @@ class CCmdSelectElements : public CCommand
 public:
 	CCmdSelectElements(FEMesh* pm, int* pe, int N, bool badd);
 	CCmdSelectElements(FEMesh* pm, vector<int>& el, bool badd);
-	~CCmdSelectElements() { delete[] m_ptag; delete[] m_pel; }
+	~CCmdSelectElements() { delete[] m_pel; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FEMesh*	m_pm;
-	bool*	m_ptag;	// old selecion state of elements
+	FESelectionBits	m_tag;	// old selecion state of elements
 	int*	m_pel;	// array of element indics we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of elements to select
@@ -754,14 +755,14 @@ class CCmdUnselectElements : public CCommand
 public:
 	CCmdUnselectElements(FEMesh* mesh, int* pe, int N);
 	CCmdUnselectElements(FEMesh* mesh, const vector<int>& elem);
-	~CCmdUnselectElements() { delete[] m_ptag; delete[] m_pel; }
+	~CCmdUnselectElements() { delete[] m_pel; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FEMesh* m_mesh;
-	bool*	m_ptag;	// old selecion state of elements
+	FESelectionBits	m_tag;	// old selecion state of elements
 	int*	m_pel;	// array of element indics we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of elements to select
@@ -774,14 +775,14 @@ class CCmdSelectFaces : public CCommand
 public:
 	CCmdSelectFaces(FEMeshBase* pm, int* pf, int N, bool badd);
 	CCmdSelectFaces(FEMeshBase* pm, vector<int>& fl, bool badd);
-	~CCmdSelectFaces() { delete[] m_ptag; delete[] m_pface; }
+	~CCmdSelectFaces() { delete[] m_pface; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FEMeshBase*	m_pm;
-	bool*	m_ptag;	// old selecion state of faces
+	FESelectionBits	m_tag;	// old selecion state of faces
 	int*	m_pface;// array of face indics we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of faces to select
@@ -794,14 +795,14 @@ class CCmdUnselectFaces : public CCommand
 public:
 	CCmdUnselectFaces(FEMeshBase* pm, int* pf, int N);
 	CCmdUnselectFaces(FEMeshBase* pm, const vector<int>& face);
-	~CCmdUnselectFaces() { delete[] m_ptag; delete[] m_pface; }
+	~CCmdUnselectFaces() { delete[] m_pface; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FEMeshBase* m_pm;
-	bool*	m_ptag;	// old selecion state of faces
+	FESelectionBits	m_tag;	// old selecion state of faces
 	int*	m_pface;	// array of face indics we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of faces to select
@@ -814,14 +815,14 @@ class CCmdSelectFEEdges : public CCommand
 public:
 	CCmdSelectFEEdges(FELineMesh* pm, int* pe, int N, bool badd);
 	CCmdSelectFEEdges(FELineMesh* pm, vector<int>& el, bool badd);
-	~CCmdSelectFEEdges() { delete[] m_ptag; delete[] m_pedge; }
+	~CCmdSelectFEEdges() { delete[] m_pedge; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FELineMesh*	m_pm;
-	bool*	m_ptag;	// old selecion state of edges
+	FESelectionBits	m_tag;	// old selecion state of edges
 	int*	m_pedge;// array of edge indices we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of edges to select
@@ -834,14 +835,14 @@ class CCmdUnselectFEEdges : public CCommand
 public:
 	CCmdUnselectFEEdges(FELineMesh* pm, int* pe, int N);
 	CCmdUnselectFEEdges(FELineMesh* pm, const vector<int>& edge);
-	~CCmdUnselectFEEdges() { delete[] m_ptag; delete[] m_pedge; }
+	~CCmdUnselectFEEdges() { delete[] m_pedge; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FELineMesh*	m_pm;
-	bool*	m_ptag;		// old selecion state of edges
+	FESelectionBits	m_tag;		// old selecion state of edges
 	int*	m_pedge;	// array of edge indices we need to select
 	bool	m_badd;		// add to selection or not
 	int		m_N;		// nr of faces to select
@@ -854,14 +855,14 @@ class CCmdSelectFENodes : public CCommand
 public:
 	CCmdSelectFENodes(FELineMesh* pm, int* pn, int N, bool badd);
 	CCmdSelectFENodes(FELineMesh* pm, vector<int>& nl, bool badd);
-	~CCmdSelectFENodes() { delete[] m_ptag; delete[] m_pn; }
+	~CCmdSelectFENodes() { delete[] m_pn; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FELineMesh*	m_pm;
-	bool*	m_ptag;	// old selecion state of nodes
+	FESelectionBits	m_tag;	// old selecion state of nodes
 	int*	m_pn;	// array of node indices we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of nodes to select
@@ -874,14 +875,14 @@ class CCmdUnselectNodes : public CCommand
 public:
 	CCmdUnselectNodes(FELineMesh* pm, int* pn, int N);
 	CCmdUnselectNodes(FELineMesh* pm, const vector<int>& node);
-	~CCmdUnselectNodes() { delete[] m_ptag; delete[] m_pn; }
+	~CCmdUnselectNodes() { delete[] m_pn; }
 
 	void Execute();
 	void UnExecute();
 
 protected:
 	FELineMesh* m_mesh;
-	bool*	m_ptag;	// old selecion state of nodes
+	FESelectionBits	m_tag;	// old selecion state of nodes
 	int*	m_pn;	// array of nodes indices we need to select
 	bool	m_badd; // add to selection or not
 	int		m_N;	// nr of nodes to select
@@ -1124,6 +1125,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*		m_pobj;
 	FEMesh*			m_pold;	// old, unmodified mesh
@@ -1143,6 +1146,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	GObject*			m_pobj;
 	FESurfaceMesh*		m_pold;	// old, unmodified mesh
@@ -1162,6 +1167,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool		m_update;
 	GObject*	m_po;
@@ -1178,6 +1185,8 @@ public:
 	void Execute();
 	void UnExecute();
 
+	size_t MemoryUsage() const override;
+
 protected:
 	bool				m_update;
 	GSurfaceMeshObject*	m_po;
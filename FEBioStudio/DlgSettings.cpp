@@ -152,6 +152,8 @@ public:
 		addBoolProperty(&m_showNewDialog, "Show New dialog box");
 		addProperty("Recent projects list", CProperty::Action)->info = QString("Clear");
 		addIntProperty(&m_autoSaveInterval, "AutoSave Interval (s)");
+		addIntProperty(&m_undoBudget, "Undo memory budget (MB)");
+		addIntProperty(&m_postMemLimit, "Post memory limit (MB)");
 	}
 
 	void SetPropertyValue(int i, const QVariant& v) override
@@ -174,6 +176,8 @@ public:
 	int		m_theme;
 	bool	m_showNewDialog;
 	int		m_autoSaveInterval;
+	int		m_undoBudget;
+	int		m_postMemLimit;
 };
 
 //-----------------------------------------------------------------------------
@@ -998,6 +1002,8 @@ void CDlgSettings::UpdateSettings()
 	ui->m_ui->m_theme = m_pwnd->currentTheme();
 	ui->m_ui->m_showNewDialog = m_pwnd->showNewDialog();
 	ui->m_ui->m_autoSaveInterval = m_pwnd->autoSaveInterval();
+	ui->m_ui->m_undoBudget = m_pwnd->undoMemoryBudget();
+	ui->m_ui->m_postMemLimit = m_pwnd->postMemoryLimit();
 
 	ui->m_select->m_bconnect = view.m_bconn;
 	ui->m_select->m_ntagInfo = view.m_ntagInfo;
@@ -1100,6 +1106,8 @@ void CDlgSettings::apply()
 	m_pwnd->setClearCommandStackOnSave(ui->m_ui->m_bcmd);
 	m_pwnd->setShowNewDialog(ui->m_ui->m_showNewDialog);
 	m_pwnd->setAutoSaveInterval(ui->m_ui->m_autoSaveInterval);
+	m_pwnd->setUndoMemoryBudget(ui->m_ui->m_undoBudget);
+	m_pwnd->setPostMemoryLimit(ui->m_ui->m_postMemLimit);
 
 	int oldTheme = m_pwnd->currentTheme();
 	if (ui->m_ui->m_theme != oldTheme)
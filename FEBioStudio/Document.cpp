@@ -58,6 +58,8 @@ SOFTWARE.*/
 #include <QDateTime>
 #include "Commands.h"
 #include "FEBioJob.h"
+#include "ModelFileWriter.h"
+#include "SaveThread.h"
 #include "Logger.h"
 #include <sstream>
 #include <QTextStream>
@@ -450,6 +452,7 @@ CGLDocument::CGLDocument(CMainWindow* wnd) : CDocument(wnd)
 
 	m_fileWriter = nullptr;
 	m_fileReader = nullptr;
+	m_saveThread = nullptr;
 
 	// Clear the command history
 	m_pCmd->Clear();
@@ -467,6 +470,9 @@ CGLDocument::CGLDocument(CMainWindow* wnd) : CDocument(wnd)
 //-----------------------------------------------------------------------------
 CGLDocument::~CGLDocument()
 {
+	// make sure the autosave thread is done
+	WaitForSave();
+
 	// remove autosave
 	QFile autoSave(m_autoSaveFilePath.c_str());
 	if(autoSave.exists()) autoSave.remove();
@@ -513,6 +519,7 @@ void CGLDocument::AddCommand(CCommand* pcmd)
 	UpdateSelection();
 	CMainWindow* wnd = GetMainWindow();
 	wnd->AddLogEntry(QString("Executing command: %1\n").arg(pcmd->GetName()));
+	ReportDiscardedUndoHistory();
 }
 
 //-----------------------------------------------------------------------------
@@ -527,6 +534,7 @@ void CGLDocument::AddCommand(CCommand* pcmd, const std::string& s)
 		wnd->AddLogEntry(QString("Executing command: %1 (%2)\n").arg(pcmd->GetName()).arg(QString::fromStdString(s)));
 	}
 	else wnd->AddLogEntry(QString("Executing command: %1\n").arg(pcmd->GetName()));
+	ReportDiscardedUndoHistory();
 }
 
 //-----------------------------------------------------------------------------
@@ -543,6 +551,7 @@ bool CGLDocument::DoCommand(CCommand* pcmd, bool b)
 	bool ret = m_pCmd->DoCommand(pcmd);
 	SetModifiedFlag();
 	if (b) UpdateSelection();
+	ReportDiscardedUndoHistory();
 	return ret;
 }
 
@@ -559,9 +568,20 @@ bool CGLDocument::DoCommand(CCommand* pcmd, const std::string& s, bool b)
 	bool ret = m_pCmd->DoCommand(pcmd);
 	SetModifiedFlag();
 	UpdateSelection(b);
+	ReportDiscardedUndoHistory();
 	return ret;
 }
 
+//-----------------------------------------------------------------------------
+void CGLDocument::ReportDiscardedUndoHistory()
+{
+	int n = m_pCmd->TakeDiscardedCount();
+	if (n == 0) return;
+
+	CMainWindow* wnd = GetMainWindow();
+	wnd->AddLogEntry(QString("The %1 oldest undo step(s) were discarded to stay within the undo memory budget (%2 MB).\n").arg(n).arg(wnd->undoMemoryBudget()));
+}
+
 //-----------------------------------------------------------------------------
 const std::string& CGLDocument::GetCommandErrorString() const
 {
@@ -797,6 +817,9 @@ Post::CImageModel* CGLDocument::ImportTiff(const std::string& fileName)
 		return nullptr;
 	}
 
+	double throughput = po->GetImageSource()->GetReadThroughput();
+	if (throughput > 0.0) CLogger::AddLogEntry(QString("Image data read at %1 MB/s\n").arg(throughput, 0, 'f', 1));
+
 	stringstream ss;
 	ss << "ImageModel" << n++;
 	po->SetName(ss.str());
@@ -961,6 +984,12 @@ bool CGLDocument::AutoSaveDocument()
 {
 	if (m_fileWriter && (m_autoSaveFilePath.empty() == false))
 	{
+		// model files are written in the background
+		if (dynamic_cast<CModelFileWriter*>(m_fileWriter))
+		{
+			return SaveDocumentAsync(m_autoSaveFilePath);
+		}
+
 		CLogger::AddLogEntry(QString("Autosaving file: %1 ...").arg(m_title.c_str()));
 
 		bool success = m_fileWriter->Write(m_autoSaveFilePath.c_str());
@@ -973,6 +1002,54 @@ bool CGLDocument::AutoSaveDocument()
 		return false;
 }
 
+//-----------------------------------------------------------------------------
+bool CGLDocument::SaveDocumentAsync(const std::string& fileName)
+{
+	CModelFileWriter* writer = dynamic_cast<CModelFileWriter*>(m_fileWriter);
+	if ((writer == nullptr) || fileName.empty()) return false;
+
+	// don't start a new save while the last one is still being written
+	if (m_saveThread) return false;
+
+	CLogger::AddLogEntry(QString("Autosaving file: %1 ...").arg(m_title.c_str()));
+
+	// Take a snapshot of the model. Everything but the mesh data is serialized to 
+	// memory here, since the model can be modified as soon as we return. The mesh 
+	// buffers are only copied, and serialized on the worker thread.
+	std::vector<unsigned char> buf;
+	OArchiveDeferred def;
+	if (writer->Write(buf, &def) == false)
+	{
+		CLogger::AddLogEntry("FAILED\n");
+		return false;
+	}
+
+	// serialize the meshes and write the snapshot to disk on a worker thread
+	m_saveThread = new CSaveThread(QString::fromStdString(fileName), buf, def);
+	QObject::connect(m_saveThread, &CSaveThread::resultReady, m_saveThread, [](bool success, QString fileName) {
+		CLogger::AddLogEntry(success ? "SUCCESS\n" : "FAILED\n");
+	});
+	QObject::connect(m_saveThread, &QThread::finished, m_saveThread, [this]() {
+		m_saveThread->deleteLater();
+		m_saveThread = nullptr;
+	});
+	m_saveThread->start();
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void CGLDocument::WaitForSave()
+{
+	if (m_saveThread)
+	{
+		m_saveThread->disconnect();
+		m_saveThread->wait();
+		delete m_saveThread;
+		m_saveThread = nullptr;
+	}
+}
+
 //-----------------------------------------------------------------------------
 void CGLDocument::GrowElementSelection(FEMesh* pm, bool respectPartitions)
 {
@@ -95,6 +95,7 @@ class FESurfaceModifier;
 class GSurfaceMeshObject;
 class FileReader;
 class FileWriter;
+class CSaveThread;
 
 namespace Post {
 	class CImageModel;
@@ -242,6 +243,13 @@ public:
 
 	bool AutoSaveDocument() override;
 
+	// Serialize the model to memory and write it to file on a background thread.
+	// Returns false if the model could not be serialized or if a previous save is still busy.
+	bool SaveDocumentAsync(const std::string& fileName);
+
+	// wait for a background save to finish
+	void WaitForSave();
+
 	// set/get the file reader
 	void SetFileReader(FileReader* fileReader);
 	FileReader* GetFileReader();
@@ -325,6 +333,9 @@ protected:
 	void SaveResources(OArchive& ar);
 	void LoadResources(IArchive& ar);
 
+	// tell the user when undo history was discarded to stay within the memory budget
+	void ReportDiscardedUndoHistory();
+
 public:
 	void SetUnitSystem(int unitSystem);
 	int GetUnitSystem() const;
@@ -344,4 +355,6 @@ protected:
 
 	FileReader*		m_fileReader;
 	FileWriter*		m_fileWriter;
+
+	CSaveThread*	m_saveThread;	// thread writing the last autosave
 };
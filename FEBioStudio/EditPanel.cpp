@@ -45,6 +45,7 @@ SOFTWARE.*/
 #include <GeomLib/GOCCObject.h>
 #include <QMessageBox>
 #include "Commands.h"
+#include <FSCore/Profiler.h>
 
 //=======================================================================================
 SurfaceModifierThread::SurfaceModifierThread(CModelDocument* doc, FESurfaceModifier* mod, GSurfaceMeshObject* po, FEGroup* pg)
@@ -57,6 +58,8 @@ SurfaceModifierThread::SurfaceModifierThread(CModelDocument* doc, FESurfaceModif
 
 void SurfaceModifierThread::run()
 {
+	PROFILE_SCOPE_CAT("SurfaceModifierThread::run", "modifier");
+	m_mod->ResetCancel();
 	bool bsuccess = m_doc->ApplyFESurfaceModifier(*m_mod, m_po, m_pg);
 	emit resultReady(bsuccess);
 }
@@ -78,7 +81,7 @@ const char* SurfaceModifierThread::currentTask()
 
 void SurfaceModifierThread::stop()
 {
-
+	if (m_mod) m_mod->Terminate();
 }
 
 //=======================================================================================
@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "FileThread.h"
 #include "MainWindow.h"
 #include <MeshIO/FileReader.h>
+#include <FSCore/Profiler.h>
 
 CFileThread::CFileThread(CMainWindow* wnd, const QueuedFile& file) : m_wnd(wnd), m_file(file)
 {
@@ -38,6 +39,7 @@ CFileThread::CFileThread(CMainWindow* wnd, const QueuedFile& file) : m_wnd(wnd),
 
 void CFileThread::run()
 {
+	PROFILE_SCOPE_CAT("CFileThread::run", "io");
 	std::string sfile = m_file.m_fileName.toStdString();
 	const char* szfile = sfile.c_str();
 	if (m_file.m_fileReader == 0)
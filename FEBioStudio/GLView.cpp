@@ -65,6 +65,7 @@ SOFTWARE.*/
 #include <MeshTools/GModel.h>
 #include "Commands.h"
 #include "PostObject.h"
+#include <FSCore/Profiler.h>
 #include <iostream>
 
 static GLubyte poly_mask[128] = {
@@ -530,6 +531,9 @@ void CGLView::mousePressEvent(QMouseEvent* ev)
 	m_x0 = m_x1 = ev->pos().x();
 	m_y0 = m_y1 = ev->pos().y();
 	m_pl.clear();
+
+	// renderers can use a lower level of detail while the mouse is down
+	m_rc.m_interactive = true;
 	m_pl.push_back(pair<int, int>(m_x0, m_y0));
 
 	m_bshift = (ev->modifiers() & Qt::ShiftModifier   ? true : false);
@@ -859,6 +863,9 @@ void CGLView::mouseDoubleClickEvent(QMouseEvent* ev)
 
 void CGLView::mouseReleaseEvent(QMouseEvent* ev)
 {
+	// the view is idle again, so renderers can refine
+	m_rc.m_interactive = false;
+
 	// get the active view
 	CPostDocument* postDoc = m_pWnd->GetPostDocument();
 
@@ -1464,6 +1471,8 @@ void CGLView::repaintEvent()
 
 void CGLView::paintGL()
 {
+	PROFILE_SCOPE_CAT("CGLView::paintGL", "render");
+
 	// Get the current document
 	CGLDocument* pdoc = GetDocument();
 	if (pdoc == nullptr)
@@ -1645,6 +1654,7 @@ void CGLView::paintGL()
 //-----------------------------------------------------------------------------
 void CGLView::RenderModelView()
 {
+	PROFILE_SCOPE_CAT("CGLView::RenderModelView", "render");
 	CModelDocument* pdoc = dynamic_cast<CModelDocument*>(GetDocument());
 	VIEW_SETTINGS& view = GetViewSettings();
 	int nitem = pdoc->GetItemMode();
@@ -1765,6 +1775,7 @@ void CGLView::RenderModelView()
 //-----------------------------------------------------------------------------
 void CGLView::RenderPostView(CPostDocument* postDoc)
 {
+	PROFILE_SCOPE_CAT("CGLView::RenderPostView", "render");
 	if (postDoc && postDoc->IsValid())
 	{
 		Post::CGLModel* glm = postDoc->GetGLModel();
@@ -2823,6 +2834,7 @@ void CGLView::RenderTrack()
 
 void CGLView::RenderImageData()
 {
+	PROFILE_SCOPE_CAT("CGLView::RenderImageData", "render");
 	CGLDocument* doc = GetDocument();
 	if (doc->IsValid() == false) return;
 
@@ -1623,10 +1623,8 @@ void CModelGraphWindow::Update(bool breset, bool bfit)
 	// since the strain calculations depend on it
 	int nsteps = doc->GetStates();
 	Post::CGLDisplacementMap* pdm = po->GetDisplacementMap();
-	if (pdm)
-	{
-		for (int i = 0; i<nsteps; ++i) po->GetDisplacementMap()->UpdateState(i);
-	}
+	po->WaitForPrefetch();
+	if (pdm) pdm->Prefetch(0, nsteps - 1);
 
 	// clear data on plots (we don't delete the plots so that we can retain user changes)
 	ClearPlotsData();
@@ -1932,142 +1930,50 @@ void CModelGraphWindow::addSelectedNodes()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected nodes
+	vector<int> sel;
+	QStringList labels;
 	int NN = mesh.Nodes();
-	switch (m_xtype)
+	for (int i = 0; i < NN; i++)
 	{
-	case 0: // time values
-	{
-		for (int i = 0; i<NN; i++)
+		FENode& node = mesh.Node(i);
+		if (node.IsSelected())
 		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				for (int j = 0; j<nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
-
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
+			sel.push_back(i);
+			labels << QString("N%1").arg(i + 1);
 		}
 	}
-	break;
-	case 1: // step values
+	if (sel.empty()) return;
+
+	if (m_xtype != 3) addItemHistories(sel, Post::CLASS_NODE, labels);
+	else
 	{
-		for (int i = 0; i<NN; i++)
-		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				for (int j = 0; j<nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
+		// time-scatter
+		int states = fem.GetStates();
 
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		int state0 = m_firstState;
+		int state1 = m_lastState;
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-	}
-	break;
-	case 2: // scatter
-	{
-		for (int i = 0; i<NN; i++)
-		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected())
-			{
-				TrackNodeHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
+		if (state0 < 0) state0 = 0;
+		if (state0 >= states) state0 = states - 1;
 
-				// evaluate y-field
-				TrackNodeHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+		if (state1 < 0) state1 = 0;
+		if (state1 >= states) state1 = states - 1;
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("N%1").arg(i + 1));
-				for (int j = 0; j<nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-	}
-	break;
-	case 3: // time-scatter
-	{
-		vector<int> sel;
-		for (int i = 0; i < NN; i++)
+		if (state1 < state0)
 		{
-			FENode& node = mesh.Node(i);
-			if (node.IsSelected()) sel.push_back(i);
+			int tmp = state0;
+			state0 = state1;
+			state1 = tmp;
 		}
 
-		if (sel.empty() == false)
-		{
-			int states = fem.GetStates();
-
-			int state0 = m_firstState;
-			int state1 = m_lastState;
-
-			if (state0 < 0) state0 = 0;
-			if (state0 >= states) state0 = states - 1;
-
-			if (state1 < 0) state1 = 0;
-			if (state1 >= states) state1 = states - 1;
-
-			if (state1 < state0)
-			{
-				int tmp = state0;
-				state0 = state1;
-				state1 = tmp;
-			}
-
-			int nsteps = state1 - state0 + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = state0; i < state0 + nsteps; ++i)
-			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
-			}
-
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FENode& node = mesh.Node(sel[i]);
-				if (node.IsSelected())
-				{
-					// evaluate x-field
-					TrackNodeHistory(sel[i], &xdata[0], m_dataX, state0, state0 + nsteps - 1);
-
-					// evaluate y-field
-					TrackNodeHistory(sel[i], &ydata[0], m_dataY, state0, state0 + nsteps - 1);
-
-					for (int j = 0; j < nsteps; ++j)
-					{
-						CPlotData& p = GetPlotWidget()->getPlotData(j);
-						p.addPoint(xdata[j], ydata[j]);
-					}
-				}
-			}
-
-			// sort the plots 
-			int nplots = GetPlotWidget()->plots();
-			for (int i = 0; i < nplots; ++i)
-			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
-			}
-		}
-	}
-	break;
+		addItemTimeScatter(sel, Post::CLASS_NODE, state0, state1);
 	}
 }
 
 //-----------------------------------------------------------------------------
 void CModelGraphWindow::addSelectedEdges()
+
 {
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFEModel();
@@ -2114,117 +2020,30 @@ void CModelGraphWindow::addSelectedFaces()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected faces
+	vector<int> sel;
+	QStringList labels;
 	int NF = mesh.Faces();
-	switch (m_xtype)
+	for (int i = 0; i < NF; ++i)
 	{
-	case 0:
-		for (int i = 0; i < NF; ++i)
+		FEFace& f = mesh.Face(i);
+		if (f.IsSelected())
 		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
-
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-		break;
-	case 1:
-		for (int i = 0; i < NF; ++i)
-		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
-			{
-				for (int j = 0; j < nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
-
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
+			sel.push_back(i);
+			labels << QString("F%1").arg(i + 1);
 		}
-		break;
-	case 2:
-		for (int i = 0; i < NF; ++i)
-		{
-			FEFace& f = mesh.Face(i);
-			if (f.IsSelected())
-			{
-				// evaluate x-field
-				TrackFaceHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
-
-				// evaluate y-field
-				TrackFaceHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	}
+	if (sel.empty()) return;
 
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("F%1").arg(i + 1));
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-			}
-		}
-		break;
-	case 3:	// time-scatter
+	if (m_xtype != 3) addItemHistories(sel, Post::CLASS_FACE, labels);
+	else
 	{
-		vector<int> sel;
-		for (int i = 0; i < NF; i++)
-		{
-			FEFace& face = mesh.Face(i);
-			if (face.IsSelected()) sel.push_back(i);
-		}
+		// time-scatter
+		addItemTimeScatter(sel, Post::CLASS_FACE, m_firstState, m_lastState);
 
-		if (sel.empty() == false)
-		{
-			int nsteps = m_lastState - m_firstState + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = m_firstState; i < m_firstState + nsteps; ++i)
-			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
-			}
-
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FEFace& face = mesh.Face(sel[i]);
-
-				// evaluate x-field
-				TrackFaceHistory(sel[i], &xdata[0], m_dataX, m_firstState, m_lastState);
-
-				// evaluate y-field
-				TrackFaceHistory(sel[i], &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				for (int j = 0; j < nsteps; ++j)
-				{
-					CPlotData& p = GetPlotWidget()->getPlotData(j);
-					p.addPoint(xdata[j], ydata[j]);
-				}
-			}
-
-			// sort the plots 
-			CPlotWidget* w = GetPlotWidget();
-			int nplots = w->plots();
-			for (int i = 0; i < nplots; ++i)
-			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
-			}
-
-			if (w->autoRangeUpdate())
-				w->fitToData(false);
-		}
-	}
-	break;
+		CPlotWidget* w = GetPlotWidget();
+		if (w->autoRangeUpdate())
+			w->fitToData(false);
 	}
 }
 
@@ -2235,170 +2054,108 @@ void CModelGraphWindow::addSelectedElems()
 	Post::FEPostModel& fem = *doc->GetFEModel();
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	int nsteps = m_lastState - m_firstState + 1;
-	vector<float> xdata(nsteps);
-	vector<float> ydata(nsteps);
-
 	// get the selected elements
+	vector<int> sel;
+	QStringList labels;
 	int NE = mesh.Elements();
-	switch (m_xtype)
+	for (int i = 0; i < NE; i++)
 	{
-	case 0:
-		for (int i = 0; i < NE; i++)
+		FEElement_& e = mesh.ElementRef(i);
+		if (e.IsSelected())
 		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = fem.GetState(j + m_firstState)->m_time;
-
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
-			}
+			sel.push_back(i);
+			labels << QString("E%1").arg(e.GetID());
 		}
-		break;
-	case 1:
-		for (int i = 0; i < NE; i++)
-		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
-			{
-				// evaluate x-field
-				for (int j = 0; j < nsteps; j++) xdata[j] = (float)j + 1.f + m_firstState;
-
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
-
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
-			}
-		}
-		break;
-	case 2:
-		for (int i = 0; i < NE; i++)
-		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected())
-			{
-				// evaluate x-field
-				TrackElementHistory(i, &xdata[0], m_dataX, m_firstState, m_lastState);
-
-				// evaluate y-field
-				TrackElementHistory(i, &ydata[0], m_dataY, m_firstState, m_lastState);
+	}
+	if (sel.empty()) return;
 
-				CPlotData* plot = nextData();
-				for (int j = 0; j < nsteps; ++j) plot->addPoint(xdata[j], ydata[j]);
-				plot->setLabel(QString("E%1").arg(e.GetID()));
-			}
-		}
-		break;
-	case 3:	// time-scatter
+	if (m_xtype != 3) addItemHistories(sel, Post::CLASS_ELEM, labels);
+	else
 	{
-		vector<int> sel;
-		for (int i = 0; i < NE; i++)
-		{
-			FEElement_& e = mesh.ElementRef(i);
-			if (e.IsSelected()) sel.push_back(i);
-		}
+		// time-scatter
+		addItemTimeScatter(sel, Post::CLASS_ELEM, m_firstState, m_lastState);
 
-		if (sel.empty() == false)
-		{
-			int nsteps = m_lastState - m_firstState + 1;
-			if (nsteps > 32) nsteps = 32;
-			for (int i = m_firstState; i < m_firstState + nsteps; ++i)
-			{
-				CPlotData* plot = nextData();
-				plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
-			}
+		CPlotWidget* w = GetPlotWidget();
+		if (w->autoRangeUpdate())
+			w->fitToData(false);
+	}
+}
 
-			for (int i = 0; i < (int)sel.size(); i++)
-			{
-				FEElement_& e = mesh.ElementRef(sel[i]);
-				if (e.IsSelected())
-				{
-					// evaluate x-field
-					TrackElementHistory(sel[i], &xdata[0], m_dataX, m_firstState, m_lastState);
+//-----------------------------------------------------------------------------
+// Add a plot for each item, using time, steps, or the x-field as x-values.
+void CModelGraphWindow::addItemHistories(const vector<int>& items, int itemClass, const QStringList& labels)
+{
+	CPostDocument* doc = GetPostDoc();
+	Post::FEPostModel& fem = *doc->GetFEModel();
 
-					// evaluate y-field
-					TrackElementHistory(sel[i], &ydata[0], m_dataY, m_firstState, m_lastState);
+	// evaluate the fields of all items at once
+	vector<float> xval, yval;
+	if (m_xtype == 2) TrackHistories(items, itemClass, xval, m_dataX, m_firstState, m_lastState);
+	int nsteps = TrackHistories(items, itemClass, yval, m_dataY, m_firstState, m_lastState);
+	if (nsteps == 0) return;
 
-					for (int j = 0; j < nsteps; ++j)
-					{
-						CPlotData& p = GetPlotWidget()->getPlotData(j);
-						p.addPoint(xdata[j], ydata[j]);
-					}
-				}
-			}
+	for (int i = 0; i < (int)items.size(); ++i)
+	{
+		const float* y = &yval[(size_t)i*nsteps];
 
-			// sort the plots 
-			CPlotWidget* w = GetPlotWidget();
-			int nplots = w->plots();
-			for (int i = 0; i < nplots; ++i)
+		CPlotData* plot = nextData();
+		plot->setLabel(labels[i]);
+		for (int j = 0; j < nsteps; ++j)
+		{
+			float x = 0.f;
+			switch (m_xtype)
 			{
-				CPlotData& data = GetPlotWidget()->getPlotData(i);
-				data.sort();
+			case 0: x = fem.GetState(j + m_firstState)->m_time; break;
+			case 1: x = (float)j + 1.f + m_firstState; break;
+			case 2: x = xval[(size_t)i*nsteps + j]; break;
 			}
-
-			if (w->autoRangeUpdate())
-				w->fitToData(false);
+			plot->addPoint(x, y[j]);
 		}
 	}
-	break;
-	}
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of a node
-void CModelGraphWindow::TrackNodeHistory(int node, float* pval, int nfield, int nmin, int nmax)
+// Add a plot for each state (up to 32) with the x- and y-values of all items.
+void CModelGraphWindow::addItemTimeScatter(const vector<int>& items, int itemClass, int state0, int state1)
 {
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFEModel();
 
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
-
-	Post::NODEDATA nd;
-	for (int n = 0; n<nn; n++)
+	int nsteps = state1 - state0 + 1;
+	if (nsteps > 32) nsteps = 32;
+	for (int i = state0; i < state0 + nsteps; ++i)
 	{
-		fem.EvaluateNode(node, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
+		CPlotData* plot = nextData();
+		plot->setLabel(QString("%1").arg(fem.GetState(i)->m_time));
 	}
-}
 
-//-----------------------------------------------------------------------------
-// Calculate time history of a edge
-void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int nmin, int nmax)
-{
-	CPostDocument* doc = GetPostDoc();
-	Post::FEPostModel& fem = *doc->GetFEModel();
+	// evaluate x- and y-fields
+	vector<float> xval, yval;
+	TrackHistories(items, itemClass, xval, m_dataX, state0, state0 + nsteps - 1);
+	nsteps = TrackHistories(items, itemClass, yval, m_dataY, state0, state0 + nsteps - 1);
 
-	int nsteps = fem.GetStates();
-	if (nmin <       0) nmin = 0;
-	if (nmax == -1) nmax = nsteps - 1;
-	if (nmax >= nsteps) nmax = nsteps - 1;
-	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		for (int j = 0; j < nsteps; ++j)
+		{
+			CPlotData& p = GetPlotWidget()->getPlotData(j);
+			p.addPoint(xval[(size_t)i*nsteps + j], yval[(size_t)i*nsteps + j]);
+		}
+	}
 
-	Post::EDGEDATA nd;
-	for (int n = 0; n<nn; n++)
+	// sort the plots 
+	int nplots = GetPlotWidget()->plots();
+	for (int i = 0; i < nplots; ++i)
 	{
-		fem.EvaluateEdge(edge, n + nmin, nfield, nd);
-		pval[n] = nd.m_val;
+		CPlotData& data = GetPlotWidget()->getPlotData(i);
+		data.sort();
 	}
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of a face
-void CModelGraphWindow::TrackFaceHistory(int nface, float* pval, int nfield, int nmin, int nmax)
+// Calculate the time histories of a list of nodes, faces, or elements. The value
+// of item i at state nmin + j is stored in val[i*nsteps + j]. Returns nsteps.
+int CModelGraphWindow::TrackHistories(const vector<int>& items, int itemClass, vector<float>& val, int nfield, int nmin, int nmax)
 {
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFEModel();
@@ -2408,19 +2165,18 @@ void CModelGraphWindow::TrackFaceHistory(int nface, float* pval, int nfield, int
 	if (nmax == -1) nmax = nsteps - 1;
 	if (nmax >= nsteps) nmax = nsteps - 1;
 	if (nmax <    nmin) nmax = nmin;
-	int nn = nmax - nmin + 1;
 
-	float data[FEFace::MAX_NODES], val;
-	for (int n = 0; n<nn; n++)
+	if (fem.EvaluateTimeHistory(items, itemClass, nfield, nmin, nmax, val) == false)
 	{
-		fem.EvaluateFace(nface, n + nmin, nfield, data, val);
-		pval[n] = val;
+		val.clear();
+		return 0;
 	}
+	return nmax - nmin + 1;
 }
 
 //-----------------------------------------------------------------------------
-// Calculate time history of an element
-void CModelGraphWindow::TrackElementHistory(int nelem, float* pval, int nfield, int nmin, int nmax)
+// Calculate time history of a edge
+void CModelGraphWindow::TrackEdgeHistory(int edge, float* pval, int nfield, int nmin, int nmax)
 {
 	CPostDocument* doc = GetPostDoc();
 	Post::FEPostModel& fem = *doc->GetFEModel();
@@ -2432,10 +2188,10 @@ void CModelGraphWindow::TrackElementHistory(int nelem, float* pval, int nfield,
 	if (nmax <    nmin) nmax = nmin;
 	int nn = nmax - nmin + 1;
 
-	float data[FEElement::MAX_NODES] = { 0.f }, val;
+	Post::EDGEDATA nd;
 	for (int n = 0; n<nn; n++)
 	{
-		fem.EvaluateElement(nelem, n + nmin, nfield, data, val);
-		pval[n] = val;
+		fem.EvaluateEdge(edge, n + nmin, nfield, nd);
+		pval[n] = nd.m_val;
 	}
 }
@@ -406,16 +406,16 @@ public:
 
 private:
 	// track mesh data
-	void TrackElementHistory(int nelem, float* pval, int nfield, int nmin = 0, int nmax = -1);
-	void TrackFaceHistory(int nface, float* pval, int nfield, int nmin = 0, int nmax = -1);
+	int TrackHistories(const vector<int>& items, int itemClass, vector<float>& val, int nfield, int nmin = 0, int nmax = -1);
 	void TrackEdgeHistory(int edge, float* pval, int nfield, int nmin = 0, int nmax = -1);
-	void TrackNodeHistory(int node, float* pval, int nfield, int nmin = 0, int nmax = -1);
 
 private:
 	void addSelectedNodes();
 	void addSelectedEdges();
 	void addSelectedFaces();
 	void addSelectedElems();
+	void addItemHistories(const vector<int>& items, int itemClass, const QStringList& labels);
+	void addItemTimeScatter(const vector<int>& items, int itemClass, int state0, int state1);
 	void addObjectData(int n);
 	void addProbeData(Post::GLProbe* probe);
 	void addRulerData(Post::GLRuler* ruler);
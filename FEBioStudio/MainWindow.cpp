@@ -64,6 +64,7 @@ SOFTWARE.*/
 #include "IconProvider.h"
 #include "Logger.h"
 #include "SSHHandler.h"
+#include "CommandManager.h"
 #include "SSHThread.h"
 #include "Encrypter.h"
 #include "DlgImportXPLT.h"
@@ -1609,6 +1610,36 @@ int CMainWindow::autoSaveInterval()
 	return ui->m_autoSaveInterval;
 }
 
+void CMainWindow::setUndoMemoryBudget(int megaBytes)
+{
+	if (megaBytes < 0) megaBytes = 0;
+	CBasicCmdManager::SetMemoryBudget((size_t)megaBytes << 20);
+}
+
+int CMainWindow::undoMemoryBudget()
+{
+	return (int)(CBasicCmdManager::GetMemoryBudget() >> 20);
+}
+
+void CMainWindow::setPostMemoryLimit(int megaBytes)
+{
+	if (megaBytes < 0) megaBytes = 0;
+	size_t bytes = (size_t)megaBytes << 20;
+	Post::FEPostModel::SetDefaultMemoryLimit(bytes);
+
+	// apply it to the models that are already open
+	for (int i = 0; i < m_DocManager->Documents(); ++i)
+	{
+		CPostDocument* doc = dynamic_cast<CPostDocument*>(m_DocManager->GetDocument(i));
+		if (doc && doc->GetFEModel()) doc->GetFEModel()->SetMemoryLimit(bytes);
+	}
+}
+
+int CMainWindow::postMemoryLimit()
+{
+	return (int)(Post::FEPostModel::GetDefaultMemoryLimit() >> 20);
+}
+
 bool CMainWindow::updaterPresent()
 {
 	return ui->m_updaterPresent;
@@ -1644,6 +1675,8 @@ void CMainWindow::writeSettings()
 	settings.setValue("theme", ui->m_theme);
 	settings.setValue("showNewDialogBox", ui->m_showNewDialog);
 	settings.setValue("autoSaveInterval", ui->m_autoSaveInterval);
+	settings.setValue("undoMemoryBudget", undoMemoryBudget());
+	settings.setValue("postMemoryLimit", postMemoryLimit());
 	settings.setValue("defaultUnits", ui->m_defaultUnits);
 	settings.setValue("bgColor1", (int)vs.m_col1);
 	settings.setValue("bgColor2", (int)vs.m_col2);
@@ -1730,6 +1763,8 @@ void CMainWindow::readSettings()
 	ui->m_theme = settings.value("theme", 0).toInt();
 	ui->m_showNewDialog = settings.value("showNewDialogBox", true).toBool();
 	ui->m_autoSaveInterval = settings.value("autoSaveInterval", 600).toInt();
+	setUndoMemoryBudget(settings.value("undoMemoryBudget", 4096).toInt());
+	setPostMemoryLimit(settings.value("postMemoryLimit", 0).toInt());
 	ui->m_defaultUnits = settings.value("defaultUnits", 0).toInt();
 	vs.m_col1 = GLColor(settings.value("bgColor1", (int)vs.m_col1).toInt());
 	vs.m_col2 = GLColor(settings.value("bgColor2", (int)vs.m_col2).toInt());
@@ -2889,6 +2924,7 @@ bool CMainWindow::ExportFEBioFile(CModelDocument* doc, const std::string& febFil
 
 	bool ret = false;
 	string err;
+	double throughput = 0.0;
 
 	try {
 		if (febioFileVersion == 0)
@@ -2897,6 +2933,7 @@ bool CMainWindow::ExportFEBioFile(CModelDocument* doc, const std::string& febFil
 			feb.SetExportSelectionsFlag(true);
 			ret = feb.Write(febFile.c_str());
 			if (ret == false) err = feb.GetErrorMessage();
+			else throughput = feb.GetXMLWriter().GetThroughput();
 		}
 		else if (febioFileVersion == 1)
 		{
@@ -2904,6 +2941,7 @@ bool CMainWindow::ExportFEBioFile(CModelDocument* doc, const std::string& febFil
 			feb.SetExportSelectionsFlag(true);
 			ret = feb.Write(febFile.c_str());
 			if (ret == false) err = feb.GetErrorMessage();
+			else throughput = feb.GetXMLWriter().GetThroughput();
 		}
 		else
 		{
@@ -2922,7 +2960,11 @@ bool CMainWindow::ExportFEBioFile(CModelDocument* doc, const std::string& febFil
 		QMessageBox::critical(this, "Run FEBio", msg);
 		AddLogEntry("FAILED\n");
 	}
-	else AddLogEntry("SUCCESS!\n");
+	else
+	{
+		AddLogEntry("SUCCESS!\n");
+		if (throughput > 0.0) AddLogEntry(QString("File written at %1 MB/s\n").arg(throughput, 0, 'f', 1));
+	}
 
 	return ret;
 }
@@ -186,6 +186,14 @@ public:
 	void setAutoSaveInterval(int interval);
 	int autoSaveInterval();
 
+	// memory budget of the undo stack (in MB, 0 = no limit)
+	void setUndoMemoryBudget(int megaBytes);
+	int undoMemoryBudget();
+
+	// memory limit of the state data of post models (in MB, 0 = no limit)
+	void setPostMemoryLimit(int megaBytes);
+	int postMemoryLimit();
+
 	// autoUpdate Check
 	bool updaterPresent();
 	bool updateAvailable();
@@ -400,6 +408,9 @@ public slots:
 	void on_actionFEBioStop_triggered();
 	void on_actionFEBioOptimize_triggered();
 	void on_actionFEBioTangent_triggered();
+	void on_actionProfiling_toggled(bool b);
+	void on_actionExportProfile_triggered();
+	void on_actionBenchmarkStreamLines_triggered();
 	void on_actionOptions_triggered();
 #ifdef _DEBUG
 	void on_actionLayerInfo_triggered();
@@ -434,6 +445,7 @@ public slots:
 	void on_actionRecordStart_triggered();
 	void on_actionRecordPause_triggered();
 	void on_actionRecordStop_triggered();
+	void on_actionRecordVolume_triggered();
 
 	// View menu actions
 	void on_actionUndoViewChange_triggered();
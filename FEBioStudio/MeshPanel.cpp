@@ -56,6 +56,7 @@ SOFTWARE.*/
 #include <MeshTools/FETetGenMesher.h>
 #include <MeshTools/FEFixMesh.h>
 #include "Commands.h"
+#include <FSCore/Profiler.h>
 
 class CSurfaceMesherProps : public CObjectProps
 {
@@ -121,8 +122,9 @@ MeshingThread::MeshingThread(GObject* po)
 
 void MeshingThread::run()
 {
+	PROFILE_SCOPE_CAT("MeshingThread::run", "mesh");
 	m_mesher = m_po->GetFEMesher();
-	if (m_mesher) m_mesher->SetErrorMessage("");
+	if (m_mesher) { m_mesher->SetErrorMessage(""); m_mesher->ResetCancel(); }
 	FEMesh* mesh = m_po->BuildMesh();
 	emit resultReady(mesh != nullptr);
 }
@@ -158,6 +160,8 @@ ModifierThread::ModifierThread(CModelDocument* doc, FEModifier* mod, GObject* po
 
 void ModifierThread::run()
 {
+	PROFILE_SCOPE_CAT("ModifierThread::run", "modifier");
+	m_mod->ResetCancel();
 	bool bsuccess = m_doc->ApplyFEModifier(*m_mod, m_po, m_pg);
 	emit resultReady(bsuccess);
 }
@@ -179,7 +183,7 @@ const char* ModifierThread::currentTask()
 
 void ModifierThread::stop()
 {
-	
+	if (m_mod) m_mod->Terminate();
 }
 
 //=============================================================================
@@ -61,3 +61,26 @@ bool CModelFileWriter::Write(const char* szfile)
 
 	return true;
 }
+
+bool CModelFileWriter::Write(std::vector<unsigned char>& buf, OArchiveDeferred* def)
+{
+	OArchive ar;
+	if (!ar.Create(buf, 0x00505256))
+	{
+		return false;
+	}
+	ar.SetDeferred(def);
+
+	try
+	{
+		m_doc->Save(ar);
+	}
+	catch (...)
+	{
+		return false;
+	}
+
+	ar.Close();
+
+	return true;
+}
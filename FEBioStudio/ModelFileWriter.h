@@ -26,8 +26,10 @@ SOFTWARE.*/
 
 #pragma once
 #include <MeshIO/FileWriter.h>
+#include <vector>
 
 class CModelDocument;
+class OArchiveDeferred;
 
 class CModelFileWriter : public FileWriter
 {
@@ -36,6 +38,11 @@ public:
 
 	bool Write(const char* szfile) override;
 
+	// Serialize the model to a memory buffer. If def is given, sections that
+	// can be written from copied data (i.e. the mesh buffers) are collected in 
+	// def and must be added with OArchiveDeferred::Finish.
+	bool Write(std::vector<unsigned char>& buf, OArchiveDeferred* def = nullptr);
+
 private:
 	CModelDocument*	m_doc;
 };
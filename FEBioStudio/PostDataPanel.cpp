@@ -42,6 +42,8 @@ SOFTWARE.*/
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QStackedWidget>
+#include <QListWidget>
+#include <QGroupBox>
 #include <QSplitter>
 #include "MainWindow.h"
 #include "Document.h"
@@ -577,6 +579,8 @@ public:
 
 	QComboBox*	conv;
 
+	QListWidget*	steps;
+
 public:
 	void setupUi(QDialog* parent)
 	{
@@ -675,12 +679,31 @@ public:
 
 		pvl->addWidget(stack);
 
+		// filters that run before the selected filter, in one pass over the states
+		QPushButton* addStep = new QPushButton("Add to Pipeline");
+		QPushButton* clearSteps = new QPushButton("Clear");
+		QHBoxLayout* pb = new QHBoxLayout;
+		pb->addWidget(addStep);
+		pb->addWidget(clearSteps);
+		pb->addStretch();
+
+		QVBoxLayout* pp = new QVBoxLayout;
+		pp->addWidget(steps = new QListWidget);
+		pp->addLayout(pb);
+		steps->setMaximumHeight(100);
+
+		QGroupBox* pipeline = new QGroupBox("Pipeline");
+		pipeline->setLayout(pp);
+		pvl->addWidget(pipeline);
+
 		QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
 		pvl->addWidget(buttonBox);
 
 		parent->setLayout(pvl);
 
 		QObject::connect(pselect, SIGNAL(currentIndexChanged(int)), stack, SLOT(setCurrentIndex(int)));
+		QObject::connect(addStep, SIGNAL(clicked()), parent, SLOT(onAddStep()));
+		QObject::connect(clearSteps, SIGNAL(clicked()), parent, SLOT(onClearSteps()));
 		QObject::connect(buttonBox, SIGNAL(accepted()), parent, SLOT(accept()));
 		QObject::connect(buttonBox, SIGNAL(rejected()), parent, SLOT(reject()));
 	}
@@ -767,41 +790,93 @@ int processScale(std::string& s, double* a, int maxa)
 	return m;
 }
 
-void CDlgFilter::accept()
+bool CDlgFilter::readStep(STEP& s)
 {
-	m_nflt = ui->pselect->currentIndex();
+	s.nflt = ui->pselect->currentIndex();
+	for (int i = 0; i < 9; ++i) s.scale[i] = 1.0;
 
-	if (m_nflt == 0)
+	if (s.nflt == 0)
 	{
-		std::string s = ui->pscale->text().toStdString();
-		int m = processScale(s, m_scale, 9);
+		std::string str = ui->pscale->text().toStdString();
+		int m = processScale(str, s.scale, 9);
 		if (m <= 0)
 		{
 			QMessageBox::critical(this, "Data Filter", "Invalid scale factor");
-			return;
+			return false;
 		}
 		if (m == 1)
 		{
-			for (int i = 1; i < 9; ++i) m_scale[i] = m_scale[0];
+			for (int i = 1; i < 9; ++i) s.scale[i] = s.scale[0];
 		}
 		else if (m != m_nsc)
 		{
 			QMessageBox::critical(this, "Data Filter", "Invalid scale factor");
-			return;
+			return false;
 		}
 	}
 
-	m_theta = ui->ptheta->text().toDouble();
-	m_iters = ui->piters->text().toInt();
+	s.theta = ui->ptheta->text().toDouble();
+	s.iters = ui->piters->text().toInt();
+
+	s.nop = ui->poperation->currentIndex();
+	s.ndata = ui->poperand->currentIndex();
 
-	m_nop = ui->poperation->currentIndex();
-	m_ndata = ui->poperand->currentIndex();
+	s.ncomp = ui->comp->currentIndex();
 
-	if ((m_nflt == 2) && (m_ndata < 0))
+	if ((s.nflt == 2) && (s.ndata < 0))
 	{
 		QMessageBox::critical(this, "Data Filter", "Invalid operand selection");
+		return false;
+	}
+
+	// Only filters that work on the values of one state can be chained. The component
+	// filter creates the new field, so it can only be the first step.
+	if (m_steps.empty() == false)
+	{
+		if ((s.nflt != 0) && (s.nflt != 1) && (s.nflt != 2))
+		{
+			QMessageBox::critical(this, "Data Filter", "Only the scale, smooth, and arithmetic filters can follow the steps of the pipeline.");
+			return false;
+		}
 	}
-	else QDialog::accept();
+	return true;
+}
+
+void CDlgFilter::onAddStep()
+{
+	STEP s;
+	if (readStep(s) == false) return;
+
+	if ((s.nflt != 0) && (s.nflt != 1) && (s.nflt != 2) && (s.nflt != 4))
+	{
+		QMessageBox::critical(this, "Data Filter", "Only the scale, smooth, arithmetic, and component filters can be added to the pipeline.");
+		return;
+	}
+
+	m_steps.push_back(s);
+	ui->steps->addItem(ui->pselect->currentText());
+}
+
+void CDlgFilter::onClearSteps()
+{
+	m_steps.clear();
+	ui->steps->clear();
+}
+
+void CDlgFilter::accept()
+{
+	STEP s;
+	if (readStep(s) == false) return;
+
+	m_nflt = s.nflt;
+	for (int i = 0; i < 9; ++i) m_scale[i] = s.scale[i];
+	m_theta = s.theta;
+	m_iters = s.iters;
+	m_nop = s.nop;
+	m_ndata = s.ndata;
+
+	m_steps.push_back(s);
+	QDialog::accept();
 }
 
 //=================================================================================================
@@ -1026,6 +1101,57 @@ void CPostDataPanel::on_DeleteButton_clicked()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Runs the steps of the filter dialog's pipeline as one filter chain, so that each
+// state runs through all the filters before the next state is processed.
+static Post::FEDataField* applyFilterPipeline(Post::FEPostModel& fem, Post::FEDataField* pdf, const std::vector<CDlgFilter::STEP>& steps, const vector<int>& dataIds, const std::string& sname, bool& bret)
+{
+	Post::DataFilterChain flt;
+
+	// the first step creates the new field
+	Post::FEDataField* newData = nullptr;
+	int n0 = 0;
+	if (steps[0].nflt == 4)
+	{
+		newData = Post::DataComponentField(fem, pdf, sname);
+		if (newData) flt.AddComponent(newData->GetFieldID(), pdf->GetFieldID(), steps[0].ncomp);
+		n0 = 1;
+	}
+	else newData = fem.CreateCachedCopy(pdf, sname.c_str());
+
+	if (newData == nullptr) { bret = false; return nullptr; }
+
+	int nfield = newData->GetFieldID();
+	for (int i = n0; i < (int)steps.size(); ++i)
+	{
+		const CDlgFilter::STEP& s = steps[i];
+		switch (s.nflt)
+		{
+		case 0:
+			if (newData->Type() == Post::DATA_VEC3F)
+				flt.AddScaleVec3(nfield, vec3d(s.scale[0], s.scale[1], s.scale[2]));
+			else
+				flt.AddScale(nfield, s.scale[0]);
+			break;
+		case 1:
+			flt.AddSmooth(nfield, s.theta, s.iters);
+			break;
+		case 2:
+		{
+			Post::FEDataFieldPtr p = fem.GetDataManager()->DataField(dataIds[s.ndata]);
+			flt.AddArithmetic(nfield, s.nop, (*p)->GetFieldID());
+		}
+		break;
+		default:
+			bret = false;
+			return newData;
+		}
+	}
+
+	bret = flt.Apply(fem);
+	return newData;
+}
+
 void CPostDataPanel::on_AddFilter_triggered()
 {
 	CMainWindow* wnd = GetMainWindow();
@@ -1073,7 +1199,11 @@ void CPostDataPanel::on_AddFilter_triggered()
 				Post::FEDataField* newData = 0;
 				bool bret = true;
 				int nfield = pdf->GetFieldID();
-				switch (dlg.m_nflt)
+				if (dlg.GetSteps().size() > 1)
+				{
+					newData = applyFilterPipeline(fem, pdf, dlg.GetSteps(), dataIds, sname, bret);
+				}
+				else switch (dlg.m_nflt)
 				{
 				case 0:
 				{
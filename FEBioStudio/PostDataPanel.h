@@ -97,6 +97,21 @@ private:
 
 class CDlgFilter : public QDialog
 {
+	Q_OBJECT
+
+public:
+	// a filter and its settings
+	struct STEP
+	{
+		int		nflt;		// filter (index in the filter list)
+		double	scale[9];	// scale factors
+		double	theta;		// smoothing factor
+		int		iters;		// smoothing iterations
+		int		nop;		// arithmetic operation
+		int		ndata;		// arithmetic operand
+		int		ncomp;		// array component
+	};
+
 public:
 	CDlgFilter(QWidget* parent);
 
@@ -116,6 +131,18 @@ public:
 	double GetScaleFactor();
 	vec3d  GetVecScaleFactor();
 
+	// The steps of the pipeline, followed by the filter that was selected when
+	// the dialog was accepted. A single step is just that filter.
+	const std::vector<STEP>& GetSteps() const { return m_steps; }
+
+private slots:
+	void onAddStep();
+	void onClearSteps();
+
+private:
+	// read the settings of the selected filter
+	bool readStep(STEP& s);
+
 public:
 	int	m_nflt;
 
@@ -129,6 +156,8 @@ private:
 	double	m_scale[9];	// scale factors
 	int		m_nsc;		// scale components
 
+	std::vector<STEP>	m_steps;	// pipeline
+
 private:
 	Ui::CDlgFilter* ui;
 };
@@ -37,6 +37,7 @@ SOFTWARE.*/
 #include <XML/XMLWriter.h>
 #include "ClassDescriptor.h"
 #include "PostSessionFile.h"
+#include "MainWindow.h"
 
 void TIMESETTINGS::Defaults()
 {
@@ -218,6 +219,7 @@ CPostDocument::CPostDocument(CMainWindow* wnd, CModelDocument* doc) : CGLDocumen
 	m_postObj = nullptr;
 	m_glm = nullptr;
 	m_sel = nullptr;
+	m_invalidState = -1;
 
 	m_binit = false;
 
@@ -358,6 +360,7 @@ void CPostDocument::SetActiveState(int n)
 	m_glm->SetCurrentTimeIndex(n);
 	m_glm->Update(false);
 	m_postObj->UpdateMesh();
+	ReportStateDataErrors();
 }
 
 int CPostDocument::GetActiveState()
@@ -482,6 +485,28 @@ void CPostDocument::UpdateFEModel(bool breset)
 
 	// update the model
 	if (m_glm) m_glm->Update(breset);
+	ReportStateDataErrors();
+}
+
+void CPostDocument::ReportStateDataErrors()
+{
+	CMainWindow* wnd = GetMainWindow();
+	int n = (m_fem ? m_fem->TakeStateDataErrors() : 0);
+	if (n > 0)
+	{
+		wnd->AddLogEntry(QString("The data of %1 state(s) could not be read back from the scratch file. These states are invalid.\n").arg(n));
+	}
+
+	// the model does not render a state whose data was lost
+	int nstate = -1;
+	if (m_glm && (m_glm->IsStateValid() == false)) nstate = GetActiveState();
+	if ((nstate >= 0) && ((n > 0) || (nstate != m_invalidState)))
+	{
+		wnd->AddLogEntry(QString("State %1 is invalid and is not shown.\n").arg(nstate + 1));
+		wnd->ShowLogPanel();
+	}
+	else if (n > 0) wnd->ShowLogPanel();
+	m_invalidState = nstate;
 }
 
 void CPostDocument::SetDataField(int n)
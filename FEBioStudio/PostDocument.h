@@ -197,6 +197,8 @@ public:
 private:
 	void ApplyPalette(const Post::CPalette& pal);
 
+	void ReportStateDataErrors();
+
 private:
 	CModelDocument*	m_doc;
 
@@ -210,6 +212,7 @@ private:
 	ModelData	m_MD;
 
 	CPostObject*	m_postObj;
+	int				m_invalidState;	// last invalid state that was reported
 
 	TIMESETTINGS m_timeSettings;
 
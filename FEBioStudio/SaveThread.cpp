@@ -0,0 +1,59 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "SaveThread.h"
+#include <QtCore/QSaveFile>
+
+CSaveThread::CSaveThread(const QString& fileName, std::vector<unsigned char>& data, OArchiveDeferred& def) : m_fileName(fileName)
+{
+	// take ownership of the data, so the caller does not need to copy it
+	m_data.swap(data);
+	m_def = std::move(def);
+	def.Clear();
+}
+
+void CSaveThread::run()
+{
+	// serialize the deferred sections
+	bool success = m_def.Finish(m_data);
+
+	QSaveFile file(m_fileName);
+	if (success) success = file.open(QIODevice::WriteOnly);
+	if (success)
+	{
+		const char* pd = (const char*)m_data.data();
+		qint64 size = (qint64)m_data.size();
+		success = (file.write(pd, size) == size);
+		if (success) success = file.commit();
+		else file.cancelWriting();
+	}
+
+	// we don't need the data anymore
+	std::vector<unsigned char>().swap(m_data);
+
+	emit resultReady(success, m_fileName);
+}
@@ -0,0 +1,56 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <QtCore/QThread>
+#include <QtCore/QString>
+#include <vector>
+#include <FSCore/Archive.h>
+
+//-----------------------------------------------------------------------------
+// Writes a serialized snapshot of a document to file on a background thread.
+// Deferred sections of the snapshot (e.g. the mesh data) are serialized on
+// the thread as well. The file is written to a temporary file first and only 
+// replaces the target when all data was written successfully.
+class CSaveThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	CSaveThread(const QString& fileName, std::vector<unsigned char>& data, OArchiveDeferred& def);
+
+	void run() override;
+
+	QString fileName() const { return m_fileName; }
+
+signals:
+	void resultReady(bool success, QString fileName);
+
+private:
+	QString						m_fileName;
+	std::vector<unsigned char>	m_data;
+	OArchiveDeferred			m_def;
+};
@@ -1247,6 +1247,7 @@ void CMainWindow::on_actionExportFEModel_triggered()
 		// export file based on selected filter
 		bool bsuccess = true;
 		QString errMsg = "(unknown)";
+		double throughput = 0.0;
 		switch (nflt)
 		{
 		case 0: // FEBio files
@@ -1272,6 +1273,7 @@ void CMainWindow::on_actionExportFEModel_triggered()
 						for (int i = 0; i < FEBIO_MAX_SECTIONS; ++i) writer.SetSectionFlag(i, dlg.m_nsection[i]);
 						bsuccess = writer.Write(szfile);
 						if (bsuccess == false) errMsg = QString::fromStdString(writer.GetErrorMessage());
+						else throughput = writer.GetXMLWriter().GetThroughput();
 					}
 					else if (dlg.m_nversion == 1)
 					{
@@ -1283,6 +1285,7 @@ void CMainWindow::on_actionExportFEModel_triggered()
 						for (int i = 0; i < FEBIO_MAX_SECTIONS; ++i) writer.SetSectionFlag(i, dlg.m_nsection[i]);
 						bsuccess = writer.Write(szfile);
 						if (bsuccess == false) errMsg = QString::fromStdString(writer.GetErrorMessage());
+						else throughput = writer.GetXMLWriter().GetThroughput();
 					}
 					else if (dlg.m_nversion == 2)
 					{
@@ -1323,7 +1326,10 @@ void CMainWindow::on_actionExportFEModel_triggered()
 			return;
 		}
 		if (bsuccess)
+		{
 			AddLogEntry(QString("success!\n"));
+			if (throughput > 0.0) AddLogEntry(QString("File written at %1 MB/s\n").arg(throughput, 0, 'f', 1));
+		}
 		else
 		{
 			AddLogEntry(QString("failed!\n"));
@@ -48,6 +48,7 @@ SOFTWARE.*/
 #include <PostGL/GLMusclePath.h>
 #include <PostGL/GLLinePlot.h>
 #include <PostLib/FEPostModel.h>
+#include <FSCore/FSThreadPool.h>
 #include <QMessageBox>
 #include <QTimer>
 #include "PostDocument.h"
@@ -922,6 +923,16 @@ void CMainWindow::onTimer()
 			}
 		}
 		ui->postToolBar->SetSpinValue(nstep + 1);
+
+		// evaluate the next states ahead of the animation (on a worker thread)
+		int nahead = FSThreadPool::Instance().Threads();
+		int ninc = (time.m_mode == MODE_FORWARD ? 1 : (time.m_mode == MODE_REVERSE ? -1 : time.m_inc));
+		Post::CGLModel* mdl = doc->GetGLModel();
+		if (mdl)
+		{
+			if (ninc > 0) mdl->Prefetch(nstep + 1, std::min(nstep + nahead, N1));
+			else mdl->Prefetch(std::max(nstep - nahead, N0), nstep - 1);
+		}
 	}
 
 	// TODO: Should I start the event before or after the view is redrawn?
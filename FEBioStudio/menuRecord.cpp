@@ -33,6 +33,11 @@ SOFTWARE.*/
 #include <PostLib/AVIAnimation.h>
 #include <PostLib/MPEGAnimation.h>
 #include <PostLib/GIFAnimation.h>
+#include <PostLib/VolRender.h>
+#include <PostLib/VolumeRayCaster.h>
+#include <QInputDialog>
+#include <QProgressDialog>
+#include "PostDocument.h"
 
 void CMainWindow::on_actionRecordNew_triggered()
 {
@@ -161,3 +166,122 @@ void CMainWindow::on_actionRecordStop_triggered()
 	}
 	else QMessageBox::information(this, "FEBio Studio", "You need to create a new video file first.");
 }
+
+void CMainWindow::on_actionRecordVolume_triggered()
+{
+	// find the first image model that has a volume render
+	CGLDocument* doc = GetGLDocument();
+	Post::CImageModel* img = nullptr;
+	Post::CVolRender* vr = nullptr;
+	for (int i = 0; doc && (vr == nullptr) && (i < doc->ImageModels()); ++i)
+	{
+		Post::CImageModel* imi = doc->GetImageModel(i);
+		for (int j = 0; j < imi->ImageRenderers(); ++j)
+		{
+			vr = dynamic_cast<Post::CVolRender*>(imi->GetImageRenderer(j));
+			if (vr) { img = imi; break; }
+		}
+	}
+
+	C3DImage* im3d = (img && img->GetImageSource() ? img->GetImageSource()->Get3DImage() : nullptr);
+	if ((vr == nullptr) || (im3d == nullptr))
+	{
+		QMessageBox::information(this, "FEBio Studio", "This requires an image with a volume render.");
+		return;
+	}
+
+	bool ok = false;
+	int frames = QInputDialog::getInt(this, "Volume Rotation", "Number of frames:", 36, 2, 3600, 1, &ok);
+	if (ok == false) return;
+
+	QStringList filters;
+	filters << "GIF files (*.gif)"
+			<< "PNG files (*.png)"
+			<< "Bitmap files (*.bmp)"
+			<< "JPG files (*.jpg)";
+#ifdef FFMPEG
+	filters << "MPG files (*.mpg)";
+#endif
+
+	QFileDialog dlg(this, "Save");
+	dlg.setNameFilters(filters);
+	dlg.setFileMode(QFileDialog::AnyFile);
+	dlg.setAcceptMode(QFileDialog::AcceptSave);
+	if (dlg.exec() == 0) return;
+
+	string sfile = dlg.selectedFiles().first().toStdString();
+	int nfilter = filters.indexOf(dlg.selectedNameFilter());
+
+	CAnimation* panim = nullptr;
+	const char* szext = nullptr;
+	switch (nfilter)
+	{
+	case 0: panim = new CGIFAnimation; szext = ".gif"; break;
+	case 1: panim = new CPNGAnimation; szext = ".png"; break;
+	case 2: panim = new CBmpAnimation; szext = ".bmp"; break;
+	case 3: panim = new CJpgAnimation; szext = ".jpg"; break;
+#ifdef FFMPEG
+	case 4: panim = new CMPEGAnimation; szext = ".mpg"; break;
+#endif
+	default:
+		return;
+	}
+	if (sfile.find('.', sfile.find_last_of("/\\") + 1) == string::npos) sfile += szext;
+
+	// the frames have the size of the graphics view
+	CGLView* glview = GetGLView();
+	int dpr = devicePixelRatio();
+	int cx = dpr*glview->width();
+	int cy = dpr*glview->height();
+
+	float fps = 10.f;
+	if (GetPostDocument()) fps = GetPostDocument()->GetTimeSettings().m_fps;
+	if (fps == 0.f) fps = 10.f;
+
+	if (panim->Create(sfile.c_str(), cx, cy, fps) == 0)
+	{
+		delete panim;
+		QMessageBox::critical(this, "FEBio Studio", "Failed creating animation stream.");
+		return;
+	}
+
+	// the frames are ray cast on the CPU, so this does not use (or disturb) the GL view
+	BOX box = img->GetBoundingBox();
+	Byte lut[256][4];
+	vr->GetTransferFunction(lut);
+
+	Post::CVolumeRayCaster rc;
+	rc.SetImage(im3d, box);
+	rc.SetTransferFunction(lut);
+
+	// orbit around the z-axis, looking slightly down at the center of the box
+	const double fov = 30.0;
+	const double elev = 20.0 * PI / 180.0;
+	vec3d c = box.Center();
+	double R = box.Radius();
+	if (R <= 0.0) R = 1.0;
+	double dist = R / sin(0.5 * fov * PI / 180.0);
+
+	QProgressDialog prg("Rendering volume animation ...", "Cancel", 0, frames, this);
+	prg.setWindowModality(Qt::WindowModal);
+	prg.setMinimumDuration(0);
+
+	bool bret = true;
+	for (int i = 0; i < frames; ++i)
+	{
+		prg.setValue(i);
+		if (prg.wasCanceled()) break;
+
+		double a = 2.0 * PI * i / frames;
+		vec3d eye = c + vec3d(cos(elev)*cos(a), cos(elev)*sin(a), sin(elev)) * dist;
+		rc.SetCamera(eye, c, vec3d(0, 0, 1), fov);
+
+		if (rc.RenderFrame(*panim, cx, cy) == false) { bret = false; break; }
+	}
+	prg.setValue(frames);
+
+	panim->Close();
+	delete panim;
+
+	if (bret == false) QMessageBox::critical(this, "FEBio Studio", "Failed writing animation frame.");
+}
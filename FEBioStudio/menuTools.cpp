@@ -34,6 +34,9 @@ SOFTWARE.*/
 #include "DlgSettings.h"
 #include "DlgMeshDiagnostics.h"
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QApplication>
+#include <FSCore/Profiler.h>
 #include <GeomLib/MeshLayer.h>
 #include <GeomLib/GObject.h>
 #include <MeshTools/GModel.h>
@@ -43,6 +46,7 @@ SOFTWARE.*/
 #include <PostLib/FEKinemat.h>
 #include <PostLib/FELSDYNAimport.h>
 #include <PostGL/GLModel.h>
+#include <PostGL/GLStreamLinePlot.h>
 
 void CMainWindow::on_actionCurveEditor_triggered()
 {
@@ -232,6 +236,55 @@ void CMainWindow::on_actionPlotMix_triggered()
 	dlg.exec();
 }
 
+void CMainWindow::on_actionProfiling_toggled(bool b)
+{
+	if (b)
+	{
+		CProfiler::Clear();
+		CProfiler::Enable(true);
+		AddLogEntry("Profiling started.\n");
+		return;
+	}
+
+	CProfiler::Enable(false);
+
+	// dump the per-operation timings
+	std::vector<FSProfileStats> stats = CProfiler::GetSummary();
+	AddLogEntry("\nProfile summary (times in ms):\n");
+	AddLogEntry(QString("%1 %2 %3 %4 %5 %6\n").arg("operation", -40).arg("calls", 8).arg("total", 12).arg("mean", 12).arg("min", 12).arg("max", 12));
+	for (const FSProfileStats& s : stats)
+	{
+		QString name = QString::fromStdString(s.name);
+		double mean = s.total / s.count;
+		AddLogEntry(QString("%1 %2 %3 %4 %5 %6\n").arg(name, -40).arg(s.count, 8).arg(s.total, 12, 'f', 3).arg(mean, 12, 'f', 3).arg(s.min, 12, 'f', 3).arg(s.max, 12, 'f', 3));
+	}
+	ShowLogPanel();
+}
+
+void CMainWindow::on_actionExportProfile_triggered()
+{
+	QString fileName = QFileDialog::getSaveFileName(this, "Export Profile", "", "Chrome trace (*.json)");
+	if (fileName.isEmpty()) return;
+
+	if (CProfiler::ExportChromeTrace(fileName.toStdString().c_str()) == false)
+	{
+		QMessageBox::critical(this, "FEBio Studio", QString("Failed to write profile to:\n%1").arg(fileName));
+	}
+}
+
+void CMainWindow::on_actionBenchmarkStreamLines_triggered()
+{
+	// trace 100k seeds through a swirling flow on a 64^3 hex grid
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	Post::StreamLineBenchmark b = Post::BenchmarkStreamLines(100000, 64);
+	QApplication::restoreOverrideCursor();
+
+	AddLogEntry(QString("Stream line benchmark: %1 elements, %2 seeds\n").arg(b.elems).arg(b.seeds));
+	AddLogEntry(QString("  setup : %1 s\n").arg(b.setupTime, 0, 'f', 3));
+	AddLogEntry(QString("  trace : %1 s (%2 lines, %3 points)\n").arg(b.traceTime, 0, 'f', 3).arg(b.lines).arg(b.points));
+	ShowLogPanel();
+}
+
 void CMainWindow::on_actionOptions_triggered()
 {
 	CDlgSettings dlg(this);
@@ -488,6 +488,9 @@ public:
 		QAction* actionFEBioStop = addAction("Stop FEBio", "actionFEBioStop");
 		QAction* actionFEBioOptimize = addAction("Generate optimization file ...", "actionFEBioOptimize");
 		QAction* actionFEBioTangent  = addAction("Generate tangent diagnostic ...", "actionFEBioTangent");
+		QAction* actionProfiling = addAction("Record Profile", "actionProfiling", QString(), true);
+		QAction* actionExportProfile = addAction("Export Profile ...", "actionExportProfile");
+		QAction* actionBenchmarkStreamLines = addAction("Benchmark Stream Lines", "actionBenchmarkStreamLines");
 		actionOptions = addAction("Options ...", "actionOptions"); actionOptions->setShortcut(Qt::Key_F12);
 
 #ifdef _DEBUG
@@ -538,11 +541,13 @@ public:
 		QAction* actionRecordStart = addAction("Start", "actionRecordStart"); actionRecordStart->setShortcut(Qt::Key_F6);
 		QAction* actionRecordPause = addAction("Pause", "actionRecordPause"); actionRecordPause->setShortcut(Qt::Key_F7);
 		QAction* actionRecordStop = addAction("Stop", "actionRecordStop"); actionRecordStop->setShortcut(Qt::Key_F8);
+		QAction* actionRecordVolume = addAction("Volume Rotation ...", "actionRecordVolume");
 
 		actionRecordNew->setWhatsThis("<font color=\"black\">Click this to open a file dialog box and create a new animation file.");
 		actionRecordStart->setWhatsThis("<font color=\"black\">Click to start recording an animation. You must create an animation file first before you can start recording.");
 		actionRecordPause->setWhatsThis("<font color=\"black\">Click this pause the current recording");
 		actionRecordStop->setWhatsThis("<font color=\"black\">Click this to stop the recording. This will finalize and close the animation file as well.");
+		actionRecordVolume->setWhatsThis("<font color=\"black\">Renders an animation that rotates around the volume rendering of an image. The frames are rendered offscreen, so the size of the animation does not depend on the graphics view.");
 
 
 		// --- View menu ---
@@ -806,6 +811,8 @@ public:
 		menuRecord->addAction(actionRecordStart);
 		menuRecord->addAction(actionRecordPause);
 		menuRecord->addAction(actionRecordStop);
+		menuRecord->addSeparator();
+		menuRecord->addAction(actionRecordVolume);
 
 		// Tools menu
 		menuBar->addAction(menuTools->menuAction());
@@ -816,6 +823,11 @@ public:
 		menuTools->addAction(actionElasticityConvertor);
 		menuTools->addAction(actionKinemat);
 		menuTools->addAction(actionPlotMix);
+		menuTools->addSeparator();
+		menuTools->addAction(actionProfiling);
+		menuTools->addAction(actionExportProfile);
+		menuTools->addAction(actionBenchmarkStreamLines);
+		menuTools->addSeparator();
 		menuTools->addAction(actionOptions);
 #ifdef _DEBUG
 		menuTools->addAction(actionLayerInfo);
@@ -28,10 +28,23 @@ SOFTWARE.*/
 #include "Archive.h"
 #include <sstream>
 #include "zlib.h"
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 static z_stream strm;
 
 using std::stringstream;
 
+#ifdef WIN32
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#else
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
 //=============================================================================
 IOMemBuffer::IOMemBuffer()
 {
@@ -85,6 +98,8 @@ IOFileStream::IOFileStream(FILE* fp, bool owner)
 	m_buf = new unsigned char[m_bufsize];
 	m_pout = new unsigned char[m_bufsize];
 	m_ncompress = 0;
+	m_nflushed = 0;
+	m_pmem = nullptr;
 	m_fp = fp;
 	m_fileOwner = owner;
 }
@@ -114,9 +129,18 @@ bool IOFileStream::Append(const char* szfile)
 bool IOFileStream::Create(const char* szfile)
 {
 	m_fp = fopen(szfile, "wb");
+	m_nflushed = 0;
 	return (m_fp != 0);
 }
 
+bool IOFileStream::Create(std::vector<unsigned char>& buf)
+{
+	buf.clear();
+	m_pmem = &buf;
+	m_nflushed = 0;
+	return true;
+}
+
 void IOFileStream::Close()
 {
 	if (m_fp)
@@ -124,7 +148,9 @@ void IOFileStream::Close()
 		Flush();
 		if(m_fileOwner)	fclose(m_fp);
 	}
+	else if (m_pmem) Flush();
 	m_fp = 0;
+	m_pmem = nullptr;
 }
 
 void IOFileStream::BeginStreaming()
@@ -165,9 +191,9 @@ void IOFileStream::EndStreaming()
 	}
 }
 
-void IOFileStream::Write(void* pd, size_t Size, size_t Count)
+void IOFileStream::Write(const void* pd, size_t Size, size_t Count)
 {
-	unsigned char* pdata = (unsigned char*)pd;
+	const unsigned char* pdata = (const unsigned char*)pd;
 	size_t nsize = Size*Count;
 	while (nsize > 0)
 	{
@@ -210,6 +236,8 @@ void IOFileStream::Flush()
 	else
 	{
 		if (m_fp) fwrite(m_buf, m_current, 1, m_fp);
+		else if (m_pmem) m_pmem->insert(m_pmem->end(), m_buf, m_buf + m_current);
+		m_nflushed += m_current;
 	}
 
 	// flush the file
@@ -219,6 +247,34 @@ void IOFileStream::Flush()
 	m_current = 0;
 }
 
+void IOFileStream::Patch(int64_t pos, const void* pd, size_t n)
+{
+	assert(m_ncompress == 0);
+	assert(pos + (int64_t)n <= GetPosition());
+
+	// if the data is still in the buffer we can just overwrite it there
+	if (pos >= m_nflushed)
+	{
+		memcpy(m_buf + (pos - m_nflushed), pd, n);
+		return;
+	}
+
+	// the data may straddle the buffer, so flush it first
+	Flush();
+
+	// if we're writing to memory, we can patch the memory buffer
+	if (m_pmem)
+	{
+		memcpy(m_pmem->data() + pos, pd, n);
+		return;
+	}
+
+	// otherwise, write it to the file and move back to the end
+	fseek64(m_fp, pos, SEEK_SET);
+	fwrite(pd, n, 1, m_fp);
+	fseek64(m_fp, 0, SEEK_END);
+}
+
 size_t IOFileStream::read(void* pd, size_t Size, size_t Count)
 {
 	return fread(pd, Size, Count, m_fp);
@@ -247,6 +303,10 @@ IArchive::IArchive()
 	m_delfp = false;
 	m_nversion = 0;
 	m_fp = 0;
+	m_pbeg = m_pend = m_pcur = nullptr;
+	m_pmap = nullptr;
+	m_hmap = nullptr;
+	m_mapSize = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -258,10 +318,11 @@ IArchive::~IArchive()
 //-----------------------------------------------------------------------------
 void IArchive::Close()
 {
-	while (m_Chunk.empty() == false) CloseChunk();
+	m_Chunk.clear();
+	UnmapFile();
 
 	// reset pointers
-	if (m_delfp) fclose(m_fp);
+	if (m_delfp && m_fp) fclose(m_fp);
 	m_fp = 0;
 	m_bend = true;
 	m_bswap = false;
@@ -288,9 +349,16 @@ bool IArchive::Open(FILE* fp, unsigned int signature)
 	// store the file pointer
 	m_fp = fp;
 
+	// get access to the file data
+	if (MapFile() == false)
+	{
+		Close();
+		return false;
+	}
+
 	// read the master tag
 	unsigned int ntag;
-	if (fread(&ntag, sizeof(int), 1, m_fp) != 1) 
+	if (read_bytes(&ntag, sizeof(int)) != IO_OK)
 	{
 		Close();
 		return false;
@@ -317,6 +385,95 @@ bool IArchive::Open(FILE* fp, unsigned int signature)
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Map the file into memory. Reading starts at the current file position.
+bool IArchive::MapFile()
+{
+	UnmapFile();
+
+	int64_t pos = (int64_t)ftell(m_fp);
+	if (pos < 0) pos = 0;
+
+#ifdef WIN32
+	HANDLE hf = (HANDLE)_get_osfhandle(_fileno(m_fp));
+	LARGE_INTEGER size;
+	if ((hf != INVALID_HANDLE_VALUE) && GetFileSizeEx(hf, &size) && (size.QuadPart > 0))
+	{
+		HANDLE hm = CreateFileMapping(hf, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (hm)
+		{
+			void* p = MapViewOfFile(hm, FILE_MAP_READ, 0, 0, 0);
+			if (p)
+			{
+				m_pmap = p;
+				m_hmap = hm;
+				m_mapSize = (size_t)size.QuadPart;
+			}
+			else CloseHandle(hm);
+		}
+	}
+#else
+	struct stat st;
+	int fd = fileno(m_fp);
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	{
+		void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			m_pmap = p;
+			m_mapSize = st.st_size;
+		}
+	}
+#endif
+
+	size_t size = 0;
+	if (m_pmap)
+	{
+		m_pbeg = (const char*)m_pmap;
+		size = m_mapSize;
+	}
+	else
+	{
+		// we could not map the file, so just read it in one go
+		fseek64(m_fp, 0, SEEK_END);
+		int64_t n = (int64_t)ftell(m_fp);
+		if (n < 0) return false;
+		fseek64(m_fp, 0, SEEK_SET);
+		m_data.resize((size_t)n);
+		if ((n > 0) && (fread(&m_data[0], 1, (size_t)n, m_fp) != (size_t)n)) { m_data.clear(); return false; }
+		m_pbeg = m_data.data();
+		size = (size_t)n;
+	}
+
+	if ((size_t)pos > size) pos = size;
+	m_pend = m_pbeg + size;
+	m_pcur = m_pbeg + pos;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void IArchive::UnmapFile()
+{
+	if (m_pmap)
+	{
+#ifdef WIN32
+		UnmapViewOfFile(m_pmap);
+		CloseHandle((HANDLE)m_hmap);
+#else
+		munmap(m_pmap, m_mapSize);
+#endif
+	}
+	m_pmap = nullptr;
+	m_hmap = nullptr;
+	m_mapSize = 0;
+
+	std::vector<char>().swap(m_data);
+	m_pbeg = m_pend = m_pcur = nullptr;
+}
+
+//-----------------------------------------------------------------------------
 int IArchive::OpenChunk()
 {
 	// see if the end flag was set
@@ -327,47 +484,30 @@ int IArchive::OpenChunk()
 		return IO_END;
 	}
 
-	// create a new chunk
-	CHUNK* pc = new CHUNK;
-
-	// read the chunk ID
-	read(pc->id);
-
-	// read the chunk size
-	read(pc->nsize);
-
-	if (pc->nsize == 0) m_bend = true;
+	// read the chunk ID and size
+	CHUNK c;
+	unsigned int nsize = 0;
+	if ((read(c.id) != IO_OK) || (read(nsize) != IO_OK)) return IO_ERROR;
+	if (nsize == 0) m_bend = true;
 
-	// record the position
-	pc->lpos = ftell(m_fp);
+	// record the extent of the chunk data
+	c.pbeg = m_pcur;
+	c.pend = ((size_t)(m_pend - m_pcur) < nsize ? m_pend : m_pcur + nsize);
 
 	// add it to the stack
-	m_Chunk.push(pc);
+	m_Chunk.push_back(c);
 
 	return IO_OK;
 }
 
+//-----------------------------------------------------------------------------
 void IArchive::CloseChunk()
 {
 	// pop the last chunk
-	CHUNK* pc = m_Chunk.top(); m_Chunk.pop();
-
-	// get the current file position
-	long lpos = ftell(m_fp);
-
-	// calculate the offset to the end of the chunk
-	int noff = pc->nsize - (lpos - pc->lpos);
+	CHUNK c = m_Chunk.back(); m_Chunk.pop_back();
 
 	// skip any remaining part in the chunk
-	// I wonder if this can really happen
-	if (noff != 0)
-	{
-		fseek(m_fp, noff, SEEK_CUR);
-		lpos = ftell(m_fp);
-	}
-
-	// delete this chunk
-	delete pc;
+	m_pcur = c.pend;
 
 	// take a peek at the parent
 	if (m_Chunk.empty())
@@ -377,39 +517,41 @@ void IArchive::CloseChunk()
 	}
 	else
 	{
-		pc = m_Chunk.top();
-		int noff = pc->nsize - (lpos - pc->lpos);
-		if (noff == 0) m_bend = true;
+		if (m_pcur >= m_Chunk.back().pend) m_bend = true;
 	}
 }
 
+//-----------------------------------------------------------------------------
 unsigned int IArchive::GetChunkID()
 {
-	CHUNK* pc = m_Chunk.top();
-	assert(pc);
-	return pc->id;
+	assert(m_Chunk.empty() == false);
+	return m_Chunk.back().id;
 }
 
-IArchive::IOResult IArchive::read(std::vector<int>& v)
+//-----------------------------------------------------------------------------
+unsigned int IArchive::GetChunkSize()
 {
-	CHUNK* pc = m_Chunk.top();
+	assert(m_Chunk.empty() == false);
+	const CHUNK& c = m_Chunk.back();
+	return (unsigned int)(c.pend - c.pbeg);
+}
 
-	int nsize = pc->nsize / sizeof(int);
+//-----------------------------------------------------------------------------
+IArchive::IOResult IArchive::read(std::vector<int>& v)
+{
+	int nsize = GetChunkSize() / sizeof(int);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(int), nsize, m_fp);
-	if (nread != nsize) return IO_ERROR;
-	return IO_OK;
+	if (nsize == 0) return IO_OK;
+	return read(&v[0], nsize);
 }
 
+//-----------------------------------------------------------------------------
 IArchive::IOResult IArchive::read(std::vector<double>& v)
 {
-	CHUNK* pc = m_Chunk.top();
-
-	int nsize = pc->nsize / sizeof(double);
+	int nsize = GetChunkSize() / sizeof(double);
 	v.resize(nsize);
-	int nread = (int)fread(&v[0], sizeof(double), nsize, m_fp);
-	if (nread != nsize) return IO_ERROR;
-	return IO_OK;
+	if (nsize == 0) return IO_OK;
+	return read(&v[0], nsize);
 }
 
 void IArchive::log(const char* sz, ...)
@@ -445,8 +587,7 @@ std::string IArchive::GetLog() const
 
 OArchive::OArchive()
 {
-	m_pRoot = 0;
-	m_pChunk = 0;
+	m_def = nullptr;
 }
 
 OArchive::~OArchive()
@@ -458,13 +599,14 @@ void OArchive::Close()
 {
 	if (m_fp.IsValid())
 	{
-		m_pRoot->Write(&m_fp);
+		// this closes the root chunk
+		while (m_chunkPos.empty() == false) EndChunk();
 		m_fp.Close();
 	}
 
-	delete m_pRoot;
-	m_pRoot = 0;
-	m_pChunk = 0;
+	while (m_chunkPos.empty() == false) m_chunkPos.pop();
+	while (m_chunkDef.empty() == false) m_chunkDef.pop();
+	m_def = nullptr;
 }
 
 bool OArchive::Create(const char* szfile, unsigned int signature)
@@ -475,26 +617,117 @@ bool OArchive::Create(const char* szfile, unsigned int signature)
 	// write the master tag 
 	m_fp.Write(&signature, sizeof(int), 1);
 
-	assert(m_pRoot == 0);
-	m_pRoot = new OBranch(0);
-	m_pChunk = m_pRoot;
+	// open the root chunk
+	assert(m_chunkPos.empty());
+	BeginChunk(0);
 
 	return true;
 }
 
-void OArchive::BeginChunk(unsigned int id)
+bool OArchive::Create(std::vector<unsigned char>& buf, unsigned int signature)
 {
-	// create a new branch
-	OBranch* pbranch = new OBranch(id);
+	if (m_fp.Create(buf) == false) return false;
+
+	// write the master tag 
+	m_fp.Write(&signature, sizeof(int), 1);
 
-	// attach it to the current branch
-	m_pChunk->AddChild(pbranch);
+	// open the root chunk
+	assert(m_chunkPos.empty());
+	BeginChunk(0);
 
-	// move the current branch pointer
-	m_pChunk = pbranch;
+	return true;
+}
+
+bool OArchive::CreateSection(std::vector<unsigned char>& buf)
+{
+	return m_fp.Create(buf);
+}
+
+void OArchive::BeginChunk(unsigned int id)
+{
+	// write the chunk header with a placeholder for the size,
+	// which will be filled in when the chunk is closed.
+	m_fp.Write(&id, sizeof(unsigned int), 1);
+	m_chunkPos.push(m_fp.GetPosition());
+	m_chunkDef.push(m_def ? m_def->m_sec.size() : 0);
+	unsigned int nsize = 0;
+	m_fp.Write(&nsize, sizeof(unsigned int), 1);
 }
 
 void OArchive::EndChunk()
 {
-	m_pChunk = m_pChunk->GetParent();
+	int64_t pos = m_chunkPos.top(); m_chunkPos.pop();
+	size_t ndef = m_chunkDef.top(); m_chunkDef.pop();
+	unsigned int nsize = (unsigned int)(m_fp.GetPosition() - pos - sizeof(unsigned int));
+	m_fp.Patch(pos, &nsize, sizeof(unsigned int));
+
+	// the size of deferred sections inside this chunk is added when they are written
+	if (m_def && (m_def->m_sec.size() > ndef))
+	{
+		OArchiveDeferred::SIZEFIX fix = { pos, ndef, m_def->m_sec.size() };
+		m_def->m_fix.push_back(fix);
+	}
+}
+
+void OArchive::WriteDeferred(std::function<void(OArchive&)> f)
+{
+	if (m_def == nullptr) { f(*this); return; }
+
+	OArchiveDeferred::SECTION sec;
+	sec.pos = m_fp.GetPosition();
+	sec.f = std::move(f);
+	m_def->m_sec.push_back(std::move(sec));
+}
+
+//////////////////////////////////////////////////////////////////////
+// OArchiveDeferred
+//////////////////////////////////////////////////////////////////////
+
+bool OArchiveDeferred::Finish(std::vector<unsigned char>& buf)
+{
+	if (m_sec.empty()) return true;
+
+	// write the sections
+	size_t total = 0;
+	for (SECTION& sec : m_sec)
+	{
+		if ((sec.pos < 0) || (sec.pos > (int64_t)buf.size())) return false;
+
+		OArchive ar;
+		ar.CreateSection(sec.data);
+		sec.f(ar);
+		ar.Close();
+		sec.f = nullptr;
+		total += sec.data.size();
+	}
+
+	// fix the sizes of the chunks that contain sections
+	for (SIZEFIX& fix : m_fix)
+	{
+		size_t n = 0;
+		for (size_t i = fix.first; i < fix.last; ++i) n += m_sec[i].data.size();
+
+		unsigned int nsize;
+		memcpy(&nsize, buf.data() + fix.pos, sizeof(unsigned int));
+		nsize += (unsigned int)n;
+		memcpy(buf.data() + fix.pos, &nsize, sizeof(unsigned int));
+	}
+
+	// splice the sections into the archive
+	std::vector<unsigned char> out;
+	out.reserve(buf.size() + total);
+	int64_t pos = 0;
+	for (SECTION& sec : m_sec)
+	{
+		out.insert(out.end(), buf.begin() + pos, buf.begin() + sec.pos);
+		out.insert(out.end(), sec.data.begin(), sec.data.end());
+		std::vector<unsigned char>().swap(sec.data);
+		pos = sec.pos;
+	}
+	out.insert(out.end(), buf.begin() + pos, buf.end());
+	buf.swap(out);
+
+	Clear();
+
+	return true;
 }
@@ -27,6 +27,8 @@ SOFTWARE.*/
 #pragma once
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <vector>
 #include <MathLib/math3d.h>
 #include <MathLib/mat3d.h>
 #include "color.h"
@@ -34,6 +36,7 @@ SOFTWARE.*/
 #include <stack>
 #include <list>
 #include <string>
+#include <functional>
 #include "memtool.h"
 //using namespace std;
 
@@ -71,14 +74,21 @@ public:
 	~IOFileStream();
 
 	bool Create(const char* szfile);
+	bool Create(std::vector<unsigned char>& buf);
 	bool Open(const char* szfile);
 	bool Append(const char* szfile);
 	void Close();
 
-	void Write(void* pd, size_t Size, size_t Count);
+	void Write(const void* pd, size_t Size, size_t Count);
 
 	void Flush();
 
+	// position in the output stream, including data that is still buffered
+	int64_t GetPosition() const { return m_nflushed + (int64_t)m_current; }
+
+	// overwrite data that was already written (only for uncompressed output)
+	void Patch(int64_t pos, const void* pd, size_t n);
+
 	// \todo temporary reading functions. Needs to be replaced with buffered functions
 	size_t read(void* pd, size_t Size, size_t Count);
 	long tell();
@@ -91,7 +101,7 @@ public:
 
 	FILE* FilePtr() { return m_fp; }
 
-	bool IsValid() { return (m_fp != nullptr); }
+	bool IsValid() { return (m_fp != nullptr) || (m_pmem != nullptr); }
 
 private:
 	FILE*	m_fp;
@@ -101,18 +111,23 @@ private:
 	unsigned char*	m_buf;	//!< buffer
 	unsigned char*	m_pout;	//!< temp buffer when writing
 	int		m_ncompress;	//!< compression level
+	int64_t	m_nflushed;		//!< nr of bytes flushed to file
+	std::vector<unsigned char>*	m_pmem;	//!< memory buffer that is written to instead of a file
 };
 
 //----------------------
 // Input archive
+// The file is memory-mapped (or read in one go when that fails) so that 
+// opening and closing chunks is just pointer arithmetic and arrays are 
+// copied from the mapped data in bulk.
 
 class IArchive
 {
 	struct CHUNK
 	{
 		unsigned int	id;		// chunk ID
-		long			lpos;	// file position of size field
-		unsigned int	nsize;	// size of chunk
+		const char*		pbeg;	// start of chunk data
+		const char*		pend;	// end of chunk data
 	};
 
 public:
@@ -138,29 +153,32 @@ public:
 	// Get the current chunk ID
 	unsigned int GetChunkID();
 
+	// Get the size of the current chunk
+	unsigned int GetChunkSize();
+
 	// Close a chunk
 	virtual void CloseChunk();
 
 	// input functions
-	IOResult read(char&   c) { int nr = (int) fread(&c, sizeof(char  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(int&    n) { int nr = (int) fread(&n, sizeof(int   ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
-	IOResult read(bool&   b) { int nr = (int) fread(&b, sizeof(bool  ), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
-	IOResult read(float&  f) { int nr = (int) fread(&f, sizeof(float ), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(f); return IO_OK; }
-	IOResult read(double& g) { int nr = (int) fread(&g, sizeof(double), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(g); return IO_OK; }
+	IOResult read(char&   c) { return read_bytes(&c, sizeof(char)); }
+	IOResult read(int&    n) { return read_data(&n, 1); }
+	IOResult read(bool&   b) { return read_bytes(&b, sizeof(bool)); }
+	IOResult read(float&  f) { return read_data(&f, 1); }
+	IOResult read(double& g) { return read_data(&g, 1); }
 
-	IOResult read(unsigned int& n) { size_t nr = fread(&n, sizeof(unsigned int), 1, m_fp); if (nr != 1) return IO_ERROR; if (m_bswap) bswap(n); return IO_OK; }
+	IOResult read(unsigned int& n) { return read_data(&n, 1); }
 
 
-	IOResult read(int*    pi, int n) { int nr = (int) fread(pi, sizeof(int   ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pi, n); return IO_OK; }
-	IOResult read(bool*   pb, int n) { int nr = (int) fread(pb, sizeof(bool  ), n, m_fp); if (nr != n) return IO_ERROR; return IO_OK; }
-	IOResult read(float*  pf, int n) { int nr = (int) fread(pf, sizeof(float ), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pf, n); return IO_OK; }
-	IOResult read(double* pg, int n) { int nr = (int) fread(pg, sizeof(double), n, m_fp); if (nr != n) return IO_ERROR; if (m_bswap) bswapv(pg, n); return IO_OK; }
-	IOResult read(vec3d*  pv, int n) { for (int i=0; i<n; ++i) read(pv[i]); return IO_OK; }
+	IOResult read(int*    pi, int n) { return read_data(pi, n); }
+	IOResult read(bool*   pb, int n) { if (n < 0) return IO_ERROR; return read_bytes(pb, sizeof(bool)*n); }
+	IOResult read(float*  pf, int n) { return read_data(pf, n); }
+	IOResult read(double* pg, int n) { return read_data(pg, n); }
+	IOResult read(vec3d*  pv, int n) { return read_data(&(pv[0].x), 3*n); }
 
-	IOResult read(vec3d& r) { read(r.x); read(r.y); read(r.z); return IO_OK; }
+	IOResult read(vec3d& r) { return read_data(&r.x, 3); }
 	IOResult read(vec2i& r) { read(r.x); read(r.y); return IO_OK; }
 	IOResult read(quatd& q) { read(q.x); read(q.y); read(q.z); read(q.w); return IO_OK; }
-	IOResult read(GLColor& c) { int nr = (int) fread(&c, sizeof(GLColor), 1, m_fp); if (nr != 1) return IO_ERROR; return IO_OK; }
+	IOResult read(GLColor& c) { return read_bytes(&c, sizeof(GLColor)); }
 
 	IOResult read(mat3d& a) 
 	{ 
@@ -173,9 +191,9 @@ public:
 	IOResult read(char* sz)
 	{
 		IOResult ret;
-		int l, nr;
+		int l;
 		ret = read(l); if (ret != IO_OK) return ret;
-		nr = (int) fread(sz, 1, l, m_fp); if (nr != l) return IO_ERROR;
+		ret = read_bytes(sz, l); if (ret != IO_OK) return ret;
 		sz[l] = 0;
 		return IO_OK;
 	}
@@ -187,11 +205,9 @@ public:
 
 		if (l > 0)
 		{
-			char* tmp = new char[l+1];
-			int nr = (int) fread(tmp, 1, l, m_fp); if (nr != l) return IO_ERROR;
-			tmp[l] = 0;
-			s = tmp;
-			delete [] tmp;
+			if (m_pend - m_pcur < l) return IO_ERROR;
+			s.assign(m_pcur, l);
+			m_pcur += l;
 		}
 		else s.clear();
 		return IO_OK;
@@ -200,9 +216,6 @@ public:
 	IOResult read(std::vector<int>& v);
 	IOResult read(std::vector<double>& v);
 
-	// conversion to FILE* 
-	operator FILE* () { return m_fp; }
-
 	void SetVersion(unsigned int n) { m_nversion = n; }
 	unsigned int Version() { return m_nversion; }
 
@@ -212,6 +225,25 @@ public:
 private:
 	bool Load(const char* szfile) { return false; }
 
+	bool MapFile();
+	void UnmapFile();
+
+	IOResult read_bytes(void* pd, size_t nsize)
+	{
+		if ((size_t)(m_pend - m_pcur) < nsize) return IO_ERROR;
+		memcpy(pd, m_pcur, nsize);
+		m_pcur += nsize;
+		return IO_OK;
+	}
+
+	template <typename T> IOResult read_data(T* pd, int n)
+	{
+		if (n < 0) return IO_ERROR;
+		IOResult ret = read_bytes(pd, sizeof(T)*n);
+		if ((ret == IO_OK) && m_bswap) bswapv(pd, n);
+		return ret;
+	}
+
 protected:
 	bool	m_bswap;	// swap data when reading
 	bool	m_bend;		// chunk end flag
@@ -219,175 +251,70 @@ protected:
 
 	unsigned int	m_nversion;	// stores the version nr of the file being loaded
 
-	stack<CHUNK*>	m_Chunk;
+	std::vector<CHUNK>	m_Chunk;	// the open chunks
 
 	FILE*	m_fp;		// the file pointer
 
+	// file data
+	const char*	m_pbeg;	// start of archive data
+	const char*	m_pend;	// end of archive data
+	const char*	m_pcur;	// current read position
+	void*		m_pmap;	// mapped view of the file (or null if not mapped)
+	void*		m_hmap;	// mapping handle (Windows only)
+	size_t		m_mapSize;	// size of mapped view
+	std::vector<char>	m_data;	// file data when the file could not be mapped
+
 protected:
 	std::string		m_log;
 };
 
 //----------------------
 // Output archive
+// Chunks are written to the file as they are created. The size field of a
+// branch chunk is written as a placeholder and patched when the chunk ends,
+// so no copy of the data is kept in memory.
+class OArchive;
 
-class OBranch;
-
-class OChunk
-{
-public:
-	OChunk(unsigned int nid) { m_nID = nid; m_pParent = 0; }
-	virtual ~OChunk() {}
-
-	unsigned int GetID() { return m_nID; }
-
-	virtual void Write(IOFileStream* fp) = 0;
-	virtual int Size() = 0;
-
-	void SetParent(OBranch* pparent) { m_pParent = pparent; }
-	OBranch* GetParent() { return m_pParent; }
-
-protected:
-	int			m_nID;
-	OBranch*	m_pParent;
-};
-
-class OBranch : public OChunk
-{
-public:
-	OBranch(unsigned int nid) : OChunk(nid) {}
-	~OBranch()
-	{
-		list<OChunk*>::iterator pc;
-		for (pc = m_child.begin(); pc != m_child.end(); ++pc) delete (*pc);
-		m_child.clear();
-	}
-
-	int Size()
-	{
-		int nsize = 0;
-		list<OChunk*>::iterator pc;
-		for (pc = m_child.begin(); pc != m_child.end(); ++pc) nsize += (*pc)->Size() + 2*sizeof(unsigned int);
-		return nsize;
-	}
-
-	void Write(IOFileStream* fp)
-	{
-		fp->Write(&m_nID, sizeof(unsigned int), 1);
-
-		unsigned int nsize = Size();
-		fp->Write(&nsize, sizeof(unsigned int), 1);
-
-		list<OChunk*>::iterator pc;
-		for (pc = m_child.begin(); pc != m_child.end(); ++pc) (*pc)->Write(fp);
-	}
-
-	void AddChild(OChunk* pc) { m_child.push_back(pc); pc->SetParent(this); }
-
-protected:
-	list<OChunk*>	m_child;
-};
-
-template <typename T>
-class OLeaf : public OChunk
-{
-public:
-	OLeaf(unsigned int nid, const T& d) : OChunk(nid) { m_d = d; }
-
-	int Size() { return sizeof(T); }
-
-	void Write(IOFileStream* fp)
-	{
-		fp->Write(&m_nID  , sizeof(unsigned int), 1);
-		unsigned int nsize = sizeof(T);
-		fp->Write(&nsize, sizeof(unsigned int), 1);
-		fp->Write(&m_d, sizeof(T), 1);
-	}
-
-protected:
-	T	m_d;
-};
-
-template <typename T>
-class OLeaf<T*> : public OChunk
+//----------------------
+// Sections of an output archive whose content is written after the rest of 
+// the archive. The writers must only use data they own (e.g. copies of mesh 
+// buffers), so that they can run on another thread after the document has 
+// changed again. 
+class OArchiveDeferred
 {
-public:
-	OLeaf(unsigned int nid, const T* pd, int nsize) : OChunk(nid)
+	struct SECTION
 	{
-		assert(nsize > 0);
-		m_pd = new T[nsize];
-		memcpy(m_pd, pd, sizeof(T)*nsize);
-		m_nsize = nsize;
-	}
-	~OLeaf() { delete m_pd; }
+		int64_t		pos;	// position in the archive where the section is inserted
+		std::function<void(OArchive&)>	f;
+		std::vector<unsigned char>		data;
+	};
 
-	int Size() { return sizeof(T)*m_nsize; }
-	void Write(IOFileStream* fp)
+	struct SIZEFIX
 	{
-		fp->Write(&m_nID, sizeof(unsigned int), 1);
-		unsigned int nsize = Size();
-		fp->Write(&nsize, sizeof(unsigned int), 1);
-		fp->Write(m_pd, sizeof(T), m_nsize);
-	}
-
-protected:
-	T*		m_pd;
-	int		m_nsize;
-};
+		int64_t	pos;		// position of a chunk size field
+		size_t	first, last;	// range of sections inside the chunk
+	};
 
-template <>
-class OLeaf<const char*> : public OChunk
-{
 public:
-	OLeaf(unsigned int nid, const char* sz) : OChunk(nid)
-	{
-		int l = (int)strlen(sz);
-		m_psz = new char[l+1];
-		memcpy(m_psz, sz, l+1);
-	}
-	~OLeaf() { delete m_psz; }
+	OArchiveDeferred() {}
 
-	int Size() { return (int)strlen(m_psz) + sizeof(int); }
-	void Write(IOFileStream* fp)
-	{
-		fp->Write(&m_nID, sizeof(unsigned int), 1);
-		unsigned int nsize = Size();
-		fp->Write(&nsize, sizeof(unsigned int), 1);
-		int l = nsize - sizeof(int);
-		fp->Write(&l, sizeof(int), 1);
-		fp->Write(m_psz, sizeof(char), l);
-	}
+	bool IsEmpty() const { return m_sec.empty(); }
 
-protected:
-	char*	m_psz;
-};
+	void Clear() { m_sec.clear(); m_fix.clear(); }
 
-template <typename T>
-class OLeaf<vector<T> > : public OChunk
-{
-public:
-	OLeaf(unsigned int nid, const vector<T>& a) : OChunk(nid)
-	{
-		m_nsize = (int)a.size();
-		assert(m_nsize > 0);
-		m_pd = new T[m_nsize];
-		memcpy(m_pd, &a[0], sizeof(T)*m_nsize);
-	}
-	~OLeaf() { delete m_pd; }
+	// Writes the deferred sections and inserts them into buf, which must
+	// hold the closed archive that the sections were added to.
+	bool Finish(std::vector<unsigned char>& buf);
 
-	int Size() { return sizeof(T)*m_nsize; }
-	void Write(IOFileStream* fp)
-	{
-		fp->Write(&m_nID, sizeof(unsigned int), 1);
-		unsigned int nsize = Size();
-		fp->Write(&nsize, sizeof(unsigned int), 1);
-		fp->Write(m_pd, sizeof(T), m_nsize);
-	}
+private:
+	std::vector<SECTION>	m_sec;
+	std::vector<SIZEFIX>	m_fix;
 
-protected:
-	T*		m_pd;
-	int		m_nsize;
+	friend class OArchive;
 };
 
+//----------------------
+// Output archive
 class OArchive  
 {
 public:
@@ -400,6 +327,23 @@ public:
 	// Open for writing
 	bool Create(const char* szfile, unsigned int signature);
 
+	// Open for writing to a memory buffer
+	bool Create(std::vector<unsigned char>& buf, unsigned int signature);
+
+	// Open for writing a section of an archive to a memory buffer. 
+	// This does not write a signature or a root chunk.
+	bool CreateSection(std::vector<unsigned char>& buf);
+
+	// Collect deferred sections in the given object instead of writing them 
+	// immediately. Only for archives that write to memory.
+	void SetDeferred(OArchiveDeferred* def) { m_def = def; }
+
+	// are deferred sections collected?
+	bool IsDeferring() const { return (m_def != nullptr); }
+
+	// Write a section with f. If deferring, f is called later by OArchiveDeferred::Finish.
+	void WriteDeferred(std::function<void(OArchive&)> f);
+
 	// begin a chunk
 	void BeginChunk(unsigned int id);
 
@@ -408,32 +352,52 @@ public:
 
 	void WriteChunk(unsigned int nid, char* sz)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
+		WriteChunk(nid, (const char*)sz);
 	}
 
 	void WriteChunk(unsigned int nid, const char* sz)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, sz));
+		int l = (int)strlen(sz);
+		WriteChunkHeader(nid, l + sizeof(int));
+		m_fp.Write(&l, sizeof(int), 1);
+		m_fp.Write(sz, sizeof(char), l);
 	}
 
 	void WriteChunk(unsigned int nid, const string& s)
 	{
-		m_pChunk->AddChild(new OLeaf<const char*>(nid, s.c_str()));
+		WriteChunk(nid, s.c_str());
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, T* po, int n)
 	{
-		m_pChunk->AddChild(new OLeaf<T*>(nid, po, n));
+		WriteChunkHeader(nid, sizeof(T)*n);
+		m_fp.Write(po, sizeof(T), n);
+	}
+
+	template <typename T> void WriteChunk(unsigned int nid, const std::vector<T>& a)
+	{
+		WriteChunkHeader(nid, (unsigned int)(sizeof(T)*a.size()));
+		if (a.empty() == false) m_fp.Write(a.data(), sizeof(T), a.size());
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, const T& o)
 	{
-		m_pChunk->AddChild(new OLeaf<T>(nid, o));
+		WriteChunkHeader(nid, sizeof(T));
+		m_fp.Write(&o, sizeof(T), 1);
+	}
+
+protected:
+	void WriteChunkHeader(unsigned int nid, unsigned int nsize)
+	{
+		m_fp.Write(&nid, sizeof(unsigned int), 1);
+		m_fp.Write(&nsize, sizeof(unsigned int), 1);
 	}
 
 protected:
 	IOFileStream	m_fp;		// the file pointer
 
-	OBranch*	m_pRoot;	// chunk tree root
-	OBranch*	m_pChunk;	// current chunk
+	stack<int64_t>	m_chunkPos;	// positions of the size fields of the open chunks
+	stack<size_t>	m_chunkDef;	// nr of deferred sections when the chunk was opened
+
+	OArchiveDeferred*	m_def;
 };
@@ -83,7 +83,7 @@ int CCallStack::GetCallStackString(char* sz)
 }
 
 //-------------------------------------------------------------------
-CCallTracer::CCallTracer(const char* sz)
+CCallTracer::CCallTracer(const char* sz) : m_timer(sz, "trace")
 {
 	CCallStack::PushCall(sz);
 }
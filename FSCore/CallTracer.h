@@ -26,6 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include <vector>
+#include "Profiler.h"
 
 //-------------------------------------------------------------------
 // This class can be used to track a call stack. Macros assist
@@ -51,11 +52,15 @@ private:
 };
 
 //-------------------------------------------------------------------
+// Tracks the call and, when profiling is enabled, times it.
 class CCallTracer
 {
 public:
 	CCallTracer(const char* sz);
 	~CCallTracer();
+
+private:
+	CProfileScope	m_timer;
 };
 
 //-------------------------------------------------------------------
@@ -0,0 +1,197 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+#include "stdafx.h"
+#include "FSThreadPool.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
+typedef std::function<void()> FSTask;
+
+// index of the pool worker running on this thread (-1 for other threads)
+static thread_local int t_worker = -1;
+
+class FSThreadPool::Imp
+{
+public:
+	struct Queue
+	{
+		std::mutex			mtx;
+		std::deque<FSTask>	tasks;
+	};
+
+public:
+	Imp()
+	{
+		int n = (int)std::thread::hardware_concurrency() - 1;
+		if (n < 1) n = 1;
+
+		m_stop = false;
+		m_pending = 0;
+		m_next = 0;
+		for (int i = 0; i < n; ++i) m_queue.push_back(std::unique_ptr<Queue>(new Queue));
+		for (int i = 0; i < n; ++i) m_worker.push_back(std::thread(&Imp::WorkerLoop, this, i));
+	}
+
+	~Imp()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		for (std::thread& t : m_worker) t.join();
+	}
+
+	// workers push to their own queue, other threads distribute round-robin
+	void Push(FSTask&& task)
+	{
+		int n = (int)m_queue.size();
+		int q = (t_worker >= 0 ? t_worker : (m_next++ % n));
+		{
+			std::lock_guard<std::mutex> lock(m_queue[q]->mtx);
+			m_queue[q]->tasks.push_back(std::move(task));
+		}
+		m_pending++;
+		{
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+		}
+		m_cv.notify_one();
+	}
+
+	// Run one queued task: newest from the own queue first, then steal the oldest from the others.
+	bool RunOne(int self)
+	{
+		FSTask task;
+		if (self >= 0) Pop(*m_queue[self], task, true);
+		int n = (int)m_queue.size();
+		for (int i = 1; (i <= n) && !task; ++i)
+		{
+			int q = (self < 0 ? i - 1 : (self + i) % n);
+			Pop(*m_queue[q], task, false);
+		}
+		if (!task) return false;
+
+		m_pending--;
+		task();
+		return true;
+	}
+
+	void WorkerLoop(int index)
+	{
+		t_worker = index;
+		while (true)
+		{
+			if (RunOne(index)) continue;
+
+			std::unique_lock<std::mutex> lock(m_waitMutex);
+			m_cv.wait(lock, [this]() { return m_stop || (m_pending > 0); });
+			if (m_stop) return;
+		}
+	}
+
+private:
+	static void Pop(Queue& q, FSTask& task, bool back)
+	{
+		std::lock_guard<std::mutex> lock(q.mtx);
+		if (q.tasks.empty()) return;
+		if (back) { task = std::move(q.tasks.back()); q.tasks.pop_back(); }
+		else { task = std::move(q.tasks.front()); q.tasks.pop_front(); }
+	}
+
+public:
+	std::vector<std::unique_ptr<Queue>>	m_queue;
+	std::vector<std::thread>	m_worker;
+
+	std::mutex				m_waitMutex;
+	std::condition_variable	m_cv;
+	std::atomic<int>		m_pending;
+	std::atomic<unsigned>	m_next;
+	bool					m_stop;
+};
+
+FSThreadPool& FSThreadPool::Instance()
+{
+	static FSThreadPool pool;
+	return pool;
+}
+
+FSThreadPool::FSThreadPool() : m(new FSThreadPool::Imp)
+{
+}
+
+FSThreadPool::~FSThreadPool()
+{
+	delete m;
+}
+
+int FSThreadPool::Threads() const
+{
+	return (int)m->m_worker.size() + 1;
+}
+
+int FSThreadPool::Chunks(int n) const
+{
+	int chunks = 4 * Threads();
+	return (n < chunks ? n : chunks);
+}
+
+bool FSThreadPool::Run(int begin, int end, int chunks, const std::function<void(int, int, int)>& body, const FSCancelToken* token)
+{
+	int n = end - begin;
+	if (n <= 0) return true;
+	if (chunks > n) chunks = n;
+	if (chunks < 1) chunks = 1;
+
+	// a single chunk is not worth the scheduling overhead
+	if (chunks == 1)
+	{
+		if (token && token->IsCancelled()) return false;
+		body(0, begin, end);
+		return (token ? !token->IsCancelled() : true);
+	}
+
+	std::atomic<int> remaining(chunks);
+	for (int i = 0; i < chunks; ++i)
+	{
+		int i0 = begin + (int)(((long long)n * i) / chunks);
+		int i1 = begin + (int)(((long long)n * (i + 1)) / chunks);
+		m->Push([=, &body, &remaining]() {
+			if ((token == nullptr) || !token->IsCancelled()) body(i, i0, i1);
+			remaining--;
+		});
+	}
+
+	// help out until all chunks of this loop are done
+	while (remaining > 0)
+	{
+		if (!m->RunOne(t_worker)) std::this_thread::yield();
+	}
+
+	return (token ? !token->IsCancelled() : true);
+}
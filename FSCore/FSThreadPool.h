@@ -0,0 +1,125 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Flag used to request early termination of a parallel loop.
+class FSCancelToken
+{
+public:
+	FSCancelToken() : m_cancel(false) {}
+	FSCancelToken(const FSCancelToken& tok) : m_cancel(tok.IsCancelled()) {}
+	void operator = (const FSCancelToken& tok) { m_cancel = tok.IsCancelled(); }
+
+	void Cancel() { m_cancel.store(true, std::memory_order_relaxed); }
+	void Reset() { m_cancel.store(false, std::memory_order_relaxed); }
+
+	bool IsCancelled() const { return m_cancel.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<bool>	m_cancel;
+};
+
+//-----------------------------------------------------------------------------
+// Shared pool of worker threads. Each worker owns a task queue and steals
+// from the other queues when its own runs dry. A thread that waits for a 
+// loop to finish executes queued tasks as well, so loops can be nested.
+class FSThreadPool
+{
+	class Imp;
+
+public:
+	// the pool is created on first use
+	static FSThreadPool& Instance();
+
+	// number of threads that execute tasks (workers plus calling thread)
+	int Threads() const;
+
+	// Splits [begin, end) into the given number of chunks and calls body(chunk, first, last) 
+	// for each chunk. Returns when all chunks are done. Chunks that have not started 
+	// yet are skipped once the token is cancelled. Returns false if the loop was cancelled.
+	bool Run(int begin, int end, int chunks, const std::function<void(int, int, int)>& body, const FSCancelToken* token = nullptr);
+
+	// default number of chunks for a loop of n iterations
+	int Chunks(int n) const;
+
+private:
+	FSThreadPool();
+	~FSThreadPool();
+	FSThreadPool(const FSThreadPool&) = delete;
+	void operator = (const FSThreadPool&) = delete;
+
+private:
+	Imp*	m;
+};
+
+//-----------------------------------------------------------------------------
+// Calls f(i) for all i in [begin, end) on the thread pool. 
+// Returns false if the token was cancelled before the loop completed.
+template <class F> bool parallel_for(int begin, int end, F f, const FSCancelToken* token = nullptr)
+{
+	if (end <= begin) return true;
+	FSThreadPool& pool = FSThreadPool::Instance();
+	return pool.Run(begin, end, pool.Chunks(end - begin), [&](int, int i0, int i1) {
+		for (int i = i0; i < i1; ++i)
+		{
+			if (token && token->IsCancelled()) return;
+			f(i);
+		}
+	}, token);
+}
+
+//-----------------------------------------------------------------------------
+// Combines map(i) for all i in [begin, end) with the associative operator 
+// reduce(a, b), starting from init. Partial results are combined in order,
+// so the result does not depend on the scheduling.
+template <class T, class Map, class Reduce> T parallel_reduce(int begin, int end, const T& init, Map map, Reduce reduce, const FSCancelToken* token = nullptr)
+{
+	if (end <= begin) return init;
+	FSThreadPool& pool = FSThreadPool::Instance();
+	int chunks = pool.Chunks(end - begin);
+	std::vector<T> partial(chunks, init);
+	std::vector<char> done(chunks, 0);
+	pool.Run(begin, end, chunks, [&](int chunk, int i0, int i1) {
+		T v = map(i0);
+		for (int i = i0 + 1; i < i1; ++i)
+		{
+			if (token && token->IsCancelled()) return;
+			v = reduce(v, map(i));
+		}
+		partial[chunk] = v;
+		done[chunk] = 1;
+	}, token);
+
+	T result = init;
+	for (int i = 0; i < chunks; ++i)
+		if (done[i]) result = reduce(result, partial[i]);
+	return result;
+}
@@ -26,19 +26,52 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "FSThreadedTask.h"
 
-FSThreadedTask::FSThreadedTask()
+FSThreadedTask::FSThreadedTask() : m_loopDone(0)
 {
-
+	m_loopSize = 0;
+	m_loopStart = m_loopEnd = 0.0;
 }
 
 FSTaskProgress FSThreadedTask::GetProgress()
 {
-	return m_progress;
+	FSTaskProgress p = m_progress;
+	if (m_loopSize > 0)
+	{
+		double f = (double)m_loopDone.load(std::memory_order_relaxed) / (double)m_loopSize;
+		p.percent = m_loopStart + f * (m_loopEnd - m_loopStart);
+	}
+	return p;
 }
 
 void FSThreadedTask::Terminate()
 {
 	m_progress.valid = false;
+	m_cancel.Cancel();
+}
+
+bool FSThreadedTask::IsCancelled() const
+{
+	return m_cancel.IsCancelled();
+}
+
+void FSThreadedTask::ResetCancel()
+{
+	m_cancel.Reset();
+}
+
+void FSThreadedTask::beginLoop(int n, double pmax)
+{
+	m_loopDone = 0;
+	m_loopStart = m_progress.percent;
+	m_loopEnd = pmax;
+	m_progress.valid = true;
+	m_loopSize = n;
+}
+
+void FSThreadedTask::endLoop(bool completed)
+{
+	m_loopSize = 0;
+	if (completed) setProgress(m_loopEnd);
 }
 
 void FSThreadedTask::setProgress(double progress)
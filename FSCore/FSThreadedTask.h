@@ -25,6 +25,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 #pragma once
 #include "FSObject.h"
+#include "FSThreadPool.h"
 
 struct FSTaskProgress
 {
@@ -58,6 +59,12 @@ public:
 	// The thread is about to be terminated
 	virtual void Terminate();
 
+	// returns true if Terminate was called
+	bool IsCancelled() const;
+
+	// clear the cancel flag before the task is (re)started
+	void ResetCancel();
+
 protected:
 	// set progress in percent (value between 0 and 100)
 	void setProgress(double d);
@@ -65,6 +72,38 @@ protected:
 	// set task, and optionally, set progress in percent (value between 0 and 100)
 	void setCurrentTask(const char* sz, double progress = 0.0);
 
+	// Calls f(i) for i in [0, n) on the thread pool. The progress advances from 
+	// its current value to pmax as iterations complete. Returns false if the task was cancelled.
+	template <class F> bool parallelFor(int n, F f, double pmax = 100.0);
+
+	// parallel reduction that stops early when the task is cancelled
+	template <class T, class Map, class Reduce> T parallelReduce(int n, const T& init, Map map, Reduce reduce)
+	{
+		return parallel_reduce(0, n, init, map, reduce, &m_cancel);
+	}
+
 private:
-	FSTaskProgress m_progress;
+	void beginLoop(int n, double pmax);
+	void endLoop(bool completed);
+
+private:
+	FSTaskProgress	m_progress;
+	FSCancelToken	m_cancel;
+
+	// progress of the running parallel loop
+	std::atomic<int>	m_loopDone;
+	int					m_loopSize;
+	double				m_loopStart;
+	double				m_loopEnd;
 };
+
+template <class F> bool FSThreadedTask::parallelFor(int n, F f, double pmax)
+{
+	beginLoop(n, pmax);
+	bool b = parallel_for(0, n, [&](int i) {
+		f(i);
+		m_loopDone.fetch_add(1, std::memory_order_relaxed);
+	}, &m_cancel);
+	endLoop(b);
+	return b;
+}
@@ -0,0 +1,231 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+#include "stdafx.h"
+#include "Profiler.h"
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+
+//-------------------------------------------------------------------
+std::atomic<bool> CProfiler::m_enabled(false);
+
+namespace {
+
+	// ring buffer of events
+	struct EventBuffer
+	{
+		std::mutex	mtx;
+		std::vector<FSProfileEvent>	events;
+		size_t		head = 0;	// next slot to write
+		bool		full = false;
+
+		EventBuffer() { events.resize(65536); }
+
+		void push(const FSProfileEvent& e)
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			events[head++] = e;
+			if (head == events.size()) { head = 0; full = true; }
+		}
+	};
+
+	EventBuffer& buffer()
+	{
+		static EventBuffer buf;
+		return buf;
+	}
+
+	std::chrono::steady_clock::time_point startTime()
+	{
+		static std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		return t0;
+	}
+
+	// small ids are easier to read in the trace viewer than native thread ids
+	int threadId()
+	{
+		static std::atomic<int> counter(0);
+		static thread_local int id = ++counter;
+		return id;
+	}
+
+	void writeString(FILE* fp, const char* sz)
+	{
+		fputc('"', fp);
+		for (const char* c = sz; c && *c; ++c)
+		{
+			if ((*c == '"') || (*c == '\\')) { fputc('\\', fp); fputc(*c, fp); }
+			else if ((unsigned char)*c < 0x20) fputc(' ', fp);
+			else fputc(*c, fp);
+		}
+		fputc('"', fp);
+	}
+}
+
+//-------------------------------------------------------------------
+void CProfiler::Enable(bool b)
+{
+	startTime();
+	m_enabled = b;
+}
+
+//-------------------------------------------------------------------
+void CProfiler::SetCapacity(int n)
+{
+	if (n < 1) n = 1;
+	EventBuffer& buf = buffer();
+	std::lock_guard<std::mutex> lock(buf.mtx);
+	buf.events.assign(n, FSProfileEvent());
+	buf.head = 0;
+	buf.full = false;
+}
+
+//-------------------------------------------------------------------
+void CProfiler::Clear()
+{
+	EventBuffer& buf = buffer();
+	std::lock_guard<std::mutex> lock(buf.mtx);
+	buf.head = 0;
+	buf.full = false;
+}
+
+//-------------------------------------------------------------------
+double CProfiler::Now()
+{
+	std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - startTime();
+	return dt.count();
+}
+
+//-------------------------------------------------------------------
+void CProfiler::AddTiming(const char* szname, const char* szcat, double t0, double t1)
+{
+	FSProfileEvent e;
+	e.name = szname;
+	e.cat = szcat;
+	e.type = 'X';
+	e.tid = threadId();
+	e.ts = t0;
+	e.dur = t1 - t0;
+	e.value = 0.0;
+	buffer().push(e);
+}
+
+//-------------------------------------------------------------------
+void CProfiler::AddCounter(const char* szname, double value)
+{
+	FSProfileEvent e;
+	e.name = szname;
+	e.cat = "";
+	e.type = 'C';
+	e.tid = threadId();
+	e.ts = Now();
+	e.dur = 0.0;
+	e.value = value;
+	buffer().push(e);
+}
+
+//-------------------------------------------------------------------
+std::vector<FSProfileEvent> CProfiler::GetEvents()
+{
+	EventBuffer& buf = buffer();
+	std::lock_guard<std::mutex> lock(buf.mtx);
+	std::vector<FSProfileEvent> ev;
+	if (buf.full)
+	{
+		ev.assign(buf.events.begin() + buf.head, buf.events.end());
+		ev.insert(ev.end(), buf.events.begin(), buf.events.begin() + buf.head);
+	}
+	else ev.assign(buf.events.begin(), buf.events.begin() + buf.head);
+	return ev;
+}
+
+//-------------------------------------------------------------------
+std::vector<FSProfileStats> CProfiler::GetSummary()
+{
+	std::vector<FSProfileEvent> ev = GetEvents();
+
+	std::map<std::string, FSProfileStats> stats;
+	for (const FSProfileEvent& e : ev)
+	{
+		if (e.type != 'X') continue;
+		double ms = e.dur / 1000.0;
+		std::map<std::string, FSProfileStats>::iterator it = stats.find(e.name);
+		if (it == stats.end())
+		{
+			FSProfileStats s = { e.name, 1, ms, ms, ms };
+			stats[e.name] = s;
+		}
+		else
+		{
+			FSProfileStats& s = it->second;
+			s.count++;
+			s.total += ms;
+			if (ms < s.min) s.min = ms;
+			if (ms > s.max) s.max = ms;
+		}
+	}
+
+	std::vector<FSProfileStats> l;
+	for (auto& it : stats) l.push_back(it.second);
+	std::sort(l.begin(), l.end(), [](const FSProfileStats& a, const FSProfileStats& b) { return a.total > b.total; });
+	return l;
+}
+
+//-------------------------------------------------------------------
+bool CProfiler::ExportChromeTrace(const char* szfile)
+{
+	FILE* fp = fopen(szfile, "wt");
+	if (fp == nullptr) return false;
+
+	std::vector<FSProfileEvent> ev = GetEvents();
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < ev.size(); ++i)
+	{
+		const FSProfileEvent& e = ev[i];
+		fprintf(fp, "{\"name\":");
+		writeString(fp, e.name);
+		if (e.type == 'X')
+		{
+			fprintf(fp, ",\"cat\":");
+			writeString(fp, (e.cat && e.cat[0] ? e.cat : "default"));
+			fprintf(fp, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", e.ts, e.dur, e.tid);
+		}
+		else
+		{
+			fprintf(fp, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%.17g}}", e.ts, e.tid, e.value);
+		}
+		if (i != ev.size() - 1) fprintf(fp, ",");
+		fprintf(fp, "\n");
+	}
+	fprintf(fp, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	bool ok = (ferror(fp) == 0);
+	fclose(fp);
+	return ok;
+}
@@ -0,0 +1,124 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------
+// A single profiling event. Timings are complete events ('X'), 
+// counters are sampled values ('C'). Times are in microseconds.
+struct FSProfileEvent
+{
+	const char*	name;
+	const char*	cat;
+	char		type;
+	int			tid;
+	double		ts;
+	double		dur;
+	double		value;
+};
+
+//-------------------------------------------------------------------
+// timing summary of all events with the same name
+struct FSProfileStats
+{
+	std::string	name;
+	int			count;
+	double		total;	// in ms
+	double		min;	// in ms
+	double		max;	// in ms
+};
+
+//-------------------------------------------------------------------
+// Collects timing events in a fixed size ring buffer. Recording is off
+// by default, in which case the scope timers only test a flag.
+// Event names must be string literals (only the pointer is stored).
+class CProfiler
+{
+public:
+	static void Enable(bool b);
+	static bool IsEnabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+	// set the max number of events that are kept (this clears the buffer)
+	static void SetCapacity(int n);
+
+	static void Clear();
+
+	// time since the profiler was first used (in microseconds)
+	static double Now();
+
+	static void AddTiming(const char* szname, const char* szcat, double t0, double t1);
+	static void AddCounter(const char* szname, double value);
+
+	// events in the order they were recorded
+	static std::vector<FSProfileEvent> GetEvents();
+
+	// per-name statistics of the recorded timings, sorted by total time
+	static std::vector<FSProfileStats> GetSummary();
+
+	// write the events in the Chrome trace format (chrome://tracing, Perfetto)
+	static bool ExportChromeTrace(const char* szfile);
+
+private:
+	CProfiler() {}
+
+private:
+	static std::atomic<bool>	m_enabled;
+};
+
+//-------------------------------------------------------------------
+// Times the enclosing scope
+class CProfileScope
+{
+public:
+	CProfileScope(const char* szname, const char* szcat = "")
+	{
+		m_name = nullptr;
+		if (CProfiler::IsEnabled())
+		{
+			m_name = szname;
+			m_cat = szcat;
+			m_t0 = CProfiler::Now();
+		}
+	}
+
+	~CProfileScope()
+	{
+		if (m_name) CProfiler::AddTiming(m_name, m_cat, m_t0, CProfiler::Now());
+	}
+
+private:
+	const char*	m_name;
+	const char*	m_cat;
+	double		m_t0;
+};
+
+//-------------------------------------------------------------------
+#define PROFILE_SCOPE(s)		CProfileScope temp_profile_obj(s);
+#define PROFILE_SCOPE_CAT(s, c)	CProfileScope temp_profile_obj(s, c);
+#define PROFILE_COUNTER(s, v)	if (CProfiler::IsEnabled()) CProfiler::AddCounter(s, v);
@@ -37,6 +37,7 @@ CGLContext::CGLContext()
 	m_springThick = 1.f;
 
 	m_btrack = false;
+	m_interactive = false;
 }
 
 CGLContext::~CGLContext(void)
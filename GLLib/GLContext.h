@@ -45,6 +45,9 @@ public:
 	vec3d	m_track_pos;	// tracked position
 	quatd	m_track_rot;	// tracked orientation
 
+	// the user is interacting with the view (renderers may use a lower level of detail)
+	bool	m_interactive;
+
 	bool		m_showMesh;
 	bool		m_showOutline;
 	bool		m_bext;
@@ -30,6 +30,14 @@ SOFTWARE.*/
 #include <math.h>
 #include <memory>
 #include <cstring>
+#include <atomic>
+#include <assert.h>
+
+#ifdef WIN32
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#else
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
 
 //-----------------------------------------------------------------------------
 // find the power of 2 that is closest to n
@@ -43,6 +51,63 @@ int closest_pow2(int n)
 	return p;
 }
 
+//=============================================================================
+// CRawImageBrickReader
+//=============================================================================
+
+CRawImageBrickReader::CRawImageBrickReader()
+{
+	m_fp = nullptr;
+	m_nx = m_ny = m_nz = 0;
+	m_bpv = 1;
+	m_offset = 0;
+}
+
+CRawImageBrickReader::~CRawImageBrickReader()
+{
+	Close();
+}
+
+bool CRawImageBrickReader::Open(const char* szfile, int nx, int ny, int nz, int bytesPerVoxel, size_t headerSize)
+{
+	Close();
+	m_fp = fopen(szfile, "rb");
+	if (m_fp == nullptr) return false;
+
+	m_nx = nx;
+	m_ny = ny;
+	m_nz = nz;
+	m_bpv = bytesPerVoxel;
+	m_offset = headerSize;
+
+	return true;
+}
+
+void CRawImageBrickReader::Close()
+{
+	if (m_fp) fclose(m_fp);
+	m_fp = nullptr;
+}
+
+bool CRawImageBrickReader::ReadBlock(int i0, int j0, int k0, int nx, int ny, int nz, void* dst)
+{
+	if (m_fp == nullptr) return false;
+
+	// we read one row at a time
+	Byte* pd = (Byte*)dst;
+	size_t rowSize = (size_t)nx*m_bpv;
+	for (int k = 0; k < nz; ++k)
+		for (int j = 0; j < ny; ++j)
+		{
+			size_t n = ((size_t)(k0 + k)*m_ny + (j0 + j))*m_nx + i0;
+			if (fseek64(m_fp, m_offset + n*m_bpv, SEEK_SET) != 0) return false;
+			if (fread(pd, 1, rowSize, m_fp) != rowSize) return false;
+			pd += rowSize;
+		}
+
+	return true;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -51,6 +116,16 @@ C3DImage::C3DImage()
 {
 	m_pb = 0;
 	m_cx = m_cy = m_cz = 0;
+	m_pixelType = UINT_8;
+	m_validRange = false;
+	m_vmin = 0.0; m_vmax = 255.0;
+
+	m_reader = nullptr;
+	m_brickSize = 0;
+	m_nbx = m_nby = m_nbz = 0;
+	m_maxBricks = 0;
+	m_tag = 0;
+	m_brickSetId = 0;
 }
 
 C3DImage::~C3DImage()
@@ -63,6 +138,41 @@ void C3DImage::CleanUp()
 	delete [] m_pb;
 	m_pb = 0;
 	m_cx = m_cy = m_cz = 0;
+	m_validRange = false;
+
+	ClearBricks();
+	delete m_reader;
+	m_reader = nullptr;
+}
+
+// Each set of bricks gets a new id, so that the per-thread brick caches
+// never return bricks of a previous image.
+static unsigned long long newBrickSetId()
+{
+	static std::atomic<unsigned long long> lastId(0);
+	return ++lastId;
+}
+
+void C3DImage::ClearBricks()
+{
+	m_brick.clear();
+	m_brickTag.clear();
+	m_resident.clear();
+	m_tag = 0;
+	m_brickSetId = newBrickSetId();
+}
+
+int C3DImage::BytesPerVoxel() const
+{
+	switch (m_pixelType)
+	{
+	case UINT_8 : return 1;
+	case UINT_16: return 2;
+	case REAL_32: return 4;
+	default:
+		assert(false);
+	}
+	return 1;
 }
 
 bool C3DImage::Create(int nx, int ny, int nz, Byte* data, int dataSize)
@@ -72,7 +182,7 @@ bool C3DImage::Create(int nx, int ny, int nz, Byte* data, int dataSize)
       return false;
 
 	// reallocate data if necessary
-	if (nx*ny*nz != m_cx*m_cy*m_cz)
+	if ((nx*ny*nz != m_cx*m_cy*m_cz) || (m_pixelType != UINT_8) || IsBricked())
 	{
 	  CleanUp();
 
@@ -92,17 +202,259 @@ bool C3DImage::Create(int nx, int ny, int nz, Byte* data, int dataSize)
 	m_cx = nx;
 	m_cy = ny;
 	m_cz = nz;
+	m_pixelType = UINT_8;
+	m_validRange = false;
 
 	return true;
 }
 
+bool C3DImage::Create(int nx, int ny, int nz, PixelType pixelType, void* data)
+{
+	if (pixelType == UINT_8) return Create(nx, ny, nz, (Byte*)data);
+
+	size_t nsize = (size_t)nx*ny*nz;
+	if (nsize == 0) return false;
+
+	CleanUp();
+	m_pixelType = pixelType;
+
+	if (data == nullptr)
+	{
+		m_pb = new Byte[nsize*BytesPerVoxel()];
+		if (m_pb == nullptr) return false;
+	}
+	else m_pb = (Byte*)data;
+
+	m_cx = nx;
+	m_cy = ny;
+	m_cz = nz;
+
+	return true;
+}
+
+bool C3DImage::CreateBricked(int nx, int ny, int nz, PixelType pixelType, C3DImageBrickReader* reader, int brickSize, int maxResidentBricks)
+{
+	if ((nx*ny*nz == 0) || (reader == nullptr) || (brickSize < 1)) return false;
+
+	CleanUp();
+	m_pixelType = pixelType;
+	m_cx = nx;
+	m_cy = ny;
+	m_cz = nz;
+
+	m_reader = reader;
+	m_brickSize = brickSize;
+	m_nbx = (nx + brickSize - 1) / brickSize;
+	m_nby = (ny + brickSize - 1) / brickSize;
+	m_nbz = (nz + brickSize - 1) / brickSize;
+	m_maxBricks = (maxResidentBricks < 1 ? 1 : maxResidentBricks);
+
+	int nbricks = m_nbx*m_nby*m_nbz;
+	m_brick.assign(nbricks, nullptr);
+	m_brickTag.assign(nbricks, 0);
+	m_brickSetId = newBrickSetId();
+	m_resident.reserve(m_maxBricks);
+
+	return true;
+}
+
+// Load brick n, evicting the least recently used brick if needed.
+// The brick lock must be held by the caller. Evicted bricks stay valid
+// for as long as a caller holds on to them.
+std::shared_ptr<Byte> C3DImage::LoadBrick(int n)
+{
+	std::shared_ptr<Byte> pb = m_brick[n];
+	m_brickTag[n] = ++m_tag;
+	if (pb) return pb;
+
+	// evict the least recently used brick
+	if ((int)m_resident.size() >= m_maxBricks)
+	{
+		int imin = 0;
+		for (int i = 1; i < (int)m_resident.size(); ++i)
+			if (m_brickTag[m_resident[i]] < m_brickTag[m_resident[imin]]) imin = i;
+
+		int m = m_resident[imin];
+		m_brick[m].reset();
+		m_resident[imin] = m_resident.back();
+		m_resident.pop_back();
+	}
+
+	// get the brick's extent
+	int bi = n % m_nbx;
+	int bj = (n / m_nbx) % m_nby;
+	int bk = n / (m_nbx*m_nby);
+	int i0 = bi*m_brickSize, ni = (i0 + m_brickSize > m_cx ? m_cx - i0 : m_brickSize);
+	int j0 = bj*m_brickSize, nj = (j0 + m_brickSize > m_cy ? m_cy - j0 : m_brickSize);
+	int k0 = bk*m_brickSize, nk = (k0 + m_brickSize > m_cz ? m_cz - k0 : m_brickSize);
+
+	size_t bytes = (size_t)ni*nj*nk*BytesPerVoxel();
+	pb = std::shared_ptr<Byte>(new Byte[bytes], std::default_delete<Byte[]>());
+	if (m_reader->ReadBlock(i0, j0, k0, ni, nj, nk, pb.get()) == false)
+	{
+		// we don't want to fail here, so just zero the data
+		memset(pb.get(), 0, bytes);
+	}
+
+	m_brick[n] = pb;
+	m_resident.push_back(n);
+
+	return pb;
+}
+
+double C3DImage::BrickValue(int i, int j, int k)
+{
+	int B = m_brickSize;
+	int bi = i / B, bj = j / B, bk = k / B;
+	int n = (bk*m_nby + bj)*m_nbx + bi;
+
+	// local coordinates and brick dimensions
+	int li = i - bi*B, lj = j - bj*B, lk = k - bk*B;
+	int ni = (bi*B + B > m_cx ? m_cx - bi*B : B);
+	int nj = (bj*B + B > m_cy ? m_cy - bj*B : B);
+	size_t l = ((size_t)lk*nj + lj)*ni + li;
+
+	// Each thread keeps the last brick it used, so that walking through a brick
+	// only needs the lock when moving to the next brick.
+	struct BrickCache
+	{
+		unsigned long long	id = 0;
+		int					n = -1;
+		std::shared_ptr<Byte>	pb;
+	};
+	static thread_local BrickCache cache;
+	if ((cache.id != m_brickSetId) || (cache.n != n))
+	{
+		std::lock_guard<std::mutex> lock(m_brickLock);
+		cache.pb = LoadBrick(n);
+		cache.id = m_brickSetId;
+		cache.n = n;
+	}
+
+	const Byte* pb = cache.pb.get();
+	switch (m_pixelType)
+	{
+	case UINT_8 : return pb[l];
+	case UINT_16: return ((const unsigned short*)pb)[l];
+	case REAL_32: return ((const float*)pb)[l];
+	}
+	return 0.0;
+}
+
+double C3DImage::GetValue(int i, int j, int k)
+{
+	if (m_reader) return BrickValue(i, j, k);
+
+	size_t n = (size_t)m_cx*((size_t)k*m_cy + j) + i;
+	switch (m_pixelType)
+	{
+	case UINT_8 : return m_pb[n];
+	case UINT_16: return ((unsigned short*)m_pb)[n];
+	case REAL_32: return ((float*)m_pb)[n];
+	}
+	return 0.0;
+}
+
+template <class T> void C3DImage::ScanRange(const T* p, size_t n, double& vmin, double& vmax)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		double v = (double)p[i];
+		if (v < vmin) vmin = v;
+		if (v > vmax) vmax = v;
+	}
+}
+
+void C3DImage::UpdateValueRange()
+{
+	m_validRange = true;
+	if (m_pixelType == UINT_8)
+	{
+		m_vmin = 0.0;
+		m_vmax = 255.0;
+		return;
+	}
+
+	double vmin = 1e99, vmax = -1e99;
+	if (m_reader == nullptr)
+	{
+		size_t nsize = (size_t)m_cx*m_cy*m_cz;
+		if (m_pixelType == UINT_16) ScanRange((unsigned short*)m_pb, nsize, vmin, vmax);
+		else ScanRange((float*)m_pb, nsize, vmin, vmax);
+	}
+	else
+	{
+		// process the image brick by brick
+		std::lock_guard<std::mutex> lock(m_brickLock);
+		int nbricks = (int)m_brick.size();
+		for (int n = 0; n < nbricks; ++n)
+		{
+			std::shared_ptr<Byte> brick = LoadBrick(n);
+			Byte* pb = brick.get();
+			int bi = n % m_nbx;
+			int bj = (n / m_nbx) % m_nby;
+			int bk = n / (m_nbx*m_nby);
+			size_t ni = (bi*m_brickSize + m_brickSize > m_cx ? m_cx - bi*m_brickSize : m_brickSize);
+			size_t nj = (bj*m_brickSize + m_brickSize > m_cy ? m_cy - bj*m_brickSize : m_brickSize);
+			size_t nk = (bk*m_brickSize + m_brickSize > m_cz ? m_cz - bk*m_brickSize : m_brickSize);
+			if (m_pixelType == UINT_16) ScanRange((unsigned short*)pb, ni*nj*nk, vmin, vmax);
+			else ScanRange((float*)pb, ni*nj*nk, vmin, vmax);
+		}
+	}
+
+	if (vmin > vmax) { vmin = 0.0; vmax = 1.0; }
+	m_vmin = vmin;
+	m_vmax = vmax;
+}
+
+void C3DImage::GetValueRange(double& vmin, double& vmax)
+{
+	if (m_validRange == false) UpdateValueRange();
+	vmin = m_vmin;
+	vmax = m_vmax;
+}
+
+void C3DImage::SetValueRange(double vmin, double vmax)
+{
+	m_vmin = vmin;
+	m_vmax = vmax;
+	m_validRange = true;
+}
+
+Byte C3DImage::ToByte(double v)
+{
+	if (m_pixelType == UINT_8) return (Byte)v;
+	if (m_validRange == false) UpdateValueRange();
+	if (m_vmax == m_vmin) return 0;
+	double w = 255.0*(v - m_vmin) / (m_vmax - m_vmin);
+	if (w < 0.0) w = 0.0;
+	if (w > 255.0) w = 255.0;
+	return (Byte)w;
+}
+
+void C3DImage::GetByteData(std::vector<Byte>& buf)
+{
+	size_t nsize = (size_t)m_cx*m_cy*m_cz;
+	buf.resize(nsize);
+	if ((m_pixelType == UINT_8) && (m_reader == nullptr))
+	{
+		memcpy(buf.data(), m_pb, nsize);
+		return;
+	}
+
+	Byte* pd = buf.data();
+	for (int k = 0; k < m_cz; ++k)
+		for (int j = 0; j < m_cy; ++j)
+			for (int i = 0; i < m_cx; ++i) *pd++ = ToByte(GetValue(i, j, k));
+}
+
 bool C3DImage::LoadFromFile(const char* szfile, int nbits)
 {
 	FILE* fp = fopen(szfile, "rb");
 	if (fp == 0) return false;
 
 	size_t nsize = m_cx*m_cy*m_cz;
-	if (nbits == 16)
+	if ((nbits == 16) && (m_pixelType == UINT_8))
 	{
 		word* m_ptmp = new word[nsize];
 		size_t nread = fread(m_ptmp, sizeof(word), nsize, fp);
@@ -113,9 +465,11 @@ bool C3DImage::LoadFromFile(const char* szfile, int nbits)
 	}
 	else
 	{
-		size_t nread = fread(m_pb, 1, nsize, fp);
+		// read the data at full precision
+		size_t nread = fread(m_pb, BytesPerVoxel(), nsize, fp);
 		if (nsize != nread) return false;
 	}
+	m_validRange = false;
 
 	// cleanup
 	fclose(fp);
@@ -126,9 +480,16 @@ bool C3DImage::LoadFromFile(const char* szfile, int nbits)
 // BitBlt assumes that the 3D and 2D images have the same resolution !
 void C3DImage::BitBlt(CImage& im, int nslice)
 {
+	Byte* pd = im.GetBytes();
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		for (int j = 0; j < m_cy; ++j)
+			for (int i = 0; i < m_cx; ++i) *pd++ = ToByte(GetValue(i, j, nslice));
+		return;
+	}
+
 	// go to the beginning of the slice
 	Byte* ps = m_pb + nslice*m_cx*m_cy;
-	Byte* pd = im.GetBytes();
 
 	// copy image data
 	int n = m_cx*m_cy;
@@ -142,6 +503,20 @@ void C3DImage::StretchBlt(CImage& im, int nslice)
 	int nx = im.Width();
 	int ny = im.Height();
 
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		for (int y = 0; y < ny; ++y)
+		{
+			double fy = (ny > 1 ? y / (double)(ny - 1) : 0.0);
+			for (int x = 0; x < nx; ++x)
+			{
+				double fx = (nx > 1 ? x / (double)(nx - 1) : 0.0);
+				*pd++ = Value(fx, fy, nslice);
+			}
+		}
+		return;
+	}
+
 	int i0 = 0;
 	int j0 = 0;
 
@@ -205,8 +580,6 @@ Byte C3DImage::Value(double fx, double fy, int nz)
 {
 	double r, s;
 
-	Byte* pb = m_pb + nz*m_cx*m_cy;
-
 	int ix = (int) ((m_cx-1)*fx);
 	int iy = (int) ((m_cy-1)*fy);
 
@@ -214,6 +587,17 @@ Byte C3DImage::Value(double fx, double fy, int nz)
 	if (iy == (m_cy - 1)) { iy--; s = 1; } else s = 2*(((m_cy-1)*fy) - iy)-1;
 
 	double h;
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		h  = (1-r)*(1-s)*GetValue(ix    , iy    , nz);
+		h += (1+r)*(1-s)*GetValue(ix + 1, iy    , nz);
+		h += (1+r)*(1+s)*GetValue(ix + 1, iy + 1, nz);
+		h += (1-r)*(1+s)*GetValue(ix    , iy + 1, nz);
+		return ToByte(0.25*h);
+	}
+
+	Byte* pb = m_pb + nz*m_cx*m_cy;
+
 	h  = (1-r)*(1-s)*pb[ix   +  iy   *m_cx];
 	h += (1+r)*(1-s)*pb[ix+1 +  iy   *m_cx];
 	h += (1+r)*(1+s)*pb[ix+1 + (iy+1)*m_cx];
@@ -224,12 +608,17 @@ Byte C3DImage::Value(double fx, double fy, int nz)
 
 Byte C3DImage::Peek(double r, double s, double t)
 {
-	static int n1,n2,n3,n4,n5,n6,n7,n8;
-	static double h1,h2,h3,h4,h5,h6,h7,h8;
+	if ((m_pixelType != UINT_8) || IsBricked()) return ToByte(PeekValue(r, s, t));
+
+	int n1,n2,n3,n4,n5,n6,n7,n8;
+	double h1,h2,h3,h4,h5,h6,h7,h8;
 
-	if (r < 0) r = 0; if (r > 1) r = 1;
-	if (s < 0) s = 0; if (s > 1) s = 1;
-	if (t < 0) t = 0; if (t > 1) t = 1;
+	if (r < 0) r = 0;
+	if (r > 1) r = 1;
+	if (s < 0) s = 0;
+	if (s > 1) s = 1;
+	if (t < 0) t = 0;
+	if (t > 1) t = 1;
 
 	int i = (int)(r*(m_cx-1)); if (i == (m_cx - 1)) i = m_cx - 2;
 	int j = (int)(s*(m_cy-1)); if (j == (m_cy - 1)) j = m_cy - 2;
@@ -262,12 +651,57 @@ Byte C3DImage::Peek(double r, double s, double t)
 	return (Byte)((h1*pb[n1]+h2*pb[n2]+h3*pb[n3]+h4*pb[n4]+h5*pb[n5]+h6*pb[n6]+h7*pb[n7]+h8*pb[n8])*0.125);
 }
 
+double C3DImage::PeekValue(double r, double s, double t)
+{
+	if (r < 0) r = 0;
+	if (r > 1) r = 1;
+	if (s < 0) s = 0;
+	if (s > 1) s = 1;
+	if (t < 0) t = 0;
+	if (t > 1) t = 1;
+
+	int i = (int)(r*(m_cx - 1)); if (i == (m_cx - 1)) i = m_cx - 2;
+	int j = (int)(s*(m_cy - 1)); if (j == (m_cy - 1)) j = m_cy - 2;
+	int k = (int)(t*(m_cz - 1)); if (k == (m_cz - 1)) k = m_cz - 2;
+	if (i < 0) i = 0;
+	if (j < 0) j = 0;
+	if (k < 0) k = 0;
+
+	r = 2.0*(r*(m_cx - 1) - i) - 1.0;
+	s = 2.0*(s*(m_cy - 1) - j) - 1.0;
+	t = 2.0*(t*(m_cz - 1) - k) - 1.0;
+
+	int i1 = (m_cx > 1 ? i + 1 : i);
+	int j1 = (m_cy > 1 ? j + 1 : j);
+	int k1 = (m_cz > 1 ? k + 1 : k);
+
+	double h = 0.0;
+	h += (1 - r)*(1 - s)*(1 - t)*GetValue(i , j , k );
+	h += (1 + r)*(1 - s)*(1 - t)*GetValue(i1, j , k );
+	h += (1 + r)*(1 + s)*(1 - t)*GetValue(i1, j1, k );
+	h += (1 - r)*(1 + s)*(1 - t)*GetValue(i , j1, k );
+	h += (1 - r)*(1 - s)*(1 + t)*GetValue(i , j , k1);
+	h += (1 + r)*(1 - s)*(1 + t)*GetValue(i1, j , k1);
+	h += (1 + r)*(1 + s)*(1 + t)*GetValue(i1, j1, k1);
+	h += (1 - r)*(1 + s)*(1 + t)*GetValue(i , j1, k1);
+
+	return h*0.125;
+}
 
 void C3DImage::Histogram(int* pdf)
 {
 	int i;
 	for (i=0; i<256; i++) pdf[i] = 0;
 
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		// bin the full precision values over the image's value range
+		for (int z = 0; z < m_cz; ++z)
+			for (int y = 0; y < m_cy; ++y)
+				for (int x = 0; x < m_cx; ++x) pdf[ToByte(GetValue(x, y, z))]++;
+		return;
+	}
+
 	Byte* pb = m_pb;
 	int nsize = m_cx*m_cy*m_cz;
 
@@ -282,6 +716,13 @@ void C3DImage::GetSliceX(CImage& im, int n)
 	Byte* ps;
 	Byte* pd = im.GetBytes();
 
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		for (int z = 0; z < m_cz; z++)
+			for (int y = 0; y < m_cy; y++) *pd++ = ToByte(GetValue(n, y, z));
+		return;
+	}
+
 	// copy image data
 	for (int z=0; z<m_cz; z++)
 	{
@@ -298,6 +739,13 @@ void C3DImage::GetSliceY(CImage& im, int n)
 	Byte* ps;
 	Byte* pd = im.GetBytes();
 
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		for (int z = 0; z < m_cz; z++)
+			for (int x = 0; x < m_cx; x++) *pd++ = ToByte(GetValue(x, n, z));
+		return;
+	}
+
 	// copy image data
 	for (int z=0; z<m_cz; z++)
 	{
@@ -313,6 +761,14 @@ void C3DImage::GetSliceZ(CImage& im, int n)
 
 	// copy image data
 	Byte* pd = im.GetBytes();
+
+	if ((m_pixelType != UINT_8) || IsBricked())
+	{
+		for (int y = 0; y < m_cy; y++)
+			for (int x = 0; x < m_cx; x++) *pd++ = ToByte(GetValue(x, y, n));
+		return;
+	}
+
 	Byte* ps = m_pb + n*m_cx*m_cy;
 
 	for (int i=0; i<m_cx*m_cy; i++, ps++) *pd++ = *ps;
@@ -377,19 +833,42 @@ void C3DImage::GetSampledSliceZ(CImage& im, double f)
 
 void C3DImage::Invert()
 {
-	int n = m_cx*m_cy*m_cz;
-	for (int i=0; i<n; i++) m_pb[i] = 255 - m_pb[i];
+	// bricked images are read-only
+	if (IsBricked()) return;
+
+	size_t n = (size_t)m_cx*m_cy*m_cz;
+	switch (m_pixelType)
+	{
+	case UINT_8: for (size_t i = 0; i < n; i++) m_pb[i] = 255 - m_pb[i]; break;
+	case UINT_16:
+	{
+		unsigned short* p = (unsigned short*)m_pb;
+		for (size_t i = 0; i < n; i++) p[i] = 65535 - p[i];
+	}
+	break;
+	case REAL_32:
+	{
+		double vmin, vmax;
+		GetValueRange(vmin, vmax);
+		float* p = (float*)m_pb;
+		for (size_t i = 0; i < n; i++) p[i] = (float)(vmax + vmin - p[i]);
+	}
+	break;
+	}
+	m_validRange = false;
 }
 
 void C3DImage::Zero()
 {
-	int n = m_cx*m_cy*m_cz;
-	for (int i=0; i<n; i++) m_pb[i] = 0;
+	if (IsBricked()) return;
+	memset(m_pb, 0, (size_t)m_cx*m_cy*m_cz*BytesPerVoxel());
+	m_validRange = false;
 }
 
 void C3DImage::FlipZ()
 {
-	int nsize = m_cx*m_cy;
+	if (IsBricked()) return;
+	int nsize = m_cx*m_cy*BytesPerVoxel();
 	Byte* buf = new Byte[nsize];
 	for (int i = 0; i < m_cz / 2; ++i)
 	{
@@ -26,11 +26,61 @@ SOFTWARE.*/
 
 #pragma once
 #include "Image.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+//-----------------------------------------------------------------------------
+// Base class for readers that can load a sub-block of voxels from an image file.
+// This is used by bricked 3D images to load bricks on demand.
+class C3DImageBrickReader
+{
+public:
+	C3DImageBrickReader() {}
+	virtual ~C3DImageBrickReader() {}
+
+	// Read the block [i0, i0+nx) x [j0, j0+ny) x [k0, k0+nz) into dst.
+	// The voxels are stored with x running fastest.
+	virtual bool ReadBlock(int i0, int j0, int k0, int nx, int ny, int nz, void* dst) = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Reads blocks from a raw (uncompressed, x-fastest) image file.
+class CRawImageBrickReader : public C3DImageBrickReader
+{
+public:
+	CRawImageBrickReader();
+	~CRawImageBrickReader();
+
+	bool Open(const char* szfile, int nx, int ny, int nz, int bytesPerVoxel, size_t headerSize = 0);
+	void Close();
+
+	bool ReadBlock(int i0, int j0, int k0, int nx, int ny, int nz, void* dst) override;
+
+private:
+	FILE*	m_fp;
+	int		m_nx, m_ny, m_nz;
+	int		m_bpv;		// bytes per voxel
+	size_t	m_offset;	// header size
+};
 
 //-----------------------------------------------------------------------------
 // A class for representing 3D image stacks
+// The voxel data can be stored as 8-bit, 16-bit or floating point values. The
+// data is either stored in a single contiguous buffer, or in bricks that are 
+// loaded on demand from a brick reader. In the latter case, only a limited number 
+// of bricks are kept in memory.
 class C3DImage
 {
+public:
+	enum PixelType {
+		UINT_8,
+		UINT_16,
+		REAL_32
+	};
+
 public:
 	C3DImage();
 	virtual ~C3DImage();
@@ -38,6 +88,12 @@ public:
 
 	bool Create(int nx, int ny, int nz, Byte* data = nullptr, int dataSize = 0);
 
+	// Create an image with the given pixel type. If data is not null, the image takes ownership.
+	bool Create(int nx, int ny, int nz, PixelType pixelType, void* data);
+
+	// Create a bricked image. The image takes ownership of the reader.
+	bool CreateBricked(int nx, int ny, int nz, PixelType pixelType, C3DImageBrickReader* reader, int brickSize = 64, int maxResidentBricks = 512);
+
 	bool LoadFromFile(const char* szfile, int nbits);
 
 	void BitBlt(CImage& im, int nslice);
@@ -48,10 +104,28 @@ public:
 	int Height() { return m_cy; }
 	int Depth () { return m_cz; }
 
+	PixelType GetPixelType() const { return m_pixelType; }
+	int BytesPerVoxel() const;
+	bool IsBricked() const { return (m_reader != nullptr); }
+
+	// Only valid for contiguous 8-bit images
 	Byte& value(int i, int j, int k) { return m_pb[m_cx*(k*m_cy + j) + i]; }
 	Byte Value(double fx, double fy, int nz);
 	Byte Peek(double fx, double fy, double fz);
 
+	// full precision access (valid for all pixel types and storage layouts)
+	double GetValue(int i, int j, int k);
+	double PeekValue(double r, double s, double t);
+
+	// get the range of voxel values (this is [0,255] for 8-bit images)
+	void GetValueRange(double& vmin, double& vmax);
+
+	// Override the value range that is mapped to bytes
+	void SetValueRange(double vmin, double vmax);
+
+	// map a full precision value to [0,255] using the image's value range
+	Byte ToByte(double v);
+
 	void Histogram(int* pdf);
 
 	void GetSliceX(CImage& im, int n);
@@ -64,17 +138,47 @@ public:
 
 	void Invert();
 
+	// Returns the voxel buffer. Only valid for contiguous images.
 	Byte* GetBytes() { return m_pb; }
 
+	// Fill buf with the image data mapped to 8-bits
+	void GetByteData(std::vector<Byte>& buf);
+
 	void Zero();
 
 	void FlipZ();
 
+private:
+	double BrickValue(int i, int j, int k);
+	std::shared_ptr<Byte> LoadBrick(int n);
+	void ClearBricks();
+	void UpdateValueRange();
+
+	template <class T> void ScanRange(const T* p, size_t n, double& vmin, double& vmax);
+
 protected:
 	Byte*	m_pb;	// image data
 	int		m_cx;
 	int		m_cy;
 	int		m_cz;
+
+	PixelType	m_pixelType;
+
+	// value range
+	bool	m_validRange;
+	double	m_vmin, m_vmax;
+
+	// bricked storage
+	C3DImageBrickReader*	m_reader;
+	int		m_brickSize;
+	int		m_nbx, m_nby, m_nbz;	// number of bricks in each direction
+	int		m_maxBricks;			// max number of resident bricks
+	std::vector<std::shared_ptr<Byte> >	m_brick;	// brick data (null if not loaded)
+	std::vector<unsigned long long>	m_brickTag;	// last access tag of each brick
+	std::vector<int>		m_resident;	// list of loaded bricks
+	unsigned long long		m_tag;
+	unsigned long long		m_brickSetId;	// identifies the bricks in the per-thread brick caches
+	std::mutex				m_brickLock;
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,244 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "3DImagePyramid.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// identifier of the pyramid cache files
+static const char CACHE_ID[4] = { 'L', 'O', 'D', '1' };
+
+C3DImagePyramid::C3DImagePyramid() : m_cancel(false)
+{
+
+}
+
+C3DImagePyramid::~C3DImagePyramid()
+{
+	Clear();
+}
+
+void C3DImagePyramid::Clear()
+{
+	// level 0 is not owned
+	for (size_t i = 1; i < m_level.size(); ++i) delete m_level[i];
+	m_level.clear();
+}
+
+bool C3DImagePyramid::Build(C3DImage* im, int minSize)
+{
+	Clear();
+	if (im == nullptr) return false;
+
+	m_level.push_back(im);
+	C3DImage* pl = im;
+	while ((pl->Width() > minSize) || (pl->Height() > minSize) || (pl->Depth() > minSize))
+	{
+		C3DImage* pn = Downsample(*pl);
+		if (pn == nullptr) break;
+		m_level.push_back(pn);
+		pl = pn;
+
+		if (m_cancel) { Clear(); return false; }
+	}
+	ShareValueRange();
+
+	return true;
+}
+
+void C3DImagePyramid::ShareValueRange()
+{
+	if (m_level.empty()) return;
+
+	double vmin, vmax;
+	m_level[0]->GetValueRange(vmin, vmax);
+	for (size_t i = 1; i < m_level.size(); ++i) m_level[i]->SetValueRange(vmin, vmax);
+}
+
+// Create an image at half the resolution by averaging blocks of 2x2x2 voxels.
+C3DImage* C3DImagePyramid::Downsample(C3DImage& im)
+{
+	int nx = im.Width();
+	int ny = im.Height();
+	int nz = im.Depth();
+	int mx = (nx + 1) / 2;
+	int my = (ny + 1) / 2;
+	int mz = (nz + 1) / 2;
+
+	C3DImage::PixelType pixelType = im.GetPixelType();
+	C3DImage* pd = new C3DImage;
+	if (pd->Create(mx, my, mz, pixelType, nullptr) == false)
+	{
+		delete pd;
+		return nullptr;
+	}
+	Byte* pb = pd->GetBytes();
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int k = 0; k < mz; ++k)
+	{
+		if (m_cancel) continue;
+
+		int k0 = 2 * k, k1 = (k0 + 1 < nz ? k0 + 1 : k0);
+		for (int j = 0; j < my; ++j)
+		{
+			int j0 = 2 * j, j1 = (j0 + 1 < ny ? j0 + 1 : j0);
+			size_t n = ((size_t)k*my + j)*mx;
+			for (int i = 0; i < mx; ++i, ++n)
+			{
+				int i0 = 2 * i, i1 = (i0 + 1 < nx ? i0 + 1 : i0);
+				double v = 0.125*(
+					im.GetValue(i0, j0, k0) + im.GetValue(i1, j0, k0) +
+					im.GetValue(i0, j1, k0) + im.GetValue(i1, j1, k0) +
+					im.GetValue(i0, j0, k1) + im.GetValue(i1, j0, k1) +
+					im.GetValue(i0, j1, k1) + im.GetValue(i1, j1, k1));
+
+				switch (pixelType)
+				{
+				case C3DImage::UINT_8 : pb[n] = (Byte)(v + 0.5); break;
+				case C3DImage::UINT_16: ((unsigned short*)pb)[n] = (unsigned short)(v + 0.5); break;
+				case C3DImage::REAL_32: ((float*)pb)[n] = (float)v; break;
+				}
+			}
+		}
+	}
+
+	return pd;
+}
+
+int C3DImagePyramid::FindLevel(int size)
+{
+	int n = 0;
+	for (int i = 1; i < Levels(); ++i)
+	{
+		C3DImage& im = *m_level[i];
+		int m = im.Width();
+		if (im.Height() > m) m = im.Height();
+		if (im.Depth () > m) m = im.Depth();
+		if (m < size) break;
+		n = i;
+	}
+	return n;
+}
+
+int C3DImagePyramid::FindLevel(int nx, int ny, int nz)
+{
+	int n = 0;
+	for (int i = 1; i < Levels(); ++i)
+	{
+		C3DImage& im = *m_level[i];
+		if ((im.Width() < nx) || (im.Height() < ny) || (im.Depth() < nz)) break;
+		n = i;
+	}
+	return n;
+}
+
+bool C3DImagePyramid::Save(const char* szfile)
+{
+	if (Levels() < 1) return false;
+
+	FILE* fp = fopen(szfile, "wb");
+	if (fp == nullptr) return false;
+
+	// write the header
+	C3DImage& im0 = *m_level[0];
+	int hdr[5] = { im0.Width(), im0.Height(), im0.Depth(), (int)im0.GetPixelType(), Levels() };
+	fwrite(CACHE_ID, 1, 4, fp);
+	fwrite(hdr, sizeof(int), 5, fp);
+
+	// write the coarse levels
+	bool bok = true;
+	for (int i = 1; i < Levels(); ++i)
+	{
+		C3DImage& im = *m_level[i];
+		int dim[3] = { im.Width(), im.Height(), im.Depth() };
+		size_t nsize = (size_t)dim[0] * dim[1] * dim[2] * im.BytesPerVoxel();
+		fwrite(dim, sizeof(int), 3, fp);
+		if (fwrite(im.GetBytes(), 1, nsize, fp) != nsize) { bok = false; break; }
+	}
+	fclose(fp);
+
+	if (!bok) remove(szfile);
+
+	return bok;
+}
+
+bool C3DImagePyramid::Load(const char* szfile, C3DImage* im, const char* szsource)
+{
+	Clear();
+	if (im == nullptr) return false;
+
+	// make sure the cache is not older than the source
+	if (szsource)
+	{
+		struct stat src, lod;
+		if (stat(szfile, &lod) != 0) return false;
+		if ((stat(szsource, &src) == 0) && (src.st_mtime > lod.st_mtime)) return false;
+	}
+
+	FILE* fp = fopen(szfile, "rb");
+	if (fp == nullptr) return false;
+
+	// read and check the header
+	char id[4] = { 0 };
+	int hdr[5] = { 0 };
+	if ((fread(id, 1, 4, fp) != 4) || (memcmp(id, CACHE_ID, 4) != 0) || (fread(hdr, sizeof(int), 5, fp) != 5) ||
+		(hdr[0] != im->Width()) || (hdr[1] != im->Height()) || (hdr[2] != im->Depth()) || (hdr[3] != (int)im->GetPixelType()) || (hdr[4] < 1))
+	{
+		fclose(fp);
+		return false;
+	}
+
+	m_level.push_back(im);
+	for (int i = 1; i < hdr[4]; ++i)
+	{
+		int dim[3];
+		C3DImage* pl = new C3DImage;
+		if ((fread(dim, sizeof(int), 3, fp) != 3) || (pl->Create(dim[0], dim[1], dim[2], im->GetPixelType(), nullptr) == false))
+		{
+			delete pl;
+			fclose(fp);
+			Clear();
+			return false;
+		}
+
+		size_t nsize = (size_t)dim[0] * dim[1] * dim[2] * pl->BytesPerVoxel();
+		if (fread(pl->GetBytes(), 1, nsize, fp) != nsize)
+		{
+			delete pl;
+			fclose(fp);
+			Clear();
+			return false;
+		}
+		m_level.push_back(pl);
+	}
+	fclose(fp);
+	ShareValueRange();
+
+	return true;
+}
@@ -0,0 +1,78 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include "3DImage.h"
+#include <vector>
+#include <atomic>
+
+//-----------------------------------------------------------------------------
+// A multi-resolution (mipmap) pyramid of a 3D image. Level 0 is the original 
+// image, and each subsequent level halves the resolution in each direction.
+// The coarse levels can be cached to disk so they only need to be built once.
+class C3DImagePyramid
+{
+public:
+	C3DImagePyramid();
+	~C3DImagePyramid();
+
+	void Clear();
+
+	// Build the pyramid for the image (the image is not owned by the pyramid).
+	// Levels are added until all dimensions are below minSize.
+	// Returns false if the build failed or was canceled.
+	bool Build(C3DImage* im, int minSize = 32);
+
+	// Stop a build that is running on another thread
+	void Cancel() { m_cancel = true; }
+	bool IsCanceled() const { return m_cancel; }
+
+	// Save the coarse levels to a cache file
+	bool Save(const char* szfile);
+
+	// Load the coarse levels from a cache file. This fails if the cache does 
+	// not match the image or if the cache is older than the source file.
+	bool Load(const char* szfile, C3DImage* im, const char* szsource = nullptr);
+
+	int Levels() const { return (int)m_level.size(); }
+	C3DImage* Level(int n) { return m_level[n]; }
+
+	// Find the coarsest level whose largest dimension is at least the requested size
+	int FindLevel(int size);
+
+	// Find the coarsest level whose dimensions are at least the requested dimensions
+	int FindLevel(int nx, int ny, int nz);
+
+private:
+	C3DImage* Downsample(C3DImage& im);
+
+	// the coarse levels use the value range of the source image
+	void ShareValueRange();
+
+private:
+	std::vector<C3DImage*>	m_level;	// level 0 is the source image (not owned)
+	std::atomic<bool>		m_cancel;
+};
@@ -29,6 +29,7 @@ DEALINGS IN THE SOFTWARE.
 #ifdef HAS_TEEM
 #include "tif_reader.h"
 #include "compatibility.h"
+#include <chrono>
 
 TIFReader::TIFReader()
 {
@@ -61,6 +62,10 @@ TIFReader::TIFReader()
 	swap_ = false;
 	isBig_ = false;
 	isHyperstack_ = false;
+
+	m_pageIndexChannel = -1;
+	m_readBytes = 0.0;
+	m_readSeconds = 0.0;
 }
 
 TIFReader::~TIFReader()
@@ -92,6 +97,8 @@ int TIFReader::Preprocess()
 	int i;
 
 	m_4d_seq.clear();
+	m_pageIndex.clear();
+	m_pageIndexChannel = -1;
 	isHyperstack_ = false;
 	isHsTimeSeq_ = false;
 	imagej_raw_ = false;
@@ -1816,4 +1823,313 @@ Nrrd* TIFReader::ReadTiff(std::vector<SliceInfo> &filelist,
 
 	return nrrdout;
 }
+//-----------------------------------------------------------------------------
+bool TIFReader::GetStackSize(int& nx, int& ny, int& nz, int& bits)
+{
+	if (m_4d_seq.empty() || m_4d_seq[0].slices.empty()) return false;
+
+	std::vector<SliceInfo>& slices = m_4d_seq[0].slices;
+	std::wstring filename = ((isHyperstack_ && !isHsTimeSeq_) ? m_path_name : slices[0].slice);
+	try {
+		OpenTiff(filename);
+		InvalidatePageInfo();
+		nx = (int)GetTiffField(kImageWidthTag);
+		ny = (int)GetTiffField(kImageLengthTag);
+		bits = (int)GetTiffField(kBitsPerSampleTag);
+		if (slices.size() > 1) nz = (int)slices.size();
+		else if (isHyperstack_ || imagej_raw_possible_) nz = m_slice_num;
+		else nz = (int)GetNumTiffPages();
+		CloseTiff();
+	}
+	catch (...)
+	{
+		CloseTiff();
+		return false;
+	}
+
+	return ((nx > 0) && (ny > 0) && (nz > 0));
+}
+
+//-----------------------------------------------------------------------------
+// Collect the strip/tile layout of a page. This uses the main stream and must be
+// called for the pages in increasing order (per file) to avoid rewinding.
+bool TIFReader::GetPageLayout(const std::wstring& file, uint64_t page, PageLayout& L)
+{
+	if (!tiff_stream.is_open() || (file != L.file))
+	{
+		CloseTiff();
+		OpenTiff(file);
+		imagej_raw_ = false;
+		InvalidatePageInfo();
+	}
+	L.file = file;
+
+	if (!imagej_raw_)
+	{
+		TurnToPage(page);
+		if (!imagej_raw_)
+		{
+			InvalidatePageInfo();
+			ReadTiffFields();
+		}
+	}
+
+	L.width = GetTiffField(kImageWidthTag);
+	L.height = GetTiffField(kImageLengthTag);
+	L.bits = (int)GetTiffField(kBitsPerSampleTag);
+	L.samples = (int)GetTiffField(kSamplesPerPixelTag); if (L.samples == 0) L.samples = 1;
+	L.planar = (int)GetTiffField(kPlanarConfigurationTag);
+	L.compression = (int)GetTiffField(kCompressionTag);
+	L.prediction = (int)GetTiffField(kPredictionTag);
+	if ((L.width == 0) || (L.height == 0) || ((L.bits != 8) && (L.bits != 16))) return false;
+
+	L.tiles = GetTiffUseTiles() && (GetTiffTileNum() > 0);
+	if (L.tiles)
+	{
+		L.block_w = GetTiffField(kTileWidthTag);
+		L.block_h = GetTiffField(kTileLengthTag);
+		L.offsets = m_page_info.ull_tile_offsets;
+		L.counts = m_page_info.ull_tile_byte_counts;
+	}
+	else
+	{
+		uint64_t rps = GetTiffField(kRowsPerStripTag);
+		L.block_w = L.width;
+		L.block_h = ((rps > 0) && (rps < L.height) ? rps : L.height);
+		if (imagej_raw_)
+		{
+			// ImageJ raw stacks only store the first page's header.
+			// The pages follow each other without gaps.
+			uint64_t pageBytes = L.width*L.height*L.samples*(L.bits / 8);
+			L.block_h = L.height;
+			L.offsets.assign(1, m_page_info.ull_strip_offsets[0] + page*pageBytes);
+			L.counts.assign(1, pageBytes);
+		}
+		else
+		{
+			L.offsets = m_page_info.ull_strip_offsets;
+			L.counts = m_page_info.ull_strip_byte_counts;
+			if (L.counts.empty() && (L.offsets.size() == 1))
+				L.counts.assign(1, L.width*L.height*L.samples*(L.bits / 8));
+		}
+	}
+
+	return (!L.offsets.empty() && (L.offsets.size() == L.counts.size()));
+}
+
+//-----------------------------------------------------------------------------
+// Decode the part of a page that overlaps the region and copy the sampled voxels
+// to dst. Returns the number of bytes read from the file.
+uint64_t TIFReader::DecodePage(std::ifstream& is, const PageLayout& L, int c,
+	int x0, int y0, int nx, int ny, int step, void* dst)
+{
+	int bpp = L.bits / 8;
+	bool planar = (L.planar == 2);
+	int stride = (planar ? 1 : L.samples);
+	int sampleOffset = (planar ? 0 : c);
+	uint64_t bw = L.block_w;
+	uint64_t bh = L.block_h;
+	uint64_t nbx = (L.width + bw - 1) / bw;
+	uint64_t nby = (L.height + bh - 1) / bh;
+	uint64_t blocksPerPlane = nbx*nby;
+
+	int onx = (nx + step - 1) / step;
+	uint64_t blockBytes = bw*bh*stride*bpp;
+	std::vector<unsigned char> raw, buf(blockBytes);
+	uint64_t bytesRead = 0;
+
+	int x1 = x0 + nx - 1;
+	int y1 = y0 + ny - 1;
+	for (uint64_t by = (uint64_t)y0 / bh; by <= (uint64_t)y1 / bh; ++by)
+		for (uint64_t bx = (uint64_t)x0 / bw; bx <= (uint64_t)x1 / bw; ++bx)
+		{
+			uint64_t block = by*nbx + bx + (planar ? c*blocksPerPlane : 0);
+			if (block >= L.offsets.size()) continue;
+
+			// does this block contain any sampled voxel?
+			int bx0 = (int)(bx*bw), by0 = (int)(by*bh);
+			int bx1 = (int)std::min<uint64_t>(bx0 + bw, L.width) - 1;
+			int by1 = (int)std::min<uint64_t>(by0 + bh, L.height) - 1;
+			int ys = std::max(y0, by0); ys = y0 + ((ys - y0 + step - 1) / step)*step;
+			int xs = std::max(x0, bx0); xs = x0 + ((xs - x0 + step - 1) / step)*step;
+			if ((ys > std::min(y1, by1)) || (xs > std::min(x1, bx1))) continue;
+
+			// read the block
+			uint64_t count = L.counts[block];
+			raw.resize(count);
+			is.seekg(L.offsets[block], is.beg);
+			is.read((char*)raw.data(), count);
+			bytesRead += count;
+
+			// decompress
+			if (L.compression == 5)
+			{
+				LZWDecode((tidata_t)raw.data(), (tidata_t)buf.data(), (tsize_t)blockBytes);
+				if (L.prediction == 2)
+				{
+					uint64_t rowBytes = bw*stride*bpp;
+					for (uint64_t j = 0; j < bh; ++j)
+						if (bpp == 1) DecodeAcc8((tidata_t)buf.data() + j*rowBytes, (tsize_t)rowBytes, stride);
+						else DecodeAcc16((tidata_t)buf.data() + j*rowBytes, (tsize_t)rowBytes, stride);
+				}
+			}
+			else memcpy(buf.data(), raw.data(), std::min<uint64_t>(count, blockBytes));
+
+			if (swap_ && (bpp == 2))
+			{
+				uint16_t* p = (uint16_t*)buf.data();
+				for (uint64_t i = 0; i < blockBytes / 2; ++i) p[i] = SwapShort(p[i]);
+			}
+
+			// copy the sampled voxels
+			for (int y = ys; y <= std::min(y1, by1); y += step)
+			{
+				size_t row = (size_t)((y - y0) / step)*onx;
+				const unsigned char* ps = buf.data() + ((uint64_t)(y - by0)*bw*stride + sampleOffset)*bpp;
+				for (int x = xs; x <= std::min(x1, bx1); x += step)
+				{
+					size_t n = row + (x - x0) / step;
+					size_t m = (size_t)(x - bx0)*stride;
+					if (bpp == 1) ((unsigned char*)dst)[n] = ps[m];
+					else ((uint16_t*)dst)[n] = ((const uint16_t*)ps)[m];
+				}
+			}
+		}
+
+	return bytesRead;
+}
+
+//-----------------------------------------------------------------------------
+// Collect the layouts of all the pages of channel c of the first time point. This
+// walks the page headers once, so that region reads don't have to.
+bool TIFReader::BuildPageIndex(int c)
+{
+	if ((m_pageIndexChannel == c) && !m_pageIndex.empty()) return true;
+	m_pageIndex.clear();
+	m_pageIndexChannel = -1;
+
+	int nx, ny, nz, bits;
+	if (GetStackSize(nx, ny, nz, bits) == false) return false;
+
+	std::vector<SliceInfo>& slices = m_4d_seq[0].slices;
+	bool sequence = (slices.size() > 1);
+
+	std::vector<PageLayout> pages(nz);
+	try {
+		for (int z = 0; z < nz; ++z)
+		{
+			std::wstring file;
+			uint64_t page = 0;
+			if (sequence)
+			{
+				file = slices[z].slice;
+			}
+			else if (isHyperstack_)
+			{
+				file = (isHsTimeSeq_ ? slices[0].slice : m_path_name);
+				page = slices[0].pagenumber + c + (uint64_t)z*m_chan_num;
+			}
+			else
+			{
+				file = slices[0].slice;
+				page = z;
+			}
+
+			if (z > 0) pages[z].file = pages[z - 1].file;
+			if (GetPageLayout(file, page, pages[z]) == false)
+			{
+				CloseTiff();
+				return false;
+			}
+		}
+		CloseTiff();
+	}
+	catch (...)
+	{
+		CloseTiff();
+		return false;
+	}
+
+	m_pageIndex.swap(pages);
+	m_pageIndexChannel = c;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+unsigned char* TIFReader::ReadRegion(int x0, int y0, int z0, int nx, int ny, int nz, int step, int c, int& bits)
+{
+	if (m_4d_seq.empty() || m_4d_seq[0].slices.empty()) return nullptr;
+	if ((nx <= 0) || (ny <= 0) || (nz <= 0) || (x0 < 0) || (y0 < 0) || (z0 < 0)) return nullptr;
+	if (step < 1) step = 1;
+
+	auto start = std::chrono::steady_clock::now();
+
+	int onx = (nx + step - 1) / step;
+	int ony = (ny + step - 1) / step;
+	int onz = (nz + step - 1) / step;
+
+	// the page layouts are collected on the first read
+	if (BuildPageIndex(c) == false) return nullptr;
+	if (z0 + (onz - 1)*step >= (int)m_pageIndex.size()) return nullptr;
+	const PageLayout* pages = &m_pageIndex[z0];
+
+	// all pages must have the same format
+	bits = pages[0].bits;
+	for (int k = 0; k < onz; ++k)
+	{
+		const PageLayout& L = pages[k*step];
+		if ((L.bits != bits) || ((uint64_t)(x0 + nx) > L.width) || ((uint64_t)(y0 + ny) > L.height)) return nullptr;
+		if (!isHyperstack_ && ((c < 0) || (c >= L.samples))) return nullptr;
+	}
+
+	// in hyperstacks the channels are separate pages
+	int channel = (isHyperstack_ ? 0 : c);
+
+	size_t sliceSize = (size_t)onx*ony*(bits / 8);
+	unsigned char* data = new unsigned char[sliceSize*onz];
+	memset(data, 0, sliceSize*onz);
+
+	// decode the pages concurrently
+	uint64_t totalBytes = 0;
+	bool bok = true;
+	#pragma omp parallel shared(bok) reduction(+:totalBytes)
+	{
+		std::ifstream is;
+		std::wstring openFile;
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int k = 0; k < onz; ++k)
+		{
+			if (!bok) continue;
+
+			const PageLayout& L = pages[k*step];
+			if (L.file != openFile)
+			{
+				if (is.is_open()) is.close();
+#ifdef _WIN32
+				is.open(L.file.c_str(), std::ifstream::binary);
+#else
+				is.open(ws2s(L.file).c_str(), std::ifstream::binary);
+#endif
+				openFile = L.file;
+			}
+
+			if (!is.is_open()) { bok = false; continue; }
+
+			totalBytes += DecodePage(is, L, channel, x0, y0, nx, ny, step, data + k*sliceSize);
+		}
+	}
+
+	if (!bok)
+	{
+		delete[] data;
+		return nullptr;
+	}
+
+	m_readBytes += (double)totalBytes;
+	m_readSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return data;
+}
+
 #endif
@@ -184,6 +184,26 @@ public:
   std::tuple<size_t,size_t,size_t,int> GetTiffInfo();
   unsigned char* GetRawImage() { return rawImage; }
 
+	/**
+	 * Gets the dimensions of the stack of the first time point without reading
+	 * the image data. Preprocess must be called first.
+	 * @return false if the stack cannot be opened.
+	 */
+	bool GetStackSize(int& nx, int& ny, int& nz, int& bits);
+	/**
+	 * Reads the sub-volume [x0,x0+nx) x [y0,y0+ny) x [z0,z0+nz) of channel c of the
+	 * first time point, keeping every step-th voxel in each direction. The page layouts
+	 * are indexed on the first call and reused after that. The pages are decoded concurrently, each thread
+	 * reading through its own file stream. Only the strips/tiles that overlap the
+	 * region are read. Preprocess must be called first.
+	 * @return A buffer of (nx/step)*(ny/step)*(nz/step) voxels (rounded up), with 8 or
+	 * 16 bits per voxel, as returned in bits. The caller owns the buffer (delete[] as
+	 * unsigned char). Returns nullptr on failure.
+	 */
+	unsigned char* ReadRegion(int x0, int y0, int z0, int nx, int ny, int nz, int step, int c, int& bits);
+	/** The throughput (in MB/s of file data) of all calls to ReadRegion so far. */
+	double GetThroughput() const { return (m_readSeconds > 0.0 ? (m_readBytes / (1024.0*1024.0)) / m_readSeconds : 0.0); }
+
 private:
 	std::wstring m_data_name;
 	bool isBig_;
@@ -194,6 +214,26 @@ private:
   
   void loadTiffInfo(size_t x, size_t y, size_t pages, int bits);
 
+	// layout of the image data of a page, used by ReadRegion
+	struct PageLayout
+	{
+		std::wstring file;
+		bool tiles;
+		uint64_t width, height;
+		uint64_t block_w, block_h;	// strip or tile size
+		int bits, samples, planar;
+		int compression, prediction;
+		std::vector<unsigned long long> offsets;
+		std::vector<unsigned long long> counts;
+	};
+	bool GetPageLayout(const std::wstring& file, uint64_t page, PageLayout& layout);
+	bool BuildPageIndex(int c);
+	std::vector<PageLayout>	m_pageIndex;	// layouts of the pages of channel m_pageIndexChannel
+	int		m_pageIndexChannel;
+	double	m_readBytes;	// file data read by ReadRegion
+	double	m_readSeconds;	// time spent in ReadRegion
+	uint64_t DecodePage(std::ifstream& is, const PageLayout& layout, int c, int x0, int y0, int nx, int ny, int step, void* dst);
+
 	struct SliceInfo
 	{
 		int slicenumber;	//slice number for sorting
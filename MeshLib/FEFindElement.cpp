@@ -288,6 +288,7 @@ void FEFindElement::InitCurrentFrame(vector<bool>& flags)
 void FEFindElement::Init(int nframe)
 {
 	vector<bool> dummy;
+	m_flags.clear();
 	m_nframe = nframe;
 	if (m_nframe == 0) InitReferenceFrame(dummy);
 	else InitCurrentFrame(dummy);
@@ -295,6 +296,7 @@ void FEFindElement::Init(int nframe)
 
 void FEFindElement::Init(vector<bool>& flags, int nframe)
 {
+	m_flags = flags;
 	m_nframe = nframe;
 	if (m_nframe == 0) InitReferenceFrame(flags);
 	else InitCurrentFrame(flags);
@@ -363,3 +365,55 @@ bool FEFindElement::FindInCurrentFrame(const vec3f& x, int& nelem, double r[3])
 	nelem = -1;
 	return false;
 }
+
+// project x into element nelem, if that element is part of the search
+bool FEFindElement::ProjectInside(int nelem, const vec3f& x, double r[3])
+{
+	FEElement_& e = m_mesh.ElementRef(nelem);
+	if (e.IsSolid() == false) return false;
+	if (m_flags.empty() == false)
+	{
+		int mid = e.m_MatID;
+		if ((mid >= 0) && (mid < (int)m_flags.size()) && (m_flags[mid] == false)) return false;
+	}
+
+	if (m_nframe == 0)
+		return ProjectInsideReferenceElement(m_mesh, e, x, r);
+	else
+		return ProjectInsideElement(m_mesh, e, x, r);
+}
+
+bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3], int nhint)
+{
+	if ((nhint < 0) || (nhint >= m_mesh.Elements())) return FindElement(x, nelem, r);
+
+	// try the hint first
+	if (ProjectInside(nhint, x, r)) { nelem = nhint; return true; }
+
+	// walk over the neighbors, and then the neighbors of the neighbors
+	FEElement_& e0 = m_mesh.ElementRef(nhint);
+	int nf0 = e0.Faces();
+	for (int i = 0; i < nf0; ++i)
+	{
+		int ni = e0.m_nbr[i];
+		if ((ni >= 0) && ProjectInside(ni, x, r)) { nelem = ni; return true; }
+	}
+
+	for (int i = 0; i < nf0; ++i)
+	{
+		int ni = e0.m_nbr[i];
+		if (ni < 0) continue;
+
+		FEElement_& ei = m_mesh.ElementRef(ni);
+		int nfi = ei.Faces();
+		for (int j = 0; j < nfi; ++j)
+		{
+			int nj = ei.m_nbr[j];
+			if ((nj < 0) || (nj == nhint)) continue;
+			if (ProjectInside(nj, x, r)) { nelem = nj; return true; }
+		}
+	}
+
+	// the point left the neighborhood, so do the global search
+	return FindElement(x, nelem, r);
+}
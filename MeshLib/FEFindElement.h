@@ -61,6 +61,10 @@ public:
 
 	bool FindElement(const vec3f& x, int& nelem, double r[3]);
 
+	// Same as above, but first looks in element nhint and its neighbors, which is much
+	// faster for points that move through the mesh in small steps.
+	bool FindElement(const vec3f& x, int& nelem, double r[3], int nhint);
+
 	BOX BoundingBox() const { return m_bound.m_box; }
 
 private:
@@ -70,6 +74,8 @@ private:
 	bool FindInReferenceFrame(const vec3f& x, int& nelem, double r[3]);
 	bool FindInCurrentFrame(const vec3f& x, int& nelem, double r[3]);
 
+	bool ProjectInside(int nelem, const vec3f& x, double r[3]);
+
 private:
 	OCTREE_BOX* FindBox(const vec3f& r);
 
@@ -77,6 +83,7 @@ private:
 	OCTREE_BOX	m_bound;
 	FECoreMesh&	m_mesh;
 	int			m_nframe;	// = 0 reference, 1 = current
+	vector<bool>	m_flags;	// material flags passed to Init
 };
 
 inline bool FEFindElement::FindElement(const vec3f& x, int& nelem, double r[3])
@@ -36,10 +36,13 @@ SOFTWARE.*/
 #include "MeshTools/FESurfaceData.h"
 #include "MeshTools/FEElementData.h"
 #include "FEMeshBuilder.h"
+#include "FESelectionBits.h"
 #include <MeshTools/GLMesh.h>
 #include <algorithm>
 #include <unordered_set>
 #include <map>
+#include <memory>
+#include <zlib.h>
 //using namespace std;
 
 double bias(double b, double x)
@@ -169,12 +172,18 @@ void Mesh_Data::GetValueRange(double& vmin, double& vmax) const
 FEMesh::FEMesh()
 {
 	m_pobj = 0;
+	m_znodes = m_zelems = 0;
+	m_zraw = 0;
 }
 
 //-----------------------------------------------------------------------------
 // copy constructor
 FEMesh::FEMesh(FEMesh& m)
 {
+	assert(m.IsCompressed() == false);
+	m_znodes = m_zelems = 0;
+	m_zraw = 0;
+
 	// create the nodes
 	m_Node.resize(m.Nodes());
 	for (int i=0; i<Nodes(); ++i) m_Node[i] = m.m_Node[i];
@@ -204,6 +213,9 @@ FEMesh::FEMesh(FEMesh& m)
 //-----------------------------------------------------------------------------
 FEMesh::FEMesh(FESurfaceMesh& m)
 {
+	m_znodes = m_zelems = 0;
+	m_zraw = 0;
+
 	int NN = m.Nodes();
 	int NF = m.Faces();
 	int NE = m.Edges();
@@ -260,6 +272,10 @@ void FEMesh::Clear()
 	m_Elem.clear();
 	m_Node.clear();
 
+	std::vector<unsigned char>().swap(m_zdata);
+	m_znodes = m_zelems = 0;
+	m_zraw = 0;
+
 	ClearMeshData();
 }
 
@@ -441,6 +457,8 @@ void FEMesh::UpdateFacePartitions()
 // This needs to be called after the number of faces changes.
 void FEMesh::UpdateSmoothingGroups()
 {
+	SmoothingChanged();
+
 	// find the largest SG
 	int max_sg = -1;
 	for (int i = 0; i<Faces(); ++i)
@@ -1391,29 +1409,162 @@ FEMesh* FEMesh::ExtractFaces(bool selectedOnly)
 }
 
 //-----------------------------------------------------------------------------
-// Save mesh data to archive
-//
-void FEMesh::Save(OArchive &ar)
+// Packed records of the node and element data that are compressed.
+struct PACKED_NODE
 {
-	int nodes = Nodes();
-	int elems = Elements();
-	int faces = Faces();
-	int edges = Edges();
+	int		ntag, gid, nid;
+	unsigned int	state;
+	vec3d	r;
+};
 
-	// write the header
-	ar.BeginChunk(CID_MESH_HEADER);
+struct PACKED_ELEM
+{
+	int		ntag, gid, nid;
+	unsigned int	state;
+	int		type;
+	int		node[FEElement::MAX_NODES];
+	int		nbr[6];
+	int		face[6];
+	double	h[9];
+	int		lid, MatID;
+	float	tex;
+	int		Qactive;
+	vec3d	fiber;
+	mat3d	Q;
+	double	a0;
+};
+
+bool FEMesh::Compress()
+{
+	if (IsCompressed()) return false;
+
+	int NN = Nodes();
+	int NE = Elements();
+	size_t raw = NN*sizeof(PACKED_NODE) + NE*sizeof(PACKED_ELEM);
+	if (raw == 0) return false;
+
+	// the records are zeroed first, so that the padding compresses well
+	std::vector<unsigned char> buf(raw, 0);
+	PACKED_NODE* pn = (PACKED_NODE*)buf.data();
+	for (int i = 0; i < NN; ++i, ++pn)
 	{
-		ar.WriteChunk(CID_MESH_NODES, nodes);
-		ar.WriteChunk(CID_MESH_ELEMENTS, elems);
-		ar.WriteChunk(CID_MESH_FACES, faces);
-		ar.WriteChunk(CID_MESH_EDGES, edges);
+		const FENode& node = m_Node[i];
+		pn->ntag  = node.m_ntag;
+		pn->gid   = node.m_gid;
+		pn->nid   = node.m_nid;
+		pn->state = node.GetFEState();
+		pn->r     = node.r;
+	}
+
+	PACKED_ELEM* pe = (PACKED_ELEM*)(buf.data() + NN*sizeof(PACKED_NODE));
+	for (int i = 0; i < NE; ++i, ++pe)
+	{
+		const FEElement& el = m_Elem[i];
+		pe->ntag  = el.m_ntag;
+		pe->gid   = el.m_gid;
+		pe->nid   = el.m_nid;
+		pe->state = el.GetFEState();
+		pe->type  = el.Type();
+		for (int j = 0; j < FEElement::MAX_NODES; ++j) pe->node[j] = el.m_node[j];
+		for (int j = 0; j < 6; ++j) pe->nbr[j] = el.m_nbr[j];
+		for (int j = 0; j < 6; ++j) pe->face[j] = el.m_face[j];
+		for (int j = 0; j < 9; ++j) pe->h[j] = el.m_h[j];
+		pe->lid     = el.m_lid;
+		pe->MatID   = el.m_MatID;
+		pe->tex     = el.m_tex;
+		pe->Qactive = (el.m_Qactive ? 1 : 0);
+		pe->fiber   = el.m_fiber;
+		pe->Q       = el.m_Q;
+		pe->a0      = el.m_a0;
+	}
+
+	uLongf zn = compressBound((uLong)raw);
+	m_zdata.resize(zn);
+	if (compress2((Bytef*)m_zdata.data(), &zn, (const Bytef*)buf.data(), (uLong)raw, Z_BEST_SPEED) != Z_OK)
+	{
+		std::vector<unsigned char>().swap(m_zdata);
+		return false;
+	}
+	m_zdata.resize(zn);
+	m_zdata.shrink_to_fit();
+
+	m_znodes = NN;
+	m_zelems = NE;
+	m_zraw = raw;
+
+	// release the arrays
+	std::vector<FENode>().swap(m_Node);
+	std::vector<FEElement>().swap(m_Elem);
+
+	return true;
+}
+
+bool FEMesh::Expand()
+{
+	if (IsCompressed() == false) return false;
+
+	std::vector<unsigned char> buf(m_zraw);
+	uLongf n = (uLongf)m_zraw;
+	if ((uncompress((Bytef*)buf.data(), &n, (const Bytef*)m_zdata.data(), (uLong)m_zdata.size()) != Z_OK) || (n != m_zraw)) return false;
+
+	int NN = m_znodes;
+	int NE = m_zelems;
+	m_Node.resize(NN);
+	m_Elem.resize(NE);
+
+	const PACKED_NODE* pn = (const PACKED_NODE*)buf.data();
+	for (int i = 0; i < NN; ++i, ++pn)
+	{
+		FENode& node = m_Node[i];
+		node.m_ntag = pn->ntag;
+		node.m_gid  = pn->gid;
+		node.m_nid  = pn->nid;
+		node.SetFEState(pn->state);
+		node.r      = pn->r;
 	}
-	ar.EndChunk();
+
+	const PACKED_ELEM* pe = (const PACKED_ELEM*)(buf.data() + NN*sizeof(PACKED_NODE));
+	for (int i = 0; i < NE; ++i, ++pe)
+	{
+		FEElement& el = m_Elem[i];
+		el.SetType(pe->type);
+		el.m_ntag = pe->ntag;
+		el.m_gid  = pe->gid;
+		el.m_nid  = pe->nid;
+		el.SetFEState(pe->state);
+		for (int j = 0; j < FEElement::MAX_NODES; ++j) el.m_node[j] = pe->node[j];
+		for (int j = 0; j < 6; ++j) el.m_nbr[j] = pe->nbr[j];
+		for (int j = 0; j < 6; ++j) el.m_face[j] = pe->face[j];
+		for (int j = 0; j < 9; ++j) el.m_h[j] = pe->h[j];
+		el.m_lid     = pe->lid;
+		el.m_MatID   = pe->MatID;
+		el.m_tex     = pe->tex;
+		el.m_Qactive = (pe->Qactive != 0);
+		el.m_fiber   = pe->fiber;
+		el.m_Q       = pe->Q;
+		el.m_a0      = pe->a0;
+	}
+
+	std::vector<unsigned char>().swap(m_zdata);
+	m_znodes = m_zelems = 0;
+	m_zraw = 0;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Writes the node, element, face, and edge sections of a mesh.
+static void saveMeshSections(OArchive& ar, const std::vector<FENode>& Node, const std::vector<FEElement>& Elem, const std::vector<FEFace>& Face, const std::vector<FEEdge>& Edge)
+{
+	int nodes = (int)Node.size();
+	int elems = (int)Elem.size();
+	int faces = (int)Face.size();
+	int edges = (int)Edge.size();
 
 	// write the nodes
 	ar.BeginChunk(CID_MESH_NODE_SECTION);
 	{
-		FENode* pn = NodePtr();
+		const FENode* pn = Node.data();
 		for (int i=0; i<nodes; ++i, ++pn)
 		{
 			ar.BeginChunk(CID_MESH_NODE);
@@ -1431,7 +1582,7 @@ void FEMesh::Save(OArchive &ar)
 	{
 		for (int i=0; i<elems; ++i)
 		{
-			FEElement_* pe = ElementPtr(i);
+			const FEElement* pe = &Elem[i];
 
 			ar.BeginChunk(CID_MESH_ELEMENT);
 			{
@@ -1454,7 +1605,7 @@ void FEMesh::Save(OArchive &ar)
 	// write the faces
 	ar.BeginChunk(CID_MESH_FACE_SECTION);
 	{
-		FEFace* pf = FacePtr();
+		const FEFace* pf = Face.data();
 		for (int i=0; i<faces; ++i, ++pf)
 		{
 			ar.BeginChunk(CID_MESH_FACE);
@@ -1475,7 +1626,7 @@ void FEMesh::Save(OArchive &ar)
 	// write the edges
 	ar.BeginChunk(CID_MESH_EDGE_SECTION);
 	{
-		FEEdge* pe = EdgePtr();
+		const FEEdge* pe = Edge.data();
 		for (int i=0; i<edges; ++i, ++pe)
 		{
 			int nn = pe->Nodes();
@@ -1490,6 +1641,41 @@ void FEMesh::Save(OArchive &ar)
 		}
 	}
 	ar.EndChunk();
+}
+
+//-----------------------------------------------------------------------------
+// Save mesh data to archive
+//
+void FEMesh::Save(OArchive &ar)
+{
+	int nodes = Nodes();
+	int elems = Elements();
+	int faces = Faces();
+	int edges = Edges();
+
+	// write the header
+	ar.BeginChunk(CID_MESH_HEADER);
+	{
+		ar.WriteChunk(CID_MESH_NODES, nodes);
+		ar.WriteChunk(CID_MESH_ELEMENTS, elems);
+		ar.WriteChunk(CID_MESH_FACES, faces);
+		ar.WriteChunk(CID_MESH_EDGES, edges);
+	}
+	ar.EndChunk();
+
+	if (ar.IsDeferring())
+	{
+		// Copy the mesh buffers, so the sections can be written after the 
+		// mesh has changed, e.g. when an autosave is written on a worker thread.
+		auto Node = std::make_shared<std::vector<FENode> >(m_Node);
+		auto Elem = std::make_shared<std::vector<FEElement> >(m_Elem);
+		auto Face = std::make_shared<std::vector<FEFace> >(m_Face);
+		auto Edge = std::make_shared<std::vector<FEEdge> >(m_Edge);
+		ar.WriteDeferred([=](OArchive& ar) {
+			saveMeshSections(ar, *Node, *Elem, *Face, *Edge);
+		});
+	}
+	else saveMeshSections(ar, m_Node, m_Elem, m_Face, m_Edge);
 
 	// TODO: Move this stuff to the GObject serialization
 	GObject* po = GetGObject();
@@ -2118,12 +2304,9 @@ FEMesh* ConvertSurfaceToMesh(FESurfaceMesh* surfaceMesh)
 //-----------------------------------------------------------------------------
 int FEMesh::CountSelectedElements() const
 {
-	int N = 0, NE = Elements();
-	for (int i = 0; i < NE; ++i)
-	{
-		if (Element(i).IsSelected()) N++;
-	}
-	return N;
+	FESelectionBits sel;
+	sel.capture(Elements(), [this](int i) { return Element(i).IsSelected(); });
+	return (int)sel.count();
 }
 
 //-----------------------------------------------------------------------------
@@ -125,6 +125,18 @@ public:
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
 
+	// Compress the node and element arrays, e.g. while the mesh is only kept for undo. 
+	// The mesh object stays valid, but has no nodes or elements until it is expanded.
+	bool Compress();
+
+	// restore the node and element arrays that were compressed
+	bool Expand();
+
+	bool IsCompressed() const { return (m_zdata.empty() == false); }
+
+	// size of the compressed node and element data
+	size_t CompressedSize() const { return m_zdata.size(); }
+
 public: // from FECoreMesh
 
 	//! return number of elements
@@ -226,6 +238,11 @@ protected:
 	// data fields
 	vector<FEMeshData*>		m_meshData;
 
+	// compressed node and element data (see Compress)
+	std::vector<unsigned char>	m_zdata;
+	int		m_znodes, m_zelems;
+	size_t	m_zraw;
+
 	friend class FEMeshBuilder;
 };
 
@@ -26,10 +26,12 @@ SOFTWARE.*/
 
 #include"FEMeshBase.h"
 #include <GeomLib/GObject.h>
+#include "FESelectionBits.h"
 
 //-----------------------------------------------------------------------------
 FEMeshBase::FEMeshBase()
 {
+	m_smoothRev = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -143,6 +145,8 @@ void FEMeshBase::RemoveEdges(int ntag)
 //
 void FEMeshBase::AutoSmooth(double angleDegrees)
 {
+	SmoothingChanged();
+
 	int NF = Faces();
 
 	// smoothing threshold
@@ -321,6 +325,8 @@ void FEMeshBase::UpdateNormals()
 // assign smoothing IDs based on surface partition
 void FEMeshBase::SmoothByPartition()
 {
+	SmoothingChanged();
+
 	// assign group IDs to smoothing IDs
 	for (int i=0; i<Faces(); ++i)
 	{
@@ -342,34 +348,25 @@ void FEMeshBase::UpdateMesh()
 //-----------------------------------------------------------------------------
 int FEMeshBase::CountSelectedNodes() const
 {
-	int N = 0, NN = Nodes();
-	for (int i = 0; i < NN; ++i)
-	{
-		if (Node(i).IsSelected()) N++;
-	}
-	return N;
+	FESelectionBits sel;
+	sel.capture(Nodes(), [this](int i) { return Node(i).IsSelected(); });
+	return (int)sel.count();
 }
 
 //-----------------------------------------------------------------------------
 int FEMeshBase::CountSelectedEdges() const
 {
-	int N = 0, NE = Edges();
-	for (int i = 0; i < NE; ++i)
-	{
-		if (Edge(i).IsSelected()) N++;
-	}
-	return N;
+	FESelectionBits sel;
+	sel.capture(Edges(), [this](int i) { return Edge(i).IsSelected(); });
+	return (int)sel.count();
 }
 
 //-----------------------------------------------------------------------------
 int FEMeshBase::CountSelectedFaces() const
 {
-	int N = 0, NF = Faces();
-	for (int i = 0; i<NF; ++i)
-	{
-		if (Face(i).IsSelected()) N++;
-	}
-	return N;
+	FESelectionBits sel;
+	sel.capture(Faces(), [this](int i) { return Face(i).IsSelected(); });
+	return (int)sel.count();
 }
 
 //-----------------------------------------------------------------------------
@@ -59,6 +59,11 @@ public:
 	// assign smoothing IDs based on surface partition
 	void SmoothByPartition();
 
+	// This is incremented each time the smoothing IDs of the faces are reassigned,
+	// so that cached normals can tell if they are stale.
+	unsigned int SmoothingRevision() const { return m_smoothRev; }
+	void SmoothingChanged() { m_smoothRev++; }
+
 	// update the normals
 	void UpdateNormals();
 
@@ -118,6 +123,8 @@ protected:
 	std::vector<FEFace>		m_Face;	//!< FE faces
 
 	FENodeFaceList		m_NFL;
+
+	unsigned int		m_smoothRev;	//!< smoothing revision (see SmoothingRevision)
 };
 
 //-------------------------------------------------------------------
@@ -0,0 +1,148 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "FESelectionBits.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// count the set bits in a word
+static inline int popcount64(uint64_t v)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(v);
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(v);
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+FESelectionBits::FESelectionBits() : m_size(0), m_version(0)
+{
+}
+
+FESelectionBits::FESelectionBits(size_t n) : m_size(0), m_version(0)
+{
+	resize(n);
+}
+
+void FESelectionBits::resize(size_t n)
+{
+	m_size = n;
+	m_bits.assign((n + 63) / 64, 0);
+	++m_version;
+}
+
+void FESelectionBits::setAll()
+{
+	for (uint64_t& w : m_bits) w = ~uint64_t(0);
+	clearPadding();
+	++m_version;
+}
+
+void FESelectionBits::clearAll()
+{
+	for (uint64_t& w : m_bits) w = 0;
+	++m_version;
+}
+
+// make sure that the bits beyond the last item are zero, 
+// so that they don't contribute to count() or operator ==
+void FESelectionBits::clearPadding()
+{
+	size_t r = m_size & 63;
+	if (r && !m_bits.empty()) m_bits.back() &= ((uint64_t(1) << r) - 1);
+}
+
+size_t FESelectionBits::count() const
+{
+	const uint64_t* pb = m_bits.data();
+	int words = (int)m_bits.size();
+	long long n = 0;
+#pragma omp parallel for reduction(+:n) schedule(static)
+	for (int i = 0; i < words; ++i) n += popcount64(pb[i]);
+	return (size_t)n;
+}
+
+size_t FESelectionBits::countChanged(const FESelectionBits& b) const
+{
+	size_t words = (m_bits.size() < b.m_bits.size() ? m_bits.size() : b.m_bits.size());
+	size_t n = 0;
+	for (size_t i = 0; i < words; ++i) n += popcount64(m_bits[i] ^ b.m_bits[i]);
+	for (size_t i = words; i < m_bits.size(); ++i) n += popcount64(m_bits[i]);
+	for (size_t i = words; i < b.m_bits.size(); ++i) n += popcount64(b.m_bits[i]);
+	return n;
+}
+
+void FESelectionBits::invert()
+{
+	uint64_t* pb = m_bits.data();
+	size_t words = m_bits.size();
+	for (size_t i = 0; i < words; ++i) pb[i] = ~pb[i];
+	clearPadding();
+	++m_version;
+}
+
+FESelectionBits& FESelectionBits::operator |= (const FESelectionBits& b)
+{
+	uint64_t* pa = m_bits.data();
+	const uint64_t* pb = b.m_bits.data();
+	size_t words = (m_bits.size() < b.m_bits.size() ? m_bits.size() : b.m_bits.size());
+	for (size_t i = 0; i < words; ++i) pa[i] |= pb[i];
+	clearPadding();
+	++m_version;
+	return *this;
+}
+
+FESelectionBits& FESelectionBits::operator &= (const FESelectionBits& b)
+{
+	uint64_t* pa = m_bits.data();
+	const uint64_t* pb = b.m_bits.data();
+	size_t words = (m_bits.size() < b.m_bits.size() ? m_bits.size() : b.m_bits.size());
+	for (size_t i = 0; i < words; ++i) pa[i] &= pb[i];
+	for (size_t i = words; i < m_bits.size(); ++i) pa[i] = 0;
+	++m_version;
+	return *this;
+}
+
+FESelectionBits& FESelectionBits::operator -= (const FESelectionBits& b)
+{
+	uint64_t* pa = m_bits.data();
+	const uint64_t* pb = b.m_bits.data();
+	size_t words = (m_bits.size() < b.m_bits.size() ? m_bits.size() : b.m_bits.size());
+	for (size_t i = 0; i < words; ++i) pa[i] &= ~pb[i];
+	++m_version;
+	return *this;
+}
+
+bool FESelectionBits::operator == (const FESelectionBits& b) const
+{
+	return (m_size == b.m_size) && (m_bits == b.m_bits);
+}
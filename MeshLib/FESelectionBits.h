@@ -0,0 +1,121 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+// Packed selection state of a list of mesh items, using one bit per item.
+// This is used to store selections compactly (e.g. in undo records) and to
+// do bulk operations on the selection of large meshes. The set operations
+// work on whole 64-bit words so the compiler can vectorize them.
+class FESelectionBits
+{
+public:
+	FESelectionBits();
+	explicit FESelectionBits(size_t n);
+
+	// resize the set. This clears all bits
+	void resize(size_t n);
+
+	size_t size() const { return m_size; }
+	bool empty() const { return (m_size == 0); }
+
+	// memory used by the bits
+	size_t memsize() const { return m_bits.size()*sizeof(uint64_t); }
+
+	bool test(size_t i) const { return ((m_bits[i >> 6] >> (i & 63)) & 1) != 0; }
+	void set(size_t i) { m_bits[i >> 6] |= (uint64_t(1) << (i & 63)); ++m_version; }
+	void reset(size_t i) { m_bits[i >> 6] &= ~(uint64_t(1) << (i & 63)); ++m_version; }
+
+	void setAll();
+	void clearAll();
+
+	// the number of set bits
+	size_t count() const;
+
+	// the number of items whose state differs from the other set
+	size_t countChanged(const FESelectionBits& b) const;
+
+	// set operations
+	void invert();
+	FESelectionBits& operator |= (const FESelectionBits& b);
+	FESelectionBits& operator &= (const FESelectionBits& b);
+	FESelectionBits& operator -= (const FESelectionBits& b);
+
+	bool operator == (const FESelectionBits& b) const;
+	bool operator != (const FESelectionBits& b) const { return !(*this == b); }
+
+	// This is incremented each time the set is modified, so that clients
+	// can see if they need to update anything that depends on the set.
+	unsigned int version() const { return m_version; }
+
+	// Set the bits from the selection state of n items. 
+	// The function f(i) must return true if item i is selected.
+	template <class F> void capture(int n, F f);
+
+	// Apply the bits to n items. The function f(i, b) must set the
+	// selection state of item i to b.
+	template <class F> void apply(int n, F f) const;
+
+private:
+	void clearPadding();
+
+private:
+	std::vector<uint64_t>	m_bits;
+	size_t					m_size;
+	unsigned int			m_version;
+};
+
+template <class F> void FESelectionBits::capture(int n, F f)
+{
+	resize(n);
+	uint64_t* pb = m_bits.data();
+	int words = (int)m_bits.size();
+
+	// each thread fills whole words, so there are no races
+#pragma omp parallel for schedule(static)
+	for (int w = 0; w < words; ++w)
+	{
+		int i0 = w * 64;
+		int i1 = (i0 + 64 < n ? i0 + 64 : n);
+		uint64_t b = 0;
+		for (int i = i0; i < i1; ++i)
+		{
+			if (f(i)) b |= (uint64_t(1) << (i - i0));
+		}
+		pb[w] = b;
+	}
+}
+
+template <class F> void FESelectionBits::apply(int n, F f) const
+{
+	if (n > (int)m_size) n = (int)m_size;
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; ++i) f(i, test(i));
+}
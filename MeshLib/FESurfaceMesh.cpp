@@ -803,6 +803,8 @@ void FESurfaceMesh::UpdateFacePartitions()
 // This needs to be called after the number of faces changes.
 void FESurfaceMesh::UpdateSmoothingGroups()
 {
+	SmoothingChanged();
+
 	// find the largest SG
 	int max_sg = -1;
 	for (int i = 0; i<Faces(); ++i)
@@ -56,6 +56,8 @@ FEMesh* FEMeshSmoothingModifier::Apply(FEMesh* pm)
 	// make a copy of this mesh
 	FEMesh* pnew = new FEMesh(*pm);
 
+	setProgress(0.0);
+
 	//marking the edge nodes.
 	vector<int> hashmap; 
 	hashmap.reserve(pm->Nodes());
@@ -88,6 +90,13 @@ FEMesh* FEMeshSmoothingModifier::Apply(FEMesh* pm)
 			break;
 	}
 
+	if (IsCancelled())
+	{
+		delete pnew;
+		FEModifier::SetError("Mesh smoothing was cancelled.");
+		return 0;
+	}
+
 	pnew->RebuildMesh();
 	return pnew;
 }
@@ -152,12 +161,15 @@ void FEMeshSmoothingModifier::Taubin_Smoothing(FEMesh* pnew,vector<int> hashmap)
 	//Creating a node node list
 	FENodeNodeList NNL(pnew);
 	
-	vector<vec3d>phi_node;
-	phi_node.reserve(pnew->Nodes());
+	int NN = pnew->Nodes();
+	vector<vec3d>phi_node(NN);
 	for(int j =0 ;j<m_iteration;j++)
 	{		
-		for(int i = 0; i < pnew->Nodes() ; i++)
-		{
+		double p0 = (100.0*j) / m_iteration;
+		double p1 = (100.0*(j + 1)) / m_iteration;
+
+		// each node only writes its own entry, so both passes can run in parallel
+		bool bok = parallelFor(NN, [&](int i) {
 			FENode& ni = pnew->Node(i);
 			vec3d r_sum;
 			for (int k = 0; k<NNL.Valence(i);k++)
@@ -167,10 +179,11 @@ void FEMeshSmoothingModifier::Taubin_Smoothing(FEMesh* pnew,vector<int> hashmap)
 			}
 			r_sum = r_sum/NNL.Valence(i);
 			r_sum -= ni.r;
-			phi_node.push_back(r_sum);
-		}		
-		for(int i = 0; i < pnew->Nodes() ; i++)
-		{
+			phi_node[i] = r_sum;
+		}, 0.5*(p0 + p1));
+		if (bok == false) return;
+
+		bok = parallelFor(NN, [&](int i) {
 			if(hashmap[i] == 0)
 			{
 				FENode& ni = pnew->Node(i);
@@ -187,8 +200,8 @@ void FEMeshSmoothingModifier::Taubin_Smoothing(FEMesh* pnew,vector<int> hashmap)
 
 				ni.r = ni.r - (phi_old * (m_threshold2 - m_threshold1)) - (phi_sq_old *(m_threshold1*m_threshold2));
 			}
-		}
-		phi_node.clear();
+		}, p1);
+		if (bok == false) return;
 	}
 }
 
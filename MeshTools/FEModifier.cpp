@@ -1227,6 +1227,12 @@ FSTaskProgress FEConvertMesh::GetProgress()
 	else return FEModifier::GetProgress();
 }
 
+void FEConvertMesh::Terminate()
+{
+	FEModifier::Terminate();
+	if (m_mod) m_mod->Terminate();
+}
+
 //=============================================================================
 // FEAddNode
 //-----------------------------------------------------------------------------
@@ -424,6 +424,9 @@ public:
 	// return progress
 	FSTaskProgress GetProgress() override;
 
+	// forward to the active converter
+	void Terminate() override;
+
 private:
 	FEModifier* m_mod;
 	int			m_currentType;
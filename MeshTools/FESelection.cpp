@@ -34,6 +34,7 @@ SOFTWARE.*/
 #include "GLMesh.h"
 #include <GeomLib/GObject.h>
 #include "GModel.h"
+#include <MeshLib/FESelectionBits.h>
 
 //////////////////////////////////////////////////////////////////////
 // FESelection
@@ -953,6 +954,31 @@ void GDiscreteSelection::Update()
 }
 
 
+//-----------------------------------------------------------------------------
+// Inverts the selection of the visible items among n mesh items. item(i) must 
+// return a reference to item i. The selection and visibility are captured as
+// bitsets, so the inversion itself works on whole words.
+template <class F> static void invertSelection(int n, F item)
+{
+	FESelectionBits sel, vis;
+	sel.capture(n, [&](int i) { return item(i).IsSelected(); });
+	vis.capture(n, [&](int i) { return item(i).IsVisible(); });
+
+	// the new selection of the visible items
+	FESelectionBits inv(sel);
+	inv.invert();
+	inv &= vis;
+
+	// hidden items keep their selection
+	sel -= vis;
+	sel |= inv;
+
+	sel.apply(n, [&](int i, bool b) {
+		if (b) item(i).Select(); else item(i).Unselect();
+	});
+}
+
+
 //////////////////////////////////////////////////////////////////////
 // FEElementSelection
 //////////////////////////////////////////////////////////////////////
@@ -980,17 +1006,8 @@ int FEElementSelection::Count()
 void FEElementSelection::Invert()
 {
 	if (m_pMesh == 0) return;
-	int N = m_pMesh->Elements(); 
-	for (int i = 0; i < N; ++i)
-	{
-		FEElement_* pe = m_pMesh->ElementPtr(i);
-
-		if (pe->IsVisible())
-		{
-			if (pe->IsSelected()) pe->Unselect();
-			else pe->Select();
-		}
-	}
+	FEMesh* pm = m_pMesh;
+	invertSelection(pm->Elements(), [=](int i) -> FEElement_& { return *pm->ElementPtr(i); });
 }
 
 void FEElementSelection::Update()
@@ -1221,14 +1238,8 @@ int FEFaceSelection::Count()
 void FEFaceSelection::Invert()
 {
 	if (m_pMesh == 0) return;
-	int N = m_pMesh->Faces(); 
 	FEFace* pf = m_pMesh->FacePtr();
-	for (int i=0; i<N; ++i, ++pf)
-		if (pf->IsVisible())
-		{
-			if (pf->IsSelected()) pf->Unselect(); 
-			else pf->Select();
-		}
+	invertSelection(m_pMesh->Faces(), [=](int i) -> FEFace& { return pf[i]; });
 }
 
 void FEFaceSelection::Update()
@@ -1462,14 +1473,8 @@ int FEEdgeSelection::Count()
 void FEEdgeSelection::Invert()
 {
 	if (m_pMesh == 0) return;
-	int N = m_pMesh->Edges(); 
 	FEEdge* pe = m_pMesh->EdgePtr();
-	for (int i=0; i<N; ++i, ++pe)
-		if (pe->IsVisible())
-		{
-			if (pe->IsSelected()) pe->Unselect(); 
-			else pe->Select();
-		}
+	invertSelection(m_pMesh->Edges(), [=](int i) -> FEEdge& { return pe[i]; });
 }
 
 void FEEdgeSelection::Update()
@@ -1700,14 +1705,8 @@ FENodeSelection::Iterator FENodeSelection::First()
 void FENodeSelection::Invert()
 {
 	if (m_pMesh == 0) return;
-	int N = m_pMesh->Nodes(); 
 	FENode* pn = m_pMesh->NodePtr();
-	for (int i=0; i<N; ++i, ++pn)
-		if (pn->IsVisible())
-		{
-			if (pn->IsSelected()) pn->Unselect(); 
-			else pn->Select();
-		}
+	invertSelection(m_pMesh->Nodes(), [=](int i) -> FENode& { return pn[i]; });
 }
 
 void FENodeSelection::Update()
@@ -55,6 +55,7 @@ CGLColorMap::CGLColorMap(CGLModel *po) : CGLDataMap(po)
 
 	m_nfield = 0;
 	m_breset = true;
+	m_cacheSize = 0;
 	m_bDispNodeVals = true;
 
 	SetName("Color Map");
@@ -164,12 +165,13 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	CGLModel* po = GetModel();
 
 	// get the mesh
-	FEPostMesh* pm = po->GetActiveMesh();
 	FEPostModel* pfem = po->GetFEModel();
 
 	int N = pfem->GetStates();
 	if (N == 0) return;
 
+	if (breset) ClearCache();
+
 	int n0 = ntime;
 	int n1 = (ntime + 1 >= N ? ntime : ntime + 1);
 	if (dt == 0.f) n1 = n0;
@@ -177,16 +179,132 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	UpdateState(n0, breset);
 	if (n0 != n1) UpdateState(n1, breset);
 
+	if (n0 == n1)
+	{
+		// the values of states are cached, since they are visited over and over
+		ApplyTextures(CachedTextures(n0), breset);
+	}
+	else
+	{
+		// get the state
+		FEState& s0 = *pfem->GetState(n0);
+		FEState& s1 = *pfem->GetState(n1);
+
+		float df = s1.m_time - s0.m_time;
+		if (df == 0) df = 1.f;
+
+		float w = dt / df;
+
+		TEX_STATE t;
+		EvalTextures(n0, n1, w, t);
+		ApplyTextures(t, breset);
+	}
+}
+
+//-----------------------------------------------------------------------------
+size_t CGLColorMap::TEX_STATE::Size() const
+{
+	return sizeof(float)*(face.size() + elem.size() + edge.size() + node.size()) + faceActive.size() + elemActive.size() + nodeTag.size();
+}
+
+//-----------------------------------------------------------------------------
+// max size of the cache of state textures
+const size_t TEX_CACHE_BYTES = 256 * 1024 * 1024;
+
+//-----------------------------------------------------------------------------
+// Returns the texture values of a state, and evaluates them if they are not cached.
+const CGLColorMap::TEX_STATE& CGLColorMap::CachedTextures(int ntime)
+{
+	unsigned int stamp = CacheStamp();
+	for (std::list<TEX_STATE>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+	{
+		if ((it->ntime == ntime) && (it->nfield == m_nfield) && (it->nodal == m_bDispNodeVals) && (it->stamp == stamp))
+		{
+			m_cache.splice(m_cache.begin(), m_cache, it);
+			return m_cache.front();
+		}
+	}
+
+	TEX_STATE t;
+	t.ntime = ntime;
+	t.nfield = m_nfield;
+	t.stamp = stamp;
+	EvalTextures(ntime, ntime, 0.f, t);
+
+	m_cacheSize += t.Size();
+	m_cache.push_front(std::move(t));
+
+	// remove the least recently used states
+	while ((m_cacheSize > TEX_CACHE_BYTES) && (m_cache.size() > 1))
+	{
+		m_cacheSize -= m_cache.back().Size();
+		m_cache.pop_back();
+	}
+
+	return m_cache.front();
+}
+
+//-----------------------------------------------------------------------------
+// The texture values depend on the mesh and on which materials are enabled.
+unsigned int CGLColorMap::CacheStamp()
+{
+	CGLModel* po = GetModel();
+	FEPostModel* pfem = po->GetFEModel();
+	FEPostMesh* pm = po->GetActiveMesh();
+
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	auto add = [&h](const void* pd, size_t n) {
+		const unsigned char* c = (const unsigned char*)pd;
+		for (size_t i = 0; i < n; ++i) { h ^= c[i]; h *= 16777619u; }
+	};
+
+	int n[4] = { pm->Nodes(), pm->Faces(), pm->Elements(), po->DiscreteEdges() };
+	add(&pm, sizeof(pm));
+	add(n, sizeof(n));
+	for (int i = 0; i < pfem->Materials(); ++i)
+	{
+		unsigned char b = (pfem->GetMaterial(i)->enabled() ? 1 : 0);
+		add(&b, 1);
+	}
+	return h;
+}
+
+//-----------------------------------------------------------------------------
+void CGLColorMap::ClearCache()
+{
+	m_cache.clear();
+	m_cacheSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluate the texture values at time w between states n0 and n1
+void CGLColorMap::EvalTextures(int n0, int n1, float w, TEX_STATE& t)
+{
+	// get the object
+	CGLModel* po = GetModel();
+
+	// get the mesh
+	FEPostMesh* pm = po->GetActiveMesh();
+	FEPostModel* pfem = po->GetFEModel();
+
 	// get the state
 	FEState& s0 = *pfem->GetState(n0);
 	FEState& s1 = *pfem->GetState(n1);
 
-	float df = s1.m_time - s0.m_time;
-	if (df == 0) df = 1.f;
+	int NN = pm->Nodes();
+	int NF = pm->Faces();
+	int NE = pm->Elements();
+	int ND = po->DiscreteEdges();
 
-	float w = dt / df;
+	int nfv = 0;
+	for (int i = 0; i < NF; ++i) nfv += pm->Face(i).Nodes();
 
-	m_rmin = m_rmax = vec3d(0, 0, 0);
+	t.nodal = m_bDispNodeVals;
+	t.rmin = t.rmax = vec3d(0, 0, 0);
+	t.face.assign(nfv, 0.f);
+	t.edge.assign(2 * ND, 0.f);
+	t.nodeTag.clear();
 
 	// update the range
 	float fmin = 1e29f, fmax = -1e29f;
@@ -197,7 +315,6 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		int ndata = FIELD_CODE(m_nfield);
 		if (s0.m_Data[ndata].GetFormat() == DATA_ITEM)
 		{
-			int NE = pm->Elements();
 			for (int i = 0; i < NE; ++i)
 			{
 				FEElement_& el = pm->ElementRef(i);
@@ -209,8 +326,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 					float f0 = d0.m_val;
 					float f1 = d1.m_val;
 					float f = f0 + (f1 - f0)*w;
-					if (f > fmax) { fmax = f; m_rmax = r; }
-					if (f < fmin) { fmin = f; m_rmin = r; }
+					if (f > fmax) { fmax = f; t.rmax = r; }
+					if (f < fmin) { fmin = f; t.rmin = r; }
 				}
 			}
 		}
@@ -218,7 +335,6 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		{
 			ValArray& elemData0 = s0.m_ElemData;
 			ValArray& elemData1 = s1.m_ElemData;
-			int NE = pm->Elements();
 			for (int i = 0; i < NE; ++i)
 			{
 				FEElement_& el = pm->ElementRef(i);
@@ -231,8 +347,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 						float f0 = elemData0.value(i, j);
 						float f1 = elemData1.value(i, j);
 						float f = f0 + (f1 - f0)*w;
-						if (f > fmax) { fmax = f; m_rmax = pm->Node(el.m_node[j]).r; }
-						if (f < fmin) { fmin = f; m_rmin = pm->Node(el.m_node[j]).r; }
+						if (f > fmax) { fmax = f; t.rmax = pm->Node(el.m_node[j]).r; }
+						if (f < fmin) { fmin = f; t.rmin = pm->Node(el.m_node[j]).r; }
 					}
 				}
 			}
@@ -241,7 +357,8 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	else
 	{
 		// evaluate all nodes to find range
-		for (int i = 0; i<pm->Nodes(); ++i)
+		t.nodeTag.assign(NN, 0);
+		for (int i = 0; i<NN; ++i)
 		{
 			FENode& node = pm->Node(i);
 			NODEDATA& d0 = s0.m_NODE[i];
@@ -251,15 +368,14 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 				float f0 = d0.m_val;
 				float f1 = d1.m_val;
 				float f = f0 + (f1 - f0)*w;
-				node.m_ntag = 1;
-				if (f > fmax) { fmax = f; m_rmax = pm->Node(i).r; }
-				if (f < fmin) { fmin = f; m_rmin = pm->Node(i).r; }
+				t.nodeTag[i] = 1;
+				if (f > fmax) { fmax = f; t.rmax = pm->Node(i).r; }
+				if (f < fmin) { fmin = f; t.rmin = pm->Node(i).r; }
 			}
-			else node.m_ntag = 0;
 		}
 
 		// evaluate face values for texture generation
-		for (int i = 0; i < pm->Faces(); ++i)
+		for (int i = 0, k = 0; i < NF; ++i)
 		{
 			FEFace& face = pm->Face(i);
 			if (face.IsEnabled())
@@ -275,13 +391,14 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 						float f0 = d0.m_val;
 						float f1 = d1.m_val;
 						float f = f0 + (f1 - f0)*w;
-						face.m_tex[j] = f;
+						t.face[k + j] = f;
 					}
 				}
 			}
+			k += face.Nodes();
 		}
 
-		for (int i = 0; i < po->DiscreteEdges(); ++i)
+		for (int i = 0; i < ND; ++i)
 		{
 			Post::GLEdge::EDGE& de = po->DiscreteEdge(i);
 			for (int j = 0; j < 2; ++j)
@@ -295,7 +412,7 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 					float f0 = d0.m_val;
 					float f1 = d1.m_val;
 					float f = f0 + (f1 - f0)*w;
-					de.tex[j] = f;
+					t.edge[2 * i + j] = f;
 				}
 			}
 		}
@@ -303,33 +420,27 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 
 	if (m_bDispNodeVals == false)
 	{
-		int NF = pm->Faces();
-		for (int i = 0; i<NF; ++i)
+		for (int i = 0, k = 0; i<NF; ++i)
 		{
 			FEFace& face = pm->Face(i);
-			FACEDATA& fd0 = s0.m_FACE[i];
-			FACEDATA& fd1 = s1.m_FACE[i];
-			//			if (face.IsEnabled() && (face.m_ntag > 0))
+			int nf = face.Nodes();
+			for (int j = 0; j<nf; ++j)
 			{
-				face.m_ntag = 1;
-				int nf = face.Nodes();
-				for (int j = 0; j<nf; ++j)
-				{
-					float f0 = faceData0.value(i, j);
-					float f1 = (n0 == n1 ? f0 : faceData1.value(i, j));
-					float f = f0 + (f1 - f0)*w;
-					face.m_tex[j] = f;
+				float f0 = faceData0.value(i, j);
+				float f1 = (n0 == n1 ? f0 : faceData1.value(i, j));
+				float f = f0 + (f1 - f0)*w;
+				t.face[k + j] = f;
 
-					if (IS_ELEM_FIELD(m_nfield) == false)
-					{
-						if (f > fmax) fmax = f;
-						if (f < fmin) fmin = f;
-					}
+				if (IS_ELEM_FIELD(m_nfield) == false)
+				{
+					if (f > fmax) fmax = f;
+					if (f < fmin) fmin = f;
 				}
 			}
+			k += nf;
 		}
 
-		for (int i = 0; i < po->DiscreteEdges(); ++i)
+		for (int i = 0; i < ND; ++i)
 		{
 			Post::GLEdge::EDGE& de = po->DiscreteEdge(i);
 			int ni = de.elem;
@@ -342,13 +453,70 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 					float f0 = d0.m_val;
 					float f1 = d1.m_val;
 					float f = f0 + (f1 - f0)*w;
-					de.tex[0] = de.tex[1] = f;
+					t.edge[2 * i] = t.edge[2 * i + 1] = f;
 				}
-				else de.tex[0] = de.tex[1] = 0.f;
 			}
 		}
 	}
 
+	t.fmin = fmin;
+	t.fmax = fmax;
+
+	// face activity
+	t.faceActive.resize(NF);
+	for (int i = 0; i < NF; ++i) t.faceActive[i] = (s0.m_FACE[i].m_ntag > 0 ? 1 : 0);
+
+	// element values
+	t.elem.assign(NE, 0.f);
+	t.elemActive.assign(NE, 0);
+	for (int i = 0; i<NE; ++i)
+	{
+		ELEMDATA& d0 = s0.m_ELEM[i];
+		ELEMDATA& d1 = s1.m_ELEM[i];
+		if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
+		{
+			float f0 = d0.m_val;
+			float f1 = d1.m_val;
+			t.elem[i] = f0 + (f1 - f0)*w;
+			t.elemActive[i] = 1;
+		}
+	}
+
+	// node values (used by the internal surfaces)
+	t.node.resize(NN);
+	for (int i = 0; i < NN; ++i)
+	{
+		float v0 = s0.m_NODE[i].m_val;
+		float v1 = s1.m_NODE[i].m_val;
+		t.node[i] = v0 + (v1 - v0)*w;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Update the range and map the texture values onto the mesh
+void CGLColorMap::ApplyTextures(const TEX_STATE& t, bool breset)
+{
+	// get the object
+	CGLModel* po = GetModel();
+
+	// get the mesh
+	FEPostMesh* pm = po->GetActiveMesh();
+
+	float fmin = t.fmin;
+	float fmax = t.fmax;
+	m_rmin = t.rmin;
+	m_rmax = t.rmax;
+
+	if (t.nodeTag.empty() == false)
+	{
+		for (int i = 0; i < pm->Nodes(); ++i) pm->Node(i).m_ntag = t.nodeTag[i];
+	}
+
+	if (t.nodal == false)
+	{
+		for (int i = 0; i < pm->Faces(); ++i) pm->Face(i).m_ntag = 1;
+	}
+
 	if (m_breset || breset)
 	{
 		if (m_range.maxtype != RANGE_USER) m_range.max = fmax;
@@ -378,31 +546,6 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		}
 	}
 
-
-//	if (m_range.ntype != RANGE_USER)
-//	{
-//		if (m_breset || breset)
-//		{
-//			m_range.max = fmax;
-//			m_range.min = fmin;
-//			m_breset = false;
-//		}
-//		else
-//		{
-//			switch (m_range.ntype)
-//			{
-//			case RANGE_DYNAMIC:
-//				m_range.max = fmax;
-//				m_range.min = fmin;
-//				break;
-//			case RANGE_STATIC:
-//				if (fmax > m_range.max) m_range.max = fmax;
-//				if (fmin < m_range.min) m_range.min = fmin;
-//				break;
-//			}
-//		}
-//	}
-
 	// set the colormap's range
 	m_pbar->SetRange(m_range.min, m_range.max);
 
@@ -412,14 +555,13 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	if (min == max) max++;
 
 	float dti = 1.f / (max - min);
-	for (int i = 0; i<pm->Faces(); ++i)
+	for (int i = 0, k = 0; i<pm->Faces(); ++i)
 	{
 		FEFace& face = pm->Face(i);
-		FACEDATA& fd = s0.m_FACE[i];
 		if (face.IsEnabled())
 		{
-			for (int j = 0; j<face.Nodes(); ++j) face.m_tex[j] = (face.m_tex[j] - min)*dti;
-			if (fd.m_ntag > 0) face.Activate(); else face.Deactivate();
+			for (int j = 0; j<face.Nodes(); ++j) face.m_tex[j] = (t.face[k + j] - min)*dti;
+			if (t.faceActive[i]) face.Activate(); else face.Deactivate();
 			face.m_texe = 0;
 		}
 		else
@@ -427,21 +569,16 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 			for (int j = 0; j<face.Nodes(); ++j) face.m_tex[j] = 0;
 			face.m_texe = 0;
 		}
+		k += face.Nodes();
 	}
 
 	// update element textures
 	for (int i = 0; i<pm->Elements(); ++i)
 	{
 		FEElement_& el = pm->ElementRef(i);
-		ELEMDATA& d0 = s0.m_ELEM[i];
-		ELEMDATA& d1 = s1.m_ELEM[i];
-		if ((d0.m_state & StatusFlags::ACTIVE) && (d1.m_state & StatusFlags::ACTIVE))
+		if (t.elemActive[i])
 		{
-			float f0 = d0.m_val;
-			float f1 = d1.m_val;
-			float f = f0 + (f1 - f0)*w;
-			el.m_tex = (f - min) / (max - min);
-
+			el.m_tex = (t.elem[i] - min) / (max - min);
 			el.Activate();
 		}
 		else el.Deactivate();
@@ -453,9 +590,7 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 		Post::GLEdge::EDGE& de = po->DiscreteEdge(i);
 		for (int j = 0; j < 2; ++j)
 		{
-			float f = de.tex[j];
-			float w = (f - min)*dti;
-			de.tex[j] = w;
+			de.tex[j] = (t.edge[2 * i + j] - min)*dti;
 		}
 	}
 
@@ -477,33 +612,15 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 					face.Activate();
 					int iel = face.m_elem[0].eid;
 
-					ELEMDATA& d0 = s0.m_ELEM[iel];
-					ELEMDATA& d1 = s1.m_ELEM[iel];
-
-					if (((d0.m_state & StatusFlags::ACTIVE) == 0) || ((d1.m_state & StatusFlags::ACTIVE) == 0)) face.Deactivate();
+					if (t.elemActive[iel] == 0) face.Deactivate();
 					else
 					{
-						float v0 = d0.m_val;
-						float v1 = d1.m_val;
-						float v = v0 + (v1 - v0)*w;
-
-						float tex = (v - min) / (max - min);
-
-						face.m_texe = tex;
+						face.m_texe = (t.elem[iel] - min) / (max - min);
 
 						int nf = face.Nodes();
 						for (int k = 0; k < nf; ++k)
 						{
-							NODEDATA& d0 = s0.m_NODE[face.n[k]];
-							NODEDATA& d1 = s1.m_NODE[face.n[k]];
-
-							float v0 = d0.m_val;
-							float v1 = d1.m_val;
-							float v = v0 + (v1 - v0)*w;
-
-							float tex = (v - min) / (max - min);
-
-							face.m_tex[k] = tex;
+							face.m_tex[k] = (t.node[face.n[k]] - min) / (max - min);
 						}
 					}
 				}
@@ -512,6 +629,7 @@ void CGLColorMap::Update(int ntime, float dt, bool breset)
 	}
 }
 
+//-----------------------------------------------------------------------------
 void CGLColorMap::UpdateState(int ntime, bool breset)
 {
 	// get the model
@@ -29,6 +29,8 @@ SOFTWARE.*/
 #include <GLWLib/GLWidget.h>
 #include <GLLib/GLTexture1D.h>
 #include <PostLib/ColorMap.h>
+#include <list>
+#include <vector>
 
 namespace Post {
 
@@ -76,6 +78,28 @@ public:
 
 	void Activate(bool b) override { CGLObject::Activate(b); ShowLegend(b); }
 
+private:
+	// texture values of a state, before they are mapped to the range
+	struct TEX_STATE
+	{
+		int				ntime;
+		int				nfield;
+		bool			nodal;		// nodal smoothing
+		unsigned int	stamp;
+
+		float	fmin, fmax;
+		vec3d	rmin, rmax;
+		std::vector<float>	face;		// face node values (packed)
+		std::vector<char>	faceActive;
+		std::vector<float>	elem;		// element values
+		std::vector<char>	elemActive;
+		std::vector<float>	edge;		// discrete edge values (two per edge)
+		std::vector<float>	node;		// node values
+		std::vector<char>	nodeTag;	// active nodes (empty when nodes are not tagged)
+
+		size_t Size() const;
+	};
+
 private:
 	void UpdateState(int ntime, bool breset);
 
@@ -83,12 +107,22 @@ private:
 
 	void Update() override;
 
+	void EvalTextures(int n0, int n1, float w, TEX_STATE& t);
+	void ApplyTextures(const TEX_STATE& t, bool breset);
+
+	const TEX_STATE& CachedTextures(int ntime);
+	unsigned int CacheStamp();
+	void ClearCache();
+
 protected:
 	int		m_nfield;
 	bool	m_breset;	// reset the range when the field has changed
 	DATA_RANGE	m_range;	// range for legend
 	vec3d	m_rmin, m_rmax;	// global indicators of min, max
 
+	std::list<TEX_STATE>	m_cache;		// texture values of recently visited states, most recent first
+	size_t					m_cacheSize;	// size of cached values (in bytes)
+
 public:
 	bool	m_bDispNodeVals;	// render nodal values
 
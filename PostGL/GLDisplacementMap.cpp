@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "GLDisplacementMap.h"
 #include "GLModel.h"
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 //-----------------------------------------------------------------------------
@@ -40,6 +41,8 @@ CGLDisplacementMap::CGLDisplacementMap(CGLModel* po) : CGLDataMap(po)
 	SetName(szname);
 
 	m_scl = vec3d(1,1,1);
+	m_nstate = -1;
+	m_cacheSize = 0;
 	UpdateData(false);
 }
 
@@ -114,6 +117,8 @@ void CGLDisplacementMap::Update(int ntime, float dt, bool breset)
 
 	m_du.resize(pm->Nodes());
 
+	if (breset) ClearCache();
+
 	if (n0 == n1)
 	{
 		// update the states
@@ -129,6 +134,7 @@ void CGLDisplacementMap::Update(int ntime, float dt, bool breset)
 			vec3f du = s1.m_NODE[i].m_rt - ref.m_Node[i].m_rt;
 			m_du[i] = du;
 		}
+		m_nstate = n0;
 	}
 	else
 	{
@@ -162,6 +168,7 @@ void CGLDisplacementMap::Update(int ntime, float dt, bool breset)
 			vec3f du = d2*w + d1*(1.f - w);
 			m_du[i] = du;
 		}
+		m_nstate = -1;
 	}
 
 	UpdateNodes();
@@ -237,5 +244,134 @@ void CGLDisplacementMap::UpdateNodes()
 	}
 
 	// update the normals
+	UpdateNormals();
+}
+
+//-----------------------------------------------------------------------------
+// max size of the cache of normals
+const size_t NORMALS_CACHE_BYTES = 256 * 1024 * 1024;
+
+//-----------------------------------------------------------------------------
+// Update the normals of the displaced mesh. The normals of the states are
+// cached, since recalculating them is the most expensive part of the update.
+void CGLDisplacementMap::UpdateNormals()
+{
+	CGLModel* po = GetModel();
+	FEMeshBase* pm = po->GetActiveMesh();
+	FEPostModel* pfem = po->GetFEModel();
+	int nfield = (pfem ? pfem->GetDisplacementField() : -1);
+
+	// interpolated displacements are not cached
+	if ((m_nstate < 0) || (nfield < 0))
+	{
+		pm->UpdateNormals();
+		return;
+	}
+
+	int NF = pm->Faces();
+	unsigned int stamp = CacheStamp();
+	for (std::list<NORMALS>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+	{
+		if ((it->ntime == m_nstate) && (it->nfield == nfield) && (it->scl == m_scl) && (it->stamp == stamp))
+		{
+			m_cache.splice(m_cache.begin(), m_cache, it);
+
+			const NORMALS& c = m_cache.front();
+			for (int i = 0, k = 0; i < NF; ++i)
+			{
+				FEFace& face = pm->Face(i);
+				face.m_fn = c.fn[i];
+				face.m_ntag = c.tag[i];
+				int nf = face.Nodes();
+				for (int j = 0; j < nf; ++j) face.m_nn[j] = c.nn[k++];
+			}
+			return;
+		}
+	}
+
 	pm->UpdateNormals();
+
+	NORMALS c;
+	c.ntime = m_nstate;
+	c.nfield = nfield;
+	c.scl = m_scl;
+	c.stamp = stamp;
+	c.fn.resize(NF);
+	c.tag.resize(NF);
+	for (int i = 0; i < NF; ++i)
+	{
+		FEFace& face = pm->Face(i);
+		c.fn[i] = face.m_fn;
+		c.tag[i] = face.m_ntag;
+		int nf = face.Nodes();
+		for (int j = 0; j < nf; ++j) c.nn.push_back(face.m_nn[j]);
+	}
+
+	m_cacheSize += c.Size();
+	m_cache.push_front(std::move(c));
+
+	// remove the least recently used states
+	while ((m_cacheSize > NORMALS_CACHE_BYTES) && (m_cache.size() > 1))
+	{
+		m_cacheSize -= m_cache.back().Size();
+		m_cache.pop_back();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The normals depend on the mesh and its smoothing groups
+unsigned int CGLDisplacementMap::CacheStamp()
+{
+	FEMeshBase* pm = GetModel()->GetActiveMesh();
+
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	auto add = [&h](const void* pd, size_t n) {
+		const unsigned char* c = (const unsigned char*)pd;
+		for (size_t i = 0; i < n; ++i) { h ^= c[i]; h *= 16777619u; }
+	};
+
+	int NF = pm->Faces();
+	unsigned int rev = pm->SmoothingRevision();
+	add(&pm, sizeof(pm));
+	add(&NF, sizeof(NF));
+	add(&rev, sizeof(rev));
+	return h;
+}
+
+//-----------------------------------------------------------------------------
+void CGLDisplacementMap::ClearCache()
+{
+	m_cache.clear();
+	m_cacheSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Evaluates the displacements of the states n0 to n1 in parallel, so that they
+// are ready when an animation gets there. This only evaluates the state data,
+// so the mesh is not touched.
+void CGLDisplacementMap::Prefetch(int n0, int n1)
+{
+	FEPostModel* pfem = GetModel()->GetFEModel();
+	if (pfem == nullptr) return;
+
+	int N = pfem->GetStates();
+	int nfield = pfem->GetDisplacementField();
+	if ((N == 0) || (nfield < 0)) return;
+	if (N != m_ntag.size()) m_ntag.assign(N, -1);
+
+	if (n0 < 0) n0 = 0;
+	if (n1 >= N) n1 = N - 1;
+
+	std::vector<int> states;
+	for (int n = n0; n <= n1; ++n)
+	{
+		if (m_ntag[n] != nfield) states.push_back(n);
+	}
+	if (states.empty()) return;
+
+	// each state writes to its own data
+	parallel_for(0, (int)states.size(), [&](int i) {
+		UpdateState(states[i]);
+	});
 }
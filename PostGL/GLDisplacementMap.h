@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "GLDataMap.h"
 #include <MathLib/math3d.h>
 #include <vector>
+#include <list>
 
 namespace Post {
 
@@ -45,6 +46,9 @@ public:
 
 	void UpdateState(int ntime, bool breset = false);
 
+	// evaluate the displacements of states n0 to n1 ahead of time
+	void Prefetch(int n0, int n1);
+
 	vec3d GetScale() { return m_scl; }
 	void SetScale(vec3d f) { m_scl = f; }
 
@@ -53,9 +57,34 @@ public:
 
 	void UpdateNodes();
 
+private:
+	// normals of the displaced mesh at a state
+	struct NORMALS
+	{
+		int				ntime;
+		int				nfield;
+		vec3d			scl;
+		unsigned int	stamp;
+
+		std::vector<vec3f>	fn;		// face normals
+		std::vector<vec3f>	nn;		// face node normals (packed)
+		std::vector<int>	tag;	// smoothing groups
+
+		size_t Size() const { return sizeof(vec3f)*(fn.size() + nn.size()) + sizeof(int)*tag.size(); }
+	};
+
+	void UpdateNormals();
+	unsigned int CacheStamp();
+	void ClearCache();
+
 public:
 	vec3d				m_scl;		//!< displacement scale factor
 	std::vector<vec3f>	m_du;		//!< nodal displacements
 	std::vector<int>	m_ntag;
+
+private:
+	int					m_nstate;		//!< state of m_du, or -1 if m_du is interpolated
+	std::list<NORMALS>	m_cache;		//!< normals of recently visited states, most recent first
+	size_t				m_cacheSize;	//!< size of cached normals (in bytes)
 };
 }
@@ -0,0 +1,329 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "GLGlyph.h"
+#include "GLModel.h"
+#include <FSCore/box.h>
+#include <algorithm>
+#include <FSCore/FSThreadPool.h>
+using namespace Post;
+using namespace std;
+
+GLGlyphMesh::GLGlyphMesh()
+{
+	m_lines = false;
+}
+
+void GLGlyphMesh::Clear()
+{
+	m_pos.clear();
+	m_nrm.clear();
+	m_lines = false;
+	ClearInstances();
+}
+
+void GLGlyphMesh::ClearInstances()
+{
+	m_inst.clear();
+	m_vpos.clear();
+	m_vnrm.clear();
+	m_vcol.clear();
+}
+
+void GLGlyphMesh::AddTri(const vec3f& r0, const vec3f& r1, const vec3f& r2, const vec3f& n0, const vec3f& n1, const vec3f& n2)
+{
+	m_pos.push_back(r0); m_nrm.push_back(n0);
+	m_pos.push_back(r1); m_nrm.push_back(n1);
+	m_pos.push_back(r2); m_nrm.push_back(n2);
+}
+
+void GLGlyphMesh::AddCone(float r0, float r1, float z0, float z1, int slices)
+{
+	// the normal is constant along the generator of the cone
+	float nz = (z1 != z0 ? (r0 - r1) / (z1 - z0) : 0.f);
+	for (int i = 0; i < slices; ++i)
+	{
+		double w0 = 2.0*PI*i / slices;
+		double w1 = 2.0*PI*(i + 1) / slices;
+		float c0 = (float)cos(w0), s0 = (float)sin(w0);
+		float c1 = (float)cos(w1), s1 = (float)sin(w1);
+
+		vec3f n0(c0, s0, nz); n0.Normalize();
+		vec3f n1(c1, s1, nz); n1.Normalize();
+
+		vec3f p00(r0*c0, r0*s0, z0);
+		vec3f p10(r0*c1, r0*s1, z0);
+		vec3f p11(r1*c1, r1*s1, z1);
+		vec3f p01(r1*c0, r1*s0, z1);
+
+		AddTri(p00, p10, p11, n0, n1, n1);
+		AddTri(p00, p11, p01, n0, n1, n0);
+	}
+}
+
+void GLGlyphMesh::AddSphere(float R, int slices, int stacks)
+{
+	for (int i = 0; i < stacks; ++i)
+	{
+		double f0 = PI*i / stacks;
+		double f1 = PI*(i + 1) / stacks;
+		for (int j = 0; j < slices; ++j)
+		{
+			double w0 = 2.0*PI*j / slices;
+			double w1 = 2.0*PI*(j + 1) / slices;
+
+			vec3f n00((float)(sin(f0)*cos(w0)), (float)(sin(f0)*sin(w0)), (float)cos(f0));
+			vec3f n10((float)(sin(f1)*cos(w0)), (float)(sin(f1)*sin(w0)), (float)cos(f1));
+			vec3f n11((float)(sin(f1)*cos(w1)), (float)(sin(f1)*sin(w1)), (float)cos(f1));
+			vec3f n01((float)(sin(f0)*cos(w1)), (float)(sin(f0)*sin(w1)), (float)cos(f0));
+
+			AddTri(n00*R, n10*R, n11*R, n00, n10, n11);
+			AddTri(n00*R, n11*R, n01*R, n00, n11, n01);
+		}
+	}
+}
+
+void GLGlyphMesh::AddBox(float h)
+{
+	const float n[6][3] = { { 1,0,0 },{ -1,0,0 },{ 0,1,0 },{ 0,-1,0 },{ 0,0,1 },{ 0,0,-1 } };
+	const float r[6][4][3] = {
+		{ { h,-h,-h },{ h, h,-h },{ h, h, h },{ h,-h, h } },
+		{ { -h, h,-h },{ -h,-h,-h },{ -h,-h, h },{ -h, h, h } },
+		{ { h, h,-h },{ -h, h,-h },{ -h, h, h },{ h, h, h } },
+		{ { -h,-h,-h },{ h,-h,-h },{ h,-h, h },{ -h,-h, h } },
+		{ { -h, h, h },{ h, h, h },{ h,-h, h },{ -h,-h, h } },
+		{ { h, h,-h },{ -h, h,-h },{ -h,-h,-h },{ h,-h,-h } }
+	};
+
+	for (int i = 0; i < 6; ++i)
+	{
+		vec3f ni(n[i][0], n[i][1], n[i][2]);
+		vec3f p[4];
+		for (int j = 0; j < 4; ++j) p[j] = vec3f(r[i][j][0], r[i][j][1], r[i][j][2]);
+		AddTri(p[0], p[1], p[2], ni, ni, ni);
+		AddTri(p[0], p[2], p[3], ni, ni, ni);
+	}
+}
+
+void GLGlyphMesh::AddLine(float z0, float z1)
+{
+	m_lines = true;
+	m_pos.push_back(vec3f(0.f, 0.f, z0)); m_nrm.push_back(vec3f(0.f, 0.f, 1.f));
+	m_pos.push_back(vec3f(0.f, 0.f, z1)); m_nrm.push_back(vec3f(0.f, 0.f, 1.f));
+}
+
+// max nr of vertices that is kept in the vertex arrays
+const size_t MAX_GLYPH_VERTS = 1 << 21;
+
+void GLGlyphMesh::Build(const vector<GLGlyphInstance>& inst)
+{
+	ClearInstances();
+
+	int NI = (int)inst.size();
+	int NV = (int)m_pos.size();
+	if ((NI == 0) || (NV == 0)) return;
+
+	if ((size_t)NI*NV > MAX_GLYPH_VERTS)
+	{
+		m_inst = inst;
+		return;
+	}
+
+	m_vpos.resize(NI*NV);
+	m_vnrm.resize(NI*NV);
+	m_vcol.resize(4 * NI*NV);
+	parallel_for(0, NI, [&](int i) {
+		Transform(inst[i], &m_vpos[i*NV], &m_vnrm[i*NV], &m_vcol[4 * i*NV]);
+	});
+}
+
+void GLGlyphMesh::Transform(const GLGlyphInstance& g, vec3f* pos, vec3f* nrm, unsigned char* col) const
+{
+	const vec3f* a = g.a;
+
+	// normals transform with the inverse transpose, i.e. the cofactor matrix
+	// (the sign of the determinant keeps them pointing outward)
+	vec3f b[3] = { a[1] ^ a[2], a[2] ^ a[0], a[0] ^ a[1] };
+	float s = (a[0] * b[0] < 0.f ? -1.f : 1.f);
+
+	int NV = (int)m_pos.size();
+	for (int j = 0; j < NV; ++j)
+	{
+		const vec3f& p = m_pos[j];
+		const vec3f& q = m_nrm[j];
+		pos[j] = a[0] * p.x + a[1] * p.y + a[2] * p.z + g.r;
+
+		vec3f m = (b[0] * q.x + b[1] * q.y + b[2] * q.z)*s;
+		nrm[j] = m.Normalize();
+
+		col[4 * j    ] = g.c[0];
+		col[4 * j + 1] = g.c[1];
+		col[4 * j + 2] = g.c[2];
+		col[4 * j + 3] = g.c[3];
+	}
+}
+
+void GLGlyphMesh::Render() const
+{
+	int NV = (int)m_pos.size();
+	if (NV == 0) return;
+	GLenum mode = (m_lines ? GL_LINES : GL_TRIANGLES);
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	if (!m_vpos.empty())
+	{
+		glVertexPointer(3, GL_FLOAT, 0, &m_vpos[0]);
+		glNormalPointer(GL_FLOAT, 0, &m_vnrm[0]);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, &m_vcol[0]);
+		glDrawArrays(mode, 0, (GLsizei)m_vpos.size());
+	}
+	else if (!m_inst.empty())
+	{
+		// The instances are drawn in batches, which keeps the vertex buffers small.
+		int NI = (int)m_inst.size();
+		const int maxVerts = 1 << 18;
+		int nb = maxVerts / NV;
+		if (nb < 1) nb = 1;
+		if (nb > NI) nb = NI;
+
+		vector<vec3f> pos(nb*NV), nrm(nb*NV);
+		vector<unsigned char> col(4 * nb*NV);
+		glVertexPointer(3, GL_FLOAT, 0, &pos[0]);
+		glNormalPointer(GL_FLOAT, 0, &nrm[0]);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, &col[0]);
+
+		for (int i0 = 0; i0 < NI; i0 += nb)
+		{
+			int n = (NI - i0 < nb ? NI - i0 : nb);
+			parallel_for(0, n, [&](int k) {
+				Transform(m_inst[i0 + k], &pos[k*NV], &nrm[k*NV], &col[4 * k*NV]);
+			});
+			glDrawArrays(mode, 0, n*NV);
+		}
+	}
+
+	glPopClientAttrib();
+}
+
+void Post::GlyphRotation(const vec3f& v, vec3f a[3])
+{
+	vec3f n = v; n.Normalize();
+	if (n.z > 0.999999f)
+	{
+		a[0] = vec3f(1.f, 0.f, 0.f);
+		a[1] = vec3f(0.f, 1.f, 0.f);
+		a[2] = vec3f(0.f, 0.f, 1.f);
+	}
+	else if (n.z < -0.999999f)
+	{
+		// rotate half a turn around the x-axis
+		a[0] = vec3f(1.f, 0.f, 0.f);
+		a[1] = vec3f(0.f, -1.f, 0.f);
+		a[2] = vec3f(0.f, 0.f, -1.f);
+	}
+	else
+	{
+		quatd q(vec3d(0, 0, 1), vec3d(n));
+		a[0] = to_vec3f(q*vec3d(1, 0, 0));
+		a[1] = to_vec3f(q*vec3d(0, 1, 0));
+		a[2] = to_vec3f(q*vec3d(0, 0, 1));
+	}
+}
+
+void Post::DecimateGlyphs(vector<GLGlyphSite>& sites, int maxCount)
+{
+	int N = (int)sites.size();
+	if ((maxCount <= 0) || (N <= maxCount)) return;
+
+	BOX box;
+	for (int i = 0; i < N; ++i) box += vec3d(sites[i].r);
+
+	// Choose the cell size so that the extent of the sites is covered by about
+	// maxCount cells. Flat dimensions are ignored, so this also works for
+	// glyphs on a plane or a line.
+	double R = box.GetMaxExtent();
+	if (R == 0.0) R = 1.0;
+	double ext[3] = { box.Width(), box.Height(), box.Depth() };
+	double V = 1.0;
+	int dim = 0;
+	for (int k = 0; k < 3; ++k) if (ext[k] > 1e-6*R) { V *= ext[k]; dim++; }
+	if (dim == 0) { V = R; dim = 1; }
+	double h = pow(V / maxCount, 1.0 / dim);
+
+	long long n[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		n[k] = (long long)ceil(ext[k] / h);
+		if (n[k] < 1) n[k] = 1;
+	}
+
+	vector<long long> key(N);
+	parallel_for(0, N, [&](int i) {
+		const vec3f& r = sites[i].r;
+		long long ix = (long long)((r.x - box.x0) / h); if (ix >= n[0]) ix = n[0] - 1;
+		long long iy = (long long)((r.y - box.y0) / h); if (iy >= n[1]) iy = n[1] - 1;
+		long long iz = (long long)((r.z - box.z0) / h); if (iz >= n[2]) iz = n[2] - 1;
+		key[i] = ix + n[0] * (iy + n[1] * iz);
+	});
+
+	// sort by cell and weight, and keep the first site in each cell
+	vector<int> idx(N);
+	for (int i = 0; i < N; ++i) idx[i] = i;
+	sort(idx.begin(), idx.end(), [&](int a, int b) {
+		if (key[a] != key[b]) return key[a] < key[b];
+		if (sites[a].w != sites[b].w) return sites[a].w > sites[b].w;
+		return a < b;
+	});
+
+	vector<GLGlyphSite> tmp;
+	tmp.reserve(maxCount);
+	for (int i = 0; i < N; ++i)
+	{
+		if ((i == 0) || (key[idx[i]] != key[idx[i - 1]])) tmp.push_back(sites[idx[i]]);
+	}
+
+	// restore the original order
+	sort(tmp.begin(), tmp.end(), [](const GLGlyphSite& a, const GLGlyphSite& b) { return a.item < b.item; });
+	sites.swap(tmp);
+}
+
+GLGlyphKey Post::GlyphKey(CGLModel* mdl)
+{
+	CGLDisplacementMap* pdm = mdl->GetDisplacementMap();
+	bool bdisp = (pdm && pdm->IsActive());
+
+	GLGlyphKey key;
+	key.mesh = mdl->GetActiveMesh();
+	key.version = mdl->MeshStateVersion();
+	key.scl = (bdisp ? pdm->GetScale() : vec3d(0, 0, 0));
+	key.ndisp = (bdisp ? mdl->GetFEModel()->GetDisplacementField() : -1);
+	return key;
+}
@@ -0,0 +1,135 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <MathLib/math3d.h>
+#include <FSCore/color.h>
+#include <vector>
+
+namespace Post {
+
+class CGLModel;
+
+//-----------------------------------------------------------------------------
+// One instance of a glyph: a linear transformation of the glyph geometry
+// (stored as columns), the glyph's position, and its color.
+struct GLGlyphInstance
+{
+	vec3f			a[3];	// columns of the transformation
+	vec3f			r;		// position
+	unsigned char	c[4];	// color (rgba)
+
+	void SetColor(const GLColor& col) { c[0] = col.r; c[1] = col.g; c[2] = col.b; c[3] = col.a; }
+};
+
+//-----------------------------------------------------------------------------
+// Candidate location of a glyph, used for decimation
+struct GLGlyphSite
+{
+	vec3f	r;		// position
+	float	w;		// weight (larger weights are kept)
+	int		item;	// node or element index
+};
+
+//-----------------------------------------------------------------------------
+// Glyph geometry that is tessellated once and then drawn for many instances.
+// The glyph is modeled along the z-axis. Build() transforms the instances (in
+// parallel) into vertex arrays that are kept until the next Build(), so that
+// a repaint only takes the draw calls. When the arrays would get too large,
+// only the instances are kept and they are transformed in batches on Render().
+class GLGlyphMesh
+{
+public:
+	GLGlyphMesh();
+
+	void Clear();
+
+	bool IsEmpty() const { return m_pos.empty(); }
+
+	// add a (truncated) cone around the z-axis, from z0 to z1
+	void AddCone(float r0, float r1, float z0, float z1, int slices);
+
+	// add a sphere at the origin
+	void AddSphere(float R, int slices, int stacks);
+
+	// add a box at the origin with half-width h
+	void AddBox(float h);
+
+	// add a line segment on the z-axis (a mesh can't mix lines and triangles)
+	void AddLine(float z0, float z1);
+
+	// build the vertex arrays of the instances
+	void Build(const std::vector<GLGlyphInstance>& inst);
+
+	// remove the instances (but keep the geometry)
+	void ClearInstances();
+
+	// render the instances of the last Build()
+	void Render() const;
+
+private:
+	void AddTri(const vec3f& r0, const vec3f& r1, const vec3f& r2, const vec3f& n0, const vec3f& n1, const vec3f& n2);
+
+	// transform the glyph geometry for instance g
+	void Transform(const GLGlyphInstance& g, vec3f* pos, vec3f* nrm, unsigned char* col) const;
+
+private:
+	std::vector<vec3f>	m_pos;	// vertex positions
+	std::vector<vec3f>	m_nrm;	// vertex normals
+	bool				m_lines;	// the mesh is made of lines instead of triangles
+
+	std::vector<GLGlyphInstance>	m_inst;	// instances that didn't fit in the vertex arrays
+	std::vector<vec3f>			m_vpos;	// vertex array of positions
+	std::vector<vec3f>			m_vnrm;	// vertex array of normals
+	std::vector<unsigned char>	m_vcol;	// vertex array of colors
+};
+
+//-----------------------------------------------------------------------------
+// The state of the model (besides the plotted data) that the glyph instances
+// depend on. The plots only rebuild their glyphs when this changes.
+struct GLGlyphKey
+{
+	const void*		mesh;		// active mesh
+	unsigned int	version;	// mesh state (visibility) version of the model
+	vec3d			scl;		// displacement scale, or zero if no displacement map is active
+	int				ndisp;		// displacement field
+
+	bool operator == (const GLGlyphKey& k) const
+	{
+		return (mesh == k.mesh) && (version == k.version) && (scl == k.scl) && (ndisp == k.ndisp);
+	}
+	bool operator != (const GLGlyphKey& k) const { return !(*this == k); }
+};
+
+GLGlyphKey GlyphKey(CGLModel* mdl);
+
+// rotation that maps the z-axis onto the direction of v
+void GlyphRotation(const vec3f& v, vec3f a[3]);
+
+// Thin out the glyph sites with a uniform grid so that (at most) about maxCount
+// sites remain. In each grid cell the site with the largest weight is kept.
+void DecimateGlyphs(std::vector<GLGlyphSite>& sites, int maxCount);
+}
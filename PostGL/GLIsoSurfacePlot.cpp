@@ -31,11 +31,16 @@ SOFTWARE.*/
 #include <GLLib/GLContext.h>
 #include <GLLib/GLCamera.h>
 #include "GLModel.h"
+#include "GLSolidNodeTable.h"
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 extern int LUT[256][15];
 extern int ET_HEX[12][2];
 
+// max memory used by the cached iso-surfaces
+const size_t ISO_CACHE_BYTES = 256 * 1024 * 1024;
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -78,6 +83,16 @@ CGLIsoSurfacePlot::CGLIsoSurfacePlot()
 	m_Col.SetDivisions(m_nslices);
 	m_Col.SetSmooth(false);
 
+	m_lastTime = 0;
+	m_lastdt = 0.f;
+	m_indexValid = false;
+	m_cacheSize = 0;
+	m_geom.dt = 0.f;
+	m_geom.scl = vec3d(0, 0, 0);
+	m_geom.ndisp = -1;
+	m_geom.cutHidden = false;
+	m_geom.version = 0;
+
 	GLLegendBar* bar = new GLLegendBar(&m_Col, 0, 0, 600, 100, GLLegendBar::ORIENT_HORIZONTAL);
 	bar->align(GLW_ALIGN_BOTTOM | GLW_ALIGN_HCENTER);
 	bar->SetType(GLLegendBar::DISCRETE);
@@ -250,14 +265,77 @@ void CGLIsoSurfacePlot::UpdateMesh()
 
 void CGLIsoSurfacePlot::UpdateSlice(float ref, GLColor col)
 {
-	float ev[8];	// element nodal values
-	vec3f ex[8];	// element nodal positions
-	vec3f en[8];	// element nodal gradients
+	// see if this surface was already extracted
+	SURFACE* surf = nullptr;
+	for (std::list<SURFACE>::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+	{
+		if ((it->ntime == m_lastTime) && (it->nfield == m_nfield) && (it->ref == ref) && (it->smooth == m_bsmooth) && (it->geom == m_geom))
+		{
+			m_cache.splice(m_cache.begin(), m_cache, it);
+			surf = &m_cache.front();
+			break;
+		}
+	}
+
+	if (surf == nullptr)
+	{
+		SURFACE s;
+		s.ntime = m_lastTime;
+		s.nfield = m_nfield;
+		s.ref = ref;
+		s.smooth = m_bsmooth;
+		s.geom = m_geom;
+		ExtractSurface(ref, s.faces);
+
+		m_cacheSize += s.faces.size() * sizeof(ISO_FACE);
+		m_cache.push_front(std::move(s));
+		surf = &m_cache.front();
+
+		// remove the least recently used surfaces
+		while ((m_cacheSize > ISO_CACHE_BYTES) && (m_cache.size() > 1))
+		{
+			m_cacheSize -= m_cache.back().faces.size() * sizeof(ISO_FACE);
+			m_cache.pop_back();
+		}
+	}
+
+	for (ISO_FACE& f : surf->faces) m_mesh.AddFace(f.r, f.n, col);
+}
+
+//-----------------------------------------------------------------------------
+// build the index of the element value ranges of the current state
+void CGLIsoSurfacePlot::UpdateIndex()
+{
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+
+	int NE = pm->Elements();
+	std::vector<SpanIndex::SPAN> span(NE);
+	parallel_for(0, NE, [&](int i) {
+		SpanIndex::SPAN& s = span[i];
+		s.item = i;
+		s.vmin = 1.0;
+		s.vmax = -1.0;
+
+		FEElement_& el = pm->ElementRef(i);
+		const int* nt = (el.IsSolid() ? solidNodeTable(el) : nullptr);
+		if (nt == nullptr) return;
 
-	const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-	const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
-	const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
-    const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
+		for (int k = 0; k < 8; ++k)
+		{
+			float v = m_val[el.m_node[nt[k]]];
+			if ((k == 0) || (v < s.vmin)) s.vmin = v;
+			if ((k == 0) || (v > s.vmax)) s.vmax = v;
+		}
+	});
+
+	m_index.Build(span);
+	m_indexValid = true;
+}
+
+//-----------------------------------------------------------------------------
+void CGLIsoSurfacePlot::ExtractSurface(float ref, std::vector<ISO_FACE>& faces)
+{
+	faces.clear();
 
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFEModel();
@@ -265,66 +343,57 @@ void CGLIsoSurfacePlot::UpdateSlice(float ref, GLColor col)
 	// get the mesh
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
-	const int* nt = nullptr;
+	// only elements whose value range brackets the iso-value can be cut
+	if (m_indexValid == false) UpdateIndex();
+	std::vector<int> elems;
+	m_index.Find(ref, elems);
 
-	// loop over all elements
-	for (int i=0; i<pm->Elements(); ++i)
-	{
-		// render only if the element is visible and
-		// its material is enabled
-		FEElement_& el = pm->ElementRef(i);
-		FEMaterial* pmat = ps->GetMaterial(el.m_MatID);
-		if (pmat->benable && (el.IsVisible() || m_bcut_hidden) && el.IsSolid())
-		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-            case FE_PENTA15: nt = PEN_NT; break;
-            case FE_TET4   : nt = TET_NT; break;
-			case FE_TET5   : nt = TET_NT; break;
-            case FE_PYRA5  : nt = PYR_NT; break;
-            case FE_PYRA13 : nt = PYR_NT; break;
-			}
-
-			// get the nodal values
-			for (int k=0; k<8; ++k)
-			{
-				FENode& node = pm->Node(el.m_node[nt[k]]);
+	int NE = (int)elems.size();
+	if (NE == 0) return;
 
-				ev[k] = m_val[el.m_node[nt[k]]];
-				ex[k] = to_vec3f(node.r);
-				en[k] = m_grd[el.m_node[nt[k]]];
-			}
+	// process the elements in parallel, each chunk into its own buffer
+	FSThreadPool& pool = FSThreadPool::Instance();
+	int chunks = pool.Chunks(NE);
+	std::vector< std::vector<ISO_FACE> > buf(chunks);
+	pool.Run(0, NE, chunks, [&](int c, int i0, int i1) {
 
-			// calculate the case of the element
-			int ncase = 0;
-			for (int k=0; k<8; ++k) 
-				if (ev[k] <= ref) ncase |= (1 << k);
+		float ev[8];	// element nodal values
+		vec3f ex[8];	// element nodal positions
+		vec3f en[8];	// element nodal gradients
 
-			// loop over faces
-			int* pf = LUT[ncase];
-			for (int l=0; l<5; l++)
+		for (int i = i0; i < i1; ++i)
+		{
+			// render only if the element is visible and
+			// its material is enabled
+			FEElement_& el = pm->ElementRef(elems[i]);
+			FEMaterial* pmat = ps->GetMaterial(el.m_MatID);
+			if (pmat->benable && (el.IsVisible() || m_bcut_hidden) && el.IsSolid())
 			{
-				if (*pf == -1) break;
+				const int* nt = solidNodeTable(el);
 
-				// calculate nodal positions
-				vec3f r[3], vn[3];
-				for (int k=0; k<3; k++)
+				// get the nodal values
+				for (int k=0; k<8; ++k)
 				{
-					int n1 = ET_HEX[pf[k]][0];
-					int n2 = ET_HEX[pf[k]][1];
-
-					float w = (ref - ev[n1]) / (ev[n2] - ev[n1]);
+					FENode& node = pm->Node(el.m_node[nt[k]]);
 
-					r[k] = ex[n1]*(1-w) + ex[n2]*w;
+					ev[k] = m_val[el.m_node[nt[k]]];
+					ex[k] = to_vec3f(node.r);
+					en[k] = (m_bsmooth ? m_grd[el.m_node[nt[k]]] : vec3f(0, 0, 0));
 				}
 
-				// calculate normals
-				if (m_bsmooth)
+				// calculate the case of the element
+				int ncase = 0;
+				for (int k=0; k<8; ++k) 
+					if (ev[k] <= ref) ncase |= (1 << k);
+
+				// loop over faces
+				int* pf = LUT[ncase];
+				for (int l=0; l<5; l++)
 				{
+					if (*pf == -1) break;
+
+					// calculate nodal positions
+					vec3f r[3], vn[3];
 					for (int k=0; k<3; k++)
 					{
 						int n1 = ET_HEX[pf[k]][0];
@@ -332,27 +401,70 @@ void CGLIsoSurfacePlot::UpdateSlice(float ref, GLColor col)
 
 						float w = (ref - ev[n1]) / (ev[n2] - ev[n1]);
 
-						vn[k] = en[n1]*(1-w) + en[n2]*w;
-						vn[k].Normalize();
+						r[k] = ex[n1]*(1-w) + ex[n2]*w;
 					}
-				}
-				else
-				{
-					for (int k=0; k<3; k++)
+
+					// calculate normals
+					if (m_bsmooth)
 					{
-						int kp1 = (k+1)%3;
-						int km1 = (k+2)%3;
-						vn[k] = (r[kp1] - r[k])^(r[km1] - r[k]);
-						vn[k].Normalize();
+						for (int k=0; k<3; k++)
+						{
+							int n1 = ET_HEX[pf[k]][0];
+							int n2 = ET_HEX[pf[k]][1];
+
+							float w = (ref - ev[n1]) / (ev[n2] - ev[n1]);
+
+							vn[k] = en[n1]*(1-w) + en[n2]*w;
+							vn[k].Normalize();
+						}
+					}
+					else
+					{
+						for (int k=0; k<3; k++)
+						{
+							int kp1 = (k+1)%3;
+							int km1 = (k+2)%3;
+							vn[k] = (r[kp1] - r[k])^(r[km1] - r[k]);
+							vn[k].Normalize();
+						}
 					}
-				}
 
-				// Add the face
-				m_mesh.AddFace(r, vn, col);
-				pf+=3;
+					// Add the face
+					ISO_FACE face;
+					for (int k = 0; k < 3; ++k) { face.r[k] = r[k]; face.n[k] = vn[k]; }
+					buf[c].push_back(face);
+					pf+=3;
+				}
 			}
 		}
-	}
+	});
+
+	for (int c = 0; c < chunks; ++c) faces.insert(faces.end(), buf[c].begin(), buf[c].end());
+}
+
+//-----------------------------------------------------------------------------
+// Key of everything besides the nodal values that affects the extracted surfaces.
+// Used to detect that cached surfaces are stale, e.g. after changing the displacement scale.
+CGLIsoSurfacePlot::GEOM_KEY CGLIsoSurfacePlot::GeometryKey()
+{
+	CGLModel* mdl = GetModel();
+	CGLDisplacementMap* pdm = mdl->GetDisplacementMap();
+	bool bdisp = (pdm && pdm->IsActive());
+
+	GEOM_KEY key;
+	key.dt = m_lastdt;
+	key.scl = (bdisp ? pdm->GetScale() : vec3d(0, 0, 0));
+	key.ndisp = (bdisp ? mdl->GetFEModel()->GetDisplacementField() : -1);
+	key.cutHidden = m_bcut_hidden;
+	key.version = mdl->MeshStateVersion();
+	return key;
+}
+
+//-----------------------------------------------------------------------------
+void CGLIsoSurfacePlot::ClearCache()
+{
+	m_cache.clear();
+	m_cacheSize = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -383,7 +495,7 @@ void CGLIsoSurfacePlot::Update(int ntime, float dt, bool breset)
 	int NN = pm->Nodes();
 	int NS = pfem->GetStates();
 
-	if (breset) { m_map.Clear(); m_GMap.Clear(); m_rng.clear(); m_val.clear(); m_grd.clear(); }
+	if (breset) { m_map.Clear(); m_GMap.Clear(); m_rng.clear(); m_val.clear(); m_grd.clear(); ClearCache(); }
 
 	if (m_map.States() != pfem->GetStates())
 	{
@@ -432,6 +544,8 @@ void CGLIsoSurfacePlot::Update(int ntime, float dt, bool breset)
 	// copy nodal values into current value buffer
 	m_val = m_map.State(ntime);
 	if (m_bsmooth) m_grd = m_GMap.State(ntime);
+	m_indexValid = false;
+	m_geom = GeometryKey();
 
 	// update colormap range
 	vec2f r = m_rng[ntime];
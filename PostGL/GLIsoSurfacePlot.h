@@ -29,6 +29,8 @@ SOFTWARE.*/
 #include "GLWLib/GLWidget.h"
 #include "PostLib/DataMap.h"
 #include <MeshTools/GLMesh.h>
+#include <PostLib/SpanIndex.h>
+#include <list>
 
 namespace Post {
 
@@ -79,9 +81,47 @@ public:
 
 	bool UpdateData(bool bsave = true);
 
+protected:
+	// triangle of an extracted iso-surface
+	struct ISO_FACE
+	{
+		vec3f	r[3];	// positions
+		vec3f	n[3];	// normals
+	};
+
+	// everything besides the nodal values that affects the extracted surfaces
+	struct GEOM_KEY
+	{
+		float	dt;			// interpolation fraction of the state
+		vec3d	scl;		// displacement scale, or zero if no displacement map is active
+		int		ndisp;		// displacement field
+		bool	cutHidden;	// cut hidden materials or not
+		unsigned int	version;	// mesh state (visibility) version of the model
+
+		bool operator == (const GEOM_KEY& k) const
+		{
+			return (dt == k.dt) && (scl == k.scl) && (ndisp == k.ndisp) && (cutHidden == k.cutHidden) && (version == k.version);
+		}
+	};
+
+	// extracted iso-surface of a (state, field, level)
+	struct SURFACE
+	{
+		int		ntime;
+		int		nfield;
+		float	ref;
+		bool	smooth;
+		GEOM_KEY	geom;
+		std::vector<ISO_FACE>	faces;
+	};
+
 protected:
 	void UpdateMesh();
 	void UpdateSlice(float ref, GLColor col);
+	void UpdateIndex();
+	void ExtractSurface(float ref, std::vector<ISO_FACE>& faces);
+	GEOM_KEY GeometryKey();
+	void ClearCache();
 
 protected:
 	int		m_nslices;		// nr. of iso surface slices
@@ -109,5 +149,12 @@ protected:
 
 	int		m_lastTime;
 	float	m_lastdt;
+
+	SpanIndex	m_index;		// element value ranges of the current state
+	bool		m_indexValid;
+
+	std::list<SURFACE>	m_cache;	// recently extracted surfaces, most recent first
+	size_t				m_cacheSize;	// size of cached faces (in bytes)
+	GEOM_KEY			m_geom;		// geometry and visibility of the current state
 };
 }
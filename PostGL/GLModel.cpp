@@ -35,6 +35,7 @@ SOFTWARE.*/
 #include <GLWLib/GLWidgetManager.h>
 #include <GLLib/GLMeshRender.h>
 #include <GLLib/glx.h>
+#include <FSCore/Profiler.h>
 #include <stack>
 //using namespace std;
 using namespace Post;
@@ -57,6 +58,9 @@ CGLModel::CGLModel(FEPostModel* ps)
 	SetName("Model");
 
 	m_lastMesh = nullptr;
+	m_meshStateVersion = 0;
+	m_stateValid = true;
+	m_prefetchDone = true;
 
 	static int layer = 1;
 	m_layer = layer++;
@@ -129,6 +133,7 @@ CGLModel::CGLModel(FEPostModel* ps)
 //! destructor
 CGLModel::~CGLModel(void)
 {
+	WaitForPrefetch();
 	delete m_pdis;
 	delete m_pcol;
 	ClearInternalSurfaces();
@@ -137,8 +142,10 @@ CGLModel::~CGLModel(void)
 //-----------------------------------------------------------------------------
 void CGLModel::SetFEModel(FEPostModel* ps)
 {
+	WaitForPrefetch();
 	ClearSelectionLists();
 	ClearInternalSurfaces();
+	m_fieldMaps.clear();
 	m_ps = ps;
 	if (ps) BuildInternalSurfaces();
 }
@@ -174,6 +181,7 @@ Post::FEState* CGLModel::GetActiveState()
 //-----------------------------------------------------------------------------
 void CGLModel::ResetAllStates()
 {
+	WaitForPrefetch();
 	FEPostModel* fem = GetFEModel();
 	if ((fem == 0) || (fem->GetStates() == 0)) return;
 
@@ -207,15 +215,27 @@ void CGLModel::SetTimeValue(float ftime)
 // Update the model data
 bool CGLModel::Update(bool breset)
 {
+	PROFILE_SCOPE_CAT("CGLModel::Update", "post");
+	m_stateValid = true;
 	if (m_ps == nullptr) return true;
 
+	// the state data can't be trimmed or evaluated while a prefetch is using it
+	WaitForPrefetch();
+
 	FEPostModel& fem = *m_ps;
 	if (fem.GetStates() == 0) return true;
 
+	// keep the state data within the memory limit of the model
+	fem.TrimMemory();
+
 	// get the time inc value
 	int ntime = fem.CurrentTimeIndex();
 	float dt = fem.CurrentTime() - fem.GetTimeValue(ntime);
 
+	// a state whose data was lost is not evaluated
+	m_stateValid = fem.IsStateValid(ntime);
+	if (m_stateValid == false) return false;
+
 	// update the state of the mesh
 	GetFEModel()->UpdateMeshState(ntime);
 
@@ -228,6 +248,16 @@ bool CGLModel::Update(bool breset)
 		m_lastMesh = currentMesh;
 	}
 
+	// the shared field maps are re-evaluated when they are needed
+	if (breset)
+	{
+		for (auto& it : m_fieldMaps)
+		{
+			std::shared_ptr<VectorFieldMap> map = it.lock();
+			if (map) map->Invalidate();
+		}
+	}
+
 	// update displacement map
 	if (m_pdis && m_pdis->IsActive()) m_pdis->Update(ntime, dt, breset);
 
@@ -251,9 +281,67 @@ bool CGLModel::Update(bool breset)
 //-----------------------------------------------------------------------------
 void CGLModel::UpdateDisplacements(int nstate, bool breset)
 {
+	WaitForPrefetch();
 	if (m_pdis && m_pdis->IsActive()) m_pdis->Update(nstate, 0.f, breset);
 }
 
+//-----------------------------------------------------------------------------
+void CGLModel::Prefetch(int n0, int n1)
+{
+	if (m_ps == nullptr) return;
+
+	// the animation asks again at the next frame
+	if (m_prefetchDone.load(std::memory_order_acquire) == false) return;
+	WaitForPrefetch();
+
+	// The memory can only be trimmed when no other thread uses the state data, so the
+	// worker only fetches one batch. The next update trims the memory again.
+	int batch = m_ps->StateBatchSize();
+	if (n1 > n0 + batch - 1) n1 = n0 + batch - 1;
+	if (n1 < n0) return;
+
+	// The worker only evaluates state data, so it does not touch the mesh. The list of
+	// maps is copied, since plots can add maps while the worker runs.
+	CGLDisplacementMap* pdis = (m_pdis && m_pdis->IsActive() ? m_pdis : nullptr);
+	std::vector<std::shared_ptr<VectorFieldMap> > maps;
+	for (auto& it : m_fieldMaps)
+	{
+		std::shared_ptr<VectorFieldMap> map = it.lock();
+		if (map) maps.push_back(map);
+	}
+	if ((pdis == nullptr) && maps.empty()) return;
+
+	m_prefetchDone = false;
+	m_prefetchThread = std::thread([this, pdis, maps, n0, n1]() {
+		if (pdis) pdis->Prefetch(n0, n1);
+		for (auto& map : maps) map->Update(n0, n1);
+		m_prefetchDone.store(true, std::memory_order_release);
+	});
+}
+
+//-----------------------------------------------------------------------------
+void CGLModel::WaitForPrefetch()
+{
+	if (m_prefetchThread.joinable()) m_prefetchThread.join();
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<VectorFieldMap> CGLModel::GetVectorFieldMap(int nfield, bool nodal)
+{
+	// see if a plot already uses this field
+	for (size_t i = 0; i < m_fieldMaps.size();)
+	{
+		std::shared_ptr<VectorFieldMap> map = m_fieldMaps[i].lock();
+		if (map == nullptr) { m_fieldMaps.erase(m_fieldMaps.begin() + i); continue; }
+		if ((map->Field() == nfield) && (map->IsNodal() == nodal)) return map;
+		++i;
+	}
+
+	std::shared_ptr<VectorFieldMap> map = std::make_shared<VectorFieldMap>(m_ps, nfield, nodal);
+	m_fieldMaps.push_back(map);
+	return map;
+}
+
 //-----------------------------------------------------------------------------
 void CGLModel::SetMaterialParams(FEMaterial* pm)
 {
@@ -319,6 +407,7 @@ bool CGLModel::AddDisplacementMap(const char* szvectorField)
 
 	if (nv == 0) return false;
 
+	WaitForPrefetch();
 	if (m_pdis) delete m_pdis;
 	m_pdis = new CGLDisplacementMap(this);
 	if (ndisp != -1)
@@ -440,6 +529,7 @@ void CGLModel::ToggleVisibleElements()
 //-----------------------------------------------------------------------------
 void CGLModel::RemoveDisplacementMap()
 {
+	WaitForPrefetch();
 	FEPostModel* ps = GetFEModel();
 	ps->SetDisplacementField(0);
 	delete m_pdis;
@@ -455,7 +545,8 @@ void CGLModel::RemoveDisplacementMap()
 //-----------------------------------------------------------------------------
 void CGLModel::Render(CGLContext& rc)
 {
-	if (GetFEModel() == nullptr) return;
+	PROFILE_SCOPE_CAT("CGLModel::Render", "render");
+	if ((GetFEModel() == nullptr) || (m_stateValid == false)) return;
 
 	// activate all clipping planes
 	CGLPlaneCutPlot::EnableClipPlanes();
@@ -1768,6 +1859,7 @@ void CGLModel::RenderMeshLines(FEPostModel* ps, int nmat)
 
 void CGLModel::RenderShadows(FEPostModel* ps, const vec3d& lp, float inf)
 {
+	if (m_stateValid == false) return;
 	Post::FEPostMesh* pm = GetActiveMesh();
 
 	// find all silhouette edges
@@ -2271,6 +2363,8 @@ void CGLModel::ClearSelectionLists()
 //-----------------------------------------------------------------------------
 void CGLModel::UpdateSelectionLists(int mode)
 {
+	m_meshStateVersion++;
+
 	Post::FEPostMesh& m = *GetActiveMesh();
 	if ((mode == -1) || (mode == SELECT_NODES))
 	{
@@ -2363,6 +2457,7 @@ void CGLModel::UnhideAll()
 	for (int i = 0; i<mesh.Faces(); ++i) mesh.Face(i).Unhide();
 	for (int i = 0; i<mesh.Edges(); ++i) mesh.Edge(i).Unhide();
 	for (int i = 0; i<mesh.Nodes(); ++i) mesh.Node(i).Unhide();
+	m_meshStateVersion++;
 	UpdateInternalSurfaces();
 }
 
@@ -2536,6 +2631,8 @@ void CGLModel::UpdateMeshState()
 		f.Disable();
 		if (mesh.ElementRef(f.m_elem[0].eid).IsEnabled()) f.Enable();
 	}
+
+	m_meshStateVersion++;
 }
 
 //-----------------------------------------------------------------------------
@@ -35,6 +35,8 @@ SOFTWARE.*/
 #include <GLLib/GLMeshRender.h>
 #include <MeshLib/Intersect.h>
 #include <vector>
+#include <thread>
+#include <atomic>
 
 namespace Post {
 
@@ -114,9 +116,24 @@ public:
 	CGLColorMap* GetColorMap() { return m_pcol; }
 	FEPostModel* GetFEModel() { return m_ps; }
 
+	// Returns false if the current state is invalid (see FEPostModel::IsStateValid)
 	bool Update(bool breset) override;
 	void UpdateDisplacements(int nstate, bool breset = false);
 
+	// false if the data of the current state was lost. The model is not rendered then.
+	bool IsStateValid() const { return m_stateValid; }
+
+	// Evaluate the data of states n0 to n1 before they are visited (e.g. during an animation).
+	// This runs on a worker thread and returns immediately. It is skipped while the
+	// previous prefetch is still running.
+	void Prefetch(int n0, int n1);
+
+	// wait for a running prefetch to finish
+	void WaitForPrefetch();
+
+	// returns the values of a vector field for all states. Plots of the same field share this map.
+	std::shared_ptr<VectorFieldMap> GetVectorFieldMap(int nfield, bool nodal);
+
 	bool AddDisplacementMap(const char* szvectorField = 0);
 
 	void RemoveDisplacementMap();
@@ -283,6 +300,10 @@ public: // Selection
 	//! enable or disable mesh items based on material's state
 	void UpdateMeshState();
 
+	//! This is incremented each time the visibility, selection or enabled state
+	//! of the mesh items changes, so that plots can tell if cached data is stale.
+	unsigned int MeshStateVersion() const { return m_meshStateVersion; }
+
 	//! hide selected elements
 	void HideSelectedElements();
 	void HideUnselectedElements();
@@ -378,9 +399,16 @@ protected:
 	CGLDisplacementMap*		m_pdis;
 	CGLColorMap*			m_pcol;
 
+	vector<std::weak_ptr<VectorFieldMap> >	m_fieldMaps;	// vector field maps shared by plots
+
 	GLMeshRender	m_render;
 
 	Post::FEPostMesh*	m_lastMesh;	// mesh of last evaluated state
+	unsigned int		m_meshStateVersion;
+	bool				m_stateValid;	// the current state is valid (see IsStateValid)
+
+	std::thread			m_prefetchThread;	// worker of the last prefetch
+	std::atomic<bool>	m_prefetchDone;		// the worker has finished
 
 	// selected items
 	vector<FENode*>		m_nodeSelection;
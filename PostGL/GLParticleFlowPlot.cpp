@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "GLParticleFlowPlot.h"
 #include "GLModel.h"
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 REGISTER_CLASS(CGLParticleFlowPlot, CLASS_PLOT, "particle-flow", 0);
@@ -59,6 +60,7 @@ CGLParticleFlowPlot::CGLParticleFlowPlot()
 	m_density = 1.f;
 
 	m_maxtime = -1;
+	m_ntime = -1;
 	m_seedTime = 1;
 	m_dt = 0.01f;
 
@@ -150,21 +152,26 @@ void CGLParticleFlowPlot::SetDensity(float v)
 
 void CGLParticleFlowPlot::Render(CGLContext& rc)
 {
-	int NP = (int) m_particles.size();
+	int NP = (int) m_death.size();
 	if (NP == 0) return;
 
+	int ntime = m_ntime;
+	if ((ntime < m_seedTime) || (ntime - m_seedTime >= (int)m_track.size())) return;
+
 	glPushAttrib(GL_ENABLE_BIT);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_TEXTURE_1D);
 
+	const vector<PARTICLE_STATE>& pt = m_track[ntime - m_seedTime];
 	glBegin(GL_POINTS);
 	for (int i=0; i<NP; ++i)
 	{
-		FlowParticle& p = m_particles[i];
-		if (p.m_balive)
+		if (IsAlive(i, ntime))
 		{
-			glColor3ub(p.m_col.r, p.m_col.g, p.m_col.b);
-			glVertex3f(p.m_r.x, p.m_r.y, p.m_r.z);
+			GLColor& c = m_col[i];
+			vec3f r = Position(pt[i]);
+			glColor3ub(c.r, c.g, c.b);
+			glVertex3f(r.x, r.y, r.z);
 		}
 	}
 	glEnd();
@@ -172,15 +179,14 @@ void CGLParticleFlowPlot::Render(CGLContext& rc)
 	if (m_showPath)
 	{
 		int ntime = GetModel()->CurrentTimeIndex();
+		if (ntime > m_maxtime) ntime = m_maxtime;
 		if (ntime >= m_seedTime + 1)
 		{
 			glColor3ub(0,0,255);
 			for (int i = 0; i<NP; ++i)
 			{
-				FlowParticle& p = m_particles[i];
-
 				int tend = ntime;
-				if (tend > p.m_ndeath) tend = p.m_ndeath;
+				if (tend > m_death[i]) tend = m_death[i];
 
 				int n0 = m_seedTime;
 				if (m_pathLength > 0)
@@ -194,7 +200,7 @@ void CGLParticleFlowPlot::Render(CGLContext& rc)
 				{
 					for (int n=n0; n<=tend; ++n)
 					{
-						vec3f& r = p.m_pos[n];
+						vec3f r = Position(m_track[n - m_seedTime][i]);
 						glVertex3f(r.x, r.y, r.z);
 					}					
 				}
@@ -211,7 +217,7 @@ void CGLParticleFlowPlot::Update(int ntime, float dt, bool breset)
 	m_lastTime = ntime;
 	m_lastDt = dt;
 
-	if (breset) { m_map.Clear(); m_rng.clear(); m_maxtime = -1; m_particles.clear(); }
+	if (breset) { m_map.reset(); m_maxtime = -1; ClearParticles(); }
 	if (m_nvec == -1) return;
 
 	CGLModel* mdl = GetModel();
@@ -226,54 +232,16 @@ void CGLParticleFlowPlot::Update(int ntime, float dt, bool breset)
 		m_find->Init(bdisp ? 1 : 0);
 	}
 
-	FEMeshBase* pm = mdl->GetActiveMesh();
-	FEPostModel* pfem = mdl->GetFEModel();
-
-	if (m_map.States() == 0)
+	if ((m_map == nullptr) || (m_map->Field() != m_nvec))
 	{
-		int NS = pfem->GetStates();
-		int NN = pm->Nodes();
-
-		m_map.Create(NS, NN, vec3f(0, 0, 0), -1);
-		m_rng.resize(NS);
+		m_map = mdl->GetVectorFieldMap(m_nvec, true);
 	}
 
-	// check the tag
-	int ntag = m_map.GetTag(ntime);
-
-	// see if we need to update
-	if (ntag != m_nvec)
-	{
-		// check all states up until this time
-		for (int n=0; n<=ntime; ++n)
-		{
-			ntag = m_map.GetTag(n);
-			if (ntag != m_nvec)
-			{
-				m_map.SetTag(n, m_nvec);
-
-				// get the state we are interested in
-				vector<vec3f>& val = m_map.State(n);
-
-				vec2f& rng = m_rng[n];
-				rng.x = rng.y = 0;
-
-				float L;
-
-				for (int i = 0; i<pm->Nodes(); ++i)
-				{
-					val[i] = pfem->EvaluateNodeVector(i, n, m_nvec);
-					L = val[i].Length();
-					if (L > rng.y) rng.y = L;
-				}
-
-				if (rng.y == rng.x) ++rng.y;
-			}
-		}
-	}
+	// evaluate all states up until this time
+	m_map->Update(0, ntime);
 
 	// copy nodal values
-	m_crng = m_rng[ntime];
+	m_crng = m_map->Range(ntime);
 
 	// update particles
 	UpdateParticles(ntime);
@@ -281,14 +249,9 @@ void CGLParticleFlowPlot::Update(int ntime, float dt, bool breset)
 
 void CGLParticleFlowPlot::UpdateParticles(int ntime)
 {
-	if (ntime < m_seedTime)
-	{
-		// deactivate all particles
-		for (int i=0; i<m_particles.size(); ++i) m_particles[i].m_balive = false;
-		return;
-	}
-
-	if (ntime > m_maxtime)
+	// Particles are only advected up to the requested time. Later states
+	// are evaluated when they are displayed for the first time.
+	if ((ntime >= m_seedTime) && (ntime > m_maxtime))
 	{
 		// perform particle integration
 		if (m_maxtime < m_seedTime)
@@ -307,64 +270,104 @@ void CGLParticleFlowPlot::UpdateParticles(int ntime)
 	UpdateParticleState(ntime);
 }
 
-void CGLParticleFlowPlot::UpdateParticleState(int ntime)
+void CGLParticleFlowPlot::ClearParticles()
 {
-	int NP = (int) m_particles.size();
-	for (int i=0; i<NP; ++i)
-	{
-		FlowParticle& p = m_particles[i];
-
-		if (ntime >= p.m_ndeath)
-		{
-			p.m_balive = false;
-		}
-		else
-		{
-			p.m_balive = true;
-			p.m_r = p.m_pos[ntime];
-			p.m_v = p.m_vel[ntime];
-		}
-	}
+	m_r.clear();
+	m_v.clear();
+	m_elem.clear();
+	m_death.clear();
+	m_col.clear();
+	m_track.clear();
+	m_ntime = -1;
+}
 
+void CGLParticleFlowPlot::UpdateParticleState(int ntime)
+{
+	m_ntime = ntime;
 	UpdateParticleColors();
 }
 
 void CGLParticleFlowPlot::UpdateParticleColors()
 {
+	int ntime = m_ntime;
+	if ((ntime < m_seedTime) || (ntime - m_seedTime >= (int)m_track.size())) return;
+
 	float vmin = m_crng.x;
 	float vmax = m_crng.y;
 	if (vmax == vmin) vmax++;
 
+	// the stored speed is relative to the range of the state
+	float vs = m_map->Range(ntime).y / 65535.f;
+
 	int ncol = m_Col.GetColorMap();
 	CColorMap& col = ColorMapManager::GetColorMap(ncol);
 
-	int NP = (int)m_particles.size();
+	const vector<PARTICLE_STATE>& pt = m_track[ntime - m_seedTime];
+	int NP = (int)m_death.size();
+	m_col.resize(NP);
 	for (int i = 0; i<NP; ++i)
 	{
-		FlowParticle& p = m_particles[i];
-		if (p.m_balive)
+		if (IsAlive(i, ntime))
 		{
-			vec3f& v = p.m_v;
-			float V = v.Length();
+			float V = pt[i].v*vs;
 			float w = (V - vmin) / (vmax - vmin);
-			p.m_col = col.map(w);
+			m_col[i] = col.map(w);
 		}
 	}
 }
 
-vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, bool& ok)
+static unsigned short quantize(float f)
+{
+	if (f <= 0.f) return 0;
+	if (f >= 65535.f) return 65535;
+	return (unsigned short)(f + 0.5f);
+}
+
+// Append the current particle positions and velocities to the trajectories.
+void CGLParticleFlowPlot::StoreState(int ntime)
+{
+	int NP = (int)m_r.size();
+	m_track.push_back(vector<PARTICLE_STATE>(NP));
+	vector<PARTICLE_STATE>& pt = m_track.back();
+
+	vec3f r0 = to_vec3f(m_box.r0());
+	float sx = (m_box.Width () > 0 ? 65535.f / (float)m_box.Width () : 0.f);
+	float sy = (m_box.Height() > 0 ? 65535.f / (float)m_box.Height() : 0.f);
+	float sz = (m_box.Depth () > 0 ? 65535.f / (float)m_box.Depth () : 0.f);
+	float sv = 65535.f / m_map->Range(ntime).y;
+
+	parallel_for(0, NP, [&](int i) {
+		const vec3f& r = m_r[i];
+		PARTICLE_STATE& p = pt[i];
+		p.x[0] = quantize((r.x - r0.x)*sx);
+		p.x[1] = quantize((r.y - r0.y)*sy);
+		p.x[2] = quantize((r.z - r0.z)*sz);
+		p.v = quantize(m_v[i].Length()*sv);
+	});
+}
+
+vec3f CGLParticleFlowPlot::Position(const PARTICLE_STATE& p) const
+{
+	const float s = 1.f / 65535.f;
+	return vec3f(
+		(float)(m_box.x0 + p.x[0] * s * m_box.Width ()),
+		(float)(m_box.y0 + p.x[1] * s * m_box.Height()),
+		(float)(m_box.z0 + p.x[2] * s * m_box.Depth ()));
+}
+
+vec3f CGLParticleFlowPlot::Velocity(const vec3f& r, int ntime, float w, int& nelem, bool& ok)
 {
 	vec3f v(0.f, 0.f, 0.f);
 	vec3f ve0[FEElement::MAX_NODES];
 	vec3f ve1[FEElement::MAX_NODES];
 	FEPostMesh& mesh = *GetModel()->GetActiveMesh();
 
-	vector<vec3f>& val0 = m_map.State(ntime    );
-	vector<vec3f>& val1 = m_map.State(ntime + 1);
+	vector<vec3f>& val0 = m_map->State(ntime    );
+	vector<vec3f>& val1 = m_map->State(ntime + 1);
 
-	int nelem;
+	// start the search in the element that contained the particle
 	double q[3];
-	if (m_find->FindElement(r, nelem, q))
+	if (m_find->FindElement(r, nelem, q, nelem))
 	{
 		ok = true;
 		FEElement_& el = mesh.ElementRef(nelem);
@@ -393,13 +396,8 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 	if (mdl == 0) return;
 	FEPostModel& fem = *mdl->GetFEModel();
 
-	// get the mesh
-	FEMeshBase& mesh = *mdl->GetActiveMesh();
-
-	BOX box = m_find->BoundingBox();
-	float R = box.GetMaxExtent();
 	float dt = m_dt;
-	if (dt <= 0.f) return;
+	int NP = (int)m_r.size();
 
 	for (int ntime=n0; ntime<n1; ++ntime)
 	{
@@ -407,61 +405,50 @@ void CGLParticleFlowPlot::AdvanceParticles(int n0, int n1)
 		float t1 = fem.GetState(ntime + 1)->m_time;
 		if (t1 < t0) t1 = t0;
 
-		int NP = (int)m_particles.size();
-#pragma omp parallel for shared (NP)
-		for (int i = 0; i<NP; ++i)
+		// particles don't move when there is no valid step size
+		if (dt > 0.f)
 		{
-			FlowParticle& p = m_particles[i];
-			p.m_pos[ntime+1] = p.m_pos[ntime];
-			p.m_vel[ntime+1] = p.m_vel[ntime];
-		}
+			parallel_for(0, NP, [&](int i) {
+				if (m_death[i] <= ntime) return;
 
-		float t = t0;
-		while (t < t1)
-		{
-			t += dt;
-			if (t > t1) t = t1;
-			float w = (t - t0) / (t1 - t0);
-
-			int NP = (int) m_particles.size();
-#pragma omp parallel for shared (NP)
-			for (int i=0; i<NP; ++i)
-			{
-				FlowParticle& p = m_particles[i];
+				vec3f r = m_r[i];
+				vec3f v = m_v[i];
+				int nelem = m_elem[i];
 
-				if (p.m_ndeath > ntime)
+				float t = t0;
+				while (t < t1)
 				{
-					vec3f r0 = p.m_pos[ntime + 1];
-					vec3f v0 = p.m_vel[ntime + 1];
+					t += dt;
+					if (t > t1) t = t1;
+					float w = (t - t0) / (t1 - t0);
 
-					vec3f r1 = r0 + v0*dt;
+					vec3f r1 = r + v*dt;
 
 					bool ok = true;
-					vec3f v1 = Velocity(r1, ntime, w, ok);
+					vec3f v1 = Velocity(r1, ntime, w, nelem, ok);
 					if (ok == false)
 					{
-						p.m_ndeath = ntime + 1;
-					}
-					else
-					{
-						p.m_pos[ntime + 1] = r1;
-						p.m_vel[ntime + 1] = v1;
+						m_death[i] = ntime + 1;
+						break;
 					}
+					r = r1;
+					v = v1;
 				}
-			}
+
+				m_r[i] = r;
+				m_v[i] = v;
+				m_elem[i] = nelem;
+			});
 		}
-	}
-}
 
-static float frand()
-{
-	return rand() / (float) RAND_MAX;
+		StoreState(ntime + 1);
+	}
 }
 
 void CGLParticleFlowPlot::SeedParticles()
 {
 	// clear current particles, if any
-	m_particles.clear();
+	ClearParticles();
 
 	// get the model
 	CGLModel* mdl = GetModel();
@@ -477,16 +464,15 @@ void CGLParticleFlowPlot::SeedParticles()
 	// get the mesh
 	FEMeshBase& mesh = *mdl->GetActiveMesh();
 
-	vector<vec3f>& val = m_map.State(m_seedTime);
+	vector<vec3f>& val = m_map->State(m_seedTime);
 
 	// make sure vtol is positive
 	float vtol = fabs(m_vtol);
 
 	// loop over all the surface facts
 	int NF = mesh.Faces();
-#pragma omp parallel for shared (NF)
-	for (int i = 0; i<NF; ++i)
-	{
+	vector<char> seed(NF, 0);
+	parallel_for(0, NF, [&](int i) {
 		FEFace& f = mesh.Face(i);
 
 		// evaluate the average velocity at this face
@@ -495,35 +481,40 @@ void CGLParticleFlowPlot::SeedParticles()
 		for (int j = 0; j<nf; ++j) vf += val[f.n[j]];
 		vf /= nf;
 
-		// generate random number
-		float w = frand();
-
 		// see if this is a valid candidate for a seed
 		vec3f fn = f.m_fn;
-		if ((fn*vf < -vtol) && (w <= m_density))
-		{
-			// calculate the face center, this will be the seed
-			// NOTE: We are using reference coordinates, therefore we assume that the mesh is not deforming!!
-			vec3d cf(0.f, 0.f, 0.f);
-			for (int j = 0; j<nf; ++j) cf += mesh.Node(f.n[j]).r;
-			cf /= nf;
-
-			// create a particle here
-			FlowParticle p;
-			p.m_pos.resize(NS);
-			p.m_vel.resize(NS);
-			p.m_balive = true;
-			p.m_ndeath = NS;	// assume the particle will live the entire time
-
-			// set initial position and velocity
-			p.m_pos[m_seedTime] = to_vec3f(cf);
-			p.m_vel[m_seedTime] = vf;
-
-			// add it to the pile
-#pragma omp critical
-            {
-                m_particles.push_back(p);
-            }
-		}
+		if ((fn*vf < -vtol) && (PlotRandom(0, i) <= m_density)) seed[i] = 1;
+	});
+
+	// create the particles in face order
+	for (int i = 0; i<NF; ++i)
+	{
+		if (seed[i] == 0) continue;
+		FEFace& f = mesh.Face(i);
+		int nf = f.Nodes();
+
+		// calculate the face center, this will be the seed
+		// NOTE: We are using reference coordinates, therefore we assume that the mesh is not deforming!!
+		vec3d cf(0.f, 0.f, 0.f);
+		vec3f vf(0.f, 0.f, 0.f);
+		for (int j = 0; j<nf; ++j) { cf += mesh.Node(f.n[j]).r; vf += val[f.n[j]]; }
+		cf /= nf;
+		vf /= nf;
+
+		// set initial position and velocity
+		m_r.push_back(to_vec3f(cf));
+		m_v.push_back(vf);
+		m_elem.push_back(f.m_elem[0].eid);
+		m_death.push_back(NS);	// assume the particle will live the entire time
 	}
+
+	// Particles can only move inside the mesh, but the mesh may deform. We add
+	// some room around the bounding box for the quantization of the trajectories.
+	m_box = m_find->BoundingBox();
+	double R = m_box.GetMaxExtent();
+	if (R == 0.0) R = 1.0;
+	m_box.Inflate(0.5*R);
+
+	// store the initial state
+	StoreState(m_seedTime);
 }
@@ -35,39 +35,12 @@ class CGLParticleFlowPlot : public CGLPlot
 {
 	enum { DATA_FIELD, COLOR_MAP, CLIP, SEED_STEP, THRESHOLD, DENSITY, STEP_SIZE, PATH_LINES, PATH_LENGTH };
 
-	class FlowParticle
+	// Compressed particle state. The position is quantized to 16 bits per component
+	// inside the trajectory box and the speed is stored relative to the state's range.
+	struct PARTICLE_STATE
 	{
-	public:
-		FlowParticle(){}
-		FlowParticle(const FlowParticle& p)
-		{
-			m_r = p.m_r;
-			m_v = p.m_v;
-			m_col = p.m_col;
-			m_balive = p.m_balive;
-			m_ndeath = p.m_ndeath;
-			m_pos = p.m_pos;
-			m_vel = p.m_vel;
-		}
-		void operator =(const FlowParticle& p)
-		{
-			m_r = p.m_r;
-			m_v = p.m_v;
-			m_col = p.m_col;
-			m_balive = p.m_balive;
-			m_ndeath = p.m_ndeath;
-			m_pos = p.m_pos;
-			m_vel = p.m_vel;
-		}
-
-	public:
-		vec3f			m_r;		// current particle position
-		vec3f			m_v;		// current particle velocity
-		GLColor			m_col;		// particles color
-		bool			m_balive;	// is particle alive at current position?
-		int				m_ndeath;	// time of death
-		vector<vec3f>	m_pos;		// particle position at various times
-		vector<vec3f>	m_vel;		// particle velocity at various times
+		unsigned short	x[3];
+		unsigned short	v;
 	};
 
 public:
@@ -105,12 +78,20 @@ protected:
 
 	void SeedParticles();
 
+	void ClearParticles();
+
 	void AdvanceParticles(int t0, int t1);
 
-	vec3f Velocity(const vec3f& r, int ntime, float dt, bool& ok);
+	vec3f Velocity(const vec3f& r, int ntime, float dt, int& nelem, bool& ok);
 
 	void UpdateParticleState(int ntime);
 
+	void StoreState(int ntime);
+
+	vec3f Position(const PARTICLE_STATE& p) const;
+
+	bool IsAlive(int i, int ntime) const { return (ntime >= m_seedTime) && (ntime <= m_maxtime) && (ntime < m_death[i]); }
+
 public:
 	void UpdateParticleColors();
 
@@ -124,8 +105,7 @@ private:
 	bool	m_showPath;
 	int		m_pathLength;
 
-	vector<vec2f>	m_rng;	// nodal ranges
-	DataMap<vec3f>	m_map;	// nodal values map
+	std::shared_ptr<VectorFieldMap>	m_map;	// nodal values map (shared with other plots)
 	vec2f			m_crng;	// current range
 
 	int				m_seedTime;	// time the particles begin to flow
@@ -136,6 +116,15 @@ private:
 
 	FEFindElement*	m_find;
 
-	vector<FlowParticle>	m_particles;
+	// particle data, stored as structure of arrays
+	vector<vec3f>	m_r;		// position at m_maxtime (full precision, used for advection)
+	vector<vec3f>	m_v;		// velocity at m_maxtime
+	vector<int>		m_elem;		// element containing the particle (start of the next search)
+	vector<int>		m_death;	// time of death
+	vector<GLColor>	m_col;		// particle colors at current time
+	int				m_ntime;	// the time for which the colors are evaluated
+
+	vector< vector<PARTICLE_STATE> >	m_track;	// trajectories; m_track[n - m_seedTime] stores all particles at state n
+	BOX									m_box;		// quantization box of the trajectories
 };
 }
@@ -29,7 +29,10 @@ SOFTWARE.*/
 #include <GLLib/GLContext.h>
 #include <GLLib/GLCamera.h>
 #include "GLModel.h"
+#include "GLSolidNodeTable.h"
 #include <MeshLib/hex.h>
+#include <FSCore/FSThreadPool.h>
+#include <algorithm>
 using namespace Post;
 
 extern int LUT[256][15];
@@ -37,10 +40,6 @@ extern int LUT2D[16][4];
 extern int ET_HEX[12][2];
 extern int ET2D[4][2];
 
-const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
-const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
-const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
 const int QUAD_NT[4] = { 0, 1, 2, 3 };
 const int TRI_NT[4]  = { 0, 1, 2, 2 };
 
@@ -86,6 +85,11 @@ CGLPlaneCutPlot::CGLPlaneCutPlot()
 
 	m_meshColor = GLColor(0, 0, 0);
 
+	m_indexMesh = nullptr;
+	m_indexValid = false;
+	m_indexTime = -1;
+	m_indexDt = 0.f;
+
 	m_nclip = GetFreePlane();
 	if (m_nclip >= 0) m_pcp[m_nclip] = this;
 
@@ -185,6 +189,16 @@ void CGLPlaneCutPlot::InitClipPlanes()
 
 void CGLPlaneCutPlot::Update(int ntime, float dt, bool breset)
 {
+	// the nodal positions only change with the state and the displacement map
+	CGLDisplacementMap* pdm = GetModel()->GetDisplacementMap();
+	vec3d scl = ((pdm && pdm->IsActive()) ? pdm->GetScale() : vec3d(0, 0, 0));
+	if (breset || (ntime != m_indexTime) || (dt != m_indexDt) || !(scl == m_indexScale))
+	{
+		m_indexValid = false;
+		m_indexTime = ntime;
+		m_indexDt = dt;
+		m_indexScale = scl;
+	}
 	UpdateSlice();
 }
 
@@ -429,32 +443,17 @@ void CGLPlaneCutPlot::RenderMesh()
 
 	Post::FEState& state = *ps->CurrentState();
 
-	// repeat over all elements
-	for (i=0; i<pm->Elements(); ++i)
+	// repeat over the elements that are cut by the plane
+	for (i=0; i<(int)m_cutElem.size(); ++i)
 	{
-		// render only when visible
-		FEElement_& el = pm->ElementRef(i);
+		FEElement_& el = pm->ElementRef(m_cutElem[i].first);
 		FEMaterial* pmat = ps->GetMaterial(el.m_MatID);
-		if ((el.m_ntag > 0) && (pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
+		if ((pmat->bmesh) && (pmat->bvisible || m_bcut_hidden) && (pmat->bclip))
 		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-            case FE_PENTA15: nt = PEN_NT; break;
-            case FE_TET4   : nt = TET_NT; break;
-            case FE_TET5   : nt = TET_NT; break;
-			case FE_TET10  : nt = TET_NT; break;
-			case FE_TET15  : nt = TET_NT; break;
-			case FE_TET20  : nt = TET_NT; break;
-            case FE_PYRA5  : nt = PYR_NT; break;
-            case FE_PYRA13 : nt = PYR_NT; break;
-			}
+			nt = solidNodeTable(el);
 
-			// calculate the case of the element
-			ncase = el.m_ntag;
+			// the case of the element was calculated when the slice was built
+			ncase = m_cutElem[i].second;
 
 			// get the nodal values
 			for (k=0; k<8; ++k)
@@ -616,8 +615,13 @@ void CGLPlaneCutPlot::UpdateSlice()
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
 	m_slice.Clear();
+	m_cutElem.clear();
 
-	Post::FEState& state = *ps->CurrentState();
+	// the span index only depends on the plane normal, so moving the plane does not require a rebuild
+	if (!m_indexValid || (m_indexMesh != pm) || !(m_indexNormal == norm) || ((int)m_index.size() != pm->Domains()))
+	{
+		UpdateSpanIndex(pm, norm);
+	}
 
 	// loop over all domains
 	for (int n = 0; n < pm->Domains(); ++n)
@@ -637,16 +641,48 @@ void CGLPlaneCutPlot::UpdateSlice()
 	AddFaces(pm);
 }
 
-void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
+void CGLPlaneCutPlot::UpdateSpanIndex(FEPostMesh* pm, const vec3d& norm)
 {
-	float ev[8];
-	vec3d ex[8];
-	int	nf[8];
-	EDGE edge[15];
-	int en[8];
-	int	rf[3];
+	m_index.resize(pm->Domains());
+	for (int n = 0; n < pm->Domains(); ++n)
+	{
+		FEDomain& dom = pm->Domain(n);
+
+		int NE = dom.Elements();
+		std::vector<SpanIndex::SPAN> span(NE);
+		parallel_for(0, NE, [&](int i) {
+			SpanIndex::SPAN& s = span[i];
+			s.item = i;
+			s.vmin = 1.0;
+			s.vmax = -1.0;
+
+			FEElement_& el = dom.Element(i);
+			const int* nt = (el.IsSolid() ? solidNodeTable(el) : nullptr);
+			if (nt == nullptr) return;
+
+			// same projection as used for the element case in SliceElement
+			for (int k = 0; k < 8; ++k)
+			{
+				vec3d x = to_vec3f(pm->Node(el.m_node[nt[k]]).r);
+				double v = norm*x;
+				if ((k == 0) || (v < s.vmin)) s.vmin = v;
+				if ((k == 0) || (v > s.vmax)) s.vmax = v;
+			}
+		});
+
+		// unsupported elements have an empty span and are not indexed
+		m_index[n].Build(span);
+	}
 
+	m_indexMesh = pm;
+	m_indexNormal = norm;
+	m_indexValid = true;
+}
+
+void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
+{
 	FEDomain& dom = pm->Domain(n);
+	if (n >= (int)m_index.size()) return;
 
 	// get the plane equations
 	GLdouble a[4];
@@ -663,189 +699,204 @@ void CGLPlaneCutPlot::AddDomain(FEPostMesh* pm, int n)
 	FEPostModel* ps = mdl->GetFEModel();
 	Post::FEState& state = *ps->CurrentState();
 
-	// repeat over all elements
-	for (int i = 0; i < dom.Elements(); ++i)
-	{
-		// render only when visible
-		FEElement_& el = dom.Element(i);
-		if ((el.IsVisible() || m_bcut_hidden) && el.IsSolid())
+	// only the elements whose extent contains the plane can be cut
+	std::vector<int> elems;
+	m_index[n].Find(ref, elems);
+
+	// triangulate the cut elements in parallel, each chunk into its own buffer
+	int NE = (int)elems.size();
+	if (NE == 0) return;
+	FSThreadPool& pool = FSThreadPool::Instance();
+	int chunks = pool.Chunks(NE);
+	std::vector< std::vector<GLSlice::FACE> > faces(chunks);
+	std::vector< std::vector<std::pair<int, int> > > cut(chunks);
+	pool.Run(0, NE, chunks, [&](int c, int i0, int i1) {
+		for (int i = i0; i < i1; ++i)
 		{
-			const int *nt = nullptr;
-			switch (el.Type())
+			FEElement_& el = dom.Element(elems[i]);
+			if ((el.IsVisible() || m_bcut_hidden) && el.IsSolid())
 			{
-			case FE_HEX8: nt = HEX_NT; break;
-			case FE_HEX20: nt = HEX_NT; break;
-			case FE_HEX27: nt = HEX_NT; break;
-			case FE_PENTA6: nt = PEN_NT; break;
-			case FE_PENTA15: nt = PEN_NT; break;
-			case FE_TET4: nt = TET_NT; break;
-			case FE_TET5: nt = TET_NT; break;
-			case FE_TET10: nt = TET_NT; break;
-			case FE_TET15: nt = TET_NT; break;
-			case FE_TET20: nt = TET_NT; break;
-			case FE_PYRA5: nt = PYR_NT; break;
-            case FE_PYRA13: nt = PYR_NT; break;
-			}
-
-			// get the nodal values
-			for (int k = 0; k < 8; ++k)
-			{
-				FENode& node = pm->Node(el.m_node[nt[k]]);
-				nf[k] = (node.IsExterior() ? 1 : 0);
-				ex[k] = to_vec3f(node.r);
-				en[k] = el.m_node[nt[k]];
-				ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+				int ncase = SliceElement(pm, el, n, norm, ref, ndivs, state, faces[c]);
+				cut[c].push_back(std::pair<int, int>(dom.ElementIndex(elems[i]), ncase));
 			}
+		}
+	});
 
-			// calculate the case of the element
-			int ncase = 0;
-			for (int k = 0; k < 8; ++k)
-				if (norm*ex[k] >= ref) ncase |= (1 << k);
+	for (int c = 0; c < chunks; ++c)
+	{
+		m_slice.AddFaces(faces[c]);
+		m_cutElem.insert(m_cutElem.end(), cut[c].begin(), cut[c].end());
+	}
+}
 
-			el.m_ntag = ncase;
+// Triangulate the cut through a single element. Returns the LUT case of the element.
+int CGLPlaneCutPlot::SliceElement(FEPostMesh* pm, FEElement_& el, int ndom, const vec3d& norm, double ref, int ndivs, Post::FEState& state, std::vector<GLSlice::FACE>& faces)
+{
+	float ev[8];
+	vec3d ex[8];
+	int	nf[8];
+	int en[8];
+	int	rf[3];
 
-			if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
-			{
-				// loop over faces
-				int* pf = LUT[ncase];
-				int ne = 0;
-				for (int l = 0; l < 5; l++)
-				{
-					if (*pf == -1) break;
+	const int *nt = solidNodeTable(el);
 
-					// calculate nodal positions
-					vec3d r[3];
-					float tex[3], w1, w2, w;
-					for (int k = 0; k < 3; k++)
-					{
-						int n1 = ET_HEX[pf[k]][0];
-						int n2 = ET_HEX[pf[k]][1];
+	// get the nodal values
+	for (int k = 0; k < 8; ++k)
+	{
+		FENode& node = pm->Node(el.m_node[nt[k]]);
+		nf[k] = (node.IsExterior() ? 1 : 0);
+		ex[k] = to_vec3f(node.r);
+		en[k] = el.m_node[nt[k]];
+		ev[k] = state.m_NODE[el.m_node[nt[k]]].m_val;
+	}
 
-						w1 = norm * ex[n1];
-						w2 = norm * ex[n2];
+	// calculate the case of the element
+	int ncase = 0;
+	for (int k = 0; k < 8; ++k)
+		if (norm*ex[k] >= ref) ncase |= (1 << k);
 
-						if (w2 != w1)
-							w = (ref - w1) / (w2 - w1);
-						else
-							w = 0.f;
+	if ((ndivs <= 1) || (el.Shape() != ELEM_HEX))
+	{
+		// loop over faces
+		int* pf = LUT[ncase];
+		int ne = 0;
+		for (int l = 0; l < 5; l++)
+		{
+			if (*pf == -1) break;
 
-						float v = ev[n1] * (1 - w) + ev[n2] * w;
+			// calculate nodal positions
+			vec3d r[3];
+			float tex[3], w1, w2, w;
+			for (int k = 0; k < 3; k++)
+			{
+				int n1 = ET_HEX[pf[k]][0];
+				int n2 = ET_HEX[pf[k]][1];
 
-						r[k] = ex[n1] * (1 - w) + ex[n2] * w;
-						tex[k] = v;
-						rf[k] = ((nf[n1] == 1) && (nf[n2] == 1) ? 1 : 0);
-					}
+				w1 = norm * ex[n1];
+				w2 = norm * ex[n2];
 
-					GLSlice::FACE face;
-					face.mat = n;
-					face.norm = norm;
-					face.r[0] = r[0];
-					face.r[1] = r[1];
-					face.r[2] = r[2];
-					face.tex[0] = tex[0];
-					face.tex[1] = tex[1];
-					face.tex[2] = tex[2];
-					face.bactive = el.IsActive();
+				if (w2 != w1)
+					w = (ref - w1) / (w2 - w1);
+				else
+					w = 0.f;
 
-					m_slice.AddFace(face);
+				float v = ev[n1] * (1 - w) + ev[n2] * w;
 
-					pf += 3;
-				}
+				r[k] = ex[n1] * (1 - w) + ex[n2] * w;
+				tex[k] = v;
+				rf[k] = ((nf[n1] == 1) && (nf[n2] == 1) ? 1 : 0);
 			}
-			else
+
+			GLSlice::FACE face;
+			face.mat = ndom;
+			face.norm = norm;
+			face.r[0] = r[0];
+			face.r[1] = r[1];
+			face.r[2] = r[2];
+			face.tex[0] = tex[0];
+			face.tex[1] = tex[1];
+			face.tex[2] = tex[2];
+			face.bactive = el.IsActive();
+
+			faces.push_back(face);
+
+			pf += 3;
+		}
+	}
+	else
+	{
+		for (int ix = 0; ix < ndivs; ++ix)
+		{
+			double wr0 = -1.0 + 2.0*ix / ndivs;
+			double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
+			for (int iy = 0; iy < ndivs; ++iy)
 			{
-				for (int ix = 0; ix < ndivs; ++ix)
+				double ws0 = -1.0 + 2.0*iy / ndivs;
+				double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
+				for (int iz = 0; iz < ndivs; ++iz)
 				{
-					double wr0 = -1.0 + 2.0*ix / ndivs;
-					double wr1 = -1.0 + 2.0*(ix + 1) / ndivs;
-					for (int iy = 0; iy < ndivs; ++iy)
+					double wt0 = -1.0 + 2.0*iz / ndivs;
+					double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
+
+					double H[8][8];
+					HEX8::shape(H[0], wr0, ws0, wt0);
+					HEX8::shape(H[1], wr1, ws0, wt0);
+					HEX8::shape(H[2], wr1, ws1, wt0);
+					HEX8::shape(H[3], wr0, ws1, wt0);
+					HEX8::shape(H[4], wr0, ws0, wt1);
+					HEX8::shape(H[5], wr1, ws0, wt1);
+					HEX8::shape(H[6], wr1, ws1, wt1);
+					HEX8::shape(H[7], wr0, ws1, wt1);
+
+					vec3d x[8];
+					float v[8];
+					for (int kk = 0; kk < 8; ++kk)
+					{
+						double* h = H[kk];
+						x[kk] = vec3d(0, 0, 0);
+						v[kk] = 0.0;
+						for (int jj = 0; jj < 8; ++jj)
+						{
+							x[kk] += ex[jj] * h[jj];
+							v[kk] += ev[jj] * h[jj];
+						}
+					}																					
+
+					// calculate the case of the element
+					int ncase = 0;
+					for (int k = 0; k < 8; ++k)
+						if (norm*x[k] >= ref) ncase |= (1 << k);
+
+					// loop over faces
+					int* pf = LUT[ncase];
+					int ne = 0;
+					for (int l = 0; l < 5; l++)
 					{
-						double ws0 = -1.0 + 2.0*iy / ndivs;
-						double ws1 = -1.0 + 2.0*(iy + 1) / ndivs;
-						for (int iz = 0; iz < ndivs; ++iz)
+						if (*pf == -1) break;
+
+						// calculate nodal positions
+						vec3d r[3];
+						float tex[3], w1, w2, w;
+						for (int k = 0; k < 3; k++)
 						{
-							double wt0 = -1.0 + 2.0*iz / ndivs;
-							double wt1 = -1.0 + 2.0*(iz + 1) / ndivs;
-
-							double H[8][8];
-							HEX8::shape(H[0], wr0, ws0, wt0);
-							HEX8::shape(H[1], wr1, ws0, wt0);
-							HEX8::shape(H[2], wr1, ws1, wt0);
-							HEX8::shape(H[3], wr0, ws1, wt0);
-							HEX8::shape(H[4], wr0, ws0, wt1);
-							HEX8::shape(H[5], wr1, ws0, wt1);
-							HEX8::shape(H[6], wr1, ws1, wt1);
-							HEX8::shape(H[7], wr0, ws1, wt1);
-
-							vec3d x[8];
-							float v[8];
-							for (int kk = 0; kk < 8; ++kk)
-							{
-								double* h = H[kk];
-								x[kk] = vec3d(0, 0, 0);
-								v[kk] = 0.0;
-								for (int jj = 0; jj < 8; ++jj)
-								{
-									x[kk] += ex[jj] * h[jj];
-									v[kk] += ev[jj] * h[jj];
-								}
-							}																					
-
-							// calculate the case of the element
-							int ncase = 0;
-							for (int k = 0; k < 8; ++k)
-								if (norm*x[k] >= ref) ncase |= (1 << k);
-
-							// loop over faces
-							int* pf = LUT[ncase];
-							int ne = 0;
-							for (int l = 0; l < 5; l++)
-							{
-								if (*pf == -1) break;
-
-								// calculate nodal positions
-								vec3d r[3];
-								float tex[3], w1, w2, w;
-								for (int k = 0; k < 3; k++)
-								{
-									int n1 = ET_HEX[pf[k]][0];
-									int n2 = ET_HEX[pf[k]][1];
-
-									w1 = norm * x[n1];
-									w2 = norm * x[n2];
-
-									if (w2 != w1)
-										w = (ref - w1) / (w2 - w1);
-									else
-										w = 0.f;
-
-									float f = v[n1] * (1 - w) + v[n2] * w;
-
-									r[k] = x[n1] * (1 - w) + x[n2] * w;
-									tex[k] = f;
-								}
-
-								GLSlice::FACE face;
-								face.mat = n;
-								face.norm = norm;
-								face.r[0] = r[0];
-								face.r[1] = r[1];
-								face.r[2] = r[2];
-								face.tex[0] = tex[0];
-								face.tex[1] = tex[1];
-								face.tex[2] = tex[2];
-								face.bactive = el.IsActive();
-
-								m_slice.AddFace(face);
-
-								pf += 3;
-							}
+							int n1 = ET_HEX[pf[k]][0];
+							int n2 = ET_HEX[pf[k]][1];
+
+							w1 = norm * x[n1];
+							w2 = norm * x[n2];
+
+							if (w2 != w1)
+								w = (ref - w1) / (w2 - w1);
+							else
+								w = 0.f;
+
+							float f = v[n1] * (1 - w) + v[n2] * w;
+
+							r[k] = x[n1] * (1 - w) + x[n2] * w;
+							tex[k] = f;
 						}
+
+						GLSlice::FACE face;
+						face.mat = ndom;
+						face.norm = norm;
+						face.r[0] = r[0];
+						face.r[1] = r[1];
+						face.r[2] = r[2];
+						face.tex[0] = tex[0];
+						face.tex[1] = tex[1];
+						face.tex[2] = tex[2];
+						face.bactive = el.IsActive();
+
+						faces.push_back(face);
+
+						pf += 3;
 					}
 				}
 			}
 		}
 	}
+
+	return ncase;
 }
 
 void CGLPlaneCutPlot::AddFaces(FEPostMesh* pm)
@@ -27,8 +27,11 @@ SOFTWARE.*/
 #pragma once
 #include "GLPlot.h"
 #include <MathLib/Transform.h>
+#include <PostLib/SpanIndex.h>
 #include <vector>
 
+class FEElement_;
+
 namespace Post {
 
 	class FEState;
@@ -61,6 +64,7 @@ class CGLPlaneCutPlot : public CGLPlot
 		FACE& Face(int i) { return m_Face[i]; }
 
 		void AddFace(FACE& f) { m_Face.push_back(f); }
+		void AddFaces(const std::vector<FACE>& f) { m_Face.insert(m_Face.end(), f.begin(), f.end()); }
 
 		int Edges() const { return (int) m_Edge.size(); }
 		EDGE& Edge(int i) { return m_Edge[i]; }
@@ -110,8 +114,10 @@ protected:
 	void ReleasePlane();
 	static int GetFreePlane();
 	void UpdateSlice();
+	void UpdateSpanIndex(FEPostMesh* pm, const vec3d& norm);
 
 	void AddDomain(FEPostMesh* pm, int n);
+	int SliceElement(FEPostMesh* pm, FEElement_& el, int ndom, const vec3d& norm, double ref, int ndivs, FEState& state, std::vector<GLSlice::FACE>& faces);
 	void AddFaces(FEPostMesh* pm);
 
 public:
@@ -144,6 +150,18 @@ protected:
 
 	GLSlice	m_slice;
 
+	// per-domain index of the element extents along the plane normal
+	std::vector<SpanIndex>	m_index;
+	vec3d		m_indexNormal;	// normal the index was built for
+	FEPostMesh*	m_indexMesh;	// mesh the index was built for
+	bool		m_indexValid;
+	int			m_indexTime;	// state the nodal positions were taken from
+	float		m_indexDt;		// interpolation fraction of that state
+	vec3d		m_indexScale;	// displacement scale, or zero if no displacement map is active
+
+	// cut elements (mesh element index, LUT case) of the current slice
+	std::vector<std::pair<int, int> >	m_cutElem;
+
 	int		m_nclip;								// clip plane number
 	static	std::vector<int>				m_clip;	// avaialabe clip planes
 	static	std::vector<CGLPlaneCutPlot*>	m_pcp;
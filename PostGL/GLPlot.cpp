@@ -98,3 +98,14 @@ void CGLLegendPlot::ShowLegend(bool b)
 		if (b) m_pbar->show(); else m_pbar->hide();
 	}
 }
+
+//-----------------------------------------------------------------------------
+float Post::PlotRandom(int seed, int item)
+{
+	// splitmix64
+	unsigned long long z = ((unsigned long long)(unsigned int)seed << 32) + (unsigned int)item + 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z = z ^ (z >> 31);
+	return (float)((z >> 40) / (double)((1ull << 24) - 1));
+}
@@ -77,4 +77,9 @@ private:
 	GLLegendBar*	m_pbar;
 };
 
+
+// Deterministic random number in [0,1] that only depends on the seed and the item,
+// so that plots can select items in parallel, independent of the evaluation order.
+float PlotRandom(int seed, int item);
+
 }
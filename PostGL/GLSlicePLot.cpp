@@ -29,6 +29,8 @@ SOFTWARE.*/
 #include "GLWLib/GLWidgetManager.h"
 #include "PostLib/constants.h"
 #include "GLModel.h"
+#include "GLSolidNodeTable.h"
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 extern int LUT[256][15];
@@ -67,6 +69,9 @@ CGLSlicePlot::CGLSlicePlot()
 	m_lastTime = 0;
 	m_lastDt = 0.f;
 
+	m_indexMesh = nullptr;
+	m_indexValid = false;
+
 	m_Col.SetDivisions(m_nslices);
 	m_Col.SetSmooth(false);
 
@@ -149,6 +154,12 @@ void CGLSlicePlot::Render(CGLContext& rc)
 		fmax -= 1e-3*Df;
 	}
 	glColor3ub(255, 255, 255);
+
+	// the index only needs to be rebuilt when the normal or the state changes
+	vec3f norm = m_norm; norm.Normalize();
+	FEPostMesh* pm = GetModel()->GetActiveMesh();
+	if (!m_indexValid || (m_indexMesh != pm) || (m_indexNorm.x != norm.x) || (m_indexNorm.y != norm.y) || (m_indexNorm.z != norm.z)) UpdateIndex(pm, norm);
+
 	if (m_nslices == 1)
 	{
 		float ref = fmin + m_offset*(fmax - fmin);
@@ -174,7 +185,7 @@ void CGLSlicePlot::Render(CGLContext& rc)
 
 void CGLSlicePlot::RenderSlice(float ref)
 {
-	int i, k, l;
+	int k, l;
 	int ncase, *pf;
 	float w;
 
@@ -182,10 +193,6 @@ void CGLSlicePlot::RenderSlice(float ref)
 	float ex[8];	// element nodal distances
 	vec3f er[8];
 
-	const int HEX_NT[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-	const int PEN_NT[8] = {0, 1, 2, 2, 3, 4, 5, 5};
-	const int TET_NT[8] = {0, 1, 2, 2, 3, 3, 3, 3};
-    const int PYR_NT[8] = {0, 1, 2, 3, 4, 4, 4, 4};
 	const int* nt;
 
 	// get the mesh
@@ -200,30 +207,20 @@ void CGLSlicePlot::RenderSlice(float ref)
 	if (rng.x == rng.y) rng.y++;
 	float f;
 
-	// loop over all elements
-	for (i=0; i<pm->Elements(); ++i)
+	// only visit the elements whose extent contains the slice
+	std::vector<int> elems;
+	m_index.Find(ref, elems);
+
+	// loop over all cut elements
+	for (int n=0; n<(int)elems.size(); ++n)
 	{
 		// render only if the element is visible and
 		// its material is enabled
-		FEElement_& el = pm->ElementRef(i);
+		FEElement_& el = pm->ElementRef(elems[n]);
 		FEMaterial* pmat = ps->GetMaterial(el.m_MatID);
 		if (pmat->benable && el.IsVisible() && el.IsSolid())
 		{
-			switch (el.Type())
-			{
-			case FE_HEX8   : nt = HEX_NT; break;
-			case FE_HEX20  : nt = HEX_NT; break;
-			case FE_HEX27  : nt = HEX_NT; break;
-			case FE_PENTA6 : nt = PEN_NT; break;
-            case FE_PENTA15: nt = PEN_NT; break;
-            case FE_TET4   : nt = TET_NT; break;
-            case FE_TET5   : nt = TET_NT; break;
-            case FE_PYRA5  : nt = PYR_NT; break;
-            case FE_PYRA13 : nt = PYR_NT; break;
-			default:
-				assert(false);
-				return;
-			}
+			nt = solidNodeTable(el);
 
 			// get the nodal values
 			for (k=0; k<8; ++k)
@@ -282,6 +279,37 @@ void CGLSlicePlot::RenderSlice(float ref)
 	}	
 }
 
+//-----------------------------------------------------------------------------
+// build the index of the element extents along the slice normal
+void CGLSlicePlot::UpdateIndex(FEPostMesh* pm, const vec3f& norm)
+{
+	int NE = pm->Elements();
+	std::vector<SpanIndex::SPAN> span(NE);
+	parallel_for(0, NE, [&](int i) {
+		SpanIndex::SPAN& s = span[i];
+		s.item = i;
+		s.vmin = 1.0;
+		s.vmax = -1.0;
+
+		FEElement_& el = pm->ElementRef(i);
+		const int* nt = (el.IsSolid() ? solidNodeTable(el) : nullptr);
+		if (nt == nullptr) return;
+
+		// same distance as used in RenderSlice
+		for (int k = 0; k < 8; ++k)
+		{
+			float v = pm->Node(el.m_node[nt[k]]).r*norm;
+			if ((k == 0) || (v < s.vmin)) s.vmin = v;
+			if ((k == 0) || (v > s.vmax)) s.vmax = v;
+		}
+	});
+
+	m_index.Build(span);
+	m_indexMesh = pm;
+	m_indexNorm = norm;
+	m_indexValid = true;
+}
+
 //-----------------------------------------------------------------------------
 void CGLSlicePlot::SetEvalField(int n) 
 { 
@@ -297,6 +325,9 @@ void CGLSlicePlot::Update()
 //-----------------------------------------------------------------------------
 void CGLSlicePlot::Update(int ntime, float dt, bool breset)
 {
+	// the nodal positions may have changed
+	m_indexValid = false;
+
 	CGLModel* mdl = GetModel();
 
 	FEMeshBase* pm = mdl->GetActiveMesh();
@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "GLPlot.h"
 #include "GLWLib/GLWidget.h"
 #include "PostLib/DataMap.h"
+#include <PostLib/SpanIndex.h>
 
 namespace Post {
 
@@ -74,6 +75,7 @@ public:
 
 protected:
 	void RenderSlice(float ref);
+	void UpdateIndex(FEPostMesh* pm, const vec3f& norm);
 
 protected:
 	int			m_nslices;	// nr. of iso surface slices
@@ -94,5 +96,10 @@ protected:
 
 	int m_lastTime;
 	float	m_lastDt;
+
+	SpanIndex	m_index;		// element extents along the normal
+	vec3f		m_indexNorm;	// normal the index was built for
+	FEPostMesh*	m_indexMesh;	// mesh the index was built for
+	bool		m_indexValid;
 };
 }
@@ -29,6 +29,9 @@ SOFTWARE.*/
 #include "GLWLib/GLWidgetManager.h"
 #include "GLModel.h"
 #include <MeshLib/MeshTools.h>
+#include <FSCore/Profiler.h>
+#include <FSCore/FSThreadPool.h>
+#include <chrono>
 using namespace Post;
 
 //=================================================================================================
@@ -160,11 +163,6 @@ void CGLStreamLinePlot::Render(CGLContext& rc)
 	glPopAttrib();
 }
 
-static float frand()
-{
-	return rand() / (float)RAND_MAX;
-}
-
 void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 {
 	m_lastTime = ntime;
@@ -174,7 +172,7 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 	FEMeshBase* pm = mdl->GetActiveMesh();
 	FEPostModel* pfem = mdl->GetFEModel();
 
-	if (breset) { m_map.Clear(); m_rng.clear(); m_val.clear(); m_prob.clear(); }
+	if (breset) { m_map.reset(); m_val.clear(); m_prob.clear(); }
 
 	// see if we need to revaluate the FEFindElement object
 	// We evaluate it when the plot needs to be reset, or when the model has a displacement map
@@ -186,14 +184,9 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 		m_find->Init(bdisp ? 1 : 0);
 	}
 
-	if (m_map.States() == 0)
+	if ((m_map == nullptr) || (m_map->Field() != m_nvec))
 	{
-		int NS = pfem->GetStates();
-		int NN = pm->Nodes();
-
-		m_map.Create(NS, NN, vec3f(0, 0, 0), -1);
-		m_rng.resize(NS);
-		m_val.resize(NN);
+		m_map = mdl->GetVectorFieldMap(m_nvec, true);
 	}
 
 	if (m_prob.empty())
@@ -201,38 +194,15 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 		FEMeshBase& mesh = *pfem->GetFEMesh(0);
 		int NF = mesh.Faces();
 		m_prob.resize(NF);
-		for (int i=0; i<NF; ++i) m_prob[i] = frand();
+		for (int i=0; i<NF; ++i) m_prob[i] = PlotRandom(0, i);
 	}
 
-	// check the tag
-	int ntag = m_map.GetTag(ntime);
-
-	// see if we need to update
-	if (ntag != m_nvec)
-	{
-		m_map.SetTag(ntime, m_nvec);
-
-		// get the state we are interested in
-		vector<vec3f>& val = m_map.State(ntime);
-
-		vec2f& rng = m_rng[ntime];
-		rng.x = rng.y = 0;
-
-		float L;
-
-		for (int i = 0; i<pm->Nodes(); ++i)
-		{
-			val[i] = pfem->EvaluateNodeVector(i, ntime, m_nvec);
-			L = val[i].Length();
-			if (L > rng.y) rng.y = L;
-		}
-
-		if (rng.y == rng.x) ++rng.y;
-	}
+	// evaluate the nodal values of this state
+	m_map->Update(ntime, ntime);
 
 	// copy nodal values
-	m_val = m_map.State(ntime);
-	m_crng = m_rng[ntime];
+	m_val = m_map->State(ntime);
+	m_crng = m_map->Range(ntime);
 
 	// update static range
 	if (breset) { m_rngMin = m_crng.x; m_rngMax = m_crng.y; }
@@ -246,7 +216,7 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 	switch (m_rangeType)
 	{
 	case RNG_DYNAMIC:
-		m_crng = m_rng[ntime];
+		m_crng = m_map->Range(ntime);
 		break;
 	case RNG_STATIC:
 		m_crng = vec2f((float)m_rngMin, (float)m_rngMax);
@@ -262,30 +232,121 @@ void CGLStreamLinePlot::Update(int ntime, float dt, bool breset)
 	UpdateStreamLines();
 }
 
-vec3f CGLStreamLinePlot::Velocity(const vec3f& r, bool& ok)
+//=================================================================================================
+StreamLineTracer::StreamLineTracer(FECoreMesh& mesh, FEFindElement& find, const vector<vec3f>& val) : m_mesh(mesh), m_find(find), m_val(val)
+{
+}
+
+vec3f StreamLineTracer::Velocity(const vec3f& r, int& nelem, bool& ok) const
 {
 	vec3f v(0.f, 0.f, 0.f);
 	vec3f ve[FEElement::MAX_NODES];
-	FEPostMesh& mesh = *GetModel()->GetActiveMesh();
-	int nelem;
 	double q[3];
-	if (m_find->FindElement(r, nelem, q))
+	int nhint = nelem;
+	if (m_find.FindElement(r, nelem, q, nhint))
 	{
 		ok = true;
-		FEElement_& el = mesh.ElementRef(nelem);
+		FEElement_& el = m_mesh.ElementRef(nelem);
 
 		int ne = el.Nodes();
 		for (int i=0; i<ne; ++i) ve[i] = m_val[el.m_node[i]];
 
 		v = el.eval(ve, q[0], q[1], q[2]);
 	}
-	else ok = false;
+	else
+	{
+		nelem = nhint;
+		ok = false;
+	}
 
 	return v;
 }
 
+// Dormand-Prince 5(4) coefficients. The last row are also the 5th order weights.
+static const float DP_A[7][6] = {
+	{ 0.f },
+	{ 1.f/5.f },
+	{ 3.f/40.f, 9.f/40.f },
+	{ 44.f/45.f, -56.f/15.f, 32.f/9.f },
+	{ 19372.f/6561.f, -25360.f/2187.f, 64448.f/6561.f, -212.f/729.f },
+	{ 9017.f/3168.f, -355.f/33.f, 46732.f/5247.f, 49.f/176.f, -5103.f/18656.f },
+	{ 35.f/384.f, 0.f, 500.f/1113.f, 125.f/192.f, -2187.f/6784.f, 11.f/84.f }
+};
+
+// difference between the 5th and 4th order weights
+static const float DP_E[7] = { 71.f/57600.f, 0.f, -71.f/16695.f, 71.f/1920.f, -17253.f/339200.f, 22.f/525.f, -1.f/40.f };
+
+// Integrate a stream line with an adaptive Runge-Kutta method, starting at r in element nelem with velocity v.
+// Steps are at most maxStep long.
+void StreamLineTracer::Trace(CGLStreamLinePlot::StreamLine& l, vec3f r, int nelem, vec3f v, float maxStep, int maxPoints) const
+{
+	const float tol = 0.01f*maxStep;	// error tolerance per step
+	const float minStep = 1e-3f*maxStep;
+
+	vec3f k[7];
+	k[0] = v;
+
+	float V = v.Length();
+	if (V < 1e-5f) return;
+	float h = maxStep / V;	// "time" increment
+
+	// limit the total nr of attempts so rejected steps cannot stall us
+	int maxIters = 10 * maxPoints;
+	for (int iter = 0; (iter < maxIters) && (l.Points() <= maxPoints); ++iter)
+	{
+		// make sure the velocity is not zero, otherwise we'll be stuck
+		V = k[0].Length();
+		if (V < 1e-5f) break;
+		if (h*V > maxStep) h = maxStep / V;
+
+		// evaluate the stages
+		bool ok = true;
+		int ne = nelem;
+		vec3f p;
+		for (int s = 1; s < 7; ++s)
+		{
+			vec3f dr(0.f, 0.f, 0.f);
+			for (int j = 0; j < s; ++j) dr += k[j] * DP_A[s][j];
+			p = r + dr*h;
+			k[s] = Velocity(p, ne, ok);
+			if (ok == false) break;
+		}
+
+		// if we left the mesh, try a smaller step to get closer to the boundary
+		if (ok == false)
+		{
+			h *= 0.5f;
+			if (h*V < minStep) break;
+			continue;
+		}
+
+		// error estimate
+		vec3f e(0.f, 0.f, 0.f);
+		for (int j = 0; j < 7; ++j) e += k[j] * DP_E[j];
+		float err = e.Length()*h;
+
+		if (err <= tol)
+		{
+			// accept the step (the last stage is the new point)
+			r = p;
+			nelem = ne;
+			k[0] = k[6];
+			l.Add(r, k[0].Length());
+		}
+
+		// update the step size
+		float f = (err > 0.f ? 0.9f*pow(tol / err, 0.2f) : 5.f);
+		if (f < 0.2f) f = 0.2f;
+		if (f > 5.f) f = 5.f;
+		h *= f;
+		if ((err > tol) && (h*V < minStep)) break;
+	}
+}
+
 void CGLStreamLinePlot::UpdateStreamLines()
 {
+	PROFILE_SCOPE_CAT("CGLStreamLinePlot::UpdateStreamLines", "post");
+
 	// clear current stream lines
 	m_streamLines.clear();
 
@@ -311,18 +372,14 @@ void CGLStreamLinePlot::UpdateStreamLines()
 	float R = box.GetMaxExtent();
 	float maxStep = m_inc*R;
 
-	// tag all elements
-	mesh.TagAllElements(0);
-
-	// use the same seed
-	srand(0);
+	// Each seed writes to its own slot, so no locking is needed and
+	// the order of the stream lines does not depend on the scheduling.
+	int NF = mesh.Faces();
+	vector<StreamLine> lines(NF);
+	StreamLineTracer tracer(mesh, *m_find, m_val);
 
 	// loop over all the surface facts
-	double q[3];
-	int NF = mesh.Faces();
-#pragma omp parallel for shared (NF)
-	for (int i=0; i<NF; ++i)
-	{
+	parallel_for(0, NF, [&](int i) {
 		FEFace& f = mesh.Face(i);
 
 		// evaluate the average velocity at this face
@@ -342,77 +399,31 @@ void CGLStreamLinePlot::UpdateStreamLines()
 			cf /= nf;
 
 			// project the seed into the adjacent solid element
+			double q[3];
 			int nelem = f.m_elem[0].eid;
 			FEElement_* el = &mesh.ElementRef(nelem);
-			el->m_ntag = 1;
 			ProjectInsideReferenceElement(mesh, *el, cf, q);
 
-			double V = vf.Length();
-
 			// now, propagate the seed and form the stream line
-			StreamLine l;
-			l.Add(cf, V);
-
-			vec3f vc = vf;
-
-			vec3f v[FEElement::MAX_NODES];
-			bool ok;
-			do
-			{
-				// make sure the velocity is not zero, otherwise we'll be stuck
-				double V = vc.Length();
-				if (V < 1e-5f) break;
-
-				// "time" increment
-				float dt =  maxStep / V;
-
-				// propagate the seed
-				// Euler's method
-//				cf += vc*dt;
-
-				// RK2 method
-/*				vec3f p = cf + vc*dt;
-				vec3f vp = Velocity(p, ok);
-				if (ok == false) break;
-				cf += (vc + vp)*(dt*0.5f);
-*/
-				// RK4
-				vec3f dr(0.f, 0.f, 0.f);
-				do
-				{
-					vec3f a = vc*dt;
-					vec3f b = Velocity(cf + a*0.5f, ok)*dt; if (ok == false) break;
-					vec3f c = Velocity(cf + b*0.5f, ok)*dt; if (ok == false) break;
-					vec3f d = Velocity(cf + c     , ok)*dt; if (ok == false) break;
-
-					dr = (a + b*2.f + c*2.f + d) / 6.0;
-					float DR = dr.Length();
-					if (DR > 2.0f*maxStep) dt *= 0.5f; else break;
-				}
-				while (1);
-				if (ok == false) break;
-
-				cf += dr;
-
-				// add it to the stream line
-				l.Add(cf, V);
-
-				// if for some reason we're stuck, we'll set a max nr of points
-				if (l.Points() > MAX_POINTS) break;
-
-				// get velocity at new point
-				vc = Velocity(cf, ok);
-				if (ok == false) break;
-			}
-			while (1);
+			StreamLine& l = lines[i];
+			l.Add(cf, vf.Length());
+			tracer.Trace(l, cf, nelem, vf, maxStep, MAX_POINTS);
+		}
+	});
 
-			if (l.Points() > 2)
-#pragma omp critical
-			{
-				m_streamLines.push_back(l);
-			}
+	// collect the stream lines
+	int nlines = 0;
+	for (int i = 0; i < NF; ++i) if (lines[i].Points() > 2) nlines++;
+	m_streamLines.reserve(nlines);
+	for (int i = 0; i < NF; ++i)
+	{
+		if (lines[i].Points() > 2)
+		{
+			m_streamLines.push_back(StreamLine());
+			m_streamLines.back().m_pt.swap(lines[i].m_pt);
 		}
 	}
+	PROFILE_COUNTER("streamlines", (double)m_streamLines.size());
 
 	// evaluate the color of stream lines
 	ColorStreamLines();
@@ -443,3 +454,98 @@ void CGLStreamLinePlot::ColorStreamLines()
 		}
 	}
 }
+
+//=================================================================================================
+StreamLineBenchmark Post::BenchmarkStreamLines(int seeds, int cells, float stepSize)
+{
+	PROFILE_SCOPE_CAT("BenchmarkStreamLines", "post");
+
+	StreamLineBenchmark res = { 0, 0, 0, 0, 0.0, 0.0 };
+	if ((seeds <= 0) || (cells <= 0) || (stepSize < 1e-6f)) return res;
+
+	auto now = []() { return std::chrono::steady_clock::now(); };
+	auto t0 = now();
+
+	// mesh the unit cube with hex elements
+	int n = cells;
+	int n1 = n + 1;
+	int NN = n1*n1*n1;
+	int NE = n*n*n;
+	FEMesh mesh;
+	mesh.Create(NN, NE);
+	for (int k = 0; k <= n; ++k)
+		for (int j = 0; j <= n; ++j)
+			for (int i = 0; i <= n; ++i)
+			{
+				FENode& node = mesh.Node((k*n1 + j)*n1 + i);
+				node.r = vec3d((double)i / n, (double)j / n, (double)k / n);
+			}
+
+	for (int k = 0; k < n; ++k)
+		for (int j = 0; j < n; ++j)
+			for (int i = 0; i < n; ++i)
+			{
+				FEElement& el = mesh.Element((k*n + j)*n + i);
+				el.SetType(FE_HEX8);
+				int n0 = (k*n1 + j)*n1 + i;
+				el.m_node[0] = n0;
+				el.m_node[1] = n0 + 1;
+				el.m_node[2] = n0 + 1 + n1;
+				el.m_node[3] = n0 + n1;
+				el.m_node[4] = n0 + n1*n1;
+				el.m_node[5] = n0 + 1 + n1*n1;
+				el.m_node[6] = n0 + 1 + n1 + n1*n1;
+				el.m_node[7] = n0 + n1 + n1*n1;
+			}
+	mesh.RebuildMesh(60.0);
+
+	// a swirl around the z-axis that slowly moves up
+	vector<vec3f> val(NN);
+	for (int i = 0; i < NN; ++i)
+	{
+		vec3f r = to_vec3f(mesh.Node(i).r);
+		val[i] = vec3f(-(r.y - 0.5f), r.x - 0.5f, 0.25f);
+	}
+
+	FEFindElement find(mesh);
+	find.Init(0);
+	auto t1 = now();
+
+	// same settings as the plot
+	int maxPoints = 2 * (int)(1.f / stepSize);
+	if (maxPoints > 10000) maxPoints = 10000;
+	float maxStep = stepSize * find.BoundingBox().GetMaxExtent();
+
+	StreamLineTracer tracer(mesh, find, val);
+	vector<int> npts(seeds, 0);
+	parallel_for(0, seeds, [&](int i) {
+		vec3f r(0.05f + 0.9f*PlotRandom(1, 3*i), 0.05f + 0.9f*PlotRandom(1, 3*i + 1), 0.05f + 0.9f*PlotRandom(1, 3*i + 2));
+
+		double q[3];
+		int nelem = -1;
+		if (find.FindElement(r, nelem, q) == false) return;
+
+		bool ok = false;
+		vec3f v = tracer.Velocity(r, nelem, ok);
+		if (ok == false) return;
+
+		CGLStreamLinePlot::StreamLine l;
+		l.Add(r, v.Length());
+		tracer.Trace(l, r, nelem, v, maxStep, maxPoints);
+		npts[i] = l.Points();
+	});
+	auto t2 = now();
+
+	res.elems = NE;
+	res.seeds = seeds;
+	for (int i = 0; i < seeds; ++i)
+	{
+		if (npts[i] > 2) res.lines++;
+		res.points += npts[i];
+	}
+	res.setupTime = std::chrono::duration<double>(t1 - t0).count();
+	res.traceTime = std::chrono::duration<double>(t2 - t1).count();
+	PROFILE_COUNTER("streamline points", (double)res.points);
+
+	return res;
+}
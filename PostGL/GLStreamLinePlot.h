@@ -109,10 +109,6 @@ public:
 
 	bool UpdateData(bool bsave = true) override;
 
-protected:
-
-	vec3f Velocity(const vec3f& r, bool& ok);
-
 private:
 	int	m_nvec;	// vector field
 
@@ -125,8 +121,7 @@ private:
 
 	CColorTexture	m_Col;	// color map
 
-	vector<vec2f>	m_rng;	// nodal ranges
-	DataMap<vec3f>	m_map;	// nodal values map
+	std::shared_ptr<VectorFieldMap>	m_map;	// nodal values map (shared with other plots)
 
 	int				m_ntime;	// current time at which this plot is evaluated
 	vector<vec3f>	m_val;	// current nodal values
@@ -141,4 +136,43 @@ private:
 	double	m_userMin, m_userMax;		//!< range for user-defined range
 	double	m_rngMin, m_rngMax;
 };
+
+//-----------------------------------------------------------------------------
+// Integrates stream lines through a nodal velocity field, using an adaptive 
+// Runge-Kutta method. The tracer only reads its data, so lines can be traced
+// in parallel.
+class StreamLineTracer
+{
+public:
+	StreamLineTracer(FECoreMesh& mesh, FEFindElement& find, const vector<vec3f>& val);
+
+	// Evaluate the velocity at r. nelem is the element of a nearby point on input,
+	// and the element that contains r on output. ok is false when r is outside the mesh.
+	vec3f Velocity(const vec3f& r, int& nelem, bool& ok) const;
+
+	// Trace a line starting at r in element nelem with velocity v. Steps are at most maxStep long.
+	void Trace(CGLStreamLinePlot::StreamLine& l, vec3f r, int nelem, vec3f v, float maxStep, int maxPoints) const;
+
+private:
+	FECoreMesh&				m_mesh;
+	FEFindElement&			m_find;
+	const vector<vec3f>&	m_val;
+};
+
+//-----------------------------------------------------------------------------
+// Result of BenchmarkStreamLines
+struct StreamLineBenchmark
+{
+	int		elems;		// nr of hex elements in the synthetic mesh
+	int		seeds;		// nr of seeds
+	int		lines;		// nr of lines with more than two points
+	long long	points;	// total nr of points
+	double	setupTime;	// time to build the mesh and the search structure (seconds)
+	double	traceTime;	// time to trace the lines (seconds)
+};
+
+// Traces stream lines from the given nr of seeds through a synthetic swirling flow on a 
+// unit cube that is meshed with cells^3 hex elements. This uses the same tracer and 
+// settings as the stream line plot and is meant for profiling.
+StreamLineBenchmark BenchmarkStreamLines(int seeds, int cells, float stepSize = 0.01f);
 }
@@ -30,6 +30,7 @@ SOFTWARE.*/
 #include "GLWLib/GLWidgetManager.h"
 #include "GLModel.h"
 #include <stdlib.h>
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 REGISTER_CLASS(GLTensorPlot, CLASS_PLOT, "tensor", 0);
@@ -60,9 +61,11 @@ GLTensorPlot::GLTensorPlot()
 	AddDoubleParam(1.0, "User max");
 	AddChoiceParam(0, "Min Range Type")->SetEnumNames("dynamic\0static\0user\0");
 	AddDoubleParam(0.0, "User min");
+	AddIntParam(0, "Max glyphs");
 
 	m_scale = 1;
 	m_dens = 1;
+	m_maxGlyphs = 0;
 
 	m_ndivs = 10;
 
@@ -70,6 +73,8 @@ GLTensorPlot::GLTensorPlot()
 	m_ntensor = 0;
 
 	m_nglyph = Glyph_Arrow;
+	m_glyphType = -1;
+	m_bvalid = false;
 
 	m_lastCol = -1;
 	m_ncol = Glyph_Col_Solid;
@@ -123,9 +128,11 @@ bool GLTensorPlot::UpdateData(bool bsave)
 		m_bautoscale = GetBoolValue(AUTO_SCALE);
 		m_bnormalize = GetBoolValue(NORMALIZE);
 		m_ndivs = GetIntValue(RANGE_DIVS);
+		m_maxGlyphs = GetIntValue(MAX_GLYPHS);
 
 		m_range.maxtype = GetIntValue(MAX_RANGE_TYPE);
 		m_range.mintype = GetIntValue(MIN_RANGE_TYPE);
+		m_bvalid = false;
 
 		if (noldcol != m_ncol)
 		{
@@ -168,6 +175,7 @@ bool GLTensorPlot::UpdateData(bool bsave)
 		SetBoolValue(AUTO_SCALE, m_bautoscale);
 		SetBoolValue(NORMALIZE, m_bnormalize);
 		SetIntValue(RANGE_DIVS, m_ndivs);
+		SetIntValue(MAX_GLYPHS, m_maxGlyphs);
 	}
 
 	return false;
@@ -202,6 +210,7 @@ void GLTensorPlot::Update(int ntime, float dt, bool breset)
 	m_lastCol = m_ncol;
 
 	if (breset) { m_map.Clear(); m_val.clear(); m_range.valid = false; }
+	m_bvalid = false;
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
@@ -420,8 +429,6 @@ void GLTensorPlot::Update(int ntime, float dt, bool breset)
 	m_val = m_map.State(ntime);
 }
 
-static double frand() { return (double)rand() / (double)RAND_MAX; }
-
 void GLTensorPlot::Render(CGLContext& rc)
 {
 	GetLegendBar()->SetDivisions(m_ndivs);
@@ -442,20 +449,7 @@ void GLTensorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_LIGHTING_BIT);
 
-	// create the cylinder object
 	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
-
-	CGLModel* mdl = GetModel();
-	FEPostModel* ps = mdl->GetFEModel();
-
-	srand(m_seed);
-
-	FEPostModel* pfem = mdl->GetFEModel();
-	FEPostMesh* pm = mdl->GetActiveMesh();
-
-	float scale = 0.02f*m_scale*pfem->GetBoundingBox().Radius();
 
 	if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
 	else
@@ -463,7 +457,6 @@ void GLTensorPlot::Render(CGLContext& rc)
 		glEnable(GL_LIGHTING);
 		glEnable(GL_COLOR_MATERIAL);
 		glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
 
 		GLfloat dif[] = { 1.f, 1.f, 1.f, 1.f };
 		GLfloat amb[] = { 0.1f, 0.1f, 0.1f, 1.f };
@@ -472,8 +465,46 @@ void GLTensorPlot::Render(CGLContext& rc)
 		glLightfv(GL_LIGHT0, GL_AMBIENT, amb);
 	}
 
+	float fmax = 1.f, fmin = 0.f;
+	if (m_ncol != Glyph_Col_Solid)
+	{
+		fmax = m_range.max;
+		fmin = m_range.min;
+	}
+	GetLegendBar()->SetRange(fmin, fmax);
+
+	// the glyphs are only rebuilt when the data, the parameters or the mesh changed
+	GLGlyphKey key = GlyphKey(GetModel());
+	if (!m_bvalid || (key != m_glyphKey))
+	{
+		BuildGlyphs();
+		m_glyphKey = key;
+		m_bvalid = true;
+	}
+	m_glyph.Render();
+
+	// restore attributes
+	glPopAttrib();
+
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+}
+
+void GLTensorPlot::BuildGlyphs()
+{
+	CGLModel* mdl = GetModel();
+	FEPostModel* ps = mdl->GetFEModel();
+
+	FEPostModel* pfem = mdl->GetFEModel();
+	FEPostMesh* pm = mdl->GetActiveMesh();
+
+	float scale = 0.02f*m_scale*pfem->GetBoundingBox().Radius();
+
+	// collect the locations of the glyphs
+	vector<GLGlyphSite> sites;
+	int items = 0;
 	if (IS_ELEM_FIELD(m_ntensor))
 	{
+		items = pm->Elements();
 		pm->TagAllElements(0);
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
@@ -495,58 +526,19 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
-		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Elements(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
-		}
-
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
-		{
-			fmax = m_range.max;
-			fmin = m_range.min;
-		}
-
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
-
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
+			if (elem.m_ntag && (PlotRandom(m_seed, i) <= m_dens))
 			{
-				vec3d r = pm->ElementCenter(elem);
-
-				TENSOR& t = m_val[i];
-
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f - fmin) / (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
-				}
-
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
+				GLGlyphSite site = { to_vec3f(pm->ElementCenter(elem)), MaxLength(m_val[i]), i };
+				sites.push_back(site);
 			}
 		}
 	}
 	else
 	{
+		items = pm->Nodes();
 		pm->TagAllNodes(0);
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
@@ -569,240 +561,145 @@ void GLTensorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		float auto_scale = 1.f;
-		if (m_bautoscale)
-		{
-			float Lmax = 0.f;
-			for (int i = 0; i < pm->Nodes(); ++i)
-			{
-				for (int j = 0; j < 3; ++j)
-				{
-					float L = fabs(m_val[i].l[j]);
-					if (L > Lmax) Lmax = L;
-				}
-			}
-			if (Lmax == 0.f) Lmax = 1.f;
-			auto_scale = 1.f / Lmax;
-		}
-
-		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
-		float fmax = 1.f, fmin = 0.f;
-		if (m_ncol != Glyph_Col_Solid)
-		{
-			fmax = m_range.max;
-			fmin = m_range.min;
-		}
-		GetLegendBar()->SetRange(fmin, fmax);
-
-		if (fmax == fmin) fmax++;
-
-		if (m_nglyph == Glyph_Line) glDisable(GL_LIGHTING);
-
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
-
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FENode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
+			if (node.m_ntag && (PlotRandom(m_seed, i) <= m_dens))
 			{
-				vec3d r = node.r;
-
-				TENSOR& t = m_val[i];
-
-				if (m_ncol != Glyph_Col_Solid)
-				{
-					float w = (t.f  - fmin)/ (fmax - fmin);
-					GLColor c = map.map(w);
-					glColor3ub(c.r, c.g, c.b);
-				}
-
-				glTranslatef(r.x, r.y, r.z);
-				RenderGlyphs(t, scale*auto_scale, pglyph);
-				glTranslatef(-r.x, -r.y, -r.z);
+				GLGlyphSite site = { to_vec3f(node.r), MaxLength(m_val[i]), i };
+				sites.push_back(site);
 			}
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	float auto_scale = 1.f;
+	if (m_bautoscale)
+	{
+		float Lmax = 0.f;
+		for (int i = 0; i < items; ++i)
+		{
+			float L = MaxLength(m_val[i]);
+			if (L > Lmax) Lmax = L;
+		}
+		if (Lmax == 0.f) Lmax = 1.f;
+		auto_scale = 1.f / Lmax;
+	}
 
-	// restore attributes
-	glPopAttrib();
+	float fmax = 1.f, fmin = 0.f;
+	if (m_ncol != Glyph_Col_Solid)
+	{
+		fmax = m_range.max;
+		fmin = m_range.min;
+	}
+	if (fmax == fmin) fmax++;
+
+	// thin out the glyphs if there are too many
+	DecimateGlyphs(sites, m_maxGlyphs);
+
+	// Arrows and lines are drawn with three instances per tensor, one for each direction.
+	int NS = (int)sites.size();
+	int ni = ((m_nglyph == Glyph_Arrow) || (m_nglyph == Glyph_Line) ? 3 : 1);
+	vector<GLGlyphInstance> glyphs(NS*ni);
+	vector<char> valid(NS*ni, 0);
+	parallel_for(0, NS, [&](int i) {
+		const GLGlyphSite& si = sites[i];
+		int n = EvalGlyphs(si.r, m_val[si.item], scale*auto_scale, fmin, fmax, &glyphs[ni*i]);
+		for (int j = 0; j < n; ++j) valid[ni*i + j] = 1;
+	});
+
+	// remove the glyphs that don't need to be drawn
+	int m = 0;
+	for (int i = 0; i < NS*ni; ++i)
+	{
+		if (valid[i]) glyphs[m++] = glyphs[i];
+	}
+	glyphs.resize(m);
 
-	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+	UpdateGlyph();
+	m_glyph.Build(glyphs);
 }
 
-void GLTensorPlot::RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph)
+float GLTensorPlot::MaxLength(const TENSOR& t)
 {
-	switch (m_nglyph)
+	float Lmax = 0.f;
+	for (int j = 0; j < 3; ++j)
 	{
-	case Glyph_Arrow : RenderArrows(t, scale, glyph); break;
-	case Glyph_Line  : RenderLines (t, scale, glyph); break;
-	case Glyph_Sphere: RenderSphere(t, scale, glyph); break;
-	case Glyph_Box   : RenderBox   (t, scale, glyph); break;
+		float L = fabs(t.l[j]);
+		if (L > Lmax) Lmax = L;
 	}
+	return Lmax;
 }
 
-void GLTensorPlot::RenderArrows(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+void GLTensorPlot::UpdateGlyph()
 {
-	GLColor c[3];
-	c[0] = GLColor(255, 0, 0);
-	c[1] = GLColor(0, 255, 0);
-	c[2] = GLColor(0, 0, 255);
+	if (!m_glyph.IsEmpty() && (m_glyphType == m_nglyph)) return;
+	m_glyphType = m_nglyph;
 
-	for (int i = 0; i<3; ++i)
+	m_glyph.Clear();
+	switch (m_nglyph)
 	{
-		glPushMatrix();
-
-		float L = (m_bnormalize ? scale : scale*t.l[i]);
-		float l0 = L*.9;
-		float l1 = L*.2;
-		float r0 = L*0.05;
-		float r1 = L*0.15;
-
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3f(0,0,1), v);
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
-		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		}
-
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
-
-		glPopMatrix();
+	case Glyph_Arrow:
+		m_glyph.AddCone(0.05f, 0.05f, 0.f, 0.9f, 5);
+		m_glyph.AddCone(0.15f, 0.f, 0.81f, 1.01f, 10);
+		break;
+	case Glyph_Line  : m_glyph.AddLine(0.f, 1.f); break;
+	case Glyph_Sphere: m_glyph.AddSphere(1.f, 16, 16); break;
+	case Glyph_Box   : m_glyph.AddBox(0.5f); break;
 	}
 }
 
-void GLTensorPlot::RenderLines(GLTensorPlot::TENSOR& t, float scale, GLUquadricObj* pglyph)
+int GLTensorPlot::EvalGlyphs(const vec3f& r, const TENSOR& t, float scale, float fmin, float fmax, GLGlyphInstance* g)
 {
-	GLColor c[3];
-	c[0] = GLColor(255, 0, 0);
-	c[1] = GLColor(0, 255, 0);
-	c[2] = GLColor(0, 0, 255);
-
-	for (int i = 0; i<3; ++i)
+	if ((m_nglyph == Glyph_Arrow) || (m_nglyph == Glyph_Line))
 	{
-		glPushMatrix();
-
-		float L = (m_bnormalize ? scale : scale*t.l[i]);
+		// the directions are colored red, green, blue
+		GLColor c[3];
+		c[0] = GLColor(255, 0, 0);
+		c[1] = GLColor(0, 255, 0);
+		c[2] = GLColor(0, 0, 255);
 
-		vec3f v = t.r[i];
-		quatd q = quatd(vec3f(0, 0, 1), v);
-		float w = q.GetAngle();
-		if (fabs(w) > 1e-6)
+		for (int i = 0; i < 3; ++i)
 		{
-			vec3d p = q.GetVector();
-			if (p.Length() > 1e-6) glRotatef(w * 180 / PI, p.x, p.y, p.z);
+			float L = (m_bnormalize ? scale : scale*t.l[i]);
+
+			GlyphRotation(t.r[i], g[i].a);
+			g[i].a[0] *= L;
+			g[i].a[1] *= L;
+			g[i].a[2] *= L;
+			g[i].r = r;
+			g[i].SetColor(c[i]);
 		}
-
-		glBegin(GL_LINES);
-		glColor3ub(c[i].r, c[i].g, c[i].b);
-		glVertex3f(0.f, 0.f, 0.f);
-		glVertex3f(0.f, 0.f, L);
-		glEnd();
-
-		glPopMatrix();
+		return 3;
 	}
-}
 
-void GLTensorPlot::RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
+	// spheres and boxes are scaled along the principal directions
+	if (scale <= 0.f) return 0;
 
 	float smax = 0.f;
 	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
 	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
 	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
+	if (smax < 1e-7f) return 0;
 
 	if (sx < 0.1*smax) sx = 0.1f*smax;
 	if (sy < 0.1*smax) sy = 0.1f*smax;
 	if (sz < 0.1*smax) sz = 0.1f*smax;
 
-	glPushMatrix();
-	vec3f* e = t.r;
-	vec3f n = e[0] ^ e[1];
-	if (n*e[2] < 0) e[2] = -e[2];
-	GLfloat m[4][4] = {0};
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	gluSphere(glyph, 1.f, 16, 16);
-	glPopMatrix();
-}
+	vec3f e2 = t.r[2];
+	if ((m_nglyph == Glyph_Sphere) && ((t.r[0] ^ t.r[1])*e2 < 0)) e2 = -e2;
 
-void GLTensorPlot::RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph)
-{
-	if (scale <= 0.f) return;
+	g->a[0] = t.r[0] * (scale*sx);
+	g->a[1] = t.r[1] * (scale*sy);
+	g->a[2] = e2 * (scale*sz);
+	g->r = r;
 
-	float smax = 0.f;
-	float sx = fabs(t.l[0]); if (sx > smax) smax = sx;
-	float sy = fabs(t.l[1]); if (sy > smax) smax = sy;
-	float sz = fabs(t.l[2]); if (sz > smax) smax = sz;
-	if (smax < 1e-7f) return;
-
-	if (sx < 0.1*smax) sx = 0.1f*smax;
-	if (sy < 0.1*smax) sy = 0.1f*smax;
-	if (sz < 0.1*smax) sz = 0.1f*smax;
-
-	glPushMatrix();
-	vec3f* e = t.r;
-	GLfloat m[4][4] = { 0 };
-	m[3][3] = 1.f;
-	m[0][0] = e[0].x; m[0][1] = e[0].y; m[0][2] = e[0].z;
-	m[1][0] = e[1].x; m[1][1] = e[1].y; m[1][2] = e[1].z;
-	m[2][0] = e[2].x; m[2][1] = e[2].y; m[2][2] = e[2].z;
-	glMultMatrixf(&m[0][0]);
-
-	glScalef(scale*sx, scale*sy, scale*sz);
-	glBegin(GL_QUADS);
+	if (m_ncol != Glyph_Col_Solid)
 	{
-		float r0 = 0.5f;
-		glNormal3d(1, 0, 0);
-		glVertex3d(r0, -r0, -r0);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(r0, r0, r0);
-		glVertex3d(r0, -r0, r0);
-
-		glNormal3d(-1, 0, 0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(-r0, -r0, r0);
-		glVertex3d(-r0, r0, r0);
-
-		glNormal3d(0, 1, 0);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, r0, r0);
-		glVertex3d(r0, r0, r0);
-
-		glNormal3d(0, -1, 0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(r0, -r0, -r0);
-		glVertex3d(r0, -r0, r0);
-		glVertex3d(-r0, -r0, r0);
-
-		glNormal3d(0, 0, 1);
-		glVertex3d(-r0, r0, r0);
-		glVertex3d(r0, r0, r0);
-		glVertex3d(r0, -r0, r0);
-		glVertex3d(-r0, -r0, r0);
-
-		glNormal3d(0, 0, -1);
-		glVertex3d(r0, r0, -r0);
-		glVertex3d(-r0, r0, -r0);
-		glVertex3d(-r0, -r0, -r0);
-		glVertex3d(r0, -r0, -r0);
+		CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
+		float w = (t.f - fmin) / (fmax - fmin);
+		g->SetColor(map.map(w));
 	}
-	glEnd();
-	glPopMatrix();
+	else g->SetColor(m_gcl);
 
+	return 1;
 }
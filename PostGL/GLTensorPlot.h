@@ -27,17 +27,13 @@ SOFTWARE.*/
 #pragma once
 #include "GLPlot.h"
 #include <GLWLib/GLWidget.h>
-#ifdef __APPLE__
-    #include <OpenGL/GLU.h>
-#else
-    #include <GL/glu.h>
-#endif
+#include "GLGlyph.h"
 
 namespace Post {
 
 class GLTensorPlot : public CGLLegendPlot
 {
-	enum { DATA_FIELD, METHOD, COLOR_MAP, RANGE_DIVS, CLIP, SHOW_HIDDEN, SCALE, DENSITY, GLYPH, GLYPH_COLOR, SOLID_COLOR, AUTO_SCALE, NORMALIZE, MAX_RANGE_TYPE, USER_MAX, MIN_RANGE_TYPE, USER_MIN };
+	enum { DATA_FIELD, METHOD, COLOR_MAP, RANGE_DIVS, CLIP, SHOW_HIDDEN, SCALE, DENSITY, GLYPH, GLYPH_COLOR, SOLID_COLOR, AUTO_SCALE, NORMALIZE, MAX_RANGE_TYPE, USER_MAX, MIN_RANGE_TYPE, USER_MIN, MAX_GLYPHS };
 
 public:
 	enum Glyph_Type {
@@ -84,36 +80,41 @@ public:
 	int GetVectorMethod() const { return m_nmethod; }
 	void SetVectorMethod(int m);
 
-	void SetScaleFactor(float g) { m_scale = g; }
+	void SetScaleFactor(float g) { m_scale = g; m_bvalid = false; }
 	double GetScaleFactor() { return m_scale; }
 
-	void SetDensity(float d) { m_dens = d; }
+	void SetDensity(float d) { m_dens = d; m_bvalid = false; }
 	double GetDensity() { return m_dens; }
 
 	bool ShowHidden() const { return m_bshowHidden; }
-	void ShowHidden(bool b) { m_bshowHidden = b; }
+	void ShowHidden(bool b) { m_bshowHidden = b; m_bvalid = false; }
 
 	int GetGlyphType() { return m_nglyph; }
-	void SetGlyphType(int ntype) { m_nglyph = ntype; }
+	void SetGlyphType(int ntype) { m_nglyph = ntype; m_bvalid = false; }
 
 	int GetColorType() { return m_ncol; }
-	void SetColorType(int ntype) { m_ncol = ntype; }
+	void SetColorType(int ntype) { m_ncol = ntype; m_bvalid = false; }
 
 	GLColor GetGlyphColor() { return m_gcl; }
-	void SetGlyphColor(GLColor c) { m_gcl = c; }
+	void SetGlyphColor(GLColor c) { m_gcl = c; m_bvalid = false; }
 
 	bool GetAutoScale() { return m_bautoscale; }
-	void SetAutoScale(bool b) { m_bautoscale = b; }
+	void SetAutoScale(bool b) { m_bautoscale = b; m_bvalid = false; }
 
 	bool GetNormalize() { return m_bnormalize; }
-	void SetNormalize(bool b) { m_bnormalize = b; }
+	void SetNormalize(bool b) { m_bnormalize = b; m_bvalid = false; }
 
 protected:
-	void RenderGlyphs(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderArrows(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderLines(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderSphere(TENSOR& t, float scale, GLUquadricObj* glyph);
-	void RenderBox(TENSOR& t, float scale, GLUquadricObj* glyph);
+	// evaluate the glyph instances of tensor t at position r (returns the nr of instances)
+	int EvalGlyphs(const vec3f& r, const TENSOR& t, float scale, float fmin, float fmax, GLGlyphInstance* g);
+
+	// build the glyph geometry
+	void UpdateGlyph();
+
+	// place the glyphs and build their instances
+	void BuildGlyphs();
+
+	static float MaxLength(const TENSOR& t);
 
 	void Update() override;
 
@@ -127,6 +128,7 @@ protected:
 	float	m_scale;
 	float	m_dens;
 	int		m_seed;
+	int		m_maxGlyphs;	// max nr of glyphs (0 = no limit)
 
 	bool	m_bshowHidden;	// show tensors on hidden materials
 	bool	m_bautoscale;	// auto scale the vectors
@@ -144,5 +146,10 @@ protected:
 	int		m_lastTime;
 	float	m_lastDt;
 	int		m_lastCol;
+
+	GLGlyphMesh	m_glyph;		// glyph geometry
+	int			m_glyphType;	// glyph type of m_glyph
+	bool		m_bvalid;		// the glyph instances are up to date
+	GLGlyphKey	m_glyphKey;		// model state the glyph instances were built for
 };
 }
@@ -30,6 +30,7 @@ SOFTWARE.*/
 #include "PostLib/constants.h"
 #include "GLWLib/GLWidgetManager.h"
 #include <PostGL/GLModel.h>
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
 //////////////////////////////////////////////////////////////////////
@@ -62,10 +63,16 @@ CGLVectorPlot::CGLVectorPlot()
 	AddIntParam(0, "Range type")->SetEnumNames("Dynamic\0Static\0User\0");
 	AddDoubleParam(1., "User Max"  );
 	AddDoubleParam(0., "User Min"  );
+	AddIntParam(0, "Max glyphs");
 
 	m_scale = 1;
 	m_dens = 1;
 	m_ar = 1;
+	m_maxGlyphs = 0;
+
+	m_glyphType = -1;
+	m_glyphAR = 0.f;
+	m_bvalid = false;
 
 	m_ntime = -1;
 	m_nvec = -1;
@@ -124,6 +131,8 @@ bool CGLVectorPlot::UpdateData(bool bsave)
 		m_rngType = GetIntValue(RANGE_TYPE);
 		m_usr[1] = GetFloatValue(USER_MAX);
 		m_usr[0] = GetFloatValue(USER_MIN);
+		m_maxGlyphs = GetIntValue(MAX_GLYPHS);
+		m_bvalid = false;
 
 		GLLegendBar* bar = GetLegendBar();
 		if ((m_ncol == 0) || !IsActive()) bar->hide();
@@ -152,13 +161,12 @@ bool CGLVectorPlot::UpdateData(bool bsave)
 		SetIntValue(RANGE_TYPE, m_rngType);
 		SetFloatValue(USER_MAX, m_usr[1]);
 		SetFloatValue(USER_MIN, m_usr[0]);
+		SetIntValue(MAX_GLYPHS, m_maxGlyphs);
 	}
 
 	return false;
 }
 
-static double frand() { return (double) rand() / (double) RAND_MAX; }
-
 void CGLVectorPlot::Render(CGLContext& rc)
 {
 	if (m_nvec == -1) return;
@@ -177,16 +185,41 @@ void CGLVectorPlot::Render(CGLContext& rc)
 	// store attributes
 	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT);
 
-	// create the cylinder object
 	glEnable(GL_LIGHTING);
-	GLUquadricObj* pglyph = gluNewQuadric();
-	gluQuadricNormals(pglyph, GLU_SMOOTH);
 
+	if (m_nglyph == GLYPH_LINE) glDisable(GL_LIGHTING);
+	else
+	{
+		glEnable(GL_LIGHTING);
+		glEnable(GL_COLOR_MATERIAL);
+
+		GLfloat dif[] = {1.f, 1.f, 1.f, 1.f};
+
+		glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
+		glLightfv(GL_LIGHT0, GL_AMBIENT, dif);
+	}
+
+	// the glyphs are only rebuilt when the data, the parameters or the mesh changed
+	GLGlyphKey key = GlyphKey(GetModel());
+	if (!m_bvalid || (key != m_glyphKey))
+	{
+		BuildGlyphs();
+		m_glyphKey = key;
+		m_bvalid = true;
+	}
+	m_glyph.Render();
+
+	// restore attributes
+	glPopAttrib();
+
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+}
+
+void CGLVectorPlot::BuildGlyphs()
+{
 	CGLModel* mdl = GetModel();
 	FEPostModel* ps = mdl->GetFEModel();
 
-	srand(m_seed);
-
 	FEPostModel* pfem = mdl->GetFEModel();
 	FEPostMesh* pm = mdl->GetActiveMesh();
 
@@ -209,18 +242,8 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		m_fscale *= autoscale;
 	}
 
-	if (m_nglyph == GLYPH_LINE) glDisable(GL_LIGHTING);
-	else
-	{
-		glEnable(GL_LIGHTING);
-		glEnable(GL_COLOR_MATERIAL);
-
-		GLfloat dif[] = {1.f, 1.f, 1.f, 1.f};
-
-		glLightfv(GL_LIGHT0, GL_DIFFUSE, dif);
-		glLightfv(GL_LIGHT0, GL_AMBIENT, dif);
-	}
-
+	// collect the locations of the glyphs
+	vector<GLGlyphSite> sites;
 	if (IS_ELEM_FIELD(m_nvec))
 	{
 		pm->TagAllElements(0);
@@ -244,15 +267,15 @@ void CGLVectorPlot::Render(CGLContext& rc)
 			}
 		}
 
-		// render the vectors at the elements' centers
+		// place the vectors at the elements' centers
 		for (int i = 0; i < pm->Elements(); ++i)
 		{
 			FEElement_& elem = pm->ElementRef(i);
-			if ((frand() <= m_dens) && elem.m_ntag)
+			float L = m_val[i].Length();
+			if (elem.m_ntag && (L > 0.f) && (PlotRandom(m_seed, i) <= m_dens))
 			{
-				vec3f r = to_vec3f(pm->ElementCenter(elem));
-				vec3f v = m_val[i];
-				RenderVector(r, v, pglyph);
+				GLGlyphSite site = { to_vec3f(pm->ElementCenter(elem)), L, i };
+				sites.push_back(site);
 			}
 		}
 	}
@@ -283,29 +306,60 @@ void CGLVectorPlot::Render(CGLContext& rc)
 		for (int i = 0; i < pm->Nodes(); ++i)
 		{
 			FENode& node = pm->Node(i);
-			if ((frand() <= m_dens) && node.m_ntag)
+			float L = m_val[i].Length();
+			if (node.m_ntag && (L > 0.f) && (PlotRandom(m_seed, i) <= m_dens))
 			{
-				vec3f r = to_vec3f(node.r);
-
-				vec3f v = m_val[i];
-
-				RenderVector(r, v, pglyph);
+				GLGlyphSite site = { to_vec3f(node.r), L, i };
+				sites.push_back(site);
 			}
 		}
 	}
 
-	gluDeleteQuadric(pglyph);
+	// thin out the glyphs if there are too many
+	DecimateGlyphs(sites, m_maxGlyphs);
 
-	// restore attributes
-	glPopAttrib();
+	// evaluate the glyphs
+	int NG = (int)sites.size();
+	vector<GLGlyphInstance> glyphs(NG);
+	parallel_for(0, NG, [&](int i) {
+		const GLGlyphSite& si = sites[i];
+		EvalGlyph(si.r, m_val[si.item], glyphs[i]);
+	});
 
-	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+	UpdateGlyph();
+	m_glyph.Build(glyphs);
+}
+
+void CGLVectorPlot::UpdateGlyph()
+{
+	if (!m_glyph.IsEmpty() && (m_glyphType == m_nglyph) && (m_glyphAR == m_ar)) return;
+	m_glyphType = m_nglyph;
+	m_glyphAR = m_ar;
+
+	// The glyph is built for a vector of unit length. The instances scale it.
+	float l0 = 0.9f;
+	float l1 = 0.2f;
+	float r0 = 0.05f*m_ar;
+	float r1 = 0.15f*m_ar;
+
+	m_glyph.Clear();
+	switch (m_nglyph)
+	{
+	case GLYPH_ARROW:
+		m_glyph.AddCone(r0, r0, 0.f, l0, 5);
+		m_glyph.AddCone(r1, 0.f, l0*0.9f, l0*0.9f + l1, 10);
+		break;
+	case GLYPH_CONE    : m_glyph.AddCone(r1, 0.f, 0.f, l0, 10); break;
+	case GLYPH_CYLINDER: m_glyph.AddCone(r1, r1, 0.f, l0, 10); break;
+	case GLYPH_SPHERE  : m_glyph.AddSphere(r1, 10, 5); break;
+	case GLYPH_BOX     : m_glyph.AddBox(r0); break;
+	case GLYPH_LINE    : m_glyph.AddLine(0.f, 1.f); break;
+	}
 }
 
-void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
+void CGLVectorPlot::EvalGlyph(const vec3f& r, vec3f v, GLGlyphInstance& g)
 {
 	float L = v.Length();
-	if (L == 0.f) return;
 
 	CColorMap& map = ColorMapManager::GetColorMap(m_Col.GetColorMap());
 
@@ -313,114 +367,29 @@ void CGLVectorPlot::RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph)
 	float fmax = m_crng.y;
 
 	float f = (L - fmin) / (fmax - fmin);
-	GLColor col = map.map(f);
 	v.Normalize();
 
 	switch (m_ncol)
 	{
 	case GLYPH_COL_LENGTH:
-		glColor3ub(col.r, col.g, col.b);
+		g.SetColor(map.map(f));
 		break;
 	case GLYPH_COL_ORIENT:
-	{
-		GLdouble r = fabs(v.x);
-		GLdouble g = fabs(v.y);
-		GLdouble b = fabs(v.z);
-		glColor3d(r, g, b);
-	}
-	break;
+		g.SetColor(GLColor((Byte)(255*fabs(v.x)), (Byte)(255*fabs(v.y)), (Byte)(255*fabs(v.z))));
+		break;
 	case GLYPH_COL_SOLID:
 	default:
-		glColor3ub(m_gcl.r, m_gcl.g, m_gcl.b);
+		g.SetColor(m_gcl);
 	}
 
 	if (m_bnorm) L = 1;
-
 	L *= m_fscale;
-	float l0 = L*.9;
-	float l1 = L*.2;
-	float r0 = L*0.05*m_ar;
-	float r1 = L*0.15*m_ar;
-
-	glPushMatrix();
-
-	glTranslatef(r.x, r.y, r.z);
-	quatd q(vec3d(0,0,1), v);
-	float w = q.GetAngle();
-	if (fabs(w) > 1e-6)
-	{
-		vec3d p = q.GetVector();
-		if (p.Length() > 1e-6) glRotated(w * 180 / PI, p.x, p.y, p.z);
-		else glRotated(w * 180 / PI, 1, 0, 0);
-	}
 
-	switch (m_nglyph)
-	{
-	case GLYPH_ARROW:
-		gluCylinder(pglyph, r0, r0, l0, 5, 1);
-		glTranslatef(0.f, 0.f, (float)l0*0.9f);
-		gluCylinder(pglyph, r1, 0, l1, 10, 1);
-		break;
-	case GLYPH_CONE:
-		gluCylinder(pglyph, r1, 0, l0, 10, 1);
-		break;
-	case GLYPH_CYLINDER:
-		gluCylinder(pglyph, r1, r1, l0, 10, 1);
-		break;
-	case GLYPH_SPHERE:
-		gluSphere(pglyph, r1, 10, 5);
-		break;
-	case GLYPH_BOX:
-		glBegin(GL_QUADS);
-		{
-			glNormal3d(1, 0, 0);
-			glVertex3d(r0, -r0, -r0);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(r0, r0, r0);
-			glVertex3d(r0, -r0, r0);
-
-			glNormal3d(-1, 0, 0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(-r0, -r0, r0);
-			glVertex3d(-r0, r0, r0);
-
-			glNormal3d(0, 1, 0);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, r0, r0);
-			glVertex3d(r0, r0, r0);
-
-			glNormal3d(0, -1, 0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(r0, -r0, -r0);
-			glVertex3d(r0, -r0, r0);
-			glVertex3d(-r0, -r0, r0);
-
-			glNormal3d(0, 0, 1);
-			glVertex3d(-r0, r0, r0);
-			glVertex3d(r0, r0, r0);
-			glVertex3d(r0, -r0, r0);
-			glVertex3d(-r0, -r0, r0);
-
-			glNormal3d(0, 0, -1);
-			glVertex3d(r0, r0, -r0);
-			glVertex3d(-r0, r0, -r0);
-			glVertex3d(-r0, -r0, -r0);
-			glVertex3d(r0, -r0, -r0);
-		}
-		glEnd();
-		break;
-	case GLYPH_LINE:
-		glBegin(GL_LINES);
-		{
-			glVertex3d(0, 0, 0);
-			glVertex3d(0, 0, L);
-		}
-		glEnd();
-	}
-
-	glPopMatrix();
+	GlyphRotation(v, g.a);
+	g.a[0] *= L;
+	g.a[1] *= L;
+	g.a[2] *= L;
+	g.r = r;
 }
 
 void CGLVectorPlot::SetVectorField(int ntype) 
@@ -437,6 +406,7 @@ void CGLVectorPlot::Update()
 void CGLVectorPlot::Activate(bool b)
 {
 	CGLLegendPlot::Activate(b);
+	m_bvalid = false;
 	GLLegendBar* bar = GetLegendBar();
 	if ((m_ncol == 0) || !IsActive()) bar->hide();
 	else
@@ -448,7 +418,8 @@ void CGLVectorPlot::Activate(bool b)
 
 void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 {
-	if (breset) { m_map.Clear(); m_rng.clear(); m_val.clear(); }
+	if (breset) { m_map.reset(); m_val.clear(); }
+	m_bvalid = false;
 
 	m_lastTime = ntime;
 	m_lastDt = dt;
@@ -460,27 +431,11 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	int N = pfem->GetStates();
 	if (N == 0) return;
 
-	// allocate buffers if needed
-	if (m_map.States() == 0)
+	// get the values map
+	bool nodal = !IS_ELEM_FIELD(m_nvec);
+	if ((m_map == nullptr) || (m_map->Field() != m_nvec) || (m_map->IsNodal() != nodal))
 	{
-		// nr of states
-		int NS = pfem->GetStates();
-
-		// pick the max of nodes and elements
-		int NM = 0;
-		for (int i = 0; i < NS; ++i)
-		{
-			FEPostMesh* pmi = pfem->GetState(i)->GetFEMesh();
-			int NN = pmi->Nodes();
-			int NE = pmi->Elements();
-			if (NN > NM) NM = NN;
-			if (NE > NM) NM = NE;
-		}
-
-		// allocate buffers
-		m_map.Create(NS, NM, vec3f(0,0,0), -1);
-		m_rng.resize(NS);
-		m_val.resize(NM);
+		m_map = mdl->GetVectorFieldMap(m_nvec, nodal);
 	}
 
 	// get the current states
@@ -489,13 +444,12 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	if (dt == 0.f) n1 = n0;
 
 	// Update the states
-	UpdateState(n0);
-	if (n1 != n0) UpdateState(n1);
+	m_map->Update(n0, n1);
 
 	// copy nodal values
 	if (n1 == n0)
 	{
-		m_val = m_map.State(ntime);
+		m_val = m_map->State(ntime);
 	}
 	else
 	{
@@ -512,8 +466,10 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 		if (IS_ELEM_FIELD(m_nvec)) ND = pm->Elements();
 		else ND = pm->Nodes();
 
-		vector<vec3f>& data0 = m_map.State(n0);
-		vector<vec3f>& data1 = m_map.State(n1);
+		vector<vec3f>& data0 = m_map->State(n0);
+		vector<vec3f>& data1 = m_map->State(n1);
+
+		m_val.resize(data0.size());
 
 		for (int i = 0; i < ND; ++i)
 		{
@@ -528,11 +484,11 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	// update static range
 	if (breset)
 	{
-		m_staticRange = m_rng[ntime];
+		m_staticRange = m_map->Range(ntime);
 	}
 	else
 	{
-		vec2f& rng = m_rng[ntime];
+		const vec2f& rng = m_map->Range(ntime);
 		if (rng.x < m_staticRange.x) m_staticRange.x = rng.x;
 		if (rng.y > m_staticRange.y) m_staticRange.y = rng.y;
 	}
@@ -541,7 +497,7 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	switch (m_rngType)
 	{
 	case 0: // dynamic
-		m_crng = m_rng[ntime];
+		m_crng = m_map->Range(ntime);
 		break;
 	case 1: // static
 		m_crng = m_staticRange;
@@ -557,46 +513,3 @@ void CGLVectorPlot::Update(int ntime, float dt, bool breset)
 	GLLegendBar* bar = GetLegendBar();
 	bar->SetRange(m_crng.x, m_crng.y);
 }
-
-void CGLVectorPlot::UpdateState(int nstate)
-{
-	CGLModel* mdl = GetModel();
-	FEPostMesh* pm = mdl->GetActiveMesh();
-	FEPostModel* pfem = mdl->GetFEModel();
-
-	// check the tag
-	int ntag = m_map.GetTag(nstate);
-
-	// see if we need to update
-	if (ntag != m_nvec)
-	{
-		m_map.SetTag(nstate, m_nvec);
-
-		// get the state we are interested in
-		vector<vec3f>& val = m_map.State(nstate);
-
-		vec2f& rng = m_rng[nstate];
-		rng.x = rng.y = 0;
-
-		if (IS_ELEM_FIELD(m_nvec))
-		{
-			for (int i = 0; i < pm->Elements(); ++i)
-			{
-				val[i] = pfem->EvaluateElemVector(i, nstate, m_nvec);
-				float L = val[i].Length();
-				if (L > rng.y) rng.y = L;
-			}
-		}
-		else
-		{
-			for (int i = 0; i < pm->Nodes(); ++i)
-			{
-				val[i] = pfem->EvaluateNodeVector(i, nstate, m_nvec);
-				float L = val[i].Length();
-				if (L > rng.y) rng.y = L;
-			}
-		}
-
-		if (rng.y == rng.x) ++rng.y;
-	}
-}
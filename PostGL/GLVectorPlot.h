@@ -26,8 +26,7 @@ SOFTWARE.*/
 
 #pragma once
 #include "GLPlot.h"
-
-class GLUquadric;
+#include "GLGlyph.h"
 
 namespace Post {
 
@@ -48,7 +47,8 @@ class CGLVectorPlot : public CGLLegendPlot
 		ASPECT_RATIO,
 		RANGE_TYPE,
 		USER_MAX,
-		USER_MIN
+		USER_MIN,
+		MAX_GLYPHS
 	};
 
 public:
@@ -74,38 +74,38 @@ public:
 
 	void Render(CGLContext& rc) override;
 
-	void SetScaleFactor(float g) { m_scale = g; }
+	void SetScaleFactor(float g) { m_scale = g; m_bvalid = false; }
 	double GetScaleFactor() { return m_scale; }
 
-	void SetDensity(float d) { m_dens = d; }
+	void SetDensity(float d) { m_dens = d; m_bvalid = false; }
 	double GetDensity() { return m_dens; }
 
 	int GetVectorField() { return m_nvec; }
 	void SetVectorField(int ntype);
 
 	int GetGlyphType() { return m_nglyph; }
-	void SetGlyphType(int ntype) { m_nglyph = ntype; }
+	void SetGlyphType(int ntype) { m_nglyph = ntype; m_bvalid = false; }
 
 	int GetColorType() { return m_ncol; }
-	void SetColorType(int ntype) { m_ncol = ntype; }
+	void SetColorType(int ntype) { m_ncol = ntype; m_bvalid = false; }
 
 	GLColor GetGlyphColor() { return m_gcl; }
-	void SetGlyphColor(GLColor c) { m_gcl = c; }
+	void SetGlyphColor(GLColor c) { m_gcl = c; m_bvalid = false; }
 
 	bool NormalizeVectors() { return m_bnorm; }
-	void NormalizeVectors(bool b) { m_bnorm = b; }
+	void NormalizeVectors(bool b) { m_bnorm = b; m_bvalid = false; }
 
 	bool GetAutoScale() { return m_bautoscale; }
-	void SetAutoScale(bool b) { m_bautoscale = b; }
+	void SetAutoScale(bool b) { m_bautoscale = b; m_bvalid = false; }
 
 	bool ShowHidden() const { return m_bshowHidden; }
-	void ShowHidden(bool b) { m_bshowHidden = b; }
+	void ShowHidden(bool b) { m_bshowHidden = b; m_bvalid = false; }
 
 	CColorTexture* GetColorMap() { return &m_Col; }
 
 	void Update(int ntime, float dt, bool breset) override;
 
-	void UpdateTexture() override { m_Col.UpdateTexture(); }
+	void UpdateTexture() override { m_Col.UpdateTexture(); m_bvalid = false; }
 
 	bool UpdateData(bool bsave = true) override;
 
@@ -114,15 +114,20 @@ public:
 	void Activate(bool b) override;
 
 private:
-	// render a vector n at position r
-	void RenderVector(const vec3f& r, vec3f v, GLUquadric* pglyph);
+	// evaluate the glyph of vector v at position r
+	void EvalGlyph(const vec3f& r, vec3f v, GLGlyphInstance& g);
+
+	// build the glyph geometry
+	void UpdateGlyph();
 
-	void UpdateState(int nstate);
+	// place the glyphs and build their instances
+	void BuildGlyphs();
 
 protected:
 	float	m_scale;
 	float	m_dens;
 	int		m_seed;
+	int		m_maxGlyphs;	// max nr of glyphs (0 = no limit)
 
 	int		m_nvec;		// vector field
 	int		m_nglyph;	// glyph type
@@ -140,8 +145,7 @@ protected:
 	GLColor			m_gcl;	// glyph color (for GLYPH_COL_SOLID)
 	CColorTexture	m_Col;	// glyph color (for not GLYPH_COL_SOLID)
 
-	vector<vec2f>	m_rng;	// nodal ranges
-	DataMap<vec3f>	m_map;	// nodal values map
+	std::shared_ptr<VectorFieldMap>	m_map;	// nodal or element values map (shared with other plots)
 	
 	int				m_ntime;	// current time at which this plot is evaluated
 	vector<vec3f>	m_val;	// current values
@@ -152,5 +156,11 @@ protected:
 	vec2f			m_staticRange;
 
 	float			m_fscale;	// total scale factor for rendering
+
+	GLGlyphMesh		m_glyph;		// glyph geometry
+	int				m_glyphType;	// glyph type of m_glyph
+	float			m_glyphAR;		// aspect ratio of m_glyph
+	bool			m_bvalid;		// the glyph instances are up to date
+	GLGlyphKey		m_glyphKey;		// model state the glyph instances were built for
 };
 }
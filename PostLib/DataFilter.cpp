@@ -30,662 +30,241 @@ SOFTWARE.*/
 #include "constants.h"
 #include "FEMeshData_T.h"
 #include "evaluate.h"
+#include <FSCore/FSThreadPool.h>
 using namespace Post;
 
-bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
+//-----------------------------------------------------------------------------
+// The values of the data classes are stored in contiguous arrays of floats
+// (or doubles for Mat3d). The kernels below work on these arrays directly. They
+// are plain loops so that the compiler can vectorize them.
+template <typename T> struct FilterScalar { typedef float type; };
+template <> struct FilterScalar<Mat3d> { typedef double type; };
+
+template <typename S> static void scale_kernel(S* p, size_t n, S s)
 {
-	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
-	float fscale = (float) scale;
-	// loop over all states
-	int NN = mesh.Nodes();
-	int ndata = FIELD_CODE(nfield);
-	for (int i = 0; i<fem.GetStates(); ++i)
+	for (size_t i = 0; i < n; ++i) p[i] *= s;
+}
+
+static void scale_vec3_kernel(float* p, size_t n, float sx, float sy, float sz)
+{
+	for (size_t i = 0; i < n; ++i)
 	{
-		FEState& s = *fem.GetState(i);
-		FEMeshData& d = s.m_Data[ndata];
-		Data_Type type = d.GetType();
-		Data_Format fmt = d.GetFormat();
-		if (IS_NODE_FIELD(nfield))
-		{
-			switch (type)
-			{
-			case DATA_FLOAT:
-			{
-				FENodeData<float>* pf = dynamic_cast< FENodeData<float>* >(&d);
-				for (int n = 0; n<NN; ++n) { float& v = (*pf)[n]; v *= fscale; }
-			}
-			break;
-			case DATA_VEC3F:
-			{
-				FENodeData<vec3f>* pv = dynamic_cast< FENodeData<vec3f>* >(&d);
-				for (int n = 0; n<NN; ++n) { vec3f& v = (*pv)[n]; v *= fscale; }
-			}
-			break;
-			case DATA_MAT3FS:
-			{
-				FENodeData<mat3fs>* pv = dynamic_cast< FENodeData<mat3fs>* >(&d);
-				for (int n = 0; n<NN; ++n) { mat3fs& v = (*pv)[n]; v *= fscale; }
-			}
-			break;
-			case DATA_MAT3D:
-			{
-				FENodeData<Mat3d>* pv = dynamic_cast< FENodeData<Mat3d>* >(&d);
-				for (int n = 0; n<NN; ++n) { Mat3d& v = (*pv)[n]; v *= fscale; }
-			}
-			break;
-			case DATA_MAT3F:
-			{
-				FENodeData<mat3f>* pv = dynamic_cast< FENodeData<mat3f>* >(&d);
-				for (int n = 0; n<NN; ++n) { mat3f& v = (*pv)[n]; v *= fscale; }
-			}
-			break;
-			default:
-				break;
-			}
-		}
-		else if (IS_ELEM_FIELD(nfield))
-		{
-			switch (type)
-			{
-			case DATA_FLOAT:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEElementData<float, DATA_NODE>* pf = dynamic_cast<FEElementData<float, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<float, DATA_ITEM>* pf = dynamic_cast<FEElementData<float, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<float, DATA_COMP>* pf = dynamic_cast<FEElementData<float, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<float, DATA_REGION>* pf = dynamic_cast<FEElementData<float, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_VEC3F:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEElementData<vec3f, DATA_NODE>* pf = dynamic_cast<FEElementData<vec3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<vec3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<vec3f, DATA_COMP>* pf = dynamic_cast<FEElementData<vec3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<vec3f, DATA_REGION>* pf = dynamic_cast<FEElementData<vec3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_MAT3FS:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEElementData<mat3fs, DATA_NODE>* pf = dynamic_cast<FEElementData<mat3fs, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<mat3fs, DATA_ITEM>* pf = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<mat3fs, DATA_COMP>* pf = dynamic_cast<FEElementData<mat3fs, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<mat3fs, DATA_REGION>* pf = dynamic_cast<FEElementData<mat3fs, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_MAT3D:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEElementData<Mat3d, DATA_NODE>* pf = dynamic_cast<FEElementData<Mat3d, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<Mat3d, DATA_ITEM>* pf = dynamic_cast<FEElementData<Mat3d, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<Mat3d, DATA_COMP>* pf = dynamic_cast<FEElementData<Mat3d, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<Mat3d, DATA_REGION>* pf = dynamic_cast<FEElementData<Mat3d, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_MAT3F:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEElementData<mat3f, DATA_NODE>* pf = dynamic_cast<FEElementData<mat3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<mat3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<mat3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<mat3f, DATA_COMP>* pf = dynamic_cast<FEElementData<mat3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<mat3f, DATA_REGION>* pf = dynamic_cast<FEElementData<mat3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			default:
-				return false;
-				break;
-			}
-		}
-		else if (IS_FACE_FIELD(nfield))
-		{
-			switch (type)
-			{
-			case DATA_FLOAT:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<float, DATA_NODE>* pf = dynamic_cast<FEFaceData<float, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<float, DATA_ITEM>* pf = dynamic_cast<FEFaceData<float, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<float, DATA_COMP>* pf = dynamic_cast<FEFaceData<float, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEFaceData<float, DATA_REGION>* pf = dynamic_cast<FEFaceData<float, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n=0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_VEC3F:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<vec3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<vec3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<vec3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<vec3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<vec3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEFaceData<vec3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<vec3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_MAT3FS:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<mat3fs, DATA_NODE>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<mat3fs, DATA_ITEM>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<mat3fs, DATA_COMP>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEFaceData<mat3fs, DATA_REGION>* pf = dynamic_cast<FEFaceData<mat3fs, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			case DATA_MAT3D:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<Mat3d, DATA_NODE>* pf = dynamic_cast<FEFaceData<Mat3d, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<Mat3d, DATA_ITEM>* pf = dynamic_cast<FEFaceData<Mat3d, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<Mat3d, DATA_COMP>* pf = dynamic_cast<FEFaceData<Mat3d, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEFaceData<Mat3d, DATA_REGION>* pf = dynamic_cast<FEFaceData<Mat3d, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= scale;
-				}
-			}
-			break;
-			case DATA_MAT3F:
-			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<mat3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<mat3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<mat3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<mat3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<mat3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<mat3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= (float) scale;
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEFaceData<mat3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<mat3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n<N; ++n) (*pf)[n] *= fscale;
-				}
-			}
-			break;
-			default:
-				return false;
-				break;
-			}
-		}
-		else 
-		{
-			break; 
-		}
+		p[3*i    ] *= sx;
+		p[3*i + 1] *= sy;
+		p[3*i + 2] *= sz;
 	}
+}
 
+static bool arithmetic_kernel(float* d, const float* s, size_t n, int nop)
+{
+	switch (nop)
+	{
+	case 0: for (size_t i = 0; i < n; ++i) d[i] = d[i] + s[i]; break;
+	case 1: for (size_t i = 0; i < n; ++i) d[i] = d[i] - s[i]; break;
+	case 2: for (size_t i = 0; i < n; ++i) d[i] = d[i] * s[i]; break;
+	case 3: for (size_t i = 0; i < n; ++i) d[i] = d[i] / s[i]; break;
+	case 4: for (size_t i = 0; i < n; ++i) d[i] = fabs(d[i] - s[i]); break;
+	default:
+		return false;
+	}
 	return true;
 }
 
 //-----------------------------------------------------------------------------
-bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
+// Calls f(v, n) with the n values of the data, if the data is stored in a D container
+template <class D, class F> static bool visit_as(Post::FEMeshData& d, F& f)
 {
-	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
+	D* p = dynamic_cast<D*>(&d);
+	if (p == nullptr) return false;
+	if (p->size() > 0) f(&(*p)[0], (size_t)p->size());
+	return true;
+}
 
-	vec3f fscale = to_vec3f(scale);
+// Calls f(v, n) with the values of the node, face, or element data of type T.
+// Returns false if the data is not stored as an array of T.
+template <typename T, class F> static bool visit_values(Post::FEMeshData& d, F f)
+{
+	return visit_as<Post::FENodeData<T> >(d, f) ||
+		visit_as<Post::FEElementData<T, DATA_NODE  > >(d, f) ||
+		visit_as<Post::FEElementData<T, DATA_ITEM  > >(d, f) ||
+		visit_as<Post::FEElementData<T, DATA_COMP  > >(d, f) ||
+		visit_as<Post::FEElementData<T, DATA_REGION> >(d, f) ||
+		visit_as<Post::FEFaceData<T, DATA_NODE  > >(d, f) ||
+		visit_as<Post::FEFaceData<T, DATA_ITEM  > >(d, f) ||
+		visit_as<Post::FEFaceData<T, DATA_COMP  > >(d, f) ||
+		visit_as<Post::FEFaceData<T, DATA_REGION> >(d, f);
+}
 
-	// loop over all states
-	int NN = mesh.Nodes();
+struct ScaleValues
+{
+	double	m_scale;
+	template <typename T> void operator () (T* v, size_t n) const
+	{
+		typedef typename FilterScalar<T>::type S;
+		static_assert(sizeof(T) % sizeof(S) == 0, "values must be arrays of scalars");
+		scale_kernel((S*)v, n * (sizeof(T) / sizeof(S)), (S)m_scale);
+	}
+};
+
+//-----------------------------------------------------------------------------
+// Scale the data of one state
+static bool scaleState(FEPostModel& fem, int nstate, int nfield, double scale)
+{
+	if (!IS_NODE_FIELD(nfield) && !IS_ELEM_FIELD(nfield) && !IS_FACE_FIELD(nfield)) return true;
+
+	Post::FEMeshData& d = fem.GetState(nstate)->m_Data[FIELD_CODE(nfield)];
+	ScaleValues f = { scale };
+	switch (d.GetType())
+	{
+	case DATA_FLOAT : return visit_values<float >(d, f);
+	case DATA_VEC3F : return visit_values<vec3f >(d, f);
+	case DATA_MAT3FS: return visit_values<mat3fs>(d, f);
+	case DATA_MAT3D : return visit_values<Mat3d >(d, f);
+	case DATA_MAT3F : return visit_values<mat3f >(d, f);
+	default:
+		// other nodal data is left unchanged
+		return IS_NODE_FIELD(nfield);
+	}
+}
+
+//-----------------------------------------------------------------------------
+static bool scaleVec3State(FEPostModel& fem, int nstate, int nfield, vec3f s)
+{
+	if (!IS_NODE_FIELD(nfield) && !IS_ELEM_FIELD(nfield) && !IS_FACE_FIELD(nfield)) return true;
+
+	Post::FEMeshData& d = fem.GetState(nstate)->m_Data[FIELD_CODE(nfield)];
+	if (d.GetType() != DATA_VEC3F) return IS_NODE_FIELD(nfield);
+
+	return visit_values<vec3f>(d, [=](vec3f* v, size_t n) {
+		scale_vec3_kernel(&v[0].x, n, s.x, s.y, s.z);
+	});
+}
+
+//-----------------------------------------------------------------------------
+// Apply a smoothing step operation on the data of one state
+static bool smoothStep(FEPostModel& fem, int nstate, int nfield, double theta)
+{
+	Post::FEState& s = *fem.GetState(nstate);
+	Post::FEPostMesh& mesh = *s.GetFEMesh();
 	int ndata = FIELD_CODE(nfield);
-	for (int i = 0; i < fem.GetStates(); ++i)
+	if (IS_NODE_FIELD(nfield))
 	{
-		FEState& s = *fem.GetState(i);
-		FEMeshData& d = s.m_Data[ndata];
-		Data_Type type = d.GetType();
-		Data_Format fmt = d.GetFormat();
-		if (IS_NODE_FIELD(nfield))
+		int NN = mesh.Nodes();
+		Post::FEMeshData& d = s.m_Data[ndata];
+		
+		switch (d.GetType())
 		{
-			switch (type)
-			{
-			case DATA_VEC3F:
-			{
-				FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&d);
-				for (int n = 0; n < NN; ++n) 
-				{ 
-					vec3f& v = (*pv)[n]; 
-					v.x *= fscale.x; 
-					v.y *= fscale.y;
-					v.z *= fscale.z;
-				}
-			}
-			break;
-			default:
-				break;
-			}
-		}
-		else if (IS_ELEM_FIELD(nfield))
+		case DATA_FLOAT:
 		{
-			switch (type)
-			{
-			case DATA_VEC3F:
+			vector<float> D; D.assign(NN, 0.f);
+			vector<int> tag; tag.assign(NN, 0);
+			Post::FENodeData<float>& data = dynamic_cast< Post::FENodeData<float>& >(d);
+
+			// evaluate the average value of the neighbors
+			int NE = mesh.Elements();
+			for (int i=0; i<NE; ++i)
 			{
-				if (fmt == DATA_NODE)
+				FEElement_& el = mesh.ElementRef(i);
+				int ne = el.Nodes();
+				for (int j=0; j<ne; ++j)
 				{
-					FEElementData<vec3f, DATA_NODE>* pf = dynamic_cast<FEElementData<vec3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
+					float f = data[el.m_node[j]];
+					for (int k = 0; k<ne; ++k)
+					if (k != j)
 					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEElementData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEElementData<vec3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEElementData<vec3f, DATA_COMP>* pf = dynamic_cast<FEElementData<vec3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_REGION)
-				{
-					FEElementData<vec3f, DATA_REGION>* pf = dynamic_cast<FEElementData<vec3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
+						int nk = el.m_node[k];
+						D[nk] += f;
+						tag[nk]++;
 					}
 				}
 			}
-			break;
-			default:
-				return false;
-				break;
-			}
+
+			// normalize 
+			for (int i=0; i<NN; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
+
+			// assign to data field
+			for (int i = 0; i<NN; ++i) { data[i] = (1.0 - theta)*data[i] + theta*D[i];  }
 		}
-		else if (IS_FACE_FIELD(nfield))
+		break;
+		case DATA_VEC3F:
 		{
-			switch (type)
-			{
-			case DATA_VEC3F:
+			vector<vec3f> D; D.assign(NN, vec3f(0.f, 0.f, 0.f));
+			vector<int> tag; tag.assign(NN, 0);
+			Post::FENodeData<vec3f>& data = dynamic_cast< Post::FENodeData<vec3f>& >(d);
+
+			// evaluate the average value of the neighbors
+			int NE = mesh.Elements();
+			for (int i = 0; i<NE; ++i)
 			{
-				if (fmt == DATA_NODE)
-				{
-					FEFaceData<vec3f, DATA_NODE>* pf = dynamic_cast<FEFaceData<vec3f, DATA_NODE>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_ITEM)
-				{
-					FEFaceData<vec3f, DATA_ITEM>* pf = dynamic_cast<FEFaceData<vec3f, DATA_ITEM>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_COMP)
-				{
-					FEFaceData<vec3f, DATA_COMP>* pf = dynamic_cast<FEFaceData<vec3f, DATA_COMP>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
-					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
-					}
-				}
-				else if (fmt == DATA_REGION)
+				FEElement_& el = mesh.ElementRef(i);
+				int ne = el.Nodes();
+				for (int j = 0; j<ne; ++j)
 				{
-					FEFaceData<vec3f, DATA_REGION>* pf = dynamic_cast<FEFaceData<vec3f, DATA_REGION>*>(&d);
-					int N = pf->size();
-					for (int n = 0; n < N; ++n)
+					vec3f v = data[el.m_node[j]];
+					for (int k = 0; k<ne; ++k)
+					if (k != j)
 					{
-						vec3f& v = (*pf)[n];
-						v.x *= fscale.x;
-						v.y *= fscale.y;
-						v.z *= fscale.z;
+						int nk = el.m_node[k];
+						D[nk] += v;
+						tag[nk]++;
 					}
 				}
 			}
-			break;
-			default:
-				return false;
-				break;
-			}
+
+			// normalize 
+			for (int i = 0; i<NN; ++i) if (tag[i]>0) D[i] /= (float)tag[i];
+
+			// assign to data field
+			for (int i = 0; i<NN; ++i) { data[i] = data[i] * (1.0 - theta) + D[i]*theta; }
 		}
-		else
-		{
-			break;
+		break;
+		default:
+			return false;
 		}
 	}
-
-	return true;
-}
-
-//-----------------------------------------------------------------------------
-// Apply a smoothing step operation on data
-bool DataSmoothStep(FEPostModel& fem, int nfield, double theta)
-{
-	// loop over all states
-	int ndata = FIELD_CODE(nfield);
-	for (int n = 0; n<fem.GetStates(); ++n)
+	else if (IS_ELEM_FIELD(nfield))
 	{
-		FEState& s = *fem.GetState(n);
-		Post::FEPostMesh& mesh = *s.GetFEMesh();
-		if (IS_NODE_FIELD(nfield))
+		Post::FEMeshData& d = s.m_Data[ndata];
+		if ((d.GetFormat() == DATA_ITEM)&&(d.GetType() == DATA_FLOAT))
 		{
-			int NN = mesh.Nodes();
-			Post::FEMeshData& d = s.m_Data[ndata];
-			
-			switch (d.GetType())
-			{
-			case DATA_FLOAT:
-			{
-				vector<float> D; D.assign(NN, 0.f);
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<float>& data = dynamic_cast< Post::FENodeData<float>& >(d);
+			int NE = mesh.Elements();
 
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i=0; i<NE; ++i)
-				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j=0; j<ne; ++j)
-					{
-						float f = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
-						{
-							int nk = el.m_node[k];
-							D[nk] += f;
-							tag[nk]++;
-						}
-					}
-				}
-
-				// normalize 
-				for (int i=0; i<NN; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
+			vector<float> D; D.assign(NE, 0.f);
+			vector<int> tag; tag.assign(NE, 0);
+			Post::FEElementData<float, DATA_ITEM>& data = dynamic_cast< Post::FEElementData<float, DATA_ITEM>& >(d);
 
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = (1.0 - theta)*data[i] + theta*D[i];  }
-			}
-			break;
-			case DATA_VEC3F:
+			// evaluate the average value of the neighbors
+			// (the neighbor IDs are element indices, so we don't need to tag the elements,
+			// which would not be safe when the states are processed in parallel)
+			for (int i=0; i<NE; ++i)
 			{
-				vector<vec3f> D; D.assign(NN, vec3f(0.f, 0.f, 0.f));
-				vector<int> tag; tag.assign(NN, 0);
-				Post::FENodeData<vec3f>& data = dynamic_cast< Post::FENodeData<vec3f>& >(d);
-
-				// evaluate the average value of the neighbors
-				int NE = mesh.Elements();
-				for (int i = 0; i<NE; ++i)
+				FEElement_& el = mesh.ElementRef(i);
+				int nf = el.Faces();
+				for (int j=0; j<nf; ++j)
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int ne = el.Nodes();
-					for (int j = 0; j<ne; ++j)
+					int nj = el.m_nbr[j];
+					if ((nj >= 0) && (data.active(nj)))
 					{
-						vec3f v = data[el.m_node[j]];
-						for (int k = 0; k<ne; ++k)
-						if (k != j)
-						{
-							int nk = el.m_node[k];
-							D[nk] += v;
-							tag[nk]++;
-						}
+						float f;
+						data.eval(nj, &f);
+						D[i] += f;
+						tag[i]++;
 					}
 				}
-
-				// normalize 
-				for (int i = 0; i<NN; ++i) if (tag[i]>0) D[i] /= (float)tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NN; ++i) { data[i] = data[i] * (1.0 - theta) + D[i]*theta; }
-			}
-			break;
-			default:
-				return false;
 			}
-		}
-		else if (IS_ELEM_FIELD(nfield))
-		{
-			Post::FEMeshData& d = s.m_Data[ndata];
-			if ((d.GetFormat() == DATA_ITEM)&&(d.GetType() == DATA_FLOAT))
-			{
-				int NE = mesh.Elements();
 
-				vector<float> D; D.assign(NE, 0.f);
-				vector<int> tag; tag.assign(NE, 0);
-				Post::FEElementData<float, DATA_ITEM>& data = dynamic_cast< Post::FEElementData<float, DATA_ITEM>& >(d);
+			// normalize 
+			for (int i=0; i<NE; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
 
-				for (int i=0; i<NE; ++i) mesh.ElementRef(i).m_ntag = i;
-
-				// evaluate the average value of the neighbors
-				for (int i=0; i<NE; ++i)
+			// assign to data field
+			for (int i = 0; i<NE; ++i) 
+				if (data.active(i))
 				{
-					FEElement_& el = mesh.ElementRef(i);
-					int nf = el.Faces();
-					for (int j=0; j<nf; ++j)
-					{
-						FEElement_* pj = mesh.ElementPtr(el.m_nbr[j]);
-						if (pj && (data.active(pj->m_ntag)))
-						{
-							float f;
-							data.eval(pj->m_ntag, &f);
-							D[i] += f;
-							tag[i]++;
-						}
-					}
+					float f;
+					data.eval(i, &f);
+					D[i] = (1.0 - theta)*f + theta*D[i];
+					data.set(i, D[i]);
 				}
-
-				// normalize 
-				for (int i=0; i<NE; ++i) if (tag[i]>0) D[i] /= (float) tag[i];
-
-				// assign to data field
-				for (int i = 0; i<NE; ++i) 
-					if (data.active(i))
-					{
-						float f;
-						data.eval(i, &f);
-						D[i] = (1.0 - theta)*f + theta*D[i];
-						data.set(i, D[i]);
-					}
-			}
 		}
 	}
 
@@ -693,14 +272,12 @@ bool DataSmoothStep(FEPostModel& fem, int nfield, double theta)
 }
 
 //-----------------------------------------------------------------------------
-// Apply a smoothing operation on data
-bool Post::DataSmooth(FEPostModel& fem, int nfield, double theta, int niters)
+static bool smoothState(FEPostModel& fem, int nstate, int nfield, double theta, int niters)
 {
 	for (int n = 0; n<niters; ++n) 
 	{
-		if (DataSmoothStep(fem, nfield, theta) == false) return false;
+		if (smoothStep(fem, nstate, nfield, theta) == false) return false;
 	}
-
 	return true;
 }
 
@@ -713,348 +290,349 @@ double flt_div(double d, double s) { return d/s; }
 double flt_err(double d, double s) { return fabs(d - s); }
 
 //-----------------------------------------------------------------------------
-bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
+static bool arithmeticState(FEPostModel& fem, int nstate, int nfield, int nop, int noperand)
 {
 	int ndst = FIELD_CODE(nfield);
 	int nsrc = FIELD_CODE(noperand);
-
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 
-	// loop over all states
-	for (int n = 0; n<fem.GetStates(); ++n)
-	{
-		FEState& state = *fem.GetState(n);
-		FEMeshData& d = state.m_Data[ndst];
-		FEMeshData& s = state.m_Data[nsrc];
+	Post::FEState& state = *fem.GetState(nstate);
+	Post::FEMeshData& d = state.m_Data[ndst];
+	Post::FEMeshData& s = state.m_Data[nsrc];
 
-		Data_Format fmt = d.GetFormat();
-		if (d.GetFormat() != s.GetFormat()) return false;
-		if ((d.GetType() != s.GetType()) && (s.GetType() != DATA_FLOAT)) return false;
+	Data_Format fmt = d.GetFormat();
+	if (d.GetFormat() != s.GetFormat()) return false;
+	if ((d.GetType() != s.GetType()) && (s.GetType() != DATA_FLOAT)) return false;
 
-		if (IS_NODE_FIELD(nfield) && IS_NODE_FIELD(noperand))
+	if (IS_NODE_FIELD(nfield) && IS_NODE_FIELD(noperand))
+	{
+		if ((d.GetType() == DATA_FLOAT) && (s.GetType() == DATA_FLOAT))
 		{
-			if ((d.GetType() == DATA_FLOAT) && (s.GetType() == DATA_FLOAT))
+			double(*f)(double, double) = 0;
+			if      (nop == 0) f = flt_add;
+			else if (nop == 1) f = flt_sub;
+			else if (nop == 2) f = flt_mul;
+			else if (nop == 3) f = flt_div;
+			else if (nop == 4) f = flt_err;
+			else
 			{
-				double(*f)(double, double) = 0;
-				if      (nop == 0) f = flt_add;
-				else if (nop == 1) f = flt_sub;
-				else if (nop == 2) f = flt_mul;
-				else if (nop == 3) f = flt_div;
-				else if (nop == 4) f = flt_err;
-				else
-				{
-					return false;
-				}
+				return false;
+			}
 
-				FENodeData<float>*   pd = dynamic_cast<FENodeData  <float>*>(&d);
-				FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s);
-				int N = pd->size();
+			Post::FENodeData<float>*   pd = dynamic_cast<Post::FENodeData  <float>*>(&d);
+			Post::FENodeData_T<float>* ps = dynamic_cast<Post::FENodeData_T<float>*>(&s);
+			int N = pd->size();
+
+			// use the array kernel when the operand is stored, rather than calculated
+			Post::FENodeData<float>* pa = dynamic_cast<Post::FENodeData<float>*>(&s);
+			if (pa && (pa->size() == N))
+			{
+				if (N > 0) arithmetic_kernel(&(*pd)[0], &(*pa)[0], N, nop);
+			}
+			else
+			{
 				for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] = (float)f((*pd)[i], v); }
 			}
-			else if (d.GetType() == DATA_VEC3F)
+		}
+		else if (d.GetType() == DATA_VEC3F)
+		{
+			if (s.GetType() == DATA_VEC3F)
 			{
-				if (s.GetType() == DATA_VEC3F)
+				Post::FENodeData<vec3f>* pd = dynamic_cast<Post::FENodeData<vec3f>*>(&d);
+				Post::FENodeData_T<vec3f>* ps = dynamic_cast<Post::FENodeData_T<vec3f>*>(&s);
+				int N = pd->size();
+				switch (nop)
 				{
-					FENodeData<vec3f>* pd = dynamic_cast<FENodeData<vec3f>*>(&d);
-					FENodeData_T<vec3f>* ps = dynamic_cast<FENodeData_T<vec3f>*>(&s);
-					int N = pd->size();
-					switch (nop)
-					{
-					case 0: for (int i = 0; i<N; ++i) { vec3f v; ps->eval(i, &v); (*pd)[i] += v; } break;
-					case 1: for (int i = 0; i<N; ++i) { vec3f v; ps->eval(i, &v); (*pd)[i] -= v; } break;
-					}
+				case 0: for (int i = 0; i<N; ++i) { vec3f v; ps->eval(i, &v); (*pd)[i] += v; } break;
+				case 1: for (int i = 0; i<N; ++i) { vec3f v; ps->eval(i, &v); (*pd)[i] -= v; } break;
 				}
-				else if (s.GetType() == DATA_FLOAT)
+			}
+			else if (s.GetType() == DATA_FLOAT)
+			{
+				Post::FENodeData<vec3f>* pd = dynamic_cast<Post::FENodeData<vec3f>*>(&d);
+				Post::FENodeData_T<float>* ps = dynamic_cast<Post::FENodeData_T<float>*>(&s);
+				int N = pd->size();
+				switch (nop)
 				{
-					FENodeData<vec3f>* pd = dynamic_cast<FENodeData<vec3f>*>(&d);
-					FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s);
-					int N = pd->size();
-					switch (nop)
-					{
-					case 2: for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] *= v; } break;
-					case 3: for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] /= v; } break;
-					}
+				case 2: for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] *= v; } break;
+				case 3: for (int i = 0; i<N; ++i) { float v; ps->eval(i, &v); (*pd)[i] /= v; } break;
 				}
-				else return false;
 			}
+			else return false;
 		}
-		else if (IS_ELEM_FIELD(nfield) && IS_ELEM_FIELD(noperand))
+	}
+	else if (IS_ELEM_FIELD(nfield) && IS_ELEM_FIELD(noperand))
+	{
+		if ((d.GetType() == DATA_FLOAT) && (s.GetType() == DATA_FLOAT))
 		{
-			if ((d.GetType() == DATA_FLOAT) && (s.GetType() == DATA_FLOAT))
+			double (*f)(double,double) = 0;
+			if      (nop == 0) f = flt_add;
+			else if (nop == 1) f = flt_sub;
+			else if (nop == 2) f = flt_mul;
+			else if (nop == 3) f = flt_div;
+			else if (nop == 4) f = flt_err;
+			else
 			{
-				double (*f)(double,double) = 0;
-				if      (nop == 0) f = flt_add;
-				else if (nop == 1) f = flt_sub;
-				else if (nop == 2) f = flt_mul;
-				else if (nop == 3) f = flt_div;
-				else if (nop == 4) f = flt_err;
-				else
-				{
-					return false;
-				}
+				return false;
+			}
 
-				if (fmt == DATA_ITEM)
+			if (fmt == DATA_ITEM)
+			{
+				Post::FEElementData<float, DATA_ITEM>* pd = dynamic_cast<Post::FEElementData<float, DATA_ITEM>*>(&d);
+				Post::FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_ITEM>*>(&s);
+				if (pd && ps)
 				{
-					FEElementData<float, DATA_ITEM>* pd = dynamic_cast<FEElementData<float, DATA_ITEM>*>(&d);
-					FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
-					if (pd && ps)
+					int N = mesh.Elements();
+					for (int i = 0; i<N; ++i)
 					{
-						int N = mesh.Elements();
-						for (int i = 0; i<N; ++i)
+						if (pd->active(i) && ps->active(i))
 						{
-							if (pd->active(i) && ps->active(i))
-							{
-								float vs, vd;
-								pd->eval(i, &vd);
-								ps->eval(i, &vs);
-								float r = (float)f(vd, vs);
-								pd->set(i, r);
-							}
+							float vs, vd;
+							pd->eval(i, &vd);
+							ps->eval(i, &vs);
+							float r = (float)f(vd, vs);
+							pd->set(i, r);
 						}
 					}
-					else return false;
 				}
-				else if (fmt == DATA_NODE)
+				else return false;
+			}
+			else if (fmt == DATA_NODE)
+			{
+				Post::FEElementData<float, DATA_NODE>* pd = dynamic_cast<Post::FEElementData<float, DATA_NODE>*>(&d);
+				Post::FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_NODE>*>(&s);
+				if (pd && ps)
 				{
-					FEElementData<float, DATA_NODE>* pd = dynamic_cast<FEElementData<float, DATA_NODE>*>(&d);
-					FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&s);
-					if (pd && ps)
+					int N = mesh.Elements();
+					float vs[FEElement::MAX_NODES], vd[FEElement::MAX_NODES];
+					for (int i = 0; i<N; ++i)
 					{
-						int N = mesh.Elements();
-						float vs[FEElement::MAX_NODES], vd[FEElement::MAX_NODES];
-						for (int i = 0; i<N; ++i)
+						FEElement& el = mesh.Element(i);
+						if (pd->active(i) && ps->active(i))
 						{
-							FEElement& el = mesh.Element(i);
-							if (pd->active(i) && ps->active(i))
+							pd->eval(i, vd);
+							ps->eval(i, vs);
+							for (int j = 0; j < el.Nodes(); ++j)
 							{
-								pd->eval(i, vd);
-								ps->eval(i, vs);
-								for (int j = 0; j < el.Nodes(); ++j)
-								{
-									float r = (float)f(vd[j], vs[j]);
-									pd->set(i, j, r);
-								}
+								float r = (float)f(vd[j], vs[j]);
+								pd->set(i, j, r);
 							}
 						}
 					}
-					else return false;
-				}
-				else
-				{
-					return false;
 				}
+				else return false;
+			}
+			else
+			{
+				return false;
 			}
-			else if (d.GetType() == DATA_MAT3FS)
+		}
+		else if (d.GetType() == DATA_MAT3FS)
+		{
+			if (s.GetType() == DATA_MAT3FS)
 			{
-				if (s.GetType() == DATA_MAT3FS)
+				if (fmt == DATA_ITEM)
 				{
-					if (fmt == DATA_ITEM)
+					Post::FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<Post::FEElementData<mat3fs, DATA_ITEM>*>(&d);
+					Post::FEElemData_T<mat3fs, DATA_ITEM>* ps = dynamic_cast<Post::FEElemData_T<mat3fs, DATA_ITEM>*>(&s);
+					if (pd && ps)
 					{
-						FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
-						FEElemData_T<mat3fs, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<mat3fs, DATA_ITEM>*>(&s);
-						if (pd && ps)
+						int N = mesh.Elements();
+						switch (nop)
 						{
-							int N = mesh.Elements();
-							switch (nop)
+						case 0: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs s, d, r; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d + s); } break;
+						case 1: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs s, d, r; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d - s); } break;
+						default:
 							{
-							case 0: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs s, d, r; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d + s); } break;
-							case 1: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs s, d, r; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d - s); } break;
-							default:
-								{
-									return false;
-								}
+								return false;
 							}
 						}
 					}
-					else return false;
 				}
-				else if (s.GetType() == DATA_FLOAT)
+				else return false;
+			}
+			else if (s.GetType() == DATA_FLOAT)
+			{
+				if (fmt == DATA_ITEM)
 				{
-					if (fmt == DATA_ITEM)
+					Post::FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<Post::FEElementData<mat3fs, DATA_ITEM>*>(&d);
+					Post::FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_ITEM>*>(&s);
+					if (pd && ps)
 					{
-						FEElementData<mat3fs, DATA_ITEM>* pd = dynamic_cast<FEElementData<mat3fs, DATA_ITEM>*>(&d);
-						FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
-						if (pd && ps)
+						mat3fs I(1.f, 1.f, 1.f, 0.f, 0.f, 0.f);
+						int N = mesh.Elements();
+						switch (nop)
 						{
-							mat3fs I(1.f, 1.f, 1.f, 0.f, 0.f, 0.f);
-							int N = mesh.Elements();
-							switch (nop)
+						case 0: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d + I*s); } break;
+						case 1: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d - I*s); } break;
+						case 2: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d*s); } break;
+						case 3: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d/s); } break;
+						default:
 							{
-							case 0: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d + I*s); } break;
-							case 1: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d - I*s); } break;
-							case 2: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d*s); } break;
-							case 3: for (int i = 0; i<N; ++i) if (pd->active(i) && (ps->active(i))) { mat3fs d, r; float s; pd->eval(i, &d); ps->eval(i, &s); pd->set(i, d/s); } break;
-							default:
-								{
-									return false;
-								}
+								return false;
 							}
 						}
-						else return false;
 					}
 					else return false;
 				}
-				else
-				{
-					return false;
-				}
+				else return false;
+			}
+			else
+			{
+				return false;
 			}
-		}
-		else
-		{
-			return false;
 		}
 	}
+	else
+	{
+		return false;
+	}
 
 	return true;
 }
 
 //-----------------------------------------------------------------------------
-bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
+static bool gradientState(FEPostModel& fem, int n, int vecField, int sclField)
 {
 	int nvec = FIELD_CODE(vecField);
 	int nscl = FIELD_CODE(sclField);
 
-	// loop over all the states
-	for (int n=0; n<fem.GetStates(); ++n)
-	{
-		FEState& state = *fem.GetState(n);
-		FEMeshData& v = state.m_Data[nvec];
-		FEMeshData& s = state.m_Data[nscl];
+	Post::FEState& state = *fem.GetState(n);
+	Post::FEMeshData& v = state.m_Data[nvec];
+	Post::FEMeshData& s = state.m_Data[nscl];
 
-		// zero the vector field
-		if (IS_NODE_FIELD(vecField) && (v.GetType() == DATA_VEC3F))
-		{
-			FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&v);
-			int N = pv->size();
-			for (int i = 0; i<N; ++i) (*pv)[i] = vec3f(0,0,0);
-		}
-		else return false;
+	// zero the vector field
+	if (IS_NODE_FIELD(vecField) && (v.GetType() == DATA_VEC3F))
+	{
+		Post::FENodeData<vec3f>* pv = dynamic_cast<Post::FENodeData<vec3f>*>(&v);
+		int N = pv->size();
+		for (int i = 0; i<N; ++i) (*pv)[i] = vec3f(0,0,0);
+	}
+	else return false;
 
-		// get the mesh
-		Post::FEPostMesh* mesh = state.GetFEMesh();
+	// get the mesh
+	Post::FEPostMesh* mesh = state.GetFEMesh();
 
-		// evaluate the field over all the nodes
-		const int NN = mesh->Nodes();
-		vector<double> d(NN, 0.f);
+	// evaluate the field over all the nodes
+	const int NN = mesh->Nodes();
+	vector<double> d(NN, 0.f);
 
-		if (s.GetType() == DATA_FLOAT)
+	if (s.GetType() == DATA_FLOAT)
+	{
+		if (IS_NODE_FIELD(sclField))
 		{
-			if (IS_NODE_FIELD(sclField))
-			{
-				FENodeData_T<float>* ps = dynamic_cast<FENodeData_T<float>*>(&s); assert(ps);
-				for (int i=0; i<NN; ++i) 
-				{	
-					float f;	
-					ps->eval(i, &f);
-					d[i] = (double) f;
-				}
+			Post::FENodeData_T<float>* ps = dynamic_cast<Post::FENodeData_T<float>*>(&s); assert(ps);
+			for (int i=0; i<NN; ++i) 
+			{	
+				float f;	
+				ps->eval(i, &f);
+				d[i] = (double) f;
 			}
-			else if (IS_ELEM_FIELD(sclField))
+		}
+		else if (IS_ELEM_FIELD(sclField))
+		{
+			if (s.GetFormat() == DATA_NODE)
 			{
-				if (s.GetFormat() == DATA_NODE)
-				{
-					vector<int> tag(NN, 0);
-					FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&s);
+				vector<int> tag(NN, 0);
+				Post::FEElemData_T<float, DATA_NODE>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_NODE>*>(&s);
 
-					float ed[FEElement::MAX_NODES] = {0.f};
-					for (int i=0; i<mesh->Elements(); ++i)
+				float ed[FEElement::MAX_NODES] = {0.f};
+				for (int i=0; i<mesh->Elements(); ++i)
+				{
+					FEElement_& el = mesh->ElementRef(i);
+					if (ps->active(i))
 					{
-						FEElement_& el = mesh->ElementRef(i);
-						if (ps->active(i))
+						ps->eval(i, ed);
+						for (int j=0; j<el.Nodes(); ++j)
 						{
-							ps->eval(i, ed);
-							for (int j=0; j<el.Nodes(); ++j)
-							{
-								d[el.m_node[j]] += ed[j];
-								tag[el.m_node[j]]++;
-							}
+							d[el.m_node[j]] += ed[j];
+							tag[el.m_node[j]]++;
 						}
 					}
-					for (int i=0; i<NN; ++i)
-						if (tag[i] > 0) d[i] /= (double) tag[i];
 				}
-				else if (s.GetFormat() == DATA_ITEM)
-				{
-					vector<int> tag(NN, 0);
-					FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<FEElemData_T<float, DATA_ITEM>*>(&s);
+				for (int i=0; i<NN; ++i)
+					if (tag[i] > 0) d[i] /= (double) tag[i];
+			}
+			else if (s.GetFormat() == DATA_ITEM)
+			{
+				vector<int> tag(NN, 0);
+				Post::FEElemData_T<float, DATA_ITEM>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_ITEM>*>(&s);
 
-					float ed =  0.f;
-					for (int i = 0; i<mesh->Elements(); ++i)
+				float ed =  0.f;
+				for (int i = 0; i<mesh->Elements(); ++i)
+				{
+					FEElement_& el = mesh->ElementRef(i);
+					if (ps->active(i))
 					{
-						FEElement_& el = mesh->ElementRef(i);
-						if (ps->active(i))
+						ps->eval(i, &ed);
+						for (int j = 0; j<el.Nodes(); ++j)
 						{
-							ps->eval(i, &ed);
-							for (int j = 0; j<el.Nodes(); ++j)
-							{
-								d[el.m_node[j]] += ed;
-								tag[el.m_node[j]]++;
-							}
+							d[el.m_node[j]] += ed;
+							tag[el.m_node[j]]++;
 						}
 					}
-					for (int i = 0; i<NN; ++i)
-						if (tag[i] > 0) d[i] /= (double)tag[i];
 				}
-				else if (s.GetFormat() == DATA_COMP)
-				{
-					vector<int> tag(NN, 0);
-					FEElemData_T<float, DATA_COMP>* ps = dynamic_cast<FEElemData_T<float, DATA_COMP>*>(&s);
+				for (int i = 0; i<NN; ++i)
+					if (tag[i] > 0) d[i] /= (double)tag[i];
+			}
+			else if (s.GetFormat() == DATA_COMP)
+			{
+				vector<int> tag(NN, 0);
+				Post::FEElemData_T<float, DATA_COMP>* ps = dynamic_cast<Post::FEElemData_T<float, DATA_COMP>*>(&s);
 
-					float ed[FEElement::MAX_NODES] = { 0.f };
-					for (int i = 0; i<mesh->Elements(); ++i)
+				float ed[FEElement::MAX_NODES] = { 0.f };
+				for (int i = 0; i<mesh->Elements(); ++i)
+				{
+					FEElement_& el = mesh->ElementRef(i);
+					if (ps->active(i))
 					{
-						FEElement_& el = mesh->ElementRef(i);
-						if (ps->active(i))
+						ps->eval(i, ed);
+						for (int j = 0; j<el.Nodes(); ++j)
 						{
-							ps->eval(i, ed);
-							for (int j = 0; j<el.Nodes(); ++j)
-							{
-								d[el.m_node[j]] += ed[j];
-								tag[el.m_node[j]]++;
-							}
+							d[el.m_node[j]] += ed[j];
+							tag[el.m_node[j]]++;
 						}
 					}
-					for (int i = 0; i<NN; ++i)
-						if (tag[i] > 0) d[i] /= (double)tag[i];
 				}
+				for (int i = 0; i<NN; ++i)
+					if (tag[i] > 0) d[i] /= (double)tag[i];
 			}
 		}
+	}
 
-		// now, calculate the gradient for each element
-		vector<vec3f> G(NN, vec3f(0.f, 0.f, 0.f));
-		vec3f eg[FEElement::MAX_NODES];
-		float ed[FEElement::MAX_NODES];
-		vector<int> tag(NN, 0);
-		for (int i=0; i<mesh->Elements(); ++i)
+	// now, calculate the gradient for each element
+	vector<vec3f> G(NN, vec3f(0.f, 0.f, 0.f));
+	vec3f eg[FEElement::MAX_NODES];
+	float ed[FEElement::MAX_NODES];
+	vector<int> tag(NN, 0);
+	for (int i=0; i<mesh->Elements(); ++i)
+	{
+		FEElement_& el = mesh->ElementRef(i);
+
+		for (int j = 0; j<el.Nodes(); ++j) ed[j] = d[el.m_node[j]];
+
+		for (int j=0; j<el.Nodes(); ++j)
 		{
-			FEElement_& el = mesh->ElementRef(i);
+			// get the iso-coords at the nodes
+			double q[3] = {0,0,0};
+			el.iso_coord(j, q);
 
-			for (int j = 0; j<el.Nodes(); ++j) ed[j] = d[el.m_node[j]];
+			// evaluate the gradient at the node
+			shape_grad(fem, i, q, n, eg);
 
-			for (int j=0; j<el.Nodes(); ++j)
-			{
-				// get the iso-coords at the nodes
-				double q[3] = {0,0,0};
-				el.iso_coord(j, q);
-
-				// evaluate the gradient at the node
-				shape_grad(fem, i, q, n, eg);
-
-				vec3f grad(0.f, 0.f, 0.f);
-				for (int k=0; k<el.Nodes(); ++k) grad += eg[k] * ed[k];
-				
-				G[el.m_node[j]] += grad;
-				tag[el.m_node[j]]++;
-			}
+			vec3f grad(0.f, 0.f, 0.f);
+			for (int k=0; k<el.Nodes(); ++k) grad += eg[k] * ed[k];
+			
+			G[el.m_node[j]] += grad;
+			tag[el.m_node[j]]++;
 		}
+	}
 
-		FENodeData<vec3f>* pv = dynamic_cast<FENodeData<vec3f>*>(&v);
-		for (int i = 0; i<NN; ++i)
-		{
-			if (tag[i] > 0) G[i] /= (float) tag[i];
-			(*pv)[i] = G[i];
-		}
+	Post::FENodeData<vec3f>* pv = dynamic_cast<Post::FENodeData<vec3f>*>(&v);
+	for (int i = 0; i<NN; ++i)
+	{
+		if (tag[i] > 0) G[i] /= (float) tag[i];
+		(*pv)[i] = G[i];
 	}
 
 	return true;
@@ -1240,66 +818,171 @@ void extractElemDataComponentNODE(Data_Type ntype, Post::FEMeshData& dst, Post::
 	}
 }
 
-FEDataField* Post::DataComponent(FEPostModel& fem, FEDataField* pdf, int ncomp, const std::string& sname)
+//-----------------------------------------------------------------------------
+// Extract component ncomp of field nsrc into field ndst for one state
+static bool componentState(FEPostModel& fem, int nstate, int ndst, int nsrc, int ncomp)
 {
-	if (pdf == 0) return 0;
+	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
+	Post::FEState* state = fem.GetState(nstate);
+	Post::FEMeshData& dst = state->m_Data[FIELD_CODE(ndst)];
+	Post::FEMeshData& src = state->m_Data[FIELD_CODE(nsrc)];
+	Data_Type ntype = src.GetType();
 
-	int nclass = pdf->DataClass();
-	Data_Type ntype = pdf->Type();
-	int nfmt = pdf->Format();
+	if (IS_NODE_FIELD(nsrc))
+	{
+		extractNodeDataComponent(ntype, dst, src, ncomp, mesh);
+	}
+	else if (IS_ELEM_FIELD(nsrc))
+	{
+		if      (src.GetFormat() == DATA_ITEM) extractElemDataComponentITEM(ntype, dst, src, ncomp, mesh);
+		else if (src.GetFormat() == DATA_NODE) extractElemDataComponentNODE(ntype, dst, src, ncomp, mesh);
+		else return false;
+	}
+	else return false;
 
-	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
+	return true;
+}
 
-	FEDataField* newField = 0;
-	if (nclass == CLASS_NODE)
+//-----------------------------------------------------------------------------
+void DataFilterChain::AddComponent(int ndst, int nsrc, int ncomp)
+{
+	m_filter.push_back([=](FEPostModel& fem, int n) { return componentState(fem, n, ndst, nsrc, ncomp); });
+}
+
+void DataFilterChain::AddScale(int nfield, double scale)
+{
+	m_filter.push_back([=](FEPostModel& fem, int n) { return scaleState(fem, n, nfield, scale); });
+}
+
+void DataFilterChain::AddScaleVec3(int nfield, vec3d scale)
+{
+	vec3f s = to_vec3f(scale);
+	m_filter.push_back([=](FEPostModel& fem, int n) { return scaleVec3State(fem, n, nfield, s); });
+}
+
+void DataFilterChain::AddSmooth(int nfield, double theta, int niters)
+{
+	m_filter.push_back([=](FEPostModel& fem, int n) { return smoothState(fem, n, nfield, theta, niters); });
+}
+
+void DataFilterChain::AddArithmetic(int nfield, int nop, int noperand)
+{
+	m_filter.push_back([=](FEPostModel& fem, int n) { return arithmeticState(fem, n, nfield, nop, noperand); });
+}
+
+void DataFilterChain::AddGradient(int vecField, int sclField)
+{
+	m_filter.push_back([=](FEPostModel& fem, int n) { return gradientState(fem, n, vecField, sclField); });
+}
+
+//-----------------------------------------------------------------------------
+// Calls f(n) for all states. The states are processed in parallel, in batches, so
+// that the model can move the data of states that are done to its scratch file
+// when there is a memory limit.
+template <class F> static void forEachState(FEPostModel& fem, F f)
+{
+	int NS = fem.GetStates();
+	int batch = fem.StateBatchSize();
+	for (int n0 = 0; n0 < NS; n0 += batch)
 	{
-		newField = new FEDataField_T<FENodeData<float> >(&fem);
-		fem.AddDataField(newField, sname);
+		int n1 = (n0 + batch < NS ? n0 + batch : NS);
+		parallel_for(n0, n1, f);
+		fem.TrimMemory();
+	}
+}
 
-		int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
-		int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
+//-----------------------------------------------------------------------------
+// Each state runs through all the filters before the next state is processed,
+// so its data is only loaded once.
+bool DataFilterChain::Apply(FEPostModel& fem)
+{
+	int NS = fem.GetStates();
+	vector<char> ok(NS, 1);
 
-		for (int n=0; n<fem.GetStates(); ++n)
+	forEachState(fem, [&](int n) {
+		for (auto& f : m_filter)
 		{
-			FEState* state = fem.GetState(n);
-			extractNodeDataComponent(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
+			if (f(fem, n) == false) { ok[n] = 0; break; }
 		}
-	}
-	else if (nclass == CLASS_FACE)
+	});
+
+	for (int n = 0; n < NS; ++n) if (ok[n] == 0) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool Post::DataScale(FEPostModel& fem, int nfield, double scale)
+{
+	DataFilterChain flt;
+	flt.AddScale(nfield, scale);
+	return flt.Apply(fem);
+}
+
+//-----------------------------------------------------------------------------
+bool Post::DataScaleVec3(FEPostModel& fem, int nfield, vec3d scale)
+{
+	DataFilterChain flt;
+	flt.AddScaleVec3(nfield, scale);
+	return flt.Apply(fem);
+}
+
+//-----------------------------------------------------------------------------
+// Apply a smoothing operation on data
+bool Post::DataSmooth(FEPostModel& fem, int nfield, double theta, int niters)
+{
+	DataFilterChain flt;
+	flt.AddSmooth(nfield, theta, niters);
+	return flt.Apply(fem);
+}
+
+//-----------------------------------------------------------------------------
+bool Post::DataArithmetic(FEPostModel& fem, int nfield, int nop, int noperand)
+{
+	DataFilterChain flt;
+	flt.AddArithmetic(nfield, nop, noperand);
+	return flt.Apply(fem);
+}
+
+//-----------------------------------------------------------------------------
+bool Post::DataGradient(FEPostModel& fem, int vecField, int sclField)
+{
+	DataFilterChain flt;
+	flt.AddGradient(vecField, sclField);
+	return flt.Apply(fem);
+}
+
+//-----------------------------------------------------------------------------
+FEDataField* Post::DataComponentField(FEPostModel& fem, FEDataField* pdf, const std::string& sname)
+{
+	if (pdf == 0) return 0;
+
+	int nclass = pdf->DataClass();
+	int nfmt = pdf->Format();
+
+	FEDataField* newField = 0;
+	if (nclass == CLASS_NODE)
 	{
-		
+		newField = new FEDataField_T<FENodeData<float> >(&fem);
 	}
 	else if (nclass == CLASS_ELEM)
 	{
-		if (nfmt == DATA_ITEM)
-		{
-			newField = new FEDataField_T<FEElementData<float, DATA_ITEM> >(&fem);
-			fem.AddDataField(newField, sname);
+		if      (nfmt == DATA_ITEM) newField = new FEDataField_T<FEElementData<float, DATA_ITEM> >(&fem);
+		else if (nfmt == DATA_NODE) newField = new FEDataField_T<FEElementData<float, DATA_NODE> >(&fem);
+	}
 
-			int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
-			int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
+	if (newField) fem.AddDataField(newField, sname);
+	return newField;
+}
 
-			for (int n = 0; n<fem.GetStates(); ++n)
-			{
-				FEState* state = fem.GetState(n);
-				extractElemDataComponentITEM(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
-			}
-		}
-		else if (nfmt == DATA_NODE)
-		{
-			newField = new FEDataField_T<FEElementData<float, DATA_NODE> >(&fem);
-			fem.AddDataField(newField, sname);
+//-----------------------------------------------------------------------------
+FEDataField* Post::DataComponent(FEPostModel& fem, FEDataField* pdf, int ncomp, const std::string& sname)
+{
+	FEDataField* newField = DataComponentField(fem, pdf, sname);
+	if (newField == 0) return 0;
 
-			int nvec = pdf->GetFieldID(); nvec = FIELD_CODE(nvec);
-			int nscl = newField->GetFieldID(); nscl = FIELD_CODE(nscl);
-
-			for (int n = 0; n<fem.GetStates(); ++n)
-			{
-				FEState* state = fem.GetState(n);
-				extractElemDataComponentNODE(ntype, state->m_Data[nscl], state->m_Data[nvec], ncomp, mesh);
-			}
-		}
-	}
+	DataFilterChain flt;
+	flt.AddComponent(newField->GetFieldID(), pdf->GetFieldID(), ncomp);
+	flt.Apply(fem);
 
 	return newField;
 }
@@ -1311,9 +994,10 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 	int ntns = FIELD_CODE(tensorField);
 	int nscl = FIELD_CODE(scalarField);
 
-	// loop over all the states
-	for (int n = 0; n<fem.GetStates(); ++n)
-	{
+	int NS = fem.GetStates();
+	vector<char> ok(NS, 1);
+
+	forEachState(fem, [&](int n) {
 		FEState& state = *fem.GetState(n);
 		FEMeshData& v = state.m_Data[ntns];
 		FEMeshData& s = state.m_Data[nscl];
@@ -1326,7 +1010,7 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 			int N = ps->size();
 			for (int i = 0; i < N; ++i) (*ps)[i] = 0.f;
 		}
-		else return false;
+		else { ok[n] = 0; return; }
 
 		// get the mesh
 		Post::FEPostMesh* mesh = state.GetFEMesh();
@@ -1351,8 +1035,9 @@ bool Post::DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tens
 				}
 			}
 		}
-	}
+	});
 
+	for (int n = 0; n < NS; ++n) if (ok[n] == 0) return false;
 	return true;
 }
 
@@ -1387,8 +1072,7 @@ FEDataField* Post::DataConvert(FEPostModel& fem, FEDataField* dataField, int new
 				int NN = mesh.Nodes();
 				int NE = mesh.Elements();
 
-				for (int n = 0; n < fem.GetStates(); ++n)
-				{
+				forEachState(fem, [&](int n) {
 					FEState* state = fem.GetState(n);
 
 					vector<float> data(NN, 0.f);
@@ -1432,7 +1116,7 @@ FEDataField* Post::DataConvert(FEPostModel& fem, FEDataField* dataField, int new
 						}
 						pnew->add(d, e, l, el.Nodes());
 					}
-				}
+				});
 			}
 		}
 		else if (nfmt == DATA_NODE)
@@ -1448,8 +1132,7 @@ FEDataField* Post::DataConvert(FEPostModel& fem, FEDataField* dataField, int new
 				int NN = mesh.Nodes();
 				int NE = mesh.Elements();
 
-				for (int n = 0; n < fem.GetStates(); ++n)
-				{
+				forEachState(fem, [&](int n) {
 					FEState* state = fem.GetState(n);
 
 					FEElemData_T<float, DATA_NODE>* pold = dynamic_cast<FEElemData_T<float, DATA_NODE>*>(&state->m_Data[nold]);
@@ -1472,7 +1155,7 @@ FEDataField* Post::DataConvert(FEPostModel& fem, FEDataField* dataField, int new
 							pnew->add(i, avg);
 						}
 					}
-				}
+				});
 			}
 		}
 	}
@@ -1499,8 +1182,7 @@ FEDataField* Post::DataEigenTensor(FEPostModel& fem, FEDataField* dataField, con
 	Post::FEPostMesh& mesh = *fem.GetFEMesh(0);
 	int NE = mesh.Elements();
 
-	for (int n = 0; n < fem.GetStates(); ++n)
-	{
+	forEachState(fem, [&](int n) {
 		FEState* state = fem.GetState(n);
 
 		FEElemData_T<mat3fs, DATA_ITEM>* pold = dynamic_cast<FEElemData_T<mat3fs, DATA_ITEM>*>(&state->m_Data[nold]);
@@ -1524,7 +1206,7 @@ FEDataField* Post::DataEigenTensor(FEPostModel& fem, FEDataField* dataField, con
 				pnew->add(i, a);
 			}
 		}
-	}
+	});
 
 	return newField;
 }
@@ -1550,8 +1232,8 @@ FEDataField* Post::DataTimeRate(FEPostModel& fem, FEDataField* dataField, const
 			int nold = dataField->GetFieldID(); nold = FIELD_CODE(nold);
 			int nnew = newField->GetFieldID(); nnew = FIELD_CODE(nnew);
 
-			for (int n = 0; n < fem.GetStates(); ++n)
-			{
+			// each state only depends on the source data, so the states are processed in parallel
+			forEachState(fem, [&](int n) {
 				Post::FENodeData<float>& vt = dynamic_cast<FENodeData<float>&>(fem.GetState(n)->m_Data[nnew]);
 				if (n == 0)
 				{
@@ -1582,7 +1264,7 @@ FEDataField* Post::DataTimeRate(FEPostModel& fem, FEDataField* dataField, const
 						vt[i] = dvdt;
 					}
 				}
-			}
+			});
 		}
 		else if (ntype == DATA_VEC3F)
 		{
@@ -1592,8 +1274,8 @@ FEDataField* Post::DataTimeRate(FEPostModel& fem, FEDataField* dataField, const
 			int nold = dataField->GetFieldID(); nold = FIELD_CODE(nold);
 			int nnew = newField->GetFieldID(); nnew = FIELD_CODE(nnew);
 
-			for (int n = 0; n < fem.GetStates(); ++n)
-			{
+			// each state only depends on the source data, so the states are processed in parallel
+			forEachState(fem, [&](int n) {
 				Post::FENodeData<vec3f>& vt = dynamic_cast<FENodeData<vec3f>&>(fem.GetState(n)->m_Data[nnew]);
 				if (n == 0)
 				{
@@ -1624,7 +1306,7 @@ FEDataField* Post::DataTimeRate(FEPostModel& fem, FEDataField* dataField, const
 						vt[i] = dvdt;
 					}
 				}
-			}
+			});
 		}
 	}
 
@@ -26,6 +26,8 @@ SOFTWARE.*/
 
 #pragma once
 #include <string>
+#include <vector>
+#include <functional>
 #include <MathLib/math3d.h>
 
 namespace Post {
@@ -61,6 +63,36 @@ bool DataFractionalAnsisotropy(FEPostModel& fem, int scalarField, int tensorFiel
 // Extract a component from a data field
 FEDataField* DataComponent(FEPostModel& fem, FEDataField* dataField, int ncomp, const std::string& sname);
 
+// Create the (empty) scalar field that stores a component of a data field
+FEDataField* DataComponentField(FEPostModel& fem, FEDataField* dataField, const std::string& sname);
+
+//-----------------------------------------------------------------------------
+// A chain of filters that is applied in one pass over the states. All filters
+// are applied to a state before moving on to the next, and the states are
+// processed in parallel. For instance, component -> scale -> smooth:
+//   FEDataField* pdf = DataComponentField(fem, src, name);
+//   DataFilterChain flt;
+//   flt.AddComponent(pdf->GetFieldID(), src->GetFieldID(), ncomp);
+//   flt.AddScale(pdf->GetFieldID(), scale);
+//   flt.AddSmooth(pdf->GetFieldID(), theta, niters);
+//   flt.Apply(fem);
+class DataFilterChain
+{
+public:
+	void AddComponent(int ndst, int nsrc, int ncomp);
+	void AddScale(int nfield, double scale);
+	void AddScaleVec3(int nfield, vec3d scale);
+	void AddSmooth(int nfield, double theta, int niters);
+	void AddArithmetic(int nfield, int nop, int noperand);
+	void AddGradient(int vecField, int sclField);
+
+	// apply the filters to all states. Returns false if a filter failed.
+	bool Apply(FEPostModel& fem);
+
+private:
+	std::vector<std::function<bool(FEPostModel& fem, int nstate)> >	m_filter;
+};
+
 //-----------------------------------------------------------------------------
 // convert between formats
 FEDataField* DataConvert(FEPostModel& fem, FEDataField* dataField, int newFormat, const std::string& name);
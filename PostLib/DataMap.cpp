@@ -27,6 +27,7 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "DataMap.h"
 #include "FEPostMesh.h"
+#include "FEPostModel.h"
 #include <assert.h>
 using namespace Post;
 
@@ -168,3 +169,67 @@ void VectorMap::Gradient(int ntime, std::vector<float> &v)
 	}
 }
 
+
+//-----------------------------------------------------------------------------
+VectorFieldMap::VectorFieldMap(FEPostModel* fem, int nfield, bool nodal) : m_fem(fem), m_nfield(nfield), m_nodal(nodal)
+{
+}
+
+//-----------------------------------------------------------------------------
+void VectorFieldMap::Update(int n0, int n1)
+{
+	// (re)allocate when the number of states changed
+	int NS = m_fem->GetStates();
+	if (States() != NS)
+	{
+		// the meshes may differ between states, so we pick the max number of items
+		int NM = 0;
+		for (int i = 0; i < NS; ++i)
+		{
+			FEPostMesh* pm = m_fem->GetState(i)->GetFEMesh();
+			int N = (m_nodal ? pm->Nodes() : pm->Elements());
+			if (N > NM) NM = N;
+		}
+		Create(NS, NM, vec3f(0, 0, 0), -1);
+		m_rng.assign(NS, vec2f(0, 1));
+	}
+	if (n0 < 0) n0 = 0;
+	if (n1 >= NS) n1 = NS - 1;
+	if (n1 < n0) return;
+
+	// find the states that need to be evaluated
+	vector<int> states;
+	for (int n = n0; n <= n1; ++n) if (m_tag[n] != 1) states.push_back(n);
+	if (states.empty()) return;
+
+	// evaluate the field
+	FEPostModel* fem = m_fem;
+	int nfield = m_nfield;
+	if (m_nodal)
+	{
+		Fill(n0, n1, 1, [=](int n, int i) {
+			FEPostMesh* pm = fem->GetState(n)->GetFEMesh();
+			return (i < pm->Nodes() ? fem->EvaluateNodeVector(i, n, nfield) : vec3f(0, 0, 0));
+		});
+	}
+	else
+	{
+		Fill(n0, n1, 1, [=](int n, int i) {
+			FEPostMesh* pm = fem->GetState(n)->GetFEMesh();
+			return (i < pm->Elements() ? fem->EvaluateElemVector(i, n, nfield) : vec3f(0, 0, 0));
+		});
+	}
+
+	// update the ranges
+	for (int n : states)
+	{
+		const vector<vec3f>& d = m_Data[n];
+		float L = parallel_reduce(0, (int)d.size(), 0.f,
+			[&](int i) { return d[i].Length(); },
+			[](float a, float b) { return (a > b ? a : b); });
+
+		vec2f& rng = m_rng[n];
+		rng.x = 0.f; rng.y = L;
+		if (rng.y == rng.x) ++rng.y;
+	}
+}
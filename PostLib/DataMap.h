@@ -26,11 +26,14 @@ SOFTWARE.*/
 
 #pragma once
 #include <MathLib/math3d.h>
+#include <FSCore/FSThreadPool.h>
 #include <vector>
+#include <memory>
 //using namespace std;
 
 namespace Post {
 class FEPostMesh;
+class FEPostModel;
 
 //-----------------------------------------------------------------------------
 template <typename T>
@@ -58,6 +61,20 @@ public:
 
 	void Clear() { m_Data.clear(); m_tag.clear(); }
 
+	// Sets the values of all states in [n0, n1] whose tag is not ntag to f(n, i),
+	// where n is the state and i the item, and tags these states.
+	// The items of a state are evaluated in parallel, so f must not modify the model.
+	template <class F> void Fill(int n0, int n1, int ntag, F f)
+	{
+		for (int n = n0; n <= n1; ++n)
+		{
+			if (m_tag[n] == ntag) continue;
+			vector<T>& d = m_Data[n];
+			parallel_for(0, (int)d.size(), [&](int i) { d[i] = f(n, i); });
+			m_tag[n] = ntag;
+		}
+	}
+
 	void SetFEMesh(FEPostMesh* pm) { m_pmesh = pm; }
 
 protected:
@@ -73,4 +90,31 @@ public:
 	// calculate the data gradient
 	void Gradient(int ntime, vector<float>& v);
 };
+
+//-----------------------------------------------------------------------------
+// Values of a vector field of all states, together with the range of the vector 
+// lengths of each state. Plots of the same field share this map (see CGLModel::GetVectorFieldMap).
+class VectorFieldMap : public DataMap<vec3f>
+{
+public:
+	VectorFieldMap(FEPostModel* fem, int nfield, bool nodal);
+
+	int Field() const { return m_nfield; }
+	bool IsNodal() const { return m_nodal; }
+
+	// evaluate the states in [n0, n1] that were not evaluated yet
+	void Update(int n0, int n1);
+
+	// range of vector lengths of state n
+	const vec2f& Range(int n) const { return m_rng[n]; }
+
+	// forces the re-evaluation of all states
+	void Invalidate() { SetTags(-1); }
+
+private:
+	FEPostModel*	m_fem;
+	int				m_nfield;
+	bool			m_nodal;	// evaluate at nodes (or elements)
+	vector<vec2f>	m_rng;
+};
 }
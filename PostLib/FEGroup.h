@@ -68,6 +68,7 @@ public:
 
 	int Elements() { return (int) m_Elem.size(); }
 	FEElement_& Element(int n);
+	int ElementIndex(int n) const { return m_Elem[n]; }
 
 	void Reserve(int nelems, int nfaces);
 
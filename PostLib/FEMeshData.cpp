@@ -28,6 +28,7 @@ SOFTWARE.*/
 #include "FEDataManager.h"
 #include "FEPostModel.h"
 #include "FEPointCongruency.h"
+#include "FEStateStore.h"
 #include <MeshLib/MeshMetrics.h>
 
 using namespace Post;
@@ -50,10 +51,25 @@ FEPostModel* Post::FEMeshData::GetFEModel()
 // FEMeshDataList
 //-----------------------------------------------------------------------------
 
+FEMeshDataList::FEMeshDataList() : m_spilled(false), m_touched(true), m_invalid(false)
+{
+	m_store = nullptr;
+	m_slot = -1;
+	m_lastUse = 0;
+	m_memSize = 0;
+}
+
 void FEMeshDataList::clear()
 {
+	if (m_store) m_store->Release(*this);
 	for (int i=0; i<(int) m_data.size(); ++i) delete m_data[i];
 	m_data.clear();
+	m_invalid = false;
+}
+
+void FEMeshDataList::Restore()
+{
+	if (m_store) m_store->Restore(*this);
 }
 
 //-----------------------------------------------------------------------------
@@ -26,6 +26,8 @@ SOFTWARE.*/
 
 #pragma once
 #include <vector>
+#include <atomic>
+#include <string.h>
 #include <MathLib/math3d.h>
 //using namespace std;
 
@@ -34,6 +36,7 @@ namespace Post {
 class FEPostModel;
 class FEState;
 class FEPostMesh;
+class FEStateStore;
 
 //-----------------------------------------------------------------------------
 // Data class: defines possible class types for data fields
@@ -105,33 +108,105 @@ public:
 
 	FEPostModel* GetFEModel();
 
+public:
+	// Out-of-core storage (see FEStateStore). Classes that store their values
+	// return the size of their arrays, append the arrays to a buffer and release
+	// them in Spill, and read them back in Restore.
+	virtual size_t MemorySize() const { return 0; }
+	virtual void Spill(std::vector<char>& buf) {}
+	virtual void Restore(const char*& buf) {}
+
 protected:
 	FEState*	m_state;
 	Data_Type	m_ntype;
 	Data_Format	m_nfmt;
 };
 
+//-----------------------------------------------------------------------------
+// helper functions for implementing FEMeshData::MemorySize, Spill and Restore
+inline size_t vectors_size() { return 0; }
+template <typename T, typename ... R> size_t vectors_size(const std::vector<T>& v, const R& ... r)
+{
+	return v.size()*sizeof(T) + vectors_size(r...);
+}
+
+inline void spill_vectors(std::vector<char>& buf) {}
+template <typename T, typename ... R> void spill_vectors(std::vector<char>& buf, std::vector<T>& v, R& ... r)
+{
+	// each array is stored as its length and item size, followed by the items
+	size_t h[2] = { v.size(), sizeof(T) }, n = v.size(), m = buf.size();
+	buf.resize(m + sizeof(h) + n*sizeof(T));
+	memcpy(&buf[m], h, sizeof(h));
+	if (n) memcpy(&buf[m + sizeof(h)], v.data(), n*sizeof(T));
+	std::vector<T>().swap(v);
+	spill_vectors(buf, r...);
+}
+
+inline void restore_vectors(const char*& buf) {}
+template <typename T, typename ... R> void restore_vectors(const char*& buf, std::vector<T>& v, R& ... r)
+{
+	size_t h[2];
+	memcpy(h, buf, sizeof(h)); buf += sizeof(h);
+	size_t n = h[0];
+	v.resize(n);
+	if (n) memcpy(v.data(), buf, n*sizeof(T));
+	buf += n*sizeof(T);
+	restore_vectors(buf, r...);
+}
+
 //-----------------------------------------------------------------------------
 //! This class helps managing lists of FEMeshData classes
-//!
+//! The data of a list can be moved to the state store of the model. It is read
+//! back the next time one of its items is accessed. If that fails, the list is
+//! marked invalid and the store restores the arrays filled with zeros, so the
+//! items are never handed out with emptied arrays.
 class FEMeshDataList
 {
 public:
-	FEMeshDataList(){}
+	FEMeshDataList();
 	~FEMeshDataList() { clear(); }
 
-	FEMeshData& operator [] (int i) { return *m_data[i]; }
+	FEMeshData& operator [] (int i)
+	{
+		if (m_spilled.load(std::memory_order_acquire)) Restore();
+		if (m_touched.load(std::memory_order_relaxed) == false) m_touched.store(true, std::memory_order_relaxed);
+		return *m_data[i];
+	}
 
-	void push_back(FEMeshData* pd) { m_data.push_back(pd); }
+	void push_back(FEMeshData* pd) { if (m_spilled) Restore(); m_touched = true; m_data.push_back(pd); }
 
 	void clear();
 
 	int size() { return (int) m_data.size(); }
 
-	void erase(int i) { m_data.erase(m_data.begin() + i); }
+	void erase(int i) { if (m_spilled) Restore(); m_touched = true; m_data.erase(m_data.begin() + i); }
+
+	bool IsSpilled() const { return m_spilled; }
+
+	// false if the data could not be read back from the store
+	bool IsValid() const { return (m_invalid == false); }
+
+	// Make sure the data is in memory. Returns false if the list is invalid.
+	bool Load() { if (m_spilled.load(std::memory_order_acquire)) Restore(); return IsValid(); }
+
+private:
+	// read the data back from the store. This always leaves the arrays allocated.
+	void Restore();
 
 protected:
 	vector<FEMeshData*>		m_data;
+
+private:
+	// out-of-core storage, managed by FEStateStore
+	std::atomic<bool>	m_spilled;	// data is in the store
+	std::atomic<bool>	m_touched;	// data was accessed since the last trim of the store
+	std::atomic<bool>	m_invalid;	// data could not be read back from the store
+	FEStateStore*		m_store;	// store that holds the data
+	int					m_slot;		// slot in the store
+	unsigned int		m_lastUse;	// store epoch of the last access
+	size_t				m_memSize;	// memory size of the data, when last measured
+
+	friend class FEStateStore;
 };
 
 //-----------------------------------------------------------------------------
@@ -76,6 +76,10 @@ public:
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data); }
+
 protected:
 	vector<T>	m_data;
 };
@@ -98,6 +102,10 @@ public:
 		m_data = data;
 	}
 
+	size_t MemorySize() const { return vectors_size(m_data); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data); }
+
 protected:
 	int				m_stride;
 	vector<float>	m_data;	
@@ -163,6 +171,10 @@ public:
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_face); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_face); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_face); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_face;
@@ -200,6 +212,10 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_face); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_face); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_face); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_face;
@@ -237,6 +253,10 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_face); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_face); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_face); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_face;
@@ -280,6 +300,10 @@ public:
 	int size() const { return (int)m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_face, m_indx); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_face, m_indx); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_face, m_indx); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_face;
@@ -335,6 +359,10 @@ public:
 		}
 	}
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem); }
+
 protected:
 	int				m_stride;
 	vector<float>	m_data;
@@ -375,6 +403,10 @@ public:
 		}
 	}
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem, m_indx); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem, m_indx); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem, m_indx); }
+
 protected:
 	int m_stride;
 	vector<float>	m_data;
@@ -422,6 +454,10 @@ public:
 		}
 	}
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem); }
+
 protected:
 	int				m_stride;
 	vector<float>	m_data;
@@ -472,6 +508,10 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_elem;
@@ -517,6 +557,10 @@ public:
 	int size() const { return (int) m_data.size(); }
 	T& operator [] (int n) { return m_data[n]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_elem;
@@ -555,6 +599,10 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_elem;
@@ -601,6 +649,10 @@ public:
 	int size() { return (int) m_data.size(); }
 	T& operator [] (int i) { return m_data[i]; }
 
+	size_t MemorySize() const { return vectors_size(m_data, m_elem, m_indx); }
+	void Spill(std::vector<char>& buf) { spill_vectors(buf, m_data, m_elem, m_indx); }
+	void Restore(const char*& buf) { restore_vectors(buf, m_data, m_elem, m_indx); }
+
 protected:
 	vector<T>		m_data;
 	vector<int>		m_elem;
@@ -33,6 +33,8 @@ SOFTWARE.*/
 #include "FEDataManager.h"
 #include "constants.h"
 #include "FEMeshData_T.h"
+#include "FEStateStore.h"
+#include <FSCore/FSThreadPool.h>
 #include <stdio.h>
 
 extern int ET_HEX[12][2];
@@ -40,6 +42,7 @@ extern int ET_HEX[12][2];
 namespace Post {
 
 FEPostModel* FEPostModel::m_pThis = 0;
+size_t FEPostModel::m_defaultMemLimit = 0;
 
 FEPostModel::PlotObject::PlotObject() 
 { 
@@ -65,6 +68,8 @@ FEPostModel::FEPostModel()
 {
 	m_ndisp = 0;
 	m_pDM = new FEDataManager(this);
+	m_store = new FEStateStore;
+	m_store->SetMemoryLimit(m_defaultMemLimit);
 
 	m_nTime = 0;
 	m_fTime = 0.f;
@@ -78,6 +83,7 @@ FEPostModel::~FEPostModel()
 {
 	Clear();
 	delete m_pDM;
+	delete m_store;
 	if (m_pThis == this) m_pThis = 0;
 
 	DeleteMeshes();
@@ -242,15 +248,70 @@ void FEPostModel::ClearStates()
 {
 	for (int i=0; i<(int) m_State.size(); i++) delete m_State[i];
 	m_State.clear();
+	m_store->Reset();
 	m_nTime = 0;
 }
 
+//-----------------------------------------------------------------------------
+void FEPostModel::SetMemoryLimit(size_t bytes)
+{
+	m_store->SetMemoryLimit(bytes);
+	TrimMemory();
+}
+
+//-----------------------------------------------------------------------------
+size_t FEPostModel::GetMemoryLimit() const
+{
+	return m_store->GetMemoryLimit();
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::SetDefaultMemoryLimit(size_t bytes)
+{
+	m_defaultMemLimit = bytes;
+}
+
+//-----------------------------------------------------------------------------
+size_t FEPostModel::GetDefaultMemoryLimit()
+{
+	return m_defaultMemLimit;
+}
+
+//-----------------------------------------------------------------------------
+void FEPostModel::TrimMemory()
+{
+	m_store->Trim(*this, m_nTime);
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::StateBatchSize()
+{
+	if (m_store->GetMemoryLimit() == 0) return (GetStates() > 0 ? GetStates() : 1);
+	return 2 * FSThreadPool::Instance().Threads();
+}
+
+//-----------------------------------------------------------------------------
+bool FEPostModel::IsStateValid(int nstate)
+{
+	if ((nstate < 0) || (nstate >= GetStates())) return false;
+	return m_State[nstate]->m_Data.Load();
+}
+
+//-----------------------------------------------------------------------------
+int FEPostModel::TakeStateDataErrors()
+{
+	return m_store->TakeErrors();
+}
+
 //-----------------------------------------------------------------------------
 void FEPostModel::AddState(FEState* pFEState)
 {
 	pFEState->SetID((int) m_State.size());
 	pFEState->m_ref = m_RefState[m_RefState.size() - 1];
 	m_State.push_back(pFEState); 
+
+	// the states of large models may not fit in memory while the file is read
+	TrimMemory();
 }
 
 //-----------------------------------------------------------------------------
@@ -349,8 +410,11 @@ FEDataField* FEPostModel::CopyDataField(FEDataField* pd, const char* sznewname)
 	int nsrc = FIELD_CODE(pd    ->GetFieldID());
 
 	int nstates = GetStates();
+	int batch = StateBatchSize();
 	for (int i=0; i<nstates; ++i)
 	{
+		if ((i > 0) && (i % batch == 0)) TrimMemory();
+
 		FEState& state = *GetState(i);
 		FEMeshDataList& DL = state.m_Data;
 
@@ -690,8 +754,11 @@ FEDataField* FEPostModel::CreateCachedCopy(FEDataField* pd, const char* sznewnam
 	// loop over all the states
 	FEPostMesh& mesh = *GetFEMesh(0);
 	int nstates = GetStates();
+	int batch = StateBatchSize();
 	for (int i = 0; i<nstates; ++i)
 	{
+		if ((i > 0) && (i % batch == 0)) TrimMemory();
+
 		FEState& state = *GetState(i);
 		FEMeshDataList& DL = state.m_Data;
 
@@ -808,10 +875,12 @@ void FEPostModel::DeleteDataField(FEDataField* pd)
 
 	// remove this field from all states
 	int NS = GetStates();
+	int batch = StateBatchSize();
 	for (int i=0; i<NS; ++i)
 	{
 		FEState* ps = GetState(i);
 		ps->m_Data.erase(m);
+		if ((i + 1) % batch == 0) TrimMemory();
 	}
 	m_pDM->DeleteDataField(pd);
 
@@ -827,10 +896,13 @@ void FEPostModel::AddDataField(FEDataField* pd, const std::string& name)
 	m_pDM->AddDataField(pd, name);
 
 	// now add new data for each of the states
-	vector<FEState*>::iterator it;
-	for (it=m_State.begin(); it != m_State.end(); ++it)
+	int NS = GetStates();
+	int batch = StateBatchSize();
+	for (int i=0; i<NS; ++i)
 	{
-		(*it)->m_Data.push_back(pd->CreateData(*it));
+		FEState* ps = GetState(i);
+		ps->m_Data.push_back(pd->CreateData(ps));
+		if ((i + 1) % batch == 0) TrimMemory();
 	}
 
 	// update all dependants
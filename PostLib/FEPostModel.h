@@ -37,6 +37,8 @@ SOFTWARE.*/
 
 namespace Post {
 
+class FEStateStore;
+
 //-----------------------------------------------------------------------------
 class MetaData
 {
@@ -200,6 +202,32 @@ public:
 	// Clear all states
 	void ClearStates();
 
+	// --- M E M O R Y ---
+	//! Set the memory limit of the state data (in bytes, zero means no limit).
+	//! Data of states beyond this limit is moved to a compressed scratch file.
+	void SetMemoryLimit(size_t bytes);
+	size_t GetMemoryLimit() const;
+
+	//! Move the least recently used states to the scratch file until the state data
+	//! fits in the memory limit. This may only be called when no state data is in use.
+	void TrimMemory();
+
+	//! number of states that should be processed between two calls to TrimMemory
+	int StateBatchSize();
+
+	//! Returns the number of states whose data could not be read back from the scratch
+	//! file since the last call. Those states are invalid (see IsStateValid).
+	int TakeStateDataErrors();
+
+	//! Makes sure the data of a state is in memory. Returns false if the data could not
+	//! be read back from the scratch file. The state is invalid then and its values
+	//! (which are zero) should not be shown.
+	bool IsStateValid(int nstate);
+
+	//! memory limit of new models
+	static void SetDefaultMemoryLimit(size_t bytes);
+	static size_t GetDefaultMemoryLimit();
+
 	// --- E V A L U A T I O N ---
 	bool Evaluate(int nfield, int ntime, bool breset = false);
 
@@ -215,6 +243,11 @@ public:
 	// evaluate based on point
 	void EvaluateNode(const vec3f& r, int ntime, int nfield, NODEDATA& d);
 
+	// Evaluates the time histories of field nfield of a list of nodes, faces or elements
+	// (itemClass = CLASS_NODE, CLASS_FACE, CLASS_ELEM) for the states n0 to n1.
+	// The value of item i at state n0 + j is stored in val[i*(n1 - n0 + 1) + j].
+	bool EvaluateTimeHistory(const vector<int>& items, int itemClass, int nfield, int n0, int n1, vector<float>& val);
+
 	// evaluate vector functions
 	vec3f EvaluateNodeVector(int n, int ntime, int nvec);
 	bool EvaluateFaceVector(int n, int ntime, int nvec, vec3f& r);
@@ -303,11 +336,13 @@ protected:
 	// --- S T A T E ---
 	vector<FEState*>	m_State;	// array of pointers to FE-state structures
 	FEDataManager*		m_pDM;		// the Data Manager
+	FEStateStore*		m_store;	// out-of-core storage of the state data
 	int					m_ndisp;	// vector field defining the displacement
 
 	// dependants
 	vector<FEModelDependant*>	m_Dependants;
 
 	static FEPostModel*	m_pThis;
+	static size_t		m_defaultMemLimit;
 };
 } // namespace Post
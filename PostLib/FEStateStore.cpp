@@ -0,0 +1,282 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "FEStateStore.h"
+#include "FEPostModel.h"
+#include <zlib.h>
+#include <algorithm>
+#include <assert.h>
+
+#ifdef WIN32
+#define fseek64(a,b,c) _fseeki64(a,b,c)
+#endif
+
+#ifdef LINUX // same for Linux and Mac OS X
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#ifdef __APPLE__ // same for Linux and Mac OS X
+#define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+using namespace Post;
+
+FEStateStore::FEStateStore()
+{
+	m_fp = nullptr;
+	m_fileSize = 0;
+	m_maxMem = 0;
+	m_memUsage = 0;
+	m_epoch = 0;
+	m_failed = false;
+	m_errors = 0;
+}
+
+FEStateStore::~FEStateStore()
+{
+	if (m_fp) fclose(m_fp);
+}
+
+void FEStateStore::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_fp) fclose(m_fp);
+	m_fp = nullptr;
+	m_fileSize = 0;
+	m_slot.clear();
+	m_memUsage = 0;
+	m_failed = false;
+	m_errors = 0;
+	std::vector<char>().swap(m_buf);
+	std::vector<char>().swap(m_zbuf);
+}
+
+int FEStateStore::TakeErrors()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int n = m_errors;
+	m_errors = 0;
+	return n;
+}
+
+void FEStateStore::Trim(FEPostModel& fem, int nkeep)
+{
+	if ((m_maxMem == 0) || m_failed) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// update the memory size and last use of the states that were accessed
+	// since the last trim. The data of the other states has not changed.
+	size_t total = 0;
+	std::vector<std::pair<unsigned int, int> > lru;
+	int NS = fem.GetStates();
+	for (int i = 0; i < NS; ++i)
+	{
+		FEMeshDataList& L = fem.GetState(i)->m_Data;
+		if (L.m_touched)
+		{
+			L.m_touched = false;
+			L.m_lastUse = m_epoch;
+			if (L.m_spilled == false)
+			{
+				L.m_memSize = 0;
+				for (FEMeshData* pd : L.m_data) L.m_memSize += pd->MemorySize();
+			}
+		}
+
+		if (L.m_spilled == false)
+		{
+			total += L.m_memSize;
+			if ((i != nkeep) && (L.m_memSize > 0)) lru.push_back(std::make_pair(L.m_lastUse, i));
+		}
+	}
+	m_epoch++;
+	m_memUsage = total;
+
+	if (total <= m_maxMem) return;
+
+	// move the least recently used states to the scratch file
+	std::sort(lru.begin(), lru.end());
+	for (size_t i = 0; (i < lru.size()) && (total > m_maxMem); ++i)
+	{
+		FEMeshDataList& L = fem.GetState(lru[i].second)->m_Data;
+		if (Spill(L) == false) break;
+		total -= L.m_memSize;
+	}
+	m_memUsage = total;
+}
+
+bool FEStateStore::Restore(FEMeshDataList& data)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// another thread may have restored the data already
+	if (data.m_spilled.load(std::memory_order_acquire) == false) return true;
+
+	Slot& s = m_slot[data.m_slot];
+
+	// try again if the read fails, in case the error is transient
+	bool ok = false;
+	for (int i = 0; (i < 3) && (ok == false); ++i) ok = ReadSlot(s);
+
+	if (ok == false)
+	{
+		// The list is marked invalid. The arrays are restored with their original sizes,
+		// but filled with zeros, so that the items never hand out emptied arrays.
+		// The slot is not reused.
+		size_t raw = 0;
+		for (auto& a : s.layout) raw += 2*sizeof(size_t) + a.first*a.second;
+		m_buf.assign(raw, 0);
+		size_t m = 0;
+		for (auto& a : s.layout)
+		{
+			size_t h[2] = { a.first, a.second };
+			memcpy(&m_buf[m], h, sizeof(h));
+			m += sizeof(h) + a.first*a.second;
+		}
+		data.m_slot = -1;
+		data.m_invalid = true;
+		m_errors++;
+	}
+
+	const char* p = m_buf.data();
+	for (FEMeshData* pd : data.m_data) pd->Restore(p);
+
+	data.m_spilled.store(false, std::memory_order_release);
+	data.m_touched = true;
+	return ok;
+}
+
+// read the data of a slot into m_buf
+bool FEStateStore::ReadSlot(const Slot& s)
+{
+	clearerr(m_fp);
+	m_zbuf.resize(s.bytes);
+	if ((fseek64(m_fp, s.offset, SEEK_SET) != 0) || (fread(m_zbuf.data(), 1, s.bytes, m_fp) != s.bytes)) return false;
+
+	if (s.compressed == false)
+	{
+		m_buf.swap(m_zbuf);
+		return true;
+	}
+
+	m_buf.resize(s.rawSize);
+	uLongf n = (uLongf)s.rawSize;
+	return (uncompress((Bytef*)m_buf.data(), &n, (const Bytef*)m_zbuf.data(), (uLong)s.bytes) == Z_OK) && (n == s.rawSize);
+}
+
+void FEStateStore::Release(FEMeshDataList& data)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ((data.m_slot >= 0) && (data.m_slot < (int)m_slot.size())) m_slot[data.m_slot].used = false;
+	data.m_slot = -1;
+	data.m_spilled = false;
+}
+
+bool FEStateStore::Spill(FEMeshDataList& data)
+{
+	if (data.m_spilled) return true;
+
+	// the scratch file is created when it is needed for the first time
+	if (m_fp == nullptr)
+	{
+		m_fp = tmpfile();
+		if (m_fp == nullptr) return false;
+		m_fileSize = 0;
+	}
+
+	m_buf.clear();
+	for (FEMeshData* pd : data.m_data) pd->Spill(m_buf);
+	size_t raw = m_buf.size();
+
+	// remember the length and item size of the arrays (see spill_vectors)
+	std::vector<std::pair<size_t, size_t> > layout;
+	for (size_t m = 0; m < raw; )
+	{
+		size_t h[2];
+		memcpy(h, &m_buf[m], sizeof(h));
+		layout.push_back(std::make_pair(h[0], h[1]));
+		m += sizeof(h) + h[0]*h[1];
+	}
+
+	// compress the data, unless that does not make it smaller
+	uLongf zn = compressBound((uLong)raw);
+	m_zbuf.resize(zn);
+	bool compressed = (compress2((Bytef*)m_zbuf.data(), &zn, (const Bytef*)m_buf.data(), (uLong)raw, Z_BEST_SPEED) == Z_OK) && (zn < raw);
+	const char* pb = (compressed ? m_zbuf.data() : m_buf.data());
+	size_t bytes = (compressed ? (size_t)zn : raw);
+
+	// reuse the slot of this list if the data still fits
+	if ((data.m_slot >= 0) && (m_slot[data.m_slot].capacity < bytes))
+	{
+		m_slot[data.m_slot].used = false;
+		data.m_slot = -1;
+	}
+	if (data.m_slot < 0) data.m_slot = AllocSlot(bytes);
+
+	Slot& s = m_slot[data.m_slot];
+	s.bytes = bytes;
+	s.rawSize = raw;
+	s.compressed = compressed;
+	// the arrays are only released once the data is flushed to the file
+	bool ok = (fseek64(m_fp, s.offset, SEEK_SET) == 0) && (fwrite(pb, 1, bytes, m_fp) == bytes) && (fflush(m_fp) == 0) && (ferror(m_fp) == 0);
+
+	if (ok == false)
+	{
+		// put the data back, and keep all data in memory from now on
+		const char* p = m_buf.data();
+		for (FEMeshData* pd : data.m_data) pd->Restore(p);
+		m_failed = true;
+		return false;
+	}
+	s.layout.swap(layout);
+
+	data.m_store = this;
+	data.m_spilled.store(true, std::memory_order_release);
+	return true;
+}
+
+int FEStateStore::AllocSlot(size_t bytes)
+{
+	for (size_t i = 0; i < m_slot.size(); ++i)
+	{
+		Slot& s = m_slot[i];
+		if ((s.used == false) && (s.capacity >= bytes)) { s.used = true; return (int)i; }
+	}
+
+	// add some room so the slot can be reused when the data grows a little
+	Slot s;
+	s.offset = m_fileSize;
+	s.capacity = bytes + bytes / 8;
+	s.bytes = 0;
+	s.rawSize = 0;
+	s.compressed = false;
+	s.used = true;
+	m_fileSize += s.capacity;
+	m_slot.push_back(s);
+	return (int)m_slot.size() - 1;
+}
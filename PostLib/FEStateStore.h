@@ -0,0 +1,111 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include <mutex>
+
+namespace Post {
+
+class FEPostModel;
+class FEMeshDataList;
+
+//-----------------------------------------------------------------------------
+// Out-of-core storage for the data of the states of a model. When the data of
+// the states exceeds the memory limit, the data of the least recently used
+// states is compressed and moved to a scratch file. It is read back when it is
+// accessed again (see FEMeshDataList).
+// States are only moved to the store in Trim, which must be called when no
+// other thread is accessing the state data.
+class FEStateStore
+{
+	struct Slot
+	{
+		long long	offset;		// position in scratch file
+		size_t		capacity;	// space reserved in scratch file
+		size_t		bytes;		// size of the stored (compressed) data
+		size_t		rawSize;	// size of the uncompressed data
+		bool		compressed;
+		bool		used;
+		std::vector<std::pair<size_t, size_t> >	layout;	// length and item size of the stored arrays
+	};
+
+public:
+	FEStateStore();
+	~FEStateStore();
+
+	// set the memory limit of the state data (in bytes). Zero means no limit.
+	void SetMemoryLimit(size_t bytes) { m_maxMem = bytes; }
+	size_t GetMemoryLimit() const { return m_maxMem; }
+
+	// move states to the scratch file until the state data fits in the memory
+	// limit. The state with index nkeep is never moved.
+	void Trim(FEPostModel& fem, int nkeep);
+
+	// the memory used by the state data at the last trim (only tracked with a memory limit)
+	size_t MemoryUsage() const { return m_memUsage; }
+
+	// Remove all data from the scratch file. The lists must have been cleared.
+	void Reset();
+
+	// Returns the number of lists whose data could not be read back since the last
+	// call, and resets it. The arrays of those lists were restored filled with zeros.
+	int TakeErrors();
+
+public:
+	// Read the data of a list back from the scratch file. If this fails, the list is
+	// marked invalid, its arrays are restored filled with zeros, the error is counted,
+	// and false is returned.
+	bool Restore(FEMeshDataList& data);
+
+	// release the slot of a list (when the list is cleared)
+	void Release(FEMeshDataList& data);
+
+private:
+	// move the data of a list to the scratch file
+	bool Spill(FEMeshDataList& data);
+	bool ReadSlot(const Slot& s);
+	int AllocSlot(size_t bytes);
+
+private:
+	FILE*		m_fp;		// the scratch file
+	long long	m_fileSize;	// end of the used part of the scratch file
+	std::vector<Slot>	m_slot;
+
+	size_t			m_maxMem;	// memory limit
+	size_t			m_memUsage;	// memory in use at the last trim
+	unsigned int	m_epoch;	// incremented at each trim
+	bool			m_failed;	// writing to the scratch file failed, so no more data is moved there
+	int				m_errors;	// nr. of lists that could not be read back
+
+	std::vector<char>	m_buf;	// buffers for (de)compression
+	std::vector<char>	m_zbuf;
+
+	std::mutex	m_mutex;
+};
+
+} // namespace Post
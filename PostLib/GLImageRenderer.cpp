@@ -25,7 +25,23 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.*/
 
 #include "stdafx.h"
+#ifdef WIN32
+#include <Windows.h>
+#include <gl/GL.h>
+#include <gl/GLU.h>
+#endif
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#endif
+#ifdef LINUX
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
 #include "GLImageRenderer.h"
+#include "ImageModel.h"
+#include <ImageLib/3DImagePyramid.h>
+#include <GLLib/GLContext.h>
 using namespace Post;
 
 CGLImageRenderer::CGLImageRenderer(CImageModel* img) : m_img(img) 
@@ -36,3 +52,50 @@ CImageModel* CGLImageRenderer::GetImageModel()
 { 
 	return m_img; 
 }
+
+double CGLImageRenderer::ScreenFootprint()
+{
+	if (m_img == nullptr) return 0.0;
+	BOX box = m_img->GetBoundingBox();
+
+	GLdouble pm[16], mv[16];
+	GLint vp[4];
+	glGetDoublev(GL_PROJECTION_MATRIX, pm);
+	glGetDoublev(GL_MODELVIEW_MATRIX, mv);
+	glGetIntegerv(GL_VIEWPORT, vp);
+
+	// project the corners of the box
+	double xmin = 1e99, xmax = -1e99, ymin = 1e99, ymax = -1e99;
+	for (int i = 0; i < 8; ++i)
+	{
+		double x = (i & 1 ? box.x1 : box.x0);
+		double y = (i & 2 ? box.y1 : box.y0);
+		double z = (i & 4 ? box.z1 : box.z0);
+		GLdouble wx, wy, wz;
+		if (gluProject(x, y, z, mv, pm, vp, &wx, &wy, &wz) == GL_FALSE) return 0.0;
+		if (wx < xmin) xmin = wx;
+		if (wx > xmax) xmax = wx;
+		if (wy < ymin) ymin = wy;
+		if (wy > ymax) ymax = wy;
+	}
+
+	// we don't need more than the viewport
+	double w = xmax - xmin; if (w > vp[2]) w = vp[2];
+	double h = ymax - ymin; if (h > vp[3]) h = vp[3];
+	return (w > h ? w : h);
+}
+
+int CGLImageRenderer::SelectImageLevel(CGLContext& rc)
+{
+	// refine to full resolution when the view is idle
+	if (rc.m_interactive == false) return 0;
+
+	CImageSource* src = (m_img ? m_img->GetImageSource() : nullptr);
+	C3DImagePyramid* pyramid = (src ? src->GetPyramid() : nullptr);
+	if (pyramid == nullptr) return 0;
+
+	double size = ScreenFootprint();
+	if (size <= 0.0) return 0;
+
+	return pyramid->FindLevel((int)size);
+}
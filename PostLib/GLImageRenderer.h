@@ -38,6 +38,14 @@ public:
 
 	CImageModel* GetImageModel();
 
+protected:
+	// Select the pyramid level of the image source to render. While the user is interacting,
+	// the coarsest level that still covers the screen footprint is used, otherwise level 0.
+	int SelectImageLevel(CGLContext& rc);
+
+	// size (in pixels) of the projection of the image box on the screen
+	double ScreenFootprint();
+
 private:
 	CImageModel*	m_img;
 };
@@ -27,9 +27,11 @@ SOFTWARE.*/
 #include "stdafx.h"
 #include "ImageModel.h"
 #include <ImageLib/3DImage.h>
+#include <ImageLib/3DImagePyramid.h>
 #include "GLImageRenderer.h"
 #include <FSCore/FSDir.h>
 #include <assert.h>
+#include <string.h>
 
 #ifdef HAS_TEEM
 #include <ImageLib/compatibility.h>
@@ -50,7 +52,10 @@ CImageSource::CImageSource(CImageModel* imgModel)
 	AddIntParam(2, "NZ")->SetState(Param_VISIBLE);
 
 	m_img = nullptr;
+	m_pyramid = nullptr;
+	m_pyramidBuild = nullptr;
 	m_imgModel = imgModel;
+	m_readThroughput = 0.0;
 }
 
 CImageModel* CImageSource::GetImageModel()
@@ -65,6 +70,7 @@ void CImageSource::SetImageModel(CImageModel* imgModel)
 
 CImageSource::~CImageSource()
 {
+	StopPyramid();
 	delete m_img;
 }
 
@@ -81,6 +87,30 @@ std::string CImageSource::GetFileName() const
 
 #ifdef HAS_TEEM
 
+//-----------------------------------------------------------------------------
+// Reads the bricks of a bricked image from a TIFF stack
+class TIFBrickReader : public C3DImageBrickReader
+{
+public:
+  TIFBrickReader(std::unique_ptr<TIFReader> reader, int bits) : m_reader(std::move(reader)), m_bits(bits) {}
+
+  bool ReadBlock(int i0, int j0, int k0, int nx, int ny, int nz, void* dst) override
+  {
+    int bits = 0;
+    unsigned char* data = m_reader->ReadRegion(i0, j0, k0, nx, ny, nz, 1, 0, bits);
+    if (data == nullptr) return false;
+
+    bool ok = (bits == m_bits);
+    if (ok) memcpy(dst, data, (size_t)nx*ny*nz*(bits / 8));
+    delete[] data;
+    return ok;
+  }
+
+private:
+  std::unique_ptr<TIFReader>  m_reader;
+  int m_bits;
+};
+
 //TODO: Maybe see if we can break this function up a bit? 
 //      See much how much of Yong's code we can break off.
 bool CImageSource::LoadTiffData(std::wstring &fileName)
@@ -88,6 +118,61 @@ bool CImageSource::LoadTiffData(std::wstring &fileName)
   C3DImage* im = new C3DImage;
   std::unique_ptr<TIFReader> reader = std::make_unique<TIFReader>();
 
+  // Stacks that are too large to keep in memory are stored in bricks, which are
+  // streamed from the file at full resolution when they are accessed.
+  const size_t MAX_TIFF_SIZE = (size_t)1 << 31;
+  int sx, sy, sz, sbits;
+  reader->SetFile(fileName);
+  reader->Preprocess();
+  if (reader->GetStackSize(sx, sy, sz, sbits))
+  {
+    size_t bytes = (size_t)sx*sy*sz*(sbits / 8);
+    if (bytes > MAX_TIFF_SIZE)
+    {
+      BOX box(sx, sy, sz, sx + reader->GetXSpc(), sy + reader->GetYSpc(), sz + reader->GetZSpc());
+
+      C3DImage::PixelType pixelType = (sbits == 16 ? C3DImage::UINT_16 : C3DImage::UINT_8);
+      TIFBrickReader* brickReader = new TIFBrickReader(std::move(reader), sbits);
+      if (im->CreateBricked(sx, sy, sz, pixelType, brickReader) == false)
+      {
+        delete brickReader;
+        delete im;
+        return false;
+      }
+
+      m_imgModel->SetBoundingBox(box);
+      SetValues(ws2s(fileName), sx, sy, sz);
+      AssignImage(im);
+
+      return true;
+    }
+
+    // read the whole stack, decoding the pages in parallel
+    int bits = 0;
+    unsigned char* data = reader->ReadRegion(0, 0, 0, sx, sy, sz, 1, 0, bits);
+    if (data)
+    {
+      C3DImage::PixelType pixelType = (bits == 16 ? C3DImage::UINT_16 : C3DImage::UINT_8);
+      if (im->Create(sx, sy, sz, pixelType, data) == false)
+      {
+        delete[] data;
+        delete im;
+        return false;
+      }
+
+      BOX box(sx, sy, sz, sx + reader->GetXSpc(), sy + reader->GetYSpc(), sz + reader->GetZSpc());
+      m_imgModel->SetBoundingBox(box);
+      m_readThroughput = reader->GetThroughput();
+
+      SetValues(ws2s(fileName), sx, sy, sz);
+      AssignImage(im);
+
+      return true;
+    }
+
+    // fall back to the page by page reader for formats that ReadRegion doesn't handle
+  }
+
   // Returns a nrrd based on templated function
   Nrrd* nrrdStruct = GetNrrd<TIFReader>(reader,fileName);
 
@@ -95,8 +180,11 @@ bool CImageSource::LoadTiffData(std::wstring &fileName)
 
   BOX box(nx, ny, npages, nx + reader->GetXSpc(), ny+reader->GetYSpc(), npages+reader->GetZSpc());
   m_imgModel->SetBoundingBox(box);
+
+  // keep 16-bit data at full precision
+  C3DImage::PixelType pixelType = (bits == 16 ? C3DImage::UINT_16 : C3DImage::UINT_8);
  
-  if(im->Create(nx,ny,npages,reader->GetRawImage()) == false)
+  if(im->Create(nx,ny,npages,pixelType,reader->GetRawImage()) == false)
   {
 	delete im;
 	return false;
@@ -122,24 +210,32 @@ bool CImageSource::LoadNrrdData(std::wstring& filename)
 
   Byte* data = static_cast<Byte*>(nrrdStruct->data);
 
-  Byte* dataBuf;
+  // keep the data at full precision
+  void* dataBuf = data;
+  C3DImage::PixelType pixelType = C3DImage::UINT_8;
 
-  if (nrrdStruct->type == nrrdTypeUShort || nrrdStruct->type == nrrdTypeShort)
+  if (nrrdStruct->type == nrrdTypeUShort)
   {
-    dataBuf = new Byte[dataSize];
-    for (int i = 0; i < dataSize; ++i)
-    {
-      dataBuf[i] = data[2*i];
-    }
+    pixelType = C3DImage::UINT_16;
+  }
+  else if (nrrdStruct->type == nrrdTypeShort)
+  {
+    // signed data is stored as floats
+    const short* ps = static_cast<const short*>(nrrdStruct->data);
+    float* pf = new float[dataSize];
+    for (int i = 0; i < dataSize; ++i) pf[i] = (float)ps[i];
+    dataBuf = pf;
+    pixelType = C3DImage::REAL_32;
+  }
+  else if (nrrdStruct->type == nrrdTypeFloat)
+  {
+    pixelType = C3DImage::REAL_32;
   }
-  else
-    dataBuf = data;
-
 
   BOX box(nx, ny, nz, nx+reader->GetXSpc(), ny+reader->GetYSpc(), nz+reader->GetZSpc());
   m_imgModel->SetBoundingBox(box);
 
-  if (im->Create(nx, ny, nz, dataBuf) == false)
+  if (im->Create(nx, ny, nz, pixelType, dataBuf) == false)
   {
     delete im;
     return false;
@@ -167,44 +263,50 @@ bool CImageSource::LoadDicomData(const std::string& filename)
 
   EP_Representation type = rawData->getRepresentation();  // An Enum that gets the type 
   const u_short* data = static_cast<const u_short*>(rawData->getData()); //only returns const
-  Byte* dataBuf = new Byte[rawData->getCount()]; //may not need dataSize
 
   std::cout << "Image depth in pixels: " << dicomImage->getDepth() << std::endl;
   std::cout << "Is it monochrome? " << dicomImage->isMonochrome() << std::endl;
 
+  void* dataBuf = nullptr;
+  C3DImage::PixelType pixelType = C3DImage::UINT_8;
+
   if (type == EPR_Uint16 && dicomImage->getDepth() == 16)
   {
-    const u_short* data = static_cast<const u_short*>(rawData->getData()); //only returns const
-    for(int i = 0; i < rawData->getCount(); ++i)
-    { 
-      dataBuf[i] = data[i] >> 8;
-    }
+    // keep the full 16-bit precision
+    u_short* buf = new u_short[rawData->getCount()];
+    for(int i = 0; i < rawData->getCount(); ++i) buf[i] = data[i];
+    dataBuf = buf;
+    pixelType = C3DImage::UINT_16;
   }
   else if (type == EPR_Uint16 && dicomImage->getDepth() == 10)
   {
-    const u_short* data = static_cast<const u_short*>(rawData->getData()); //only returns const
     std::vector<std::bitset<10>> tenBitVec(rawData->getCount());
  
     for(int i = 0; i < rawData->getCount(); ++i)
       tenBitVec.at(i) = data[i];
 
+    u_short* buf = new u_short[rawData->getCount()];
     for(int i = 0; i < rawData->getCount(); ++i)
     {
-      dataBuf[i] = 256 * tenBitVec[i].to_ulong()/1024;
+      buf[i] = (u_short) tenBitVec[i].to_ulong();
     }
+    dataBuf = buf;
+    pixelType = C3DImage::UINT_16;
   }
   else
   {
+    Byte* buf = new Byte[rawData->getCount()]; //may not need dataSize
     for(int i = 0; i < rawData->getCount(); ++i)
     { 
-      dataBuf[i] = data[i];
+      buf[i] = data[i];
     }
+    dataBuf = buf;
   }
 
   BOX box(nx, ny, nz, nx+dicomImage->getWidthHeightRatio(), ny+dicomImage->getHeightWidthRatio(), nz+1.0);
   m_imgModel->SetBoundingBox(box);
 
-  if (im->Create(nx, ny, nz, dataBuf) == false)
+  if (im->Create(nx, ny, nz, pixelType, dataBuf) == false)
   {
     delete im;
     return false;
@@ -220,16 +322,39 @@ bool CImageSource::LoadDicomData(const std::string& filename)
 bool CImageSource::LoadImageData(const std::string& fileName, int nx, int ny, int nz)
 {
   C3DImage* im = new C3DImage;
-  if (im->Create(nx, ny, nz) == false)
+
+  // Large images are not read in one go. Instead, bricks are loaded from the file on demand.
+  const size_t MAX_CONTIGUOUS_SIZE = (size_t)1 << 30;
+  if ((size_t)nx*ny*nz > MAX_CONTIGUOUS_SIZE)
   {
-    delete im;
-    return false;
-  }
+    CRawImageBrickReader* reader = new CRawImageBrickReader;
+    if (reader->Open(fileName.c_str(), nx, ny, nz, 1) == false)
+    {
+      delete reader;
+      delete im;
+      return false;
+    }
 
-  if (im->LoadFromFile(fileName.c_str(), 8) == false)
+    if (im->CreateBricked(nx, ny, nz, C3DImage::UINT_8, reader) == false)
+    {
+      delete reader;
+      delete im;
+      return false;
+    }
+  }
+  else
   {
-    delete im;
-    return false;
+    if (im->Create(nx, ny, nz) == false)
+    {
+      delete im;
+      return false;
+    }
+
+    if (im->LoadFromFile(fileName.c_str(), 8) == false)
+    {
+      delete im;
+      return false;
+    }
   }
 
   SetValues(fileName,nx,ny,nz);
@@ -248,10 +373,48 @@ void CImageSource::SetValues(const std::string& fileName, int x, int y, int z)
 
 void CImageSource::AssignImage(C3DImage* im)
 {
+  StopPyramid();
   delete m_img;
   m_img = im;
 }
 
+void CImageSource::StopPyramid()
+{
+	if (m_pyramidThread.joinable())
+	{
+		m_pyramidBuild->Cancel();
+		m_pyramidThread.join();
+	}
+	delete m_pyramidBuild;
+	m_pyramidBuild = nullptr;
+	m_pyramid = nullptr;
+}
+
+C3DImagePyramid* CImageSource::GetPyramid()
+{
+	if (m_img == nullptr) return nullptr;
+
+	C3DImagePyramid* pyramid = m_pyramid.load(std::memory_order_acquire);
+	if (pyramid || m_pyramidBuild) return pyramid;
+
+	// Build the pyramid in the background. Until it is ready, the renderers use
+	// the full resolution image. The pyramid is cached next to the source file.
+	pyramid = m_pyramidBuild = new C3DImagePyramid;
+	C3DImage* img = m_img;
+	std::string fileName = GetFileName();
+	m_pyramidThread = std::thread([this, pyramid, img, fileName]() {
+		std::string cacheFile = (fileName.empty() ? std::string() : fileName + ".lod");
+		if (cacheFile.empty() || (pyramid->Load(cacheFile.c_str(), img, fileName.c_str()) == false))
+		{
+			if (pyramid->Build(img) == false) return;
+			if (!cacheFile.empty()) pyramid->Save(cacheFile.c_str());
+		}
+		m_pyramid.store(pyramid, std::memory_order_release);
+	});
+
+	return nullptr;
+}
+
 void CImageSource::Save(OArchive& ar)
 {
 	FSObject::Save(ar);
@@ -28,6 +28,8 @@ SOFTWARE.*/
 #include <vector>
 #include <string>
 #include <memory>
+#include <thread>
+#include <atomic>
 #include <FSCore/box.h>
 #include <FSCore/FSObjectList.h>
 #include "GLImageRenderer.h"
@@ -39,6 +41,7 @@ SOFTWARE.*/
 #endif
 
 class C3DImage;
+class C3DImagePyramid;
 
 namespace Post {
 
@@ -66,6 +69,10 @@ public:
 
 	C3DImage* Get3DImage() { return m_img; }
 
+	// Get the multi-resolution pyramid of the image. The first call starts building
+	// it on a worker thread. This returns null until the pyramid is ready.
+	C3DImagePyramid* GetPyramid();
+
 	void Save(OArchive& ar);
 	void Load(IArchive& ar);
 
@@ -73,6 +80,9 @@ public:
 	int Height() const;
 	int Depth() const;
 
+	// the read throughput (in MB/s of file data) of the last load, or zero if not known
+	double GetReadThroughput() const { return m_readThroughput; }
+
 public:
 	CImageModel* GetImageModel();
 	void SetImageModel(CImageModel* imgModel);
@@ -91,9 +101,14 @@ private:
 
     void SetValues(const std::string &fileName, int x, int y, int z);
     void AssignImage(C3DImage* im);
+	void StopPyramid();
 
 	C3DImage*	m_img;
+	std::atomic<C3DImagePyramid*>	m_pyramid;	// the pyramid, once it is ready
+	C3DImagePyramid*	m_pyramidBuild;		// the pyramid that is being built
+	std::thread			m_pyramidThread;
 	CImageModel*	m_imgModel;
+	double			m_readThroughput;
     unsigned char* data = nullptr;
 };
 
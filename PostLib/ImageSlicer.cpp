@@ -37,6 +37,7 @@ SOFTWARE.*/
 #endif
 #include "ImageSlicer.h"
 #include "ImageModel.h"
+#include <ImageLib/3DImagePyramid.h>
 #include <assert.h>
 #include <sstream>
 
@@ -59,6 +60,7 @@ CImageSlicer::CImageSlicer(CImageModel* img) : CGLImageRenderer(img)
 
 	m_texID = 0;
 	m_reloadTexture = true;
+	m_level = 0;
 
 	UpdateData(false);
 }
@@ -106,7 +108,11 @@ void CImageSlicer::Update()
 void CImageSlicer::UpdateSlice()
 {
 	CImageSource* src = GetImageModel()->GetImageSource();
-	C3DImage& im3d = *src->Get3DImage();
+
+	// use the selected level of detail
+	C3DImagePyramid* pyramid = (m_level > 0 ? src->GetPyramid() : nullptr);
+	if (pyramid && (m_level >= pyramid->Levels())) m_level = pyramid->Levels() - 1;
+	C3DImage& im3d = (pyramid ? *pyramid->Level(m_level) : *src->Get3DImage());
 
 	int nop = GetOrientation();
 	double off = GetOffset();
@@ -174,6 +180,14 @@ void CImageSlicer::BuildLUT()
 //! Render textures
 void CImageSlicer::Render(CGLContext& rc)
 {
+	// update the slice if we need a different level of detail
+	int level = SelectImageLevel(rc);
+	if (level != m_level)
+	{
+		m_level = level;
+		UpdateSlice();
+	}
+
 	if (m_texID == 0)
 	{
 		glDisable(GL_TEXTURE_2D);
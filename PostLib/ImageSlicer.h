@@ -69,6 +69,7 @@ private:
 	CRGBAImage		m_im;	// 2D image that will be displayed
 	int				m_LUTC[4][256];	// color lookup table
 	bool			m_reloadTexture;
+	int				m_level;	// pyramid level of the current slice
 
 	Post::CColorTexture	m_Col;
 
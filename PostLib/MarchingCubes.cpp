@@ -189,8 +189,11 @@ void CMarchingCubes::CreateSurface()
 	float dyi = (b.y1 - b.y0) / (NY - 1);
 	float dzi = (b.z1 - b.z0) / (NZ - 1);
 
-	Byte ref = (Byte)(m_val * 255.f);
-	float fref = (float)ref;
+	// the iso-value is defined relative to the image's value range
+	double vmin, vmax;
+	im3d.GetValueRange(vmin, vmax);
+	float ref = (float)(vmin + m_val*(vmax - vmin));
+	float fref = ref;
 	m_ref = ref;
 
 	C3DGradientMap grad(im3d, b);
@@ -201,7 +204,7 @@ void CMarchingCubes::CreateSurface()
 		TriMesh temp;
 		temp.Resize(MAX_FACES);
 		int nfaces = 0;
-		Byte val[8];
+		float val[8];
 		vec3f r[8], g[8];
 
 		#pragma omp for schedule(dynamic, 5)
@@ -214,16 +217,16 @@ void CMarchingCubes::CreateSurface()
 					// get the voxel's values
 					if (i == 0)
 					{
-						val[0] = im3d.value(i, j, k);
-						val[3] = im3d.value(i, j + 1, k);
-						val[4] = im3d.value(i, j, k + 1);
-						val[7] = im3d.value(i, j + 1, k + 1);
+						val[0] = im3d.GetValue(i, j, k);
+						val[3] = im3d.GetValue(i, j + 1, k);
+						val[4] = im3d.GetValue(i, j, k + 1);
+						val[7] = im3d.GetValue(i, j + 1, k + 1);
 					}
 
-					val[1] = im3d.value(i + 1, j, k);
-					val[2] = im3d.value(i + 1, j + 1, k);
-					val[5] = im3d.value(i + 1, j, k + 1);
-					val[6] = im3d.value(i + 1, j + 1, k + 1);
+					val[1] = im3d.GetValue(i + 1, j, k);
+					val[2] = im3d.GetValue(i + 1, j + 1, k);
+					val[5] = im3d.GetValue(i + 1, j, k + 1);
+					val[6] = im3d.GetValue(i + 1, j + 1, k + 1);
 
 					// calculate the case of the voxel
 					int ncase = 0;
@@ -289,7 +292,7 @@ void CMarchingCubes::CreateSurface()
 								int n1 = ET_HEX[pf[m]][0];
 								int n2 = ET_HEX[pf[m]][1];
 
-								float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
+								float w = (fref - val[n1]) / (val[n2] - val[n1]);
 								assert((w >= 0.f) && (w <= 1.f));
 
 								tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
@@ -338,7 +341,7 @@ void CMarchingCubes::CreateSurface()
 	// create surface meshes
 	if (m_bcloseSurface)
 	{
-		Byte val[4];
+		float val[4];
 		vec3f r[4];
 
 		// X-planes
@@ -353,10 +356,10 @@ void CMarchingCubes::CreateSurface()
 				for (int j = 0; j < NY - 1; ++j)
 				{
 					// get the pixel's values
-					val[0] = im3d.value(i, j, k);
-					val[1] = im3d.value(i, j + 1, k);
-					val[2] = im3d.value(i, j + 1, k + 1);
-					val[3] = im3d.value(i, j, k + 1);
+					val[0] = im3d.GetValue(i, j, k);
+					val[1] = im3d.GetValue(i, j + 1, k);
+					val[2] = im3d.GetValue(i, j + 1, k + 1);
+					val[3] = im3d.GetValue(i, j, k + 1);
 
 					// get the corners
 					r[0].x = x; r[0].y = b.y0 + j      *dyi; r[0].z = b.z0 + k*dzi;
@@ -382,10 +385,10 @@ void CMarchingCubes::CreateSurface()
 				for (int i = 0; i < NX - 1; ++i)
 				{
 					// get the pixel's values
-					val[0] = im3d.value(i  , j, k);
-					val[1] = im3d.value(i+1, j, k);
-					val[2] = im3d.value(i+1, j, k + 1);
-					val[3] = im3d.value(i  , j, k + 1);
+					val[0] = im3d.GetValue(i  , j, k);
+					val[1] = im3d.GetValue(i+1, j, k);
+					val[2] = im3d.GetValue(i+1, j, k + 1);
+					val[3] = im3d.GetValue(i  , j, k + 1);
 
 					// get the corners
 					r[0].x = b.x0 + i    *dxi; r[0].y = y; r[0].z = b.z0 + k*dzi;
@@ -411,10 +414,10 @@ void CMarchingCubes::CreateSurface()
 				for (int i = 0; i < NX - 1; ++i)
 				{
 					// get the pixel's values
-					val[0] = im3d.value(i    , j    , k);
-					val[1] = im3d.value(i + 1, j    , k);
-					val[2] = im3d.value(i + 1, j + 1, k);
-					val[3] = im3d.value(i    , j + 1, k);
+					val[0] = im3d.GetValue(i    , j    , k);
+					val[1] = im3d.GetValue(i + 1, j    , k);
+					val[2] = im3d.GetValue(i + 1, j + 1, k);
+					val[3] = im3d.GetValue(i    , j + 1, k);
 
 					// get the corners
 					r[0].x = b.x0 + i      *dxi; r[0].y = b.y0 + j      *dyi; r[0].z = z;
@@ -430,7 +433,7 @@ void CMarchingCubes::CreateSurface()
 	}
 }
 
-void CMarchingCubes::AddSurfaceTris(Byte val[4], vec3f r[4], const vec3f& faceNormal)
+void CMarchingCubes::AddSurfaceTris(float val[4], vec3f r[4], const vec3f& faceNormal)
 {
 	// calculate the case of the voxel
 	int ncase = 0;
@@ -449,7 +452,7 @@ void CMarchingCubes::AddSurfaceTris(Byte val[4], vec3f r[4], const vec3f& faceNo
 		if (val[3] > m_ref) ncase |= 0x08;
 	}
 
-	float fref = (float)m_ref;
+	float fref = m_ref;
 
 	// loop over faces
 	int* pf = LUT2D_tri[ncase];
@@ -471,7 +474,7 @@ void CMarchingCubes::AddSurfaceTris(Byte val[4], vec3f r[4], const vec3f& faceNo
 				int n1 = ET2D[node - 4][0];
 				int n2 = ET2D[node - 4][1];
 
-				float w = (fref - (float)val[n1]) / ((float)val[n2] - (float)val[n1]);
+				float w = (fref - val[n1]) / (val[n2] - val[n1]);
 				tri.m_node[m] = r[n1] * (1.f - w) + r[n2] * w;
 			}
 
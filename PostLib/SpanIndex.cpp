@@ -0,0 +1,130 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+#include "stdafx.h"
+#include "SpanIndex.h"
+#include <algorithm>
+using namespace Post;
+
+SpanIndex::SpanIndex()
+{
+}
+
+void SpanIndex::Clear()
+{
+	m_node.clear();
+	m_byMin.clear();
+	m_byMax.clear();
+}
+
+void SpanIndex::Build(const std::vector<SPAN>& spans)
+{
+	Clear();
+
+	std::vector<SPAN> tmp;
+	tmp.reserve(spans.size());
+	for (const SPAN& s : spans)
+	{
+		if (s.vmin <= s.vmax) tmp.push_back(s);
+	}
+	if (tmp.empty()) return;
+
+	m_byMin.reserve(tmp.size());
+	m_byMax.reserve(tmp.size());
+	BuildNode(tmp, 0, (int)tmp.size());
+}
+
+// Builds the node for the spans in [n0, n1) and returns its index. The center
+// is the median of the span midpoints, so each subtree gets at most half of
+// the spans and the depth of the tree is O(log N).
+int SpanIndex::BuildNode(std::vector<SPAN>& spans, int n0, int n1)
+{
+	if (n1 <= n0) return -1;
+
+	auto mid = [](const SPAN& s) { return 0.5*(s.vmin + s.vmax); };
+	int nm = (n0 + n1) / 2;
+	std::nth_element(spans.begin() + n0, spans.begin() + nm, spans.begin() + n1, [&](const SPAN& a, const SPAN& b) { return mid(a) < mid(b); });
+	double c = mid(spans[nm]);
+
+	// partition into [left | center | right]
+	auto b = spans.begin();
+	auto itl = std::partition(b + n0, b + n1, [=](const SPAN& s) { return s.vmax < c; });
+	auto itr = std::partition(itl, b + n1, [=](const SPAN& s) { return s.vmin <= c; });
+	int nl = (int)(itl - b);
+	int nr = (int)(itr - b);
+
+	int n = (int)m_node.size();
+	m_node.push_back(NODE());
+	m_node[n].center = c;
+	m_node[n].first = (int)m_byMin.size();
+	m_node[n].count = nr - nl;
+
+	m_byMin.insert(m_byMin.end(), b + nl, b + nr);
+	m_byMax.insert(m_byMax.end(), b + nl, b + nr);
+	std::sort(m_byMin.begin() + m_node[n].first, m_byMin.end(), [](const SPAN& a, const SPAN& b) { return a.vmin < b.vmin; });
+	std::sort(m_byMax.begin() + m_node[n].first, m_byMax.end(), [](const SPAN& a, const SPAN& b) { return a.vmax > b.vmax; });
+
+	// m_node can be reallocated by the recursive calls
+	int left = BuildNode(spans, n0, nl);
+	int right = BuildNode(spans, nr, n1);
+	m_node[n].left = left;
+	m_node[n].right = right;
+
+	return n;
+}
+
+void SpanIndex::Find(double v, std::vector<int>& items) const
+{
+	items.clear();
+	if (m_node.empty()) return;
+
+	int n = 0;
+	while (n >= 0)
+	{
+		const NODE& node = m_node[n];
+		const SPAN* pmin = m_byMin.data() + node.first;
+		const SPAN* pmax = m_byMax.data() + node.first;
+		if (v < node.center)
+		{
+			// all spans of this node end at or above the center
+			for (int i = 0; (i < node.count) && (pmin[i].vmin <= v); ++i) items.push_back(pmin[i].item);
+			n = node.left;
+		}
+		else if (v > node.center)
+		{
+			// all spans of this node start at or below the center
+			for (int i = 0; (i < node.count) && (pmax[i].vmax >= v); ++i) items.push_back(pmax[i].item);
+			n = node.right;
+		}
+		else
+		{
+			for (int i = 0; i < node.count; ++i) items.push_back(pmin[i].item);
+			break;
+		}
+	}
+
+	// callers depend on a deterministic order
+	std::sort(items.begin(), items.end());
+}
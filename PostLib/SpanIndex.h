@@ -0,0 +1,81 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <vector>
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// Index of value intervals that quickly finds all items whose interval
+// contains a given value. This is used to find the elements that are cut
+// by an iso-value or a plane without visiting all elements.
+// The spans are stored in a centered interval tree, so the cost of a query 
+// is O(log N + k), with k the number of spans that contain the value, no 
+// matter how wide the spans are.
+class SpanIndex
+{
+public:
+	struct SPAN
+	{
+		double	vmin, vmax;
+		int		item;
+	};
+
+private:
+	// A node stores the spans that contain its center, once sorted by vmin 
+	// and once sorted by vmax (descending). Spans that lie entirely below or
+	// above the center are stored in the left and right subtree.
+	struct NODE
+	{
+		double	center;
+		int		first, count;	// range in m_byMin and m_byMax
+		int		left, right;	// child nodes (-1 if none)
+	};
+
+public:
+	SpanIndex();
+
+	void Clear();
+
+	// Build the index. Spans with vmin > vmax are ignored.
+	void Build(const std::vector<SPAN>& spans);
+
+	// Return the items with vmin <= v <= vmax, sorted by item.
+	void Find(double v, std::vector<int>& items) const;
+
+	int Size() const { return (int)m_byMin.size(); }
+
+private:
+	int BuildNode(std::vector<SPAN>& spans, int n0, int n1);
+
+private:
+	std::vector<NODE>	m_node;		// tree nodes, the root is the first node
+	std::vector<SPAN>	m_byMin;	// spans of each node, sorted by vmin
+	std::vector<SPAN>	m_byMax;	// spans of each node, sorted by vmax (descending)
+};
+
+}
@@ -40,6 +40,7 @@ SOFTWARE.*/
 #include "ImageModel.h"
 #include "ColorMap.h"
 #include <ImageLib/3DGradientMap.h>
+#include <ImageLib/3DImagePyramid.h>
 #include <sstream>
 
 using std::stringstream;
@@ -70,8 +71,6 @@ CVolRender::CVolRender(CImageModel* img) : CGLImageRenderer(img)
 	AddColorParam(GLColor::White(), "Specular color");
 	AddVecParam(vec3d(1, 1, 1), "Light direction");
 
-	m_pImx = m_pImy = m_pImz = 0;
-	m_sliceX = m_sliceY = m_sliceZ = 0;
 	m_nx = m_ny = m_nz = 0;
 
 	m_blight = false;
@@ -177,13 +176,9 @@ void CVolRender::Reset()
 
 void CVolRender::Clear()
 {
-	delete [] m_sliceX; m_sliceX = 0;
-	delete [] m_sliceY; m_sliceY = 0;
-	delete [] m_sliceZ; m_sliceZ = 0;
-
-	delete [] m_pImx; m_pImx = 0; m_nx = 0;
-	delete [] m_pImy; m_pImy = 0; m_ny = 0;
-	delete [] m_pImz; m_pImz = 0; m_nz = 0;
+	m_im3d.CleanUp();
+	m_att.CleanUp();
+	m_nx = m_ny = m_nz = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -210,45 +205,14 @@ void CVolRender::Create()
 	m_nz = closest_pow2(d);
 	m_im3d.Create(m_nx, m_ny, m_nz);
 
-	// resample image
-	im3d.StretchBlt(m_im3d);
-
-	// allocate slices
-	m_sliceX = new CImage[m_nx];
-	m_pImx = new CRGBAImage[m_nx];
-	for (int i = 0; i < m_nx; ++i)
-	{
-		m_sliceX[i].Create(m_ny, m_nz);
-		m_pImx[i].Create(m_ny, m_nz);
-	}
-
-	m_sliceY = new CImage[m_ny]; 
-	m_pImy = new CRGBAImage[m_ny];
-	for (int i = 0; i < m_ny; ++i)
-	{
-		m_sliceY[i].Create(m_nx, m_nz);
-		m_pImy[i].Create(m_nx, m_nz);
-	}
-	
-	m_sliceZ = new CImage[m_nz]; 
-	m_pImz = new CRGBAImage[m_nz];
-	for (int i = 0; i < m_nz; ++i)
-	{
-		m_sliceZ[i].Create(m_nx, m_ny);
-		m_pImz[i].Create(m_nx, m_ny);
-	}
-
-#pragma omp parallel default(shared)
-	{
-#pragma omp for
-		for (int i = 0; i < m_nx; ++i) m_im3d.GetSliceX(m_sliceX[i], i);
-
-#pragma omp for
-		for (int i = 0; i < m_ny; ++i) m_im3d.GetSliceY(m_sliceY[i], i);
+	// resample from the coarsest level of detail that still has the required resolution
+	C3DImagePyramid* pyramid = src->GetPyramid();
+	int level = (pyramid ? pyramid->FindLevel(m_nx, m_ny, m_nz) : 0);
+	C3DImage& ims = (level > 0 ? *pyramid->Level(level) : im3d);
+	ims.StretchBlt(m_im3d);
 
-#pragma omp for
-		for (int i = 0; i < m_nz; ++i) m_im3d.GetSliceZ(m_sliceZ[i], i);
-	}
+	// the attenuation map needs to be recalculated
+	m_bcalc_lighting = true;
 
 	// calculate alpha scale factors
 /*	BOX b = img.GetBoundingBox();
@@ -303,8 +267,8 @@ void CVolRender::Update()
 
 void CVolRender::UpdateVolRender()
 {
-	// calculate attenuation factors
-	if (m_bcalc_lighting)
+	// calculate attenuation factors (only needed for lighting)
+	if (m_blight && m_bcalc_lighting && (m_nx*m_ny*m_nz > 0))
 	{
 		CalcAttenuation();
 		m_bcalc_lighting = false;
@@ -328,121 +292,76 @@ void CVolRender::UpdateVolRender()
 		m_LUTC[3][i] = (i == 0 ? m_Amin : (i == 255 ? m_Amax : (m_A0 + i*(m_A1 - m_A0) / 255)));
 	}
 
-	UpdateRGBImages();
-}
-
-void CVolRender::UpdateRGBImages()
-{
-	#pragma omp parallel default(shared)
+	// combine the intensity and color maps
+	for (int i = 0; i < 256; ++i)
 	{
-		#pragma omp for 
-		for (int i = 0; i < m_nx; i++)
-		{
-			CImage& im = m_sliceX[i];
-			Colorize(m_pImx[i], im);
-			if (m_blight) DepthCueX(m_pImx[i], i);
-		}
-
-		// create the y-images
-		#pragma omp for 
-		for (int i = 0; i < m_ny; i++)
-		{
-			CImage& im = m_sliceY[i];
-			Colorize(m_pImy[i], im);
-			if (m_blight) DepthCueY(m_pImy[i], i);
-		}
-
-		// create the z-images
-		#pragma omp for 
-		for (int i = 0; i < m_nz; i++)
-		{
-			CImage& im = m_sliceZ[i];
-			Colorize(m_pImz[i], im);
-			if (m_blight) DepthCueZ(m_pImz[i], i);
-		}
+		int val = m_LUT[i];
+		m_RGBA[i][0] = (Byte)m_LUTC[0][val];
+		m_RGBA[i][1] = (Byte)m_LUTC[1][val];
+		m_RGBA[i][2] = (Byte)m_LUTC[2][val];
+		m_RGBA[i][3] = (Byte)m_LUTC[3][val];
 	}
 }
 
 //-----------------------------------------------------------------------------
-//! Colorize the texture images
-void CVolRender::Colorize(CRGBAImage& imd, CImage& ims)
+void CVolRender::GetTransferFunction(Byte lut[256][4]) const
 {
-	int nx = imd.Width();
-	int ny = imd.Height();
-	int nn = nx*ny;
-	Byte* ps = ims.GetBytes();
-	Byte* pd = imd.GetBytes();
-	for (int i=0; i<nn; i++, ps++, pd+=4)
-	{
-		int val = m_LUT[*ps];
-		pd[0] = m_LUTC[0][val];
-		pd[1] = m_LUTC[1][val];
-		pd[2] = m_LUTC[2][val];
-		pd[3] = m_LUTC[3][val];
-	}
+	for (int i = 0; i < 256; ++i)
+		for (int j = 0; j < 4; ++j) lut[i][j] = m_RGBA[i][j];
 }
 
 //-----------------------------------------------------------------------------
-//! Attenuate X-textures
-void CVolRender::DepthCueX(CRGBAImage& im, int n)
+//! Colorize a slice of the volume and apply depth cueing
+void CVolRender::ColorizeSlice(int axis, int n)
 {
-	int nx = im.Width();
-	int ny = im.Height();
-	int nz = m_att.Width();
-
-	Byte* p = im.GetBytes();
-	for (int j=0; j<ny; ++j)
-		for (int i=0; i<nx; ++i, p += 4)
-		{
-			double a = m_att.value(n, i, j) / 255.0;
-			double w = m_shadeStrength*a + (1.0 - m_shadeStrength);
-			double s = m_shadeStrength*a*a;
-			p[0] = (Byte) (((p[0]*(1.0 - s) + s*m_spc.r)*w + m_amb.r*(1.0 - w)));
-			p[1] = (Byte) (((p[1]*(1.0 - s) + s*m_spc.g)*w + m_amb.g*(1.0 - w)));
-			p[2] = (Byte) (((p[2]*(1.0 - s) + s*m_spc.r)*w + m_amb.b*(1.0 - w)));
-		}
-}
+	// get the slice dimensions
+	int nx, ny;
+	switch (axis)
+	{
+	case 0: nx = m_ny; ny = m_nz; break;
+	case 1: nx = m_nx; ny = m_nz; break;
+	default:
+		nx = m_nx; ny = m_ny;
+	}
+	if ((m_slice.Width() != nx) || (m_slice.Height() != ny)) m_slice.Create(nx, ny);
 
-//-----------------------------------------------------------------------------
-//! Attenuate Y-textures
-void CVolRender::DepthCueY(CRGBAImage& im, int n)
-{
-	int nx = im.Width();
-	int ny = im.Height();
-	int nz = m_att.Height();
+	bool blight = (m_blight && (m_att.Width() == m_nx) && (m_att.Height() == m_ny) && (m_att.Depth() == m_nz));
 
-	Byte* p = im.GetBytes();
-	for (int j=0; j<ny; ++j)
-		for (int i=0; i<nx; ++i, p += 4)
+	Byte* pb = m_slice.GetBytes();
+	#pragma omp parallel for
+	for (int j = 0; j < ny; ++j)
+	{
+		Byte* p = pb + 4 * j*nx;
+		for (int i = 0; i < nx; ++i, p += 4)
 		{
-			double a = m_att.value(i, n, j) / 255.0;
-			double w = m_shadeStrength*a + (1.0 - m_shadeStrength);
-			double s = m_shadeStrength*a*a;
-			p[0] = (Byte) (((p[0]*(1.0 - s) + s*m_spc.r)*w + m_amb.r*(1.0 - w)));
-			p[1] = (Byte) (((p[1]*(1.0 - s) + s*m_spc.g)*w + m_amb.g*(1.0 - w)));
-			p[2] = (Byte) (((p[2]*(1.0 - s) + s*m_spc.r)*w + m_amb.b*(1.0 - w)));
-		}
-}
-
-//-----------------------------------------------------------------------------
-//! Attenuate Z-textures
-void CVolRender::DepthCueZ(CRGBAImage& im, int n)
-{
-	int nx = im.Width();
-	int ny = im.Height();
-	int nz = m_att.Depth();
+			int vi, vj, vk;
+			switch (axis)
+			{
+			case 0: vi = n; vj = i; vk = j; break;
+			case 1: vi = i; vj = n; vk = j; break;
+			default:
+				vi = i; vj = j; vk = n;
+			}
 
-	Byte* p = im.GetBytes();
-	for (int j=0; j<ny; ++j)
-		for (int i=0; i<nx; ++i, p += 4)
-		{
-			double a = m_att.value(i, j, n) / 255.0;
-			double w = m_shadeStrength*a + (1.0 - m_shadeStrength);
-			double s = m_shadeStrength*a*a;
-			p[0] = (Byte) (((p[0]*(1.0 - s) + s*m_spc.r)*w + m_amb.r*(1.0 - w)));
-			p[1] = (Byte) (((p[1]*(1.0 - s) + s*m_spc.g)*w + m_amb.g*(1.0 - w)));
-			p[2] = (Byte) (((p[2]*(1.0 - s) + s*m_spc.r)*w + m_amb.b*(1.0 - w)));
+			const Byte* c = m_RGBA[m_im3d.value(vi, vj, vk)];
+			if (blight)
+			{
+				double a = m_att.value(vi, vj, vk) / 255.0;
+				double w = m_shadeStrength*a + (1.0 - m_shadeStrength);
+				double s = m_shadeStrength*a*a;
+				p[0] = (Byte)(((c[0] * (1.0 - s) + s*m_spc.r)*w + m_amb.r*(1.0 - w)));
+				p[1] = (Byte)(((c[1] * (1.0 - s) + s*m_spc.g)*w + m_amb.g*(1.0 - w)));
+				p[2] = (Byte)(((c[2] * (1.0 - s) + s*m_spc.b)*w + m_amb.b*(1.0 - w)));
+			}
+			else
+			{
+				p[0] = c[0];
+				p[1] = c[1];
+				p[2] = c[2];
+			}
+			p[3] = c[3];
 		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -509,7 +428,8 @@ void CVolRender::RenderX(int inc)
 
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_ny, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImx[i].GetBytes());
+		ColorizeSlice(0, i);
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_ny, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_slice.GetBytes());
 
 		x = box.x0 + i*(box.x1 - box.x0)*fx;
 
@@ -546,7 +466,8 @@ void CVolRender::RenderY(int inc)
 
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImy[i].GetBytes());
+		ColorizeSlice(1, i);
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_nz, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_slice.GetBytes());
 
 		y = box.y0 + i*(box.y1 - box.y0)*fy;
 
@@ -583,7 +504,8 @@ void CVolRender::RenderZ(int inc)
 
 	for (int i=n0; i != n1; i += inc)
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_ny, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pImz[i].GetBytes());
+		ColorizeSlice(2, i);
+		glTexImage2D(GL_TEXTURE_2D, 0, 4, m_nx, m_ny, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_slice.GetBytes());
 
 		z = box.z0 + i*(box.z1 - box.z0)*fz;
 
@@ -61,20 +61,20 @@ public:
 
 	bool UpdateData(bool bsave = true) override;
 
+	// copy the current transfer function (e.g. for use by CVolumeRayCaster)
+	void GetTransferFunction(Byte lut[256][4]) const;
+
 protected:
 	void RenderX(int inc);
 	void RenderY(int inc);
 	void RenderZ(int inc);
 
-	void Colorize(CRGBAImage& imd, CImage& ims);
+	// colorize slice n of the volume, normal to the given axis, into m_slice
+	void ColorizeSlice(int axis, int n);
 
 	void CalcAttenuation();
-	void DepthCueX(CRGBAImage& im, int n);
-	void DepthCueY(CRGBAImage& im, int n);
-	void DepthCueZ(CRGBAImage& im, int n);
 
 	void UpdateVolRender();
-	void UpdateRGBImages();
 
 public:
 	Post::CColorTexture	m_Col;		//!< color texture
@@ -91,13 +91,10 @@ protected:
 	C3DImage		m_im3d;	// resampled 3D image data
 	C3DImage		m_att;	// attenuation map (for lighting)
 
-	CImage*	m_sliceX;
-	CImage*	m_sliceY;
-	CImage*	m_sliceZ;
-
-	CRGBAImage*	m_pImx;	// Image array in x-direction
-	CRGBAImage*	m_pImy;	// Image array in y-direction
-	CRGBAImage*	m_pImz;	// Image array in x-direction
+	// The slices are colorized when they are rendered, so only the scalar
+	// volume needs to be stored, and editing the transfer function only
+	// requires updating the lookup table.
+	CRGBAImage		m_slice;	// colorized slice that is being rendered
 	unsigned int m_texID;
 
 	int m_nx;	// nr of images in x-direction
@@ -110,5 +107,6 @@ protected:
 	vec3d	m_light;	// light direction
 
 	int	m_LUT[256], m_LUTC[4][256];
+	Byte	m_RGBA[256][4];		// combined transfer function lookup table
 };
 }
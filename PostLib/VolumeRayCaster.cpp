@@ -0,0 +1,444 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#include "stdafx.h"
+#include "VolumeRayCaster.h"
+#include "Animation.h"
+#include <FSCore/FSThreadPool.h>
+#include <QImage>
+#include <math.h>
+#include <string.h>
+using namespace Post;
+
+// nr of voxels along each side of the finest octree nodes
+static const int BRICK_SIZE = 8;
+
+// size of the image tiles that are handed out to threads
+static const int TILE_SIZE = 32;
+
+// a ray is terminated when its accumulated opacity exceeds this value
+static const float OPAQUE_ALPHA = 0.99f;
+
+CVolumeRayCaster::CVolumeRayCaster()
+{
+	m_im = nullptr;
+	m_pb = nullptr;
+	m_nx = m_ny = m_nz = 0;
+
+	for (int i = 0; i < 256; ++i)
+	{
+		m_lut[i][0] = m_lut[i][1] = m_lut[i][2] = (Byte)i;
+		m_lut[i][3] = (Byte)i;
+	}
+
+	m_eye = vec3d(0, 0, 1);
+	m_dir = vec3d(0, 0, -1);
+	m_up = vec3d(0, 1, 0);
+	m_right = vec3d(1, 0, 0);
+	m_fov = 30.0;
+	m_dist = 1.0;
+
+	m_bg[0] = m_bg[1] = m_bg[2] = 0; m_bg[3] = 255;
+	m_dt = 0.5;
+
+	UpdateAlpha();
+}
+
+void CVolumeRayCaster::SetImage(C3DImage* im, const BOX& box)
+{
+	m_im = im;
+	m_box = box;
+	m_buf.clear();
+	m_pb = nullptr;
+	m_nx = m_ny = m_nz = 0;
+	m_tree.clear();
+	if (im == nullptr) return;
+
+	m_nx = im->Width();
+	m_ny = im->Height();
+	m_nz = im->Depth();
+	if (m_nx*m_ny*m_nz == 0) return;
+
+	// the ray caster works on 8-bit intensities, so make a copy if the image has
+	// a different pixel type or is not stored contiguously.
+	if ((im->GetPixelType() == C3DImage::UINT_8) && (im->IsBricked() == false))
+		m_pb = im->GetBytes();
+	else
+	{
+		im->GetByteData(m_buf);
+		m_pb = m_buf.data();
+	}
+
+	m_scale.x = (box.Width () > 0 ? (m_nx - 1) / box.Width () : 0.0);
+	m_scale.y = (box.Height() > 0 ? (m_ny - 1) / box.Height() : 0.0);
+	m_scale.z = (box.Depth () > 0 ? (m_nz - 1) / box.Depth () : 0.0);
+
+	BuildOctree();
+	UpdateEmptyNodes();
+}
+
+void CVolumeRayCaster::SetTransferFunction(const Byte lut[256][4])
+{
+	for (int i = 0; i < 256; ++i)
+		for (int j = 0; j < 4; ++j) m_lut[i][j] = lut[i][j];
+
+	UpdateAlpha();
+	UpdateEmptyNodes();
+}
+
+void CVolumeRayCaster::SetCamera(const vec3d& eye, const vec3d& target, const vec3d& up, double fov)
+{
+	m_eye = eye;
+	m_dir = target - eye;
+	m_dist = m_dir.Length();
+	m_dir.Normalize();
+
+	m_right = m_dir ^ up; m_right.Normalize();
+	m_up = m_right ^ m_dir; m_up.Normalize();
+
+	m_fov = fov;
+}
+
+void CVolumeRayCaster::SetBackground(Byte r, Byte g, Byte b, Byte a)
+{
+	m_bg[0] = r;
+	m_bg[1] = g;
+	m_bg[2] = b;
+	m_bg[3] = a;
+}
+
+void CVolumeRayCaster::SetStepSize(double dt)
+{
+	if (dt <= 0.0) return;
+	m_dt = dt;
+	UpdateAlpha();
+}
+
+//-----------------------------------------------------------------------------
+// The lookup table's opacity is defined per voxel, so it needs to be corrected
+// for the sample distance.
+void CVolumeRayCaster::UpdateAlpha()
+{
+	m_opaque[0] = 0;
+	for (int i = 0; i < 256; ++i)
+	{
+		float a = m_lut[i][3] / 255.f;
+		m_alpha[i] = 1.f - (float)pow(1.0 - a, m_dt);
+		m_opaque[i + 1] = m_opaque[i] + (m_lut[i][3] > 0 ? 1 : 0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Build the min/max octree. Node i of the finest level covers the voxel cells
+// [i*BRICK_SIZE, (i+1)*BRICK_SIZE), so its range includes all the voxels that
+// are used when interpolating inside these cells.
+void CVolumeRayCaster::BuildOctree()
+{
+	m_tree.clear();
+
+	Level L0;
+	L0.size = BRICK_SIZE;
+	L0.nx = (m_nx > 1 ? (m_nx - 2) / BRICK_SIZE + 1 : 1);
+	L0.ny = (m_ny > 1 ? (m_ny - 2) / BRICK_SIZE + 1 : 1);
+	L0.nz = (m_nz > 1 ? (m_nz - 2) / BRICK_SIZE + 1 : 1);
+	int nodes = L0.nx*L0.ny*L0.nz;
+	L0.vmin.assign(nodes, 255);
+	L0.vmax.assign(nodes, 0);
+	L0.empty.assign(nodes, false);
+
+	int nx = m_nx, ny = m_ny, nz = m_nz;
+	const Byte* pb = m_pb;
+	parallel_for(0, nodes, [&](int n) {
+		int bi = n % L0.nx;
+		int bj = (n / L0.nx) % L0.ny;
+		int bk = n / (L0.nx*L0.ny);
+
+		int i0 = bi*BRICK_SIZE, i1 = i0 + BRICK_SIZE; if (i1 > nx - 1) i1 = nx - 1;
+		int j0 = bj*BRICK_SIZE, j1 = j0 + BRICK_SIZE; if (j1 > ny - 1) j1 = ny - 1;
+		int k0 = bk*BRICK_SIZE, k1 = k0 + BRICK_SIZE; if (k1 > nz - 1) k1 = nz - 1;
+
+		Byte vmin = 255, vmax = 0;
+		for (int k = k0; k <= k1; ++k)
+			for (int j = j0; j <= j1; ++j)
+			{
+				const Byte* p = pb + ((size_t)k*ny + j)*nx;
+				for (int i = i0; i <= i1; ++i)
+				{
+					if (p[i] < vmin) vmin = p[i];
+					if (p[i] > vmax) vmax = p[i];
+				}
+			}
+		L0.vmin[n] = vmin;
+		L0.vmax[n] = vmax;
+	});
+	m_tree.push_back(L0);
+
+	// build the coarser levels until a single node covers the volume
+	while ((m_tree.back().nx > 1) || (m_tree.back().ny > 1) || (m_tree.back().nz > 1))
+	{
+		const Level& c = m_tree.back();
+		Level p;
+		p.size = 2 * c.size;
+		p.nx = (c.nx + 1) / 2;
+		p.ny = (c.ny + 1) / 2;
+		p.nz = (c.nz + 1) / 2;
+		int np = p.nx*p.ny*p.nz;
+		p.vmin.assign(np, 255);
+		p.vmax.assign(np, 0);
+		p.empty.assign(np, false);
+
+		for (int k = 0; k < c.nz; ++k)
+			for (int j = 0; j < c.ny; ++j)
+				for (int i = 0; i < c.nx; ++i)
+				{
+					int nc = (k*c.ny + j)*c.nx + i;
+					int n = ((k/2)*p.ny + j/2)*p.nx + i/2;
+					if (c.vmin[nc] < p.vmin[n]) p.vmin[n] = c.vmin[nc];
+					if (c.vmax[nc] > p.vmax[n]) p.vmax[n] = c.vmax[nc];
+				}
+		m_tree.push_back(p);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// A node is empty when all the values in its range map to zero opacity.
+void CVolumeRayCaster::UpdateEmptyNodes()
+{
+	for (Level& L : m_tree)
+	{
+		int nodes = (int)L.vmin.size();
+		for (int n = 0; n < nodes; ++n)
+			L.empty[n] = (m_opaque[L.vmax[n] + 1] - m_opaque[L.vmin[n]] == 0);
+	}
+}
+
+bool CVolumeRayCaster::Render(CRGBAImage& im, int width, int height)
+{
+	if ((width <= 0) || (height <= 0)) return false;
+	im.Create(width, height);
+
+	int tx = (width + TILE_SIZE - 1) / TILE_SIZE;
+	int ty = (height + TILE_SIZE - 1) / TILE_SIZE;
+	int tiles = tx*ty;
+
+	// rays through empty space are much cheaper than rays through the volume,
+	// so each tile is a separate task that idle workers can steal.
+	FSThreadPool::Instance().Run(0, tiles, tiles, [&](int, int n0, int n1) {
+		for (int n = n0; n < n1; ++n)
+		{
+			int x0 = (n % tx)*TILE_SIZE;
+			int y0 = (n / tx)*TILE_SIZE;
+			int x1 = x0 + TILE_SIZE; if (x1 > width) x1 = width;
+			int y1 = y0 + TILE_SIZE; if (y1 > height) y1 = height;
+			RenderTile(im, x0, y0, x1, y1);
+		}
+	});
+
+	return true;
+}
+
+bool CVolumeRayCaster::RenderFrame(CAnimation& anim, int width, int height)
+{
+	CRGBAImage im;
+	if (Render(im, width, height) == false) return false;
+
+	QImage qim(width, height, QImage::Format_RGBA8888);
+	for (int j = 0; j < height; ++j)
+		memcpy(qim.scanLine(j), im.GetPixel(0, j), 4 * width);
+
+	return (anim.Write(qim) != 0);
+}
+
+//-----------------------------------------------------------------------------
+// Renders the pixels [x0,x1)x[y0,y1). Row 0 is the top of the image.
+void CVolumeRayCaster::RenderTile(CRGBAImage& im, int x0, int y0, int x1, int y1)
+{
+	int W = im.Width();
+	int H = im.Height();
+	double ar = (double)W / (double)H;
+
+	// half the height of the view plane at unit distance (perspective), or at the target (orthographic)
+	bool ortho = (m_fov <= 0.0);
+	double h = (ortho ? m_dist*tan(15.0*PI / 180.0) : tan(0.5*m_fov*PI / 180.0));
+
+	vec3d b0(m_box.x0, m_box.y0, m_box.z0);
+
+	for (int y = y0; y < y1; ++y)
+		for (int x = x0; x < x1; ++x)
+		{
+			double u = (2.0*(x + 0.5) / W - 1.0)*ar*h;
+			double v = (1.0 - 2.0*(y + 0.5) / H)*h;
+
+			vec3d o, d;
+			if (ortho)
+			{
+				o = m_eye + m_right*u + m_up*v;
+				d = m_dir;
+			}
+			else
+			{
+				o = m_eye;
+				d = m_dir + m_right*u + m_up*v;
+			}
+
+			// transform to voxel coordinates
+			vec3d ov = o - b0;
+			ov = vec3d(ov.x*m_scale.x, ov.y*m_scale.y, ov.z*m_scale.z);
+			vec3d dv(d.x*m_scale.x, d.y*m_scale.y, d.z*m_scale.z);
+			dv.Normalize();
+
+			CastRay(ov, dv, im.GetPixel(x, y));
+		}
+}
+
+//-----------------------------------------------------------------------------
+// Trilinear interpolation of the 8-bit voxel data. The eight corner values are
+// blended with straight-line arithmetic (no branches on the sample position),
+// so the compiler can keep the lerps in vector registers.
+float CVolumeRayCaster::Sample(float x, float y, float z) const
+{
+	int i = (int)x; if (i > m_nx - 2) i = (m_nx > 1 ? m_nx - 2 : 0);
+	int j = (int)y; if (j > m_ny - 2) j = (m_ny > 1 ? m_ny - 2 : 0);
+	int k = (int)z; if (k > m_nz - 2) k = (m_nz > 1 ? m_nz - 2 : 0);
+	float r = x - i; if (r > 1.f) r = 1.f;
+	float s = y - j; if (s > 1.f) s = 1.f;
+	float t = z - k; if (t > 1.f) t = 1.f;
+
+	size_t di = (m_nx > 1 ? 1 : 0);
+	size_t dj = (m_ny > 1 ? m_nx : 0);
+	size_t dk = (m_nz > 1 ? (size_t)m_nx*m_ny : 0);
+
+	const Byte* p = m_pb + ((size_t)k*m_ny + j)*m_nx + i;
+	float v0[4] = { (float)p[0], (float)p[dj], (float)p[dk], (float)p[dj + dk] };
+	float v1[4] = { (float)p[di], (float)p[di + dj], (float)p[di + dk], (float)p[di + dj + dk] };
+
+	float a[4];
+	for (int n = 0; n < 4; ++n) a[n] = v0[n] + r*(v1[n] - v0[n]);
+
+	float b0 = a[0] + s*(a[1] - a[0]);
+	float b1 = a[2] + s*(a[3] - a[2]);
+	return b0 + t*(b1 - b0);
+}
+
+//-----------------------------------------------------------------------------
+// Composites a ray front-to-back. The ray is given in voxel coordinates and
+// d must be a unit vector.
+void CVolumeRayCaster::CastRay(const vec3d& o, const vec3d& d, Byte* rgba)
+{
+	float c[4] = { 0.f, 0.f, 0.f, 0.f };
+
+	// clip the ray to the volume
+	double tmin = 0.0, tmax = 1e99;
+	double lo[3] = { 0.0, 0.0, 0.0 };
+	double hi[3] = { (double)m_nx - 1, (double)m_ny - 1, (double)m_nz - 1 };
+	double ro[3] = { o.x, o.y, o.z };
+	double rd[3] = { d.x, d.y, d.z };
+	bool hit = (m_pb != nullptr);
+	for (int n = 0; (n < 3) && hit; ++n)
+	{
+		if (rd[n] == 0.0)
+		{
+			if ((ro[n] < lo[n]) || (ro[n] > hi[n])) hit = false;
+		}
+		else
+		{
+			double t0 = (lo[n] - ro[n]) / rd[n];
+			double t1 = (hi[n] - ro[n]) / rd[n];
+			if (t0 > t1) { double tmp = t0; t0 = t1; t1 = tmp; }
+			if (t0 > tmin) tmin = t0;
+			if (t1 < tmax) tmax = t1;
+			if (tmin > tmax) hit = false;
+		}
+	}
+
+	if (hit)
+	{
+		const Level& L0 = m_tree[0];
+		int levels = (int)m_tree.size();
+		double t = tmin;
+		while (t <= tmax)
+		{
+			vec3d p = o + d*t;
+			if (p.x < 0) p.x = 0;
+			if (p.x > hi[0]) p.x = hi[0];
+			if (p.y < 0) p.y = 0;
+			if (p.y > hi[1]) p.y = hi[1];
+			if (p.z < 0) p.z = 0;
+			if (p.z > hi[2]) p.z = hi[2];
+
+			int ni = (int)p.x / BRICK_SIZE; if (ni >= L0.nx) ni = L0.nx - 1;
+			int nj = (int)p.y / BRICK_SIZE; if (nj >= L0.ny) nj = L0.ny - 1;
+			int nk = (int)p.z / BRICK_SIZE; if (nk >= L0.nz) nk = L0.nz - 1;
+
+			if (L0.empty[(nk*L0.ny + nj)*L0.nx + ni])
+			{
+				// find the largest empty node that contains this point
+				int l = 0;
+				while (l + 1 < levels)
+				{
+					const Level& P = m_tree[l + 1];
+					if (P.empty[((nk/2)*P.ny + nj/2)*P.nx + ni/2] == false) break;
+					ni /= 2; nj /= 2; nk /= 2;
+					l++;
+				}
+
+				// and jump to where the ray leaves it
+				double s = m_tree[l].size;
+				double n0[3] = { ni*s, nj*s, nk*s };
+				double texit = tmax;
+				for (int n = 0; n < 3; ++n)
+				{
+					if (rd[n] > 0.0) { double te = (n0[n] + s - ro[n]) / rd[n]; if (te < texit) texit = te; }
+					else if (rd[n] < 0.0) { double te = (n0[n] - ro[n]) / rd[n]; if (te < texit) texit = te; }
+				}
+				t = (texit > t ? texit : t) + 1e-3;
+				continue;
+			}
+
+			float v = Sample((float)p.x, (float)p.y, (float)p.z);
+			int iv = (int)(v + 0.5f);
+			float a = m_alpha[iv];
+			if (a > 0.f)
+			{
+				float w = (1.f - c[3])*a;
+				c[0] += w*m_lut[iv][0];
+				c[1] += w*m_lut[iv][1];
+				c[2] += w*m_lut[iv][2];
+				c[3] += w;
+				if (c[3] > OPAQUE_ALPHA) break;
+			}
+
+			t += m_dt;
+		}
+	}
+
+	// blend with background
+	float f = 1.f - c[3];
+	rgba[0] = (Byte)(c[0] + f*m_bg[0]);
+	rgba[1] = (Byte)(c[1] + f*m_bg[1]);
+	rgba[2] = (Byte)(c[2] + f*m_bg[2]);
+	rgba[3] = (Byte)(255.f*c[3] + f*m_bg[3]);
+}
@@ -0,0 +1,112 @@
+/*This file is part of the FEBio Studio source code and is licensed under the MIT license
+listed below.
+
+See Copyright-FEBio-Studio.txt for details.
+
+Copyright (c) 2021 University of Utah, The Trustees of Columbia University in
+the City of New York, and others.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.*/
+
+#pragma once
+#include <ImageLib/3DImage.h>
+#include <ImageLib/RGBAImage.h>
+#include <FSCore/box.h>
+#include <vector>
+
+class CAnimation;
+
+namespace Post {
+
+//-----------------------------------------------------------------------------
+// CPU ray-casting volume renderer. This renders a 3D image into an RGBA
+// buffer without requiring an OpenGL context, so it can be used for
+// offscreen rendering (e.g. when exporting animations) and for volumes that
+// are too large to resample into 2D texture stacks.
+// The image is divided into tiles that are rendered in parallel. Empty
+// space is skipped using a min/max octree over bricks of voxels, and rays
+// are terminated as soon as they become (nearly) opaque.
+class CVolumeRayCaster
+{
+	// min/max values of one level of the octree
+	struct Level
+	{
+		int		nx, ny, nz;		// nr of nodes in each direction
+		int		size;			// nr of voxels spanned by a node
+		std::vector<Byte>	vmin, vmax;
+		std::vector<bool>	empty;	// does the node map to zero opacity?
+	};
+
+public:
+	CVolumeRayCaster();
+
+	// set the image and the physical box it occupies
+	void SetImage(C3DImage* im, const BOX& box);
+
+	// set the transfer function as a lookup table that maps 8-bit intensity to RGBA
+	void SetTransferFunction(const Byte lut[256][4]);
+
+	// set a perspective (fov > 0, in degrees) or orthographic (fov <= 0) camera
+	void SetCamera(const vec3d& eye, const vec3d& target, const vec3d& up, double fov = 30.0);
+
+	// set the background color
+	void SetBackground(Byte r, Byte g, Byte b, Byte a = 255);
+
+	// sample distance, in voxels (default is 0.5)
+	void SetStepSize(double dt);
+
+	// render the volume
+	bool Render(CRGBAImage& im, int width, int height);
+
+	// render the volume and append it as a frame to an animation
+	bool RenderFrame(CAnimation& anim, int width, int height);
+
+private:
+	void BuildOctree();
+	void UpdateEmptyNodes();
+	void UpdateAlpha();
+
+	void RenderTile(CRGBAImage& im, int x0, int y0, int x1, int y1);
+	void CastRay(const vec3d& o, const vec3d& d, Byte* rgba);
+
+	float Sample(float x, float y, float z) const;
+
+private:
+	C3DImage*	m_im;
+	BOX			m_box;
+	const Byte*	m_pb;				// 8-bit voxel data
+	std::vector<Byte>	m_buf;		// 8-bit copy, for images that are not contiguous 8-bit
+	int			m_nx, m_ny, m_nz;
+
+	Byte		m_lut[256][4];
+	float		m_alpha[256];		// opacity, corrected for the step size
+	int			m_opaque[257];		// prefix count of nonzero opacity entries in lut
+
+	std::vector<Level>	m_tree;		// min/max octree, finest level first
+
+	vec3d		m_eye, m_dir, m_up, m_right;
+	double		m_fov;
+	double		m_dist;				// distance from eye to target
+	Byte		m_bg[4];
+	double		m_dt;
+
+	// transformation from world to voxel coordinates
+	vec3d		m_scale;
+};
+}
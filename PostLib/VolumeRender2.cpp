@@ -115,7 +115,14 @@ void CVolumeRender2::InitTexture()
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
 	// This will copy the image data to texture memory, so in principle we won't need im3d anymore
-	glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, im3d.GetBytes());
+	if ((im3d.GetPixelType() == C3DImage::UINT_8) && (im3d.IsBricked() == false))
+		glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, im3d.GetBytes());
+	else
+	{
+		std::vector<Byte> buf;
+		im3d.GetByteData(buf);
+		glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, buf.data());
+	}
 }
 
 void CVolumeRender2::ReloadTexture()
@@ -133,7 +140,14 @@ void CVolumeRender2::ReloadTexture()
 	int nz = im3d.Depth();
 
 	glBindTexture(GL_TEXTURE_3D, m_texID);
-	glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, im3d.GetBytes());
+	if ((im3d.GetPixelType() == C3DImage::UINT_8) && (im3d.IsBricked() == false))
+		glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, im3d.GetBytes());
+	else
+	{
+		std::vector<Byte> buf;
+		im3d.GetByteData(buf);
+		glTexImage3D(GL_TEXTURE_3D, 0, 1, nx, ny, nz, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, buf.data());
+	}
 }
 
 const char* shadertxt = \
@@ -29,6 +29,9 @@ SOFTWARE.*/
 #include "FEMeshData_T.h"
 #include <MeshLib/MeshMetrics.h>
 #include <MeshLib/MeshTools.h>
+#include <FSCore/Profiler.h>
+#include <FSCore/FSThreadPool.h>
+#include <unordered_map>
 using namespace Post;
 
 //-----------------------------------------------------------------------------
@@ -188,6 +191,11 @@ bool FEPostModel::IsValidFieldCode(int nfield, int nstate)
 // Evaluate a data field at a particular time
 bool FEPostModel::Evaluate(int nfield, int ntime, bool breset)
 {
+	PROFILE_SCOPE_CAT("FEPostModel::Evaluate", "post");
+
+	// the data of this state could not be read back from the scratch file
+	if (IsStateValid(ntime) == false) return false;
+
 	// get the state data 
 	FEState& state = *m_State[ntime];
 	FEPostMesh* mesh = state.GetFEMesh();
@@ -2669,3 +2677,111 @@ mat3f FEPostModel::EvaluateElemTensor(int n, int ntime, int nten, int ntype)
 
 	return m;
 }
+
+//-----------------------------------------------------------------------------
+// The items and states are split in blocks that are evaluated in parallel. The blocks
+// are ordered by state, so each state's data is visited by as few tasks as possible.
+// Nodal values of element fields are averages of the adjacent elements. Since most
+// elements are shared by several nodes, each block evaluates those elements only once.
+bool FEPostModel::EvaluateTimeHistory(const vector<int>& items, int itemClass, int nfield, int n0, int n1, vector<float>& val)
+{
+	PROFILE_SCOPE_CAT("FEPostModel::EvaluateTimeHistory", "post");
+
+	int NS = GetStates();
+	if ((n0 < 0) || (n1 >= NS) || (n1 < n0)) return false;
+	if ((itemClass != CLASS_NODE) && (itemClass != CLASS_FACE) && (itemClass != CLASS_ELEM)) return false;
+
+	int steps = n1 - n0 + 1;
+	int NI = (int)items.size();
+	val.assign((size_t)NI * steps, 0.f);
+	if (NI == 0) return true;
+
+	// split the items so that there are enough tasks when there are only a few states
+	int threads = FSThreadPool::Instance().Threads();
+	int blocks = (4 * threads + steps - 1) / steps;
+	if (blocks > (NI + 63) / 64) blocks = (NI + 63) / 64;
+	if (blocks < 1) blocks = 1;
+	int blockSize = (NI + blocks - 1) / blocks;
+
+	bool avgElems = (itemClass == CLASS_NODE) && IS_ELEM_FIELD(nfield);
+
+	// the states are processed in batches, so that the states that are done can
+	// be moved to the scratch file when there is a memory limit
+	int batch = StateBatchSize();
+	for (int b0 = 0; b0 < steps; b0 += batch)
+	{
+		int b1 = (b0 + batch < steps ? b0 + batch : steps);
+
+		// don't report values of states whose data could not be read back
+		for (int j = b0; j < b1; ++j)
+			if (IsStateValid(n0 + j) == false) return false;
+
+		parallel_for(b0 * blocks, b1 * blocks, [&](int task) {
+			int j = task / blocks;
+			int i0 = (task % blocks) * blockSize;
+			int i1 = i0 + blockSize; if (i1 > NI) i1 = NI;
+			int ntime = n0 + j;
+
+			float data[FEElement::MAX_NODES] = { 0.f }, v;
+			if (itemClass == CLASS_NODE)
+			{
+				if (avgElems)
+				{
+					FEPostMesh& mesh = *GetState(ntime)->GetFEMesh();
+
+					// nodal values of the elements of this block (empty if the element is inactive)
+					std::unordered_map<int, vector<float> > elemData;
+					for (int i = i0; i < i1; ++i)
+					{
+						const vector<NodeElemRef>& nel = mesh.NodeElemList(items[i]);
+						float f = 0.f;
+						int m = 0;
+						for (const NodeElemRef& ref : nel)
+						{
+							auto it = elemData.find(ref.eid);
+							if (it == elemData.end())
+							{
+								vector<float> d;
+								if (EvaluateElement(ref.eid, ntime, nfield, data, v))
+									d.assign(data, data + mesh.ElementRef(ref.eid).Nodes());
+								it = elemData.insert(std::make_pair(ref.eid, d)).first;
+							}
+							if (it->second.empty() == false) { f += it->second[ref.nid]; ++m; }
+						}
+						val[(size_t)i*steps + j] = (m > 0 ? f / (float)m : 0.f);
+					}
+				}
+				else
+				{
+					NODEDATA nd;
+					for (int i = i0; i < i1; ++i)
+					{
+						EvaluateNode(items[i], ntime, nfield, nd);
+						val[(size_t)i*steps + j] = nd.m_val;
+					}
+				}
+			}
+			else if (itemClass == CLASS_FACE)
+			{
+				for (int i = i0; i < i1; ++i)
+				{
+					v = 0.f;
+					EvaluateFace(items[i], ntime, nfield, data, v);
+					val[(size_t)i*steps + j] = v;
+				}
+			}
+			else
+			{
+				for (int i = i0; i < i1; ++i)
+				{
+					v = 0.f;
+					EvaluateElement(items[i], ntime, nfield, data, v);
+					val[(size_t)i*steps + j] = v;
+				}
+			}
+		});
+		TrimMemory();
+	}
+
+	return true;
+}
@@ -29,6 +29,14 @@ SOFTWARE.*/
 //////////////////////////////////////////////////////////////////////
 
 #include "XMLReader.h"
+#include <algorithm>
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -36,23 +44,158 @@ static char THIS_FILE[]=__FILE__;
 #define new DEBUG_NEW
 #endif
 
-int XMLAtt::value(double* pf, int n)
+//////////////////////////////////////////////////////////////////////
+// number parsing
+//////////////////////////////////////////////////////////////////////
+
+inline bool xml_isspace(char c) { return ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')); }
+inline bool xml_isdigit(char c) { return ((unsigned)(c - '0') < 10u); }
+
+const char* xml_parse(const char* sz, const char* se, int& v)
 {
-	char* sz = m_szval;
-	int nr = 0;
-	for (int i = 0; i<n; ++i)
+	const char* s0 = sz;
+	while ((sz < se) && xml_isspace(*sz)) sz++;
+
+	bool neg = false;
+	if ((sz < se) && ((*sz == '-') || (*sz == '+'))) { neg = (*sz == '-'); sz++; }
+	if ((sz >= se) || !xml_isdigit(*sz)) { v = 0; return s0; }
+
+	int n = 0;
+	while ((sz < se) && xml_isdigit(*sz)) n = 10 * n + (*sz++ - '0');
+	v = (neg ? -n : n);
+	return sz;
+}
+
+const char* xml_parse(const char* sz, const char* se, double& v)
+{
+	// powers of ten that are exactly representable
+	static const double p10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	const char* s0 = sz;
+	while ((sz < se) && xml_isspace(*sz)) sz++;
+	const char* sn = sz;
+
+	bool neg = false;
+	if ((sz < se) && ((*sz == '-') || (*sz == '+'))) { neg = (*sz == '-'); sz++; }
+
+	// read the mantissa into an integer
+	uint64_t m = 0;
+	int nd = 0;		// significant digits
+	int e10 = 0;	// decimal exponent
+	int ndigits = 0;
+	while ((sz < se) && xml_isdigit(*sz))
+	{
+		if (nd < 19) { m = 10 * m + (*sz - '0'); if (m) nd++; }
+		else { e10++; nd++; }
+		sz++; ndigits++;
+	}
+	if ((sz < se) && (*sz == '.'))
+	{
+		sz++;
+		while ((sz < se) && xml_isdigit(*sz))
+		{
+			if (nd < 19) { m = 10 * m + (*sz - '0'); if (m) nd++; e10--; }
+			else nd++;
+			sz++; ndigits++;
+		}
+	}
+
+	if (ndigits > 0)
+	{
+		// exponent
+		if ((sz < se) && ((*sz == 'e') || (*sz == 'E')))
+		{
+			int ex = 0;
+			const char* sx = xml_parse(sz + 1, se, ex);
+			if (sx != sz + 1) { e10 += ex; sz = sx; }
+		}
+
+		// If the mantissa and exponent are exactly representable, a single
+		// multiplication or division gives the correctly rounded result.
+		if ((nd <= 15) && (e10 >= -22) && (e10 <= 22))
+		{
+			double d = (double)m;
+			d = (e10 < 0 ? d / p10[-e10] : d * p10[e10]);
+			v = (neg ? -d : d);
+			return sz;
+		}
+	}
+	else if ((sz >= se) || !isalpha(*sz))
 	{
-		char* sze = strchr(sz, ',');
+		// not a number
+		v = 0.0;
+		return s0;
+	}
 
-		pf[i] = atof(sz);
+	// Fall back to strtod for long mantissas, large exponents, inf, nan, etc.
+	char buf[128];
+	size_t l = 0;
+	while ((sn + l < se) && (l < sizeof(buf) - 1) && !xml_isspace(sn[l]) && (sn[l] != ',')) { buf[l] = sn[l]; l++; }
+	buf[l] = 0;
+	char* end = buf;
+	v = strtod(buf, &end);
+	return (end == buf ? s0 : sn + (end - buf));
+}
+
+const char* xml_parse(const char* sz, const char* se, float& v)
+{
+	double d = 0.0;
+	sz = xml_parse(sz, se, d);
+	v = (float)d;
+	return sz;
+}
+
+//-----------------------------------------------------------------------------
+// Parse a comma-separated list of at most n values. Returns the number of values read.
+template <typename T> static int xml_parse_list(const char* sz, const char* se, T* pv, int n)
+{
+	int nr = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		sz = xml_parse(sz, se, pv[i]);
 		nr++;
 
-		if (sze) sz = sze + 1;
-		else break;
+		// find the next comma
+		while ((sz < se) && (*sz != ',')) sz++;
+		if (sz >= se) break;
+		sz++;
 	}
 	return nr;
 }
 
+//-----------------------------------------------------------------------------
+// Parse a list of values separated by commas or white space.
+template <typename T> static void xml_parse_vector(const char* sz, const char* se, std::vector<T>& l)
+{
+	l.clear();
+	while (sz < se)
+	{
+		// skip space
+		while ((sz < se) && xml_isspace(*sz)) ++sz;
+		if (sz >= se) break;
+
+		// read the value
+		T v;
+		sz = xml_parse(sz, se, v);
+		l.push_back(v);
+
+		// find next space or comma
+		while ((sz < se) && !xml_isspace(*sz) && (*sz != ',')) sz++;
+		if ((sz < se) && (*sz == ',')) sz++;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// XMLAtt
+//////////////////////////////////////////////////////////////////////
+
+int XMLAtt::value(double* pf, int n)
+{
+	return xml_parse_list(m_szval, m_szval + strlen(m_szval), pf, n);
+}
+
 //////////////////////////////////////////////////////////////////////
 // XMLTag
 //////////////////////////////////////////////////////////////////////
@@ -65,6 +208,10 @@ XMLTag::XMLTag()
 	m_sztag[0] = 0;
 	m_nlevel = 0;
 
+	m_szv = "";
+	m_nv = 0;
+	m_bsval = true;
+
 	m_natt = 0;
 	int i;
 	for (i=0; i<MAX_ATT; ++i)
@@ -80,131 +227,71 @@ XMLTag::XMLTag()
 
 int XMLTag::value(double* pf, int n)
 {
-	const char* sz = m_sval.c_str();
-	int nr = 0;
-	for (int i=0; i<n; ++i)
-	{
-		const char* sze = strchr(sz, ',');
-
-		pf[i] = atof(sz);
-		nr++;
-
-		if (sze) sz = sze + 1;
-		else break;
-	}
-	return nr;
+	return xml_parse_list(m_szv, m_szv + m_nv, pf, n);
 }
  
 //////////////////////////////////////////////////////////////////////
 
 int XMLTag::value(float* pf, int n)
 {
-	const char* sz = m_sval.c_str();
-	int nr = 0;
-	for (int i=0; i<n; ++i)
-	{
-		const char* sze = strchr(sz, ',');
-
-		pf[i] = (float) atof(sz);
-		nr++;
-
-		if (sze) sz = sze + 1;
-		else break;
-	}
-	return nr;
+	return xml_parse_list(m_szv, m_szv + m_nv, pf, n);
 }
 
 void XMLTag::value(std::vector<double>& l)
 {
-	l.clear();
-	const char *sz = m_sval.c_str();
-	while (sz && *sz)
-	{
-		// skip space
-		while (*sz == ' ') ++sz;
-
-		// read the value
-		if (sz && *sz)
-		{
-			double v = atof(sz);
-			l.push_back(v);
-
-			// find next space or comma
-			while (*sz && (*sz != ' ') && (*sz != ',')) sz++;
-			if (*sz == ',') sz++;
-		}
-	}
+	xml_parse_vector(m_szv, m_szv + m_nv, l);
 }
 
 void XMLTag::value2(std::vector<int>& l)
 {
-	l.clear();
-	const char* sz = m_sval.c_str();
-	while (sz && *sz)
-	{
-		// skip space
-		while (*sz == ' ') ++sz;
-
-		// read the value
-		if (sz && *sz)
-		{
-			int v = (int)atoi(sz);
-			l.push_back(v);
-
-			// find next space or comma
-			while (*sz && (*sz != ' ') && (*sz != ',')) sz++;
-			if (*sz == ',') sz++;
-		}
-	}
+	xml_parse_vector(m_szv, m_szv + m_nv, l);
 }
 
 //////////////////////////////////////////////////////////////////////
 
 int XMLTag::value(int* pi, int n)
 {
-	const char* sz = m_sval.c_str();
-	int nr = 0;
-	for (int i=0; i<n; ++i)
-	{
-		const char* sze = strchr(sz, ',');
-
-		pi[i] = atoi(sz);
-		nr++;
-
-		if (sze) sz = sze + 1;
-		else break;
-	}
-	return nr;
+	return xml_parse_list(m_szv, m_szv + m_nv, pi, n);
 }
 
 //////////////////////////////////////////////////////////////////////
 
+void XMLTag::value(double& val) { xml_parse(m_szv, m_szv + m_nv, val); }
+void XMLTag::value(float& val) { xml_parse(m_szv, m_szv + m_nv, val); }
+void XMLTag::value(int& val) { xml_parse(m_szv, m_szv + m_nv, val); }
+
 void XMLTag::value(vec3d& v)
 {
-	sscanf(m_sval.c_str(), "%lg,%lg,%lg", &v.x, &v.y, &v.z);
+	double a[3] = { v.x, v.y, v.z };
+	xml_parse_list(m_szv, m_szv + m_nv, a, 3);
+	v = vec3d(a[0], a[1], a[2]);
 }
 
 void XMLTag::value(vec2i& v)
 {
-	sscanf(m_sval.c_str(), "%d,%d", &v.x, &v.y);
+	int a[2] = { v.x, v.y };
+	xml_parse_list(m_szv, m_szv + m_nv, a, 2);
+	v.x = a[0]; v.y = a[1];
 }
 
 void XMLTag::value(vec3f& v)
 {
-	sscanf(m_sval.c_str(), "%g,%g,%g", &v.x, &v.y, &v.z);
+	float a[3] = { v.x, v.y, v.z };
+	xml_parse_list(m_szv, m_szv + m_nv, a, 3);
+	v.x = a[0]; v.y = a[1]; v.z = a[2];
 }
 
 void XMLTag::value(mat3d& m)
 {
 	double a[9] = { 0 };
-	sscanf(m_sval.c_str(), "%lg,%lg,%lg,%lg,%lg,%lg,%lg,%lg,%lg", a, a+1, a+2,a+3,a+4,a+5,a+6,a+7,a+8);
+	xml_parse_list(m_szv, m_szv + m_nv, a, 9);
 	m = mat3d(a);
 }
 
 void XMLTag::value(GLColor& c)
 {
 	int n[3] = { 0,0,0 };
-	sscanf(m_sval.c_str(), "%d,%d,%d", &n[0], &n[1], &n[2]);
+	xml_parse_list(m_szv, m_szv + m_nv, n, 3);
 	c.r = (Byte)n[0];
 	c.g = (Byte)n[1];
 	c.b = (Byte)n[2];
@@ -212,77 +299,66 @@ void XMLTag::value(GLColor& c)
 
 void XMLTag::value(std::string& s)
 {
-	s = m_sval;
+	s = sval();
 }
 
 //-----------------------------------------------------------------------------
-void XMLTag::value(vector<int>& l)
+// Copy the value into m_sval. Line breaks are not part of the value.
+const std::string& XMLTag::sval()
 {
-	int i, n = 0, n0, n1, nn;
-	char* szval = strdup(m_sval.c_str());
-	char* ch;
-	char* sz = szval;
-	int nread;
-	do
+	if (m_bsval == false)
 	{
-		ch = strchr(sz, ',');
-		if (ch) *ch = 0;
-		nread = sscanf(sz, "%d:%d:%d", &n0, &n1, &nn);
-		switch (nread)
+		m_sval.clear();
+		m_sval.reserve(m_nv);
+		const char* sz = m_szv;
+		const char* se = m_szv + m_nv;
+		while (sz < se)
 		{
-		case 1:
-			n1 = n0;
-			nn = 1;
-			break;
-		case 2:
-			nn = 1;
-			break;
-		case 3:
-			break;
-		default:
-			n0 = 0;
-			n1 = -1;
-			nn = 1;
+			const char* sn = (const char*)memchr(sz, '\n', se - sz);
+			if (sn == nullptr) sn = se;
+			m_sval.append(sz, sn - sz);
+			sz = sn + 1;
 		}
-
-		for (i=n0; i<=n1; i += nn) ++n;
-
-		if (ch) *ch = ',';
-		sz = ch+1;
+		m_bsval = true;
 	}
-	while (ch != 0);
+	return m_sval;
+}
 
-	if (n != 0)
+//-----------------------------------------------------------------------------
+// Read a list of comma-separated items, where each item is either a single
+// number, or a range n0:n1 or n0:n1:nn.
+void XMLTag::value(vector<int>& l)
+{
+	l.clear();
+	const char* sz = m_szv;
+	const char* se = m_szv + m_nv;
+	while (sz < se)
 	{
-		l.resize(n);
-
-		sz = szval;
-		n = 0;
-		do
+		int n0 = 0, n1 = -1, nn = 1;
+		const char* ch = xml_parse(sz, se, n0);
+		if (ch != sz)
 		{
-			ch = strchr(sz, ',');
-			if (ch) *ch = 0;
-			nread = sscanf(sz, "%d:%d:%d", &n0, &n1, &nn);
-			switch (nread)
+			n1 = n0;
+			while ((ch < se) && xml_isspace(*ch)) ch++;
+			if ((ch < se) && (*ch == ':'))
 			{
-			case 1:
-				n1 = n0;
-				nn = 1;
-				break;
-			case 2:
-				nn = 1;
+				ch = xml_parse(ch + 1, se, n1);
+				while ((ch < se) && xml_isspace(*ch)) ch++;
+				if ((ch < se) && (*ch == ':'))
+				{
+					ch = xml_parse(ch + 1, se, nn);
+					if (nn <= 0) nn = 1;
+				}
 			}
+		}
 
-			for (i=n0; i<=n1; i += nn) l[n++] = i;
-			assert(n <= (int) l.size());
+		if (n1 - n0 > 0) l.reserve(l.size() + (n1 - n0) / nn + 1);
+		for (int i = n0; i <= n1; i += nn) l.push_back(i);
 
-			if (ch) *ch = ',';
-			sz = ch+1;
-		}
-		while (ch != 0);
+		// find the next item
+		while ((ch < se) && (*ch != ',')) ch++;
+		sz = ch + 1;
 	}
-
-	free(szval);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -343,10 +419,11 @@ XMLReader::XMLReader()
 	m_fp = 0;
 	m_ownFile = false;
 	m_nline = 0;
-	m_bufIndex = 0;
-	m_bufSize = 0;
-	m_eof = false;
 	m_currentPos = 0;
+	m_pdata = nullptr;
+	m_size = 0;
+	m_pmap = nullptr;
+	m_hmap = nullptr;
 }
 
 XMLReader::~XMLReader()
@@ -356,20 +433,101 @@ XMLReader::~XMLReader()
 
 void XMLReader::Close()
 {
+	UnmapFile();
+
 	if (m_ownFile && (m_fp != 0))
 	{
 		fclose(m_fp);
 	}
 	m_fp = 0;
 
-	m_bufIndex = 0;
-	m_bufSize = 0;
-	m_eof = false;
 	m_currentPos = 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 
+bool XMLReader::MapFile()
+{
+	UnmapFile();
+	if (m_fp == 0) return false;
+
+	// parsing continues from the current file position
+	int64_t pos = (int64_t) ftell(m_fp);
+	if (pos < 0) pos = 0;
+
+#ifdef WIN32
+	HANDLE hf = (HANDLE)_get_osfhandle(_fileno(m_fp));
+	LARGE_INTEGER size;
+	if ((hf != INVALID_HANDLE_VALUE) && GetFileSizeEx(hf, &size) && (size.QuadPart > 0))
+	{
+		HANDLE hm = CreateFileMapping(hf, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (hm)
+		{
+			void* p = MapViewOfFile(hm, FILE_MAP_READ, 0, 0, 0);
+			if (p)
+			{
+				m_pmap = p;
+				m_hmap = hm;
+				m_size = size.QuadPart;
+			}
+			else CloseHandle(hm);
+		}
+	}
+#else
+	struct stat st;
+	int fd = fileno(m_fp);
+	if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+	{
+		void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			m_pmap = p;
+			m_size = st.st_size;
+		}
+	}
+#endif
+
+	if (m_pmap) m_pdata = (const char*) m_pmap;
+	else
+	{
+		// we could not map the file, so just read it in one go
+		fseek(m_fp, 0, SEEK_END);
+		long n = ftell(m_fp);
+		if (n < 0) return false;
+		fseek(m_fp, 0, SEEK_SET);
+		m_data.resize(n);
+		if ((n > 0) && (fread(&m_data[0], 1, n, m_fp) != (size_t) n)) { m_data.clear(); return false; }
+		fseek(m_fp, (long) pos, SEEK_SET);
+		m_pdata = m_data.data();
+		m_size = n;
+	}
+
+	m_currentPos = pos;
+	return true;
+}
+
+void XMLReader::UnmapFile()
+{
+	if (m_pmap)
+	{
+#ifdef WIN32
+		UnmapViewOfFile(m_pmap);
+		CloseHandle((HANDLE) m_hmap);
+#else
+		munmap(m_pmap, m_size);
+#endif
+	}
+	m_pmap = nullptr;
+	m_hmap = nullptr;
+
+	std::vector<char>().swap(m_data);
+	m_pdata = nullptr;
+	m_size = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 // Open a file. 
 bool XMLReader::Open(const char* szfile, bool checkForXMLTag)
 {
@@ -396,6 +554,7 @@ bool XMLReader::Open(const char* szfile, bool checkForXMLTag)
 	}
 
 	// This file is ready to be processed
+	if (MapFile() == false) { Close(); return false; }
 	return true;
 }
 
@@ -417,7 +576,7 @@ bool XMLReader::Attach(FILE* fp)
 	}
 
 	// This file is ready to be processed
-	return true;
+	return MapFile();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -425,10 +584,7 @@ bool XMLReader::Attach(FILE* fp)
 bool XMLReader::FindTag(const char* sztag, XMLTag& tag)
 {
 	// go to the beginning of the file
-	fseek(m_fp, 0, SEEK_SET);
-	m_bufIndex = m_bufSize = 0;
 	m_currentPos = 0;
-	m_eof = false;
 
 	// set the first tag
 	tag.m_preader = this;
@@ -455,13 +611,7 @@ void XMLReader::NextTag(XMLTag& tag)
 	m_nline = tag.m_ncurrent_line;
 
 	// set the current file position
-	if (m_currentPos != tag.m_fpos)
-	{
-		fseek(m_fp, tag.m_fpos, SEEK_SET);
-		m_currentPos = tag.m_fpos;
-		m_bufSize = m_bufIndex = 0;
-		m_eof = false;
-	}
+	m_currentPos = tag.m_fpos;
 
 	// clear tag's content
 	tag.clear();
@@ -634,13 +784,24 @@ void XMLReader::ReadTag(XMLTag& tag)
 
 void XMLReader::ReadValue(XMLTag& tag)
 {
-	char ch;
+	// the value runs until the start of the next tag
+	const char* sz = m_pdata + m_currentPos;
+	const char* se = (const char*) memchr(sz, '<', m_size - m_currentPos);
+	if (se == nullptr)
+	{
+		m_currentPos = m_size;
+		throw EndOfFile();
+	}
+
+	m_nline += (int) std::count(sz, se, '\n');
+	m_currentPos += (se - sz) + 1;
+
 	if (!tag.isend())
 	{
-		tag.m_sval.clear();
-		while ((ch=GetChar())!='<') tag.m_sval += ch;
+		tag.m_szv = sz;
+		tag.m_nv = se - sz;
+		tag.m_bsval = (tag.m_nv == 0);
 	}
-	else while ((ch=GetChar())!='<');
 }
 
 void XMLReader::ReadEndTag(XMLTag& tag)
@@ -717,3 +878,198 @@ void XMLReader::SkipTag(XMLTag& tag)
 	}
 	while (!tag.isend());
 }
+
+//////////////////////////////////////////////////////////////////////
+// XMLLeaf
+//////////////////////////////////////////////////////////////////////
+
+bool XMLLeaf::FindAttribute(const char* szatt, const char*& sz, const char*& se) const
+{
+	size_t l = strlen(szatt);
+	const char* s = m_szatt;
+	const char* sf = m_szatt + m_natt;
+	while (s < sf)
+	{
+		// read the attribute's name
+		while ((s < sf) && xml_isspace(*s)) s++;
+		if (s >= sf) break;
+		const char* sn = s;
+		while ((s < sf) && isvalid(*s)) s++;
+		size_t nl = s - sn;
+
+		while ((s < sf) && xml_isspace(*s)) s++;
+		if ((s >= sf) || (*s != '=')) return false;
+		s++;
+
+		// read the value
+		while ((s < sf) && xml_isspace(*s)) s++;
+		if ((s >= sf) || ((*s != '"') && (*s != '\''))) return false;
+		char quot = *s++;
+		const char* sv = s;
+		while ((s < sf) && (*s != quot)) s++;
+		if (s >= sf) return false;
+
+		if ((nl == l) && (strncmp(sn, szatt, l) == 0))
+		{
+			sz = sv;
+			se = s;
+			return true;
+		}
+		s++;
+	}
+	return false;
+}
+
+int XMLLeaf::AttributeValue(const char* szatt, int def_val) const
+{
+	const char *sz, *se;
+	if (FindAttribute(szatt, sz, se) == false) return def_val;
+	int v = def_val;
+	xml_parse(sz, se, v);
+	return v;
+}
+
+int XMLLeaf::value(int* pi, int n) const
+{
+	return xml_parse_list(m_szv, m_szv + m_nv, pi, n);
+}
+
+int XMLLeaf::value(double* pf, int n) const
+{
+	return xml_parse_list(m_szv, m_szv + m_nv, pf, n);
+}
+
+void XMLLeaf::value(vec3d& v) const
+{
+	double a[3] = { v.x, v.y, v.z };
+	xml_parse_list(m_szv, m_szv + m_nv, a, 3);
+	v = vec3d(a[0], a[1], a[2]);
+}
+
+//-----------------------------------------------------------------------------
+// Tokenize the leaf elements in [sz, se). Returns false if anything other
+// than a leaf element is found.
+static bool parse_leaves(const char* sz, const char* se, std::vector<XMLLeaf>& leaves)
+{
+	while (true)
+	{
+		while ((sz < se) && xml_isspace(*sz)) sz++;
+		if (sz >= se) return true;
+		if (*sz != '<') return false;
+
+		// read the tag name
+		XMLLeaf leaf;
+		const char* s = sz + 1;
+		leaf.m_szname = s;
+		while ((s < se) && isvalid(*s)) s++;
+		leaf.m_nname = s - leaf.m_szname;
+		if (leaf.m_nname == 0) return false;
+
+		// find the end of the start tag
+		const char* gt = (const char*)memchr(s, '>', se - s);
+		if (gt == nullptr) return false;
+		leaf.m_szatt = s;
+
+		if (gt[-1] == '/')
+		{
+			// empty element
+			leaf.m_natt = gt - 1 - s;
+			leaf.m_szv = gt;
+			leaf.m_nv = 0;
+			sz = gt + 1;
+		}
+		else
+		{
+			leaf.m_natt = gt - s;
+
+			// the value runs until the end tag
+			const char* lt = (const char*)memchr(gt + 1, '<', se - gt - 1);
+			if (lt == nullptr) return false;
+			leaf.m_szv = gt + 1;
+			leaf.m_nv = lt - gt - 1;
+
+			// make sure the end tag matches
+			if ((size_t)(se - lt) < leaf.m_nname + 3) return false;
+			if ((lt[1] != '/') || (strncmp(lt + 2, leaf.m_szname, leaf.m_nname) != 0)) return false;
+			s = lt + 2 + leaf.m_nname;
+			while ((s < se) && xml_isspace(*s)) s++;
+			if ((s >= se) || (*s != '>')) return false;
+			sz = s + 1;
+		}
+
+		leaves.push_back(leaf);
+	}
+}
+
+bool XMLReader::ReadLeafBlock(XMLTag& tag, std::vector<XMLLeaf>& leaves)
+{
+	// size of the chunks that are tokenized in parallel
+	const int64_t CHUNK_SIZE = 1 << 20;
+
+	leaves.clear();
+	if (tag.isleaf() || tag.isend() || (m_pdata == nullptr)) return false;
+
+	// find the end tag
+	const char* sz = m_pdata + tag.m_fpos;
+	const char* sf = m_pdata + m_size;
+	size_t l = strlen(tag.m_sztag);
+	const char* se = sz;
+	while (true)
+	{
+		se = (const char*)memchr(se, '<', sf - se);
+		if ((se == nullptr) || (se + 1 >= sf)) return false;
+
+		// comments and CDATA sections are handled by the regular parser
+		if (se[1] == '!') return false;
+
+		if ((se[1] == '/') && (se + l + 2 < sf) && (strncmp(se + 2, tag.m_sztag, l) == 0) && !isvalid(se[l + 2])) break;
+		se++;
+	}
+
+	// split the block at element boundaries
+	int chunks = (int)((se - sz) / CHUNK_SIZE) + 1;
+	std::vector<const char*> start(chunks + 1);
+	start[0] = sz;
+	start[chunks] = se;
+	for (int i = 1; i < chunks; ++i)
+	{
+		const char* s = sz + (se - sz) * i / chunks;
+		if (s < start[i - 1]) s = start[i - 1];
+		while ((s < se) && ((s = (const char*)memchr(s, '<', se - s)) != nullptr) && (s[1] == '/')) s++;
+		start[i] = (s ? s : se);
+	}
+
+	// tokenize the chunks
+	std::vector< std::vector<XMLLeaf> > chunk(chunks);
+	std::vector<int> lines(chunks, 0);
+	int nerr = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:nerr)
+	for (int i = 0; i < chunks; ++i)
+	{
+		if (parse_leaves(start[i], start[i + 1], chunk[i]) == false) nerr++;
+		lines[i] = (int) std::count(start[i], start[i + 1], '\n');
+	}
+	if (nerr > 0) return false;
+
+	// assemble the list
+	std::vector<size_t> offset(chunks + 1, 0);
+	int nlines = 0;
+	for (int i = 0; i < chunks; ++i)
+	{
+		offset[i + 1] = offset[i] + chunk[i].size();
+		nlines += lines[i];
+	}
+	leaves.resize(offset[chunks]);
+#pragma omp parallel for
+	for (int i = 0; i < chunks; ++i)
+	{
+		std::copy(chunk[i].begin(), chunk[i].end(), leaves.begin() + offset[i]);
+	}
+
+	// read the end tag
+	tag.m_fpos = se - m_pdata;
+	tag.m_ncurrent_line += nlines;
+	NextTag(tag);
+
+	return true;
+}
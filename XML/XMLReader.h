@@ -34,6 +34,8 @@ SOFTWARE.*/
 #include <FSCore/color.h>
 #include <stdexcept>
 #include <cstring>
+#include <vector>
+#include <stdint.h>
 
 #ifndef WIN32
 	#include <string>
@@ -76,7 +78,13 @@ public:
 
 public:
 	char		m_sztag[MAX_TAG];	// tag name
-	std::string	m_sval;				// tag value
+
+	// The tag's value is a view into the reader's buffer. It is only copied
+	// into m_sval when it is requested as a string (see sval()).
+	const char*	m_szv;				// start of value
+	size_t		m_nv;				// length of value
+	std::string	m_sval;				// tag value (as string)
+	bool		m_bsval;			// is m_sval up to date?
 
 	XMLAtt	m_att[MAX_ATT];		// attributes
 
@@ -104,7 +112,10 @@ public:
 	void clear()
 	{
 		m_sztag[0] = 0;
+		m_szv = "";
+		m_nv = 0;
 		m_sval.clear();
+		m_bsval = true;
 		m_natt = 0;
 		m_bend = false;
 		m_bleaf = true;
@@ -136,10 +147,10 @@ public:
 
 	const char* Name() { return m_sztag; }
 
-	void value(char* szstr) { strcpy(szstr, m_sval.c_str()); }
-	void value(double& val) { val = atof(m_sval.c_str()); } 
-	void value(float& val)  { val = (float) atof(m_sval.c_str()); }
-	void value(int& val) { val = atoi(m_sval.c_str()); }
+	void value(char* szstr) { strcpy(szstr, sval().c_str()); }
+	void value(double& val);
+	void value(float& val);
+	void value(int& val);
 	int value(double* pf, int n);
 	int value(float* pf, int n);
 	int value(int* pi, int n);
@@ -147,14 +158,17 @@ public:
 	void value(vec2i& v);
 	void value(mat3d& v);
 	void value(vec3f& v);
-	void value(bool& b) { b = (atoi(m_sval.c_str()) == 1); }
+	void value(bool& b) { int n; value(n); b = (n == 1); }
 	void value(std::vector<int>& l);
 	void value2(std::vector<int>& l);
 	void value(std::vector<double>& l);
 	void value(GLColor& c);
 	void value(std::string& s);
 
-	const char* szvalue() { return m_sval.c_str(); }
+	const char* szvalue() { return sval().c_str(); }
+
+	// the value as a string
+	const std::string& sval();
 
 	const std::string& comment();
 };
@@ -180,11 +194,48 @@ template <> inline std::string XMLTag::AttributeValue<std::string>(const char* s
 	else return def_val;
 }
 
-class XMLReader  
+//-----------------------------------------------------------------------------
+// Locale-independent number parsing. These skip leading white space, parse a
+// number from [sz, se) and return a pointer to the first character that was not
+// parsed. If no number was found, v is set to zero and sz is returned.
+const char* xml_parse(const char* sz, const char* se, int& v);
+const char* xml_parse(const char* sz, const char* se, float& v);
+const char* xml_parse(const char* sz, const char* se, double& v);
+
+//-----------------------------------------------------------------------------
+// A leaf element (i.e. <name att="...">value</name>) that was extracted with
+// XMLReader::ReadLeafBlock. This is a view into the reader's buffer, so it is
+// only valid while the reader is open.
+class XMLLeaf
 {
 public:
-	enum { BUF_SIZE = 4096 };
+	const char*	m_szname;	// tag name
+	size_t		m_nname;
+	const char*	m_szatt;	// attribute section
+	size_t		m_natt;
+	const char*	m_szv;		// value
+	size_t		m_nv;
 
+public:
+	bool operator == (const char* sztag) const { return ((strlen(sztag) == m_nname) && (strncmp(sztag, m_szname, m_nname) == 0)); }
+	bool operator != (const char* sztag) const { return !(*this == sztag); }
+
+	// find an attribute's value. Returns false if the attribute is not defined.
+	bool FindAttribute(const char* szatt, const char*& sz, const char*& se) const;
+
+	int AttributeValue(const char* szatt, int def_val) const;
+
+	int value(int* pi, int n) const;
+	int value(double* pf, int n) const;
+	void value(vec3d& v) const;
+};
+
+//-----------------------------------------------------------------------------
+// The XMLReader maps the file into memory (or reads it in one go when mapping
+// is not possible), so tags are tokenized in place and values are handed out
+// as views into the file buffer.
+class XMLReader  
+{
 public:
 	// exceptions -----------
 
@@ -287,6 +338,13 @@ public:
 
 	const std::string& GetLastComment();
 
+	// Extract the children of a tag whose children are all leaf elements (e.g.
+	// the <Nodes> or <Elements> sections). The block is split into chunks that
+	// are tokenized in parallel, and the tag is moved to its end tag. If the block
+	// cannot be processed this way (e.g. it contains comments or nested elements)
+	// false is returned and the tag is not modified.
+	bool ReadLeafBlock(XMLTag& tag, std::vector<XMLLeaf>& leaves);
+
 	int64_t currentPos()
 	{
 		return m_currentPos;
@@ -302,29 +360,13 @@ protected:
 
 	char readNextChar()
 	{
-		if (m_bufIndex >= m_bufSize)
-		{
-			if (m_eof) throw EndOfFile();
-
-			m_bufSize = fread(m_buf, 1, BUF_SIZE, m_fp);
-			m_bufIndex = 0;
-			m_eof = (m_bufSize != BUF_SIZE);
-		}
-		m_currentPos++;
-		return m_buf[m_bufIndex++];
+		if (m_currentPos >= m_size) throw EndOfFile();
+		return m_pdata[m_currentPos++];
 	}
 
 	void rewind(int64_t nstep)
 	{
-		m_bufIndex -= nstep;
 		m_currentPos -= nstep;
-
-		if (m_bufIndex < 0)
-		{
-			fseek(m_fp, m_bufIndex - m_bufSize, SEEK_CUR);
-			m_bufIndex = m_bufSize = 0;
-			m_eof = false;
-		}
 	}
 
 	// only used for processing comments
@@ -340,6 +382,10 @@ protected:
 		return ch;
 	}
 
+	// map the file into memory, starting parsing at the current file position
+	bool MapFile();
+	void UnmapFile();
+
 	void ReadTag(XMLTag& tag);
 	void ReadValue(XMLTag& tag);
 	void ReadEndTag(XMLTag& tag);
@@ -353,9 +399,11 @@ protected:
 
 	std::string	m_comment;	// last comment that was read
 
-	char		m_buf[BUF_SIZE];
-	int64_t		m_bufIndex, m_bufSize;
-	bool		m_eof;
+	const char*	m_pdata;	//!< file contents
+	int64_t		m_size;		//!< size of file
+	void*		m_pmap;		//!< start of memory-mapped file (null if the file was read into m_data)
+	void*		m_hmap;		//!< file mapping handle (Windows only)
+	std::vector<char>	m_data;	//!< file contents, if the file could not be mapped
 
 	friend class XMLTag;
 };
@@ -29,6 +29,181 @@ SOFTWARE.*/
 //////////////////////////////////////////////////////////////////////
 
 #include "XMLWriter.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+
+//////////////////////////////////////////////////////////////////////
+// number formatting
+//////////////////////////////////////////////////////////////////////
+
+// powers of ten that are exactly representable
+static const double p10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+int xml_format_int(char* sz, int n, int width)
+{
+	char tmp[16];
+	int l = 0;
+	unsigned int u = (n < 0 ? 0u - (unsigned int)n : (unsigned int)n);
+	do { tmp[l++] = (char)('0' + u % 10); u /= 10; } while (u);
+	if (n < 0) tmp[l++] = '-';
+
+	char* s = sz;
+	for (int i = l; i < width; ++i) *s++ = ' ';
+	while (l > 0) *s++ = tmp[--l];
+	*s = 0;
+	return (int)(s - sz);
+}
+
+//-----------------------------------------------------------------------------
+// Calculate the prec most significant decimal digits of v > 0, i.e. v ~ m*10^(e10 - prec + 1).
+// Scaling with an exact power of ten needs only a single rounding, so the digits
+// are the same as printf's, except (extremely rarely) when v is within an ulp of
+// a rounding tie. Returns false if v is outside the range where this works.
+static bool xml_digits(double v, int prec, uint64_t& m, int& e10)
+{
+	e10 = (int)floor(log10(v));
+	double d = 0.0;
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		int k = prec - 1 - e10;
+		if ((k > 22) || (k < -22)) return false;
+		d = (k >= 0 ? v * p10[k] : v / p10[-k]);
+
+		// log10 can be off by one near powers of ten
+		if (d < p10[prec - 1]) e10--;
+		else if (d >= p10[prec]) e10++;
+		else break;
+	}
+
+	double r = nearbyint(d);
+	if (r >= p10[prec]) { r = p10[prec - 1]; e10++; }
+	m = (uint64_t)r;
+	return true;
+}
+
+// write the exponent as printf does (sign and at least two digits)
+static char* xml_exponent(char* s, int e10)
+{
+	*s++ = 'e';
+	*s++ = (e10 < 0 ? '-' : '+');
+	if (e10 < 0) e10 = -e10;
+	if (e10 >= 100) *s++ = (char)('0' + e10 / 100);
+	*s++ = (char)('0' + (e10 / 10) % 10);
+	*s++ = (char)('0' + e10 % 10);
+	return s;
+}
+
+int xml_format_g(char* sz, double v, int prec)
+{
+	if (prec <= 0) prec = 1;
+	if ((prec > 15) || (v != v) || (v - v != 0.0)) return sprintf(sz, "%.*g", prec, v);
+
+	char* s = sz;
+	if (v == 0.0)
+	{
+		if (signbit(v)) *s++ = '-';
+		*s++ = '0'; *s = 0;
+		return (int)(s - sz);
+	}
+
+	uint64_t m;
+	int e10;
+	if (xml_digits(fabs(v), prec, m, e10) == false) return sprintf(sz, "%.*g", prec, v);
+	if (v < 0) *s++ = '-';
+
+	char d[16];
+	for (int i = prec - 1; i >= 0; --i) { d[i] = (char)('0' + m % 10); m /= 10; }
+	int nd = prec;
+	while ((nd > 1) && (d[nd - 1] == '0')) nd--;
+
+	if ((e10 < -4) || (e10 >= prec))
+	{
+		*s++ = d[0];
+		if (nd > 1) { *s++ = '.'; for (int i = 1; i < nd; ++i) *s++ = d[i]; }
+		s = xml_exponent(s, e10);
+	}
+	else if (e10 >= 0)
+	{
+		for (int i = 0; i <= e10; ++i) *s++ = (i < nd ? d[i] : '0');
+		if (nd > e10 + 1)
+		{
+			*s++ = '.';
+			for (int i = e10 + 1; i < nd; ++i) *s++ = d[i];
+		}
+	}
+	else
+	{
+		*s++ = '0'; *s++ = '.';
+		for (int i = 1; i < -e10; ++i) *s++ = '0';
+		for (int i = 0; i < nd; ++i) *s++ = d[i];
+	}
+	*s = 0;
+	return (int)(s - sz);
+}
+
+int xml_format_e(char* sz, double v, int prec, int width)
+{
+	if ((prec < 0) || (prec > 14) || (v != v) || (v - v != 0.0)) return sprintf(sz, "%*.*e", width, prec, v);
+
+	char tmp[32];
+	char* s = tmp;
+	if (signbit(v)) *s++ = '-';
+
+	uint64_t m = 0;
+	int e10 = 0;
+	if ((v != 0.0) && (xml_digits(fabs(v), prec + 1, m, e10) == false)) return sprintf(sz, "%*.*e", width, prec, v);
+
+	char d[16];
+	for (int i = prec; i >= 0; --i) { d[i] = (char)('0' + m % 10); m /= 10; }
+	*s++ = d[0];
+	if (prec > 0) { *s++ = '.'; for (int i = 1; i <= prec; ++i) *s++ = d[i]; }
+	s = xml_exponent(s, e10);
+
+	int l = (int)(s - tmp);
+	char* o = sz;
+	for (int i = l; i < width; ++i) *o++ = ' ';
+	memcpy(o, tmp, l); o += l;
+	*o = 0;
+	return (int)(o - sz);
+}
+
+//-----------------------------------------------------------------------------
+// If v has a representation with at most 15 significant digits, it is found by
+// rounding to 15 digits and removing trailing zeros. Otherwise, 16 or 17 digits
+// are needed, and printf is used for these.
+int xml_format_shortest(char* sz, double v)
+{
+	if ((v != 0.0) && (v == v) && (v - v == 0.0))
+	{
+		uint64_t m;
+		int e10;
+		if (xml_digits(fabs(v), 15, m, e10))
+		{
+			// check that the digits read back exactly (m < 2^53, so this is a single rounding)
+			int k = e10 - 14;
+			double w = (k >= 0 ? (double)m * p10[k] : (double)m / p10[-k]);
+			if ((k >= -22) && (k <= 22) && (w == fabs(v))) return xml_format_g(sz, v, 15);
+		}
+		int l = sprintf(sz, "%.16g", v);
+		if (strtod(sz, nullptr) == v) return l;
+		return sprintf(sz, "%.17g", v);
+	}
+	return xml_format_g(sz, v, 15);
+}
+
+// field width of integer format strings such as "%6d"
+static int int_width(const char* szfmt)
+{
+	return ((szfmt[0] == '%') ? atoi(szfmt + 1) : 0);
+}
+
+//////////////////////////////////////////////////////////////////////
+// XMLElement
+//////////////////////////////////////////////////////////////////////
 
 const char* XMLElement::intFormat = "%6d";
 
@@ -37,18 +212,28 @@ void XMLElement::setDefautlFormats()
 	intFormat = "%6d";
 }
 
+void XMLElement::value(int n)
+{
+	xml_format_int(m_szval, n);
+}
+
+void XMLElement::value(double g)
+{
+	xml_format_g(m_szval, g, 9);
+}
+
 void XMLElement::value(int* pi, int n)
 {
 	m_szval[0] = 0;
 	if (n==0) return;
 
-	sprintf(m_szval, intFormat, pi[0]);
-	int l = (int)strlen(m_szval);
+	int w = int_width(intFormat);
+	char* s = m_szval;
+	s += xml_format_int(s, pi[0], w);
 	for (int i=1; i<n; ++i)
 	{
-		sprintf(m_szval+l, ",");
-		sprintf(m_szval + l + 1, intFormat, pi[i]);
-		l = (int)strlen(m_szval);
+		*s++ = ',';
+		s += xml_format_int(s, pi[i], w);
 	}
 }
 
@@ -57,23 +242,36 @@ void XMLElement::value(double* pg, int n)
 	m_szval[0] = 0;
 	if (n==0) return;
 
-	sprintf(m_szval, "%lg", pg[0]);
-	int l = (int)strlen(m_szval);
+	char* s = m_szval;
+	s += xml_format_g(s, pg[0]);
 	for (int i=1; i<n; ++i)
 	{
-		sprintf(m_szval+l, ",%lg", pg[i]);
-		l = (int)strlen(m_szval);
+		*s++ = ',';
+		s += xml_format_g(s, pg[i]);
 	}
 }
 
 void XMLElement::value(const vec3d& r)
 { 
-	if (XMLWriter::GetFloatFormat() == XMLWriter::ScientificFormat)
-		sprintf(m_szval, "%15.7e,%15.7e,%15.7e", r.x, r.y, r.z); 
-	else
-		sprintf(m_szval, "%.9lg,%.9lg,%.9lg", r.x, r.y, r.z);
+	char* s = m_szval;
+	switch (XMLWriter::GetFloatFormat())
+	{
+	case XMLWriter::ScientificFormat:
+		s += xml_format_e(s, r.x, 7, 15); *s++ = ',';
+		s += xml_format_e(s, r.y, 7, 15); *s++ = ',';
+		s += xml_format_e(s, r.z, 7, 15);
+		break;
+	case XMLWriter::ShortestFormat:
+		s += xml_format_shortest(s, r.x); *s++ = ',';
+		s += xml_format_shortest(s, r.y); *s++ = ',';
+		s += xml_format_shortest(s, r.z);
+		break;
+	default:
+		s += xml_format_g(s, r.x, 9); *s++ = ',';
+		s += xml_format_g(s, r.y, 9); *s++ = ',';
+		s += xml_format_g(s, r.z, 9);
+	}
 }
-
 void XMLElement::value(const vec2i& r)
 {
 	sprintf(m_szval, "%d,%d", r.x, r.y);
@@ -107,7 +305,7 @@ int XMLElement::add_attribute(const char* szn, const char* szv)
 int XMLElement::add_attribute(const char* szn, int n)
 {
 	strcpy(m_attn[m_natt], szn);
-	sprintf(m_attv[m_natt], "%d", n);
+	xml_format_int(m_attv[m_natt], n);
 	m_natt++;
 	return m_natt-1;
 }
@@ -123,7 +321,7 @@ int XMLElement::add_attribute(const char* szn, bool b)
 int XMLElement::add_attribute(const char* szn, double g)
 {
 	strcpy(m_attn[m_natt], szn);
-	sprintf(m_attv[m_natt], "%lg", g);
+	xml_format_g(m_attv[m_natt], g);
 	m_natt++;
 	return m_natt-1;
 }
@@ -143,7 +341,7 @@ void XMLElement::set_attribute(int nid, const char* szv)
 
 void XMLElement::set_attribute(int nid, int n)
 {
-	sprintf(m_attv[nid], "%d", n);
+	xml_format_int(m_attv[nid], n);
 }
 
 void XMLElement::set_attribute(int nid, bool b)
@@ -153,10 +351,11 @@ void XMLElement::set_attribute(int nid, bool b)
 
 void XMLElement::set_attribute(int nid, double g)
 {
-	sprintf(m_attv[nid], "%lg", g);
+	xml_format_g(m_attv[nid], g);
 }
 
 
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -173,6 +372,11 @@ XMLWriter::XMLFloatFormat XMLWriter::GetFloatFormat()
 	return m_floatFormat;
 }
 
+static double wall_time()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 XMLWriter::XMLWriter()
 {
 	m_fp = 0;
@@ -180,6 +384,11 @@ XMLWriter::XMLWriter()
 
 	m_sztab[0] = 0;
 
+	m_nbuf = 0;
+	m_bytes = 0.0;
+	m_startTime = 0.0;
+	m_throughput = 0.0;
+
 	XMLElement::setDefautlFormats();
 }
 
@@ -194,16 +403,55 @@ bool XMLWriter::open(const char* szfile)
 	if (szfile == nullptr) return false;
 
 	m_fp = fopen(szfile, "wt");
+	if (m_fp == nullptr) return false;
+
+	m_buf.resize(BUF_SIZE);
+	m_nbuf = 0;
+	m_bytes = 0.0;
+	m_startTime = wall_time();
 
 	// write the first line
-	if (m_fp) fprintf(m_fp, "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n");
+	write("<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n");
 	
-	return (m_fp != nullptr);
+	return true;
 }
 
 void XMLWriter::close()
 {
-	if (m_fp) fclose(m_fp); m_fp = 0;
+	if (m_fp)
+	{
+		flush();
+		fclose(m_fp);
+
+		double dt = wall_time() - m_startTime;
+		m_throughput = (dt > 0.0 ? m_bytes / (1024.0*1024.0) / dt : 0.0);
+	}
+	m_fp = 0;
+	std::vector<char>().swap(m_buf);
+	m_nbuf = 0;
+}
+
+void XMLWriter::flush()
+{
+	if (m_fp && (m_nbuf > 0)) fwrite(&m_buf[0], 1, m_nbuf, m_fp);
+	m_bytes += (double)m_nbuf;
+	m_nbuf = 0;
+}
+
+void XMLWriter::write(const char* sz, size_t l)
+{
+	if (m_nbuf + l > BUF_SIZE)
+	{
+		flush();
+		if (l > BUF_SIZE)
+		{
+			if (m_fp) fwrite(sz, 1, l, m_fp);
+			m_bytes += (double)l;
+			return;
+		}
+	}
+	memcpy(&m_buf[m_nbuf], sz, l);
+	m_nbuf += l;
 }
 
 void XMLWriter::inc_level()
@@ -236,20 +484,45 @@ void XMLWriter::dec_level()
 	m_sztab[l] = 0;
 }
 
-
-void XMLWriter::add_branch(XMLElement& el, bool bclear)
+// write the indentation and the start of a tag
+void XMLWriter::write_start(const char* sztag)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s", m_sztab);
-
-	fprintf(m_fp, szformat, el.m_sztag);
+	write(m_sztab, m_level);
+	put('<');
+	write(sztag);
+}
 
+void XMLWriter::write_atts(XMLElement& el)
+{
 	for (int i=0; i<el.m_natt; ++i)
 	{
-		fprintf(m_fp, " %s=\"%s\"", el.m_attn[i], el.m_attv[i]);
+		put(' ');
+		write(el.m_attn[i]);
+		write("=\"", 2);
+		write(el.m_attv[i]);
+		put('"');
 	}
+}
 
-	fprintf(m_fp, ">%s\n", el.m_szval);
+// format a value with the current float format
+int XMLWriter::format_float(char* sz, double v)
+{
+	switch (m_floatFormat)
+	{
+	case ScientificFormat: return xml_format_e(sz, v, 7, 15);
+	case ShortestFormat: return xml_format_shortest(sz, v);
+	default:
+		return xml_format_g(sz, v, 9);
+	}
+}
+
+void XMLWriter::add_branch(XMLElement& el, bool bclear)
+{
+	write_start(el.m_sztag);
+	write_atts(el);
+	put('>');
+	write(el.m_szval);
+	put('\n');
 
 	strcpy(m_tag[m_level], el.m_sztag);
 
@@ -260,9 +533,8 @@ void XMLWriter::add_branch(XMLElement& el, bool bclear)
 
 void XMLWriter::add_branch(const char* sz)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s>\n", m_sztab);
-	fprintf(m_fp, szformat, sz);
+	write_start(sz);
+	write(">\n", 2);
 
 	strcpy(m_tag[m_level], sz);
 	inc_level();
@@ -270,46 +542,34 @@ void XMLWriter::add_branch(const char* sz)
 
 void XMLWriter::add_empty(XMLElement& el, bool bclear)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s", m_sztab);
-
-	fprintf(m_fp, szformat, el.m_sztag);
-
-	for (int i=0; i<el.m_natt; ++i)
-	{
-		fprintf(m_fp, " %s=\"%s\"", el.m_attn[i], el.m_attv[i]);
-	}
-
-	fprintf(m_fp, "/>\n");
+	write_start(el.m_sztag);
+	write_atts(el);
+	write("/>\n", 3);
 
 	if (bclear) el.clear();
 }
 
 void XMLWriter::add_leaf(XMLElement& el, bool bclear)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s", m_sztab);
-
-	fprintf(m_fp, szformat, el.m_sztag);
-
-	for (int i=0; i<el.m_natt; ++i)
-	{
-		fprintf(m_fp, " %s=\"%s\"", el.m_attn[i], el.m_attv[i]);
-	}
-
-	fprintf(m_fp, ">%s</%s>\n", el.m_szval, el.m_sztag);
+	write_start(el.m_sztag);
+	write_atts(el);
+	put('>');
+	write(el.m_szval);
+	write("</", 2);
+	write(el.m_sztag);
+	write(">\n", 2);
 
 	if (bclear) el.clear();
 }
 
 void XMLWriter::add_leaf(const char* szn, const char* szv)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s", m_sztab);
-
-	fprintf(m_fp, szformat, szn);
-
-	fprintf(m_fp, ">%s</%s>\n", szv, szn);
+	write_start(szn);
+	put('>');
+	write(szv);
+	write("</", 2);
+	write(szn);
+	write(">\n", 2);
 }
 
 void XMLWriter::add_leaf(const char* szn, const std::string& s)
@@ -319,82 +579,141 @@ void XMLWriter::add_leaf(const char* szn, const std::string& s)
 
 void XMLWriter::add_leaf(const char* szn, double* pg, int n)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s>", m_sztab);
-
-	fprintf(m_fp, szformat, szn);
+	char sz[64];
+	write_start(szn);
+	put('>');
 
-	if (n>0)
+	for (int i=0; i<n; ++i)
 	{
-		fprintf(m_fp, "%.12lg", pg[0]);
-		for (int i=1; i<n; ++i) fprintf(m_fp, ",%.12lg", pg[i]);
+		if (i > 0) put(',');
+		write(sz, xml_format_g(sz, pg[i], 12));
 	}
 
-	fprintf(m_fp, "</%s>\n", szn);
-
+	write("</", 2);
+	write(szn);
+	write(">\n", 2);
 }
 
 void XMLWriter::add_leaf(const char* szn, float* pg, int n)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s>", m_sztab);
+	char sz[64];
+	write_start(szn);
+	put('>');
 
-	fprintf(m_fp, szformat, szn);
-
-	if (n>0)
+	for (int i=0; i<n; ++i)
 	{
-		fprintf(m_fp, "%.12g", pg[0]);
-		for (int i=1; i<n; ++i) fprintf(m_fp, ",%.12g", pg[i]);
+		if (i > 0) put(',');
+		write(sz, xml_format_g(sz, pg[i], 12));
 	}
 
-	fprintf(m_fp, "</%s>\n", szn);
-
+	write("</", 2);
+	write(szn);
+	write(">\n", 2);
 }
 
 
 void XMLWriter::add_leaf(const char* szn, int* pi, int n)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s>", m_sztab);
+	char sz[16];
+	write_start(szn);
+	put('>');
 
-	fprintf(m_fp, szformat, szn);
-
-	if (n>0)
+	for (int i=0; i<n; ++i)
 	{
-		fprintf(m_fp, "%d", pi[0]);
-		for (int i=1; i<n; ++i) fprintf(m_fp, ",%d", pi[i]);
+		if (i > 0) put(',');
+		write(sz, xml_format_int(sz, pi[i]));
 	}
 
-	fprintf(m_fp, "</%s>\n", szn);
+	write("</", 2);
+	write(szn);
+	write(">\n", 2);
 }
 
 void XMLWriter::add_leaf(XMLElement& el, const std::vector<int>& A)
 {
-	char szformat[256] = {0};
-	sprintf(szformat, "%s<%%s", m_sztab);
-
-	fprintf(m_fp, szformat, el.m_sztag);
-
-	for (int i=0; i<el.m_natt; ++i)
-	{
-		fprintf(m_fp, " %s=\"%s\"", el.m_attn[i], el.m_attv[i]);
-	}
-
-	fprintf(m_fp, ">\n%s", m_sztab);
+	write_start(el.m_sztag);
+	write_atts(el);
+	write(">\n", 2);
+	write(m_sztab, m_level);
 
+	char sz[16];
 	int n = (int) A.size(), l = 0;
 	for (int i=0; i<n; ++i)
 	{
-		l += fprintf(m_fp, "%5d", A[i]);
+		int m = xml_format_int(sz, A[i], 5);
+		write(sz, m);
+		l += m;
 		if (i < n-1)
 		{
-			fprintf(m_fp, ",");
-			if (l > 80) { fprintf(m_fp, "\n%s", m_sztab); l=0; }
+			put(',');
+			if (l > 80) { put('\n'); write(m_sztab, m_level); l=0; }
+		}
+	}
+	put('\n');
+	write(m_sztab, m_level);
+	write("</", 2);
+	write(el.m_sztag);
+	write(">\n", 2);
+}
+
+void XMLWriter::add_leaf_array(const char* szn, const char* szatt, const int* ids, const double* v, int rows, int cols)
+{
+	char sz[64];
+	size_t ln = strlen(szn);
+	size_t la = strlen(szatt);
+	for (int i = 0; i < rows; ++i)
+	{
+		write(m_sztab, m_level);
+		put('<');
+		write(szn, ln);
+		put(' ');
+		write(szatt, la);
+		write("=\"", 2);
+		write(sz, xml_format_int(sz, ids[i]));
+		write("\">", 2);
+
+		const double* vi = v + (size_t)i*cols;
+		for (int j = 0; j < cols; ++j)
+		{
+			if (j > 0) put(',');
+			write(sz, format_float(sz, vi[j]));
 		}
+
+		write("</", 2);
+		write(szn, ln);
+		write(">\n", 2);
 	}
-	fprintf(m_fp,"\n%s</%s>\n", m_sztab, el.m_sztag);
 }
 
+void XMLWriter::add_leaf_array(const char* szn, const char* szatt, const int* ids, const int* v, int rows, int cols)
+{
+	char sz[16];
+	int w = int_width(XMLElement::intFormat);
+	size_t ln = strlen(szn);
+	size_t la = strlen(szatt);
+	for (int i = 0; i < rows; ++i)
+	{
+		write(m_sztab, m_level);
+		put('<');
+		write(szn, ln);
+		put(' ');
+		write(szatt, la);
+		write("=\"", 2);
+		write(sz, xml_format_int(sz, ids[i]));
+		write("\">", 2);
+
+		const int* vi = v + (size_t)i*cols;
+		for (int j = 0; j < cols; ++j)
+		{
+			if (j > 0) put(',');
+			write(sz, xml_format_int(sz, vi[j], w));
+		}
+
+		write("</", 2);
+		write(szn, ln);
+		write(">\n", 2);
+	}
+}
 
 void XMLWriter::close_branch()
 {
@@ -402,10 +721,10 @@ void XMLWriter::close_branch()
 	{
 		dec_level();
 
-		char szformat[256] = {0};
-		sprintf(szformat, "%s</%%s>\n", m_sztab);
-
-		fprintf(m_fp, szformat, m_tag[m_level]);
+		write(m_sztab, m_level);
+		write("</", 2);
+		write(m_tag[m_level]);
+		write(">\n", 2);
 	}
 }
 
@@ -415,10 +734,14 @@ void XMLWriter::add_comment(const std::string& s, bool singleLine)
 
 	if (singleLine)
 	{
-		fprintf(m_fp, "<!-- %s -->\n", s.c_str());
+		write("<!-- ", 5);
+		write(s.c_str(), s.size());
+		write(" -->\n", 5);
 	}
 	else
 	{
-		fprintf(m_fp, "<!--\n%s\n-->\n", s.c_str());
+		write("<!--\n", 5);
+		write(s.c_str(), s.size());
+		write("\n-->\n", 5);
 	}
 }
@@ -38,6 +38,17 @@ SOFTWARE.*/
 
 class XMLWriter;
 
+//-----------------------------------------------------------------------------
+// Fast number formatting. These produce the same output as the printf format
+// that is mentioned, and return the number of characters written (excluding
+// the terminating zero).
+int xml_format_int(char* sz, int n, int width = 0);			// "%*d"
+int xml_format_g(char* sz, double v, int prec = 6);			// "%.*lg" (prec <= 15)
+int xml_format_e(char* sz, double v, int prec, int width);	// "%*.*le" (prec <= 14)
+
+// shortest representation that reads back as the same double
+int xml_format_shortest(char* sz, double v);
+
 class XMLElement
 {
 public:
@@ -57,10 +68,10 @@ public:
 	void name(const char* sz) { strcpy(m_sztag, sz); }
 
 	void value(const char* sz) { strcpy(m_szval, sz); }
-	void value(int    n) { sprintf(m_szval, "%d" , n); }
+	void value(int    n);
 	void value(int* pi, int n);
 	void value(bool   b) { sprintf(m_szval, "%d" , (int) b); }
-	void value(double g) { sprintf(m_szval, "%.9lg", g); }
+	void value(double g);
 	void value(double* pg, int n);
 	void value(const vec3d& r);
 	void value(const mat3d& a);
@@ -97,9 +108,12 @@ class XMLWriter
 public:
 	enum XMLFloatFormat {
 		ScientificFormat,
-		FixedFormat
+		FixedFormat,
+		ShortestFormat		// shortest representation that round-trips
 	};
 
+	enum { BUF_SIZE = 1 << 20 };
+
 public:
 	XMLWriter();
 	virtual ~XMLWriter();
@@ -129,10 +143,19 @@ public:
 	void add_leaf(const char* szn, const GLColor& c) { char szv[256]; sprintf(szv, "%d,%d,%d", c.r, c.g, c.b); add_leaf(szn, szv); }
 	void add_leaf(XMLElement& el, const std::vector<int>& A);
 
+	// Write rows of leaf elements <szn szatt="ids[i]">v[i*cols],...,v[i*cols+cols-1]</szn>.
+	// This is much faster than writing the leaves one at a time and is meant for
+	// large lists such as node coordinates and element connectivity.
+	void add_leaf_array(const char* szn, const char* szatt, const int* ids, const double* v, int rows, int cols);
+	void add_leaf_array(const char* szn, const char* szatt, const int* ids, const int* v, int rows, int cols);
+
 	void close_branch();
 
 	void add_comment(const std::string& s, bool singleLine = false);
 
+	// export throughput (MB/s) of the last file that was closed
+	double GetThroughput() const { return m_throughput; }
+
 public:
 	static void SetFloatFormat(XMLFloatFormat fmt);
 	static XMLFloatFormat GetFloatFormat();
@@ -141,10 +164,26 @@ protected:
 	void inc_level();
 	void dec_level();
 
+	// write to the output buffer
+	void write(const char* sz, size_t l);
+	void write(const char* sz) { write(sz, strlen(sz)); }
+	void put(char c) { if (m_nbuf == BUF_SIZE) flush(); m_buf[m_nbuf++] = c; }
+	void flush();
+
+	void write_start(const char* sztag);
+	void write_atts(XMLElement& el);
+	int format_float(char* sz, double v);
+
 protected:
 	FILE*	m_fp;
 	int		m_level;
 
+	std::vector<char>	m_buf;	// output buffer
+	size_t	m_nbuf;				// nr of characters in output buffer
+	double	m_bytes;			// nr of bytes written
+	double	m_startTime;		// time when file was opened
+	double	m_throughput;		// throughput (MB/s) of last file
+
 	char	m_tag[MAX_TAGS][256];
 	char	m_sztab[256];
 
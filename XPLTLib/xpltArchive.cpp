@@ -80,8 +80,10 @@ public:
 	unsigned int	m_bufsize;	// size of data buffer
 
 	// write data
-	OBranch* m_pRoot;	// chunk tree root
-	OBranch* m_pChunk;	// current chunk
+	stack<int64_t>	m_chunkPos;	// positions of the size fields of the open chunks
+	bool			m_bdirect;	// write the current root chunk directly to file?
+	bool			m_bappend;	// was the file opened for appending?
+	std::vector<unsigned char>	m_out;	// root chunk buffer when not writing directly
 
 	Imp()
 	{
@@ -93,8 +95,8 @@ public:
 		m_pdata = 0;
 		m_bufsize = 0;
 		m_ncompress = 0;
-		m_pRoot = 0;
-		m_pChunk = 0;
+		m_bdirect = false;
+		m_bappend = false;
 		m_bSaving = true;
 	}
 };
@@ -108,9 +110,20 @@ xpltArchive::~xpltArchive()
 	Close();
 }
 
-void xpltArchive::AddChild(OChunk* c)
+void xpltArchive::WriteChunkHeader(unsigned int nid, unsigned int nsize)
 {
-	im.m_pChunk->AddChild(c);
+	WriteData(&nid, sizeof(unsigned int));
+	WriteData(&nsize, sizeof(unsigned int));
+}
+
+void xpltArchive::WriteData(const void* pd, size_t nsize)
+{
+	if (im.m_bdirect) im.m_fp->Write(pd, 1, nsize);
+	else
+	{
+		const unsigned char* pc = (const unsigned char*)pd;
+		im.m_out.insert(im.m_out.end(), pc, pc + nsize);
+	}
 }
 
 void xpltArchive::SetVersion(unsigned int n) { im.m_nversion = n; }
@@ -124,7 +137,7 @@ void xpltArchive::Close()
 {
 	if (im.m_bSaving)
 	{
-		if (im.m_pRoot) Flush();
+		if (im.m_chunkPos.empty() == false) Flush();
 	}
 	else {
 		// clear the stack
@@ -153,15 +166,32 @@ void xpltArchive::Close()
 
 void xpltArchive::Flush()
 {
-	if (im.m_fp && im.m_pRoot)
+	// close any open chunks
+	while (im.m_chunkPos.size() > 1) EndChunk();
+	if (im.m_chunkPos.empty() == false)
 	{
-		im.m_fp->BeginStreaming();
-		im.m_pRoot->Write(im.m_fp);
-		im.m_fp->EndStreaming();
+		int64_t pos = im.m_chunkPos.top(); im.m_chunkPos.pop();
+
+		if (im.m_bdirect)
+		{
+			unsigned int nsize = (unsigned int)(im.m_fp->GetPosition() - pos - sizeof(unsigned int));
+			im.m_fp->Patch(pos, &nsize, sizeof(unsigned int));
+			im.m_fp->Flush();
+		}
+		else
+		{
+			unsigned int nsize = (unsigned int)(im.m_out.size() - pos - sizeof(unsigned int));
+			memcpy(&im.m_out[pos], &nsize, sizeof(unsigned int));
+			if (im.m_fp)
+			{
+				im.m_fp->BeginStreaming();
+				im.m_fp->Write(im.m_out.data(), 1, im.m_out.size());
+				im.m_fp->EndStreaming();
+			}
+			im.m_out.clear();
+		}
 	}
-	delete im.m_pRoot;
-	im.m_pRoot = 0;
-	im.m_pChunk = 0;
+	im.m_bdirect = false;
 }
 
 
@@ -177,34 +207,45 @@ bool xpltArchive::Create(const char* szfile)
 	im.m_fp->Write(&ntag, sizeof(int), 1);
 
 	im.m_bSaving = true;
+	im.m_bappend = false;
 
 	return true;
 }
 
 void xpltArchive::BeginChunk(unsigned int id)
 {
-	if (im.m_pRoot == 0)
+	if (im.m_chunkPos.empty())
 	{
-		im.m_pRoot = new OBranch(id);
-		im.m_pChunk = im.m_pRoot;
+		// A root chunk can be streamed straight to the file, since its size fields
+		// can be patched afterwards. This isn't possible when the chunk is compressed
+		// or when the file was opened for appending, so then the chunk is assembled
+		// in memory first.
+		im.m_bdirect = ((im.m_ncompress == 0) && (im.m_bappend == false));
+		im.m_out.clear();
 	}
-	else
-	{
-		// create a new branch
-		OBranch* pbranch = new OBranch(id);
 
-		// attach it to the current branch
-		im.m_pChunk->AddChild(pbranch);
-
-		// move the current branch pointer
-		im.m_pChunk = pbranch;
-	}
+	WriteData(&id, sizeof(unsigned int));
+	im.m_chunkPos.push(im.m_bdirect ? im.m_fp->GetPosition() : (int64_t)im.m_out.size());
+	unsigned int nsize = 0;
+	WriteData(&nsize, sizeof(unsigned int));
 }
 
 void xpltArchive::EndChunk()
 {
-	if (im.m_pChunk != im.m_pRoot)
-		im.m_pChunk = im.m_pChunk->GetParent();
+	if (im.m_chunkPos.size() > 1)
+	{
+		int64_t pos = im.m_chunkPos.top(); im.m_chunkPos.pop();
+		if (im.m_bdirect)
+		{
+			unsigned int nsize = (unsigned int)(im.m_fp->GetPosition() - pos - sizeof(unsigned int));
+			im.m_fp->Patch(pos, &nsize, sizeof(unsigned int));
+		}
+		else
+		{
+			unsigned int nsize = (unsigned int)(im.m_out.size() - pos - sizeof(unsigned int));
+			memcpy(&im.m_out[pos], &nsize, sizeof(unsigned int));
+		}
+	}
 	else
 	{
 		Flush();
@@ -330,6 +371,7 @@ bool xpltArchive::Append(const char* szfile)
 	im.m_fp = new IOFileStream();
 	if (im.m_fp->Append(szfile) == false) return false;
 	im.m_bSaving = true;
+	im.m_bappend = true;
 	return true;
 }
 
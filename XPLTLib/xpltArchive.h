@@ -68,22 +68,28 @@ public:
 
 	template <typename T> void WriteChunk(unsigned int nid, T& o)
 	{
-		AddChild(new OLeaf<T>(nid, o));
+		WriteChunkHeader(nid, sizeof(T));
+		WriteData(&o, sizeof(T));
 	}
 
 	void WriteChunk(unsigned int nid, const char* sz)
 	{
-		AddChild(new OLeaf<const char*>(nid, sz));
+		int l = (int)strlen(sz);
+		WriteChunkHeader(nid, l + sizeof(int));
+		WriteData(&l, sizeof(int));
+		WriteData(sz, l);
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, T* po, int n)
 	{
-		AddChild(new OLeaf<T*>(nid, po, n));
+		WriteChunkHeader(nid, sizeof(T)*n);
+		WriteData(po, sizeof(T)*n);
 	}
 
 	template <typename T> void WriteChunk(unsigned int nid, std::vector<T>& a)
 	{
-		AddChild(new OLeaf<std::vector<T> >(nid, a));
+		WriteChunkHeader(nid, (unsigned int)(sizeof(T)*a.size()));
+		if (a.empty() == false) WriteData(a.data(), sizeof(T)*a.size());
 	}
 
 	// (overridden from Archive)
@@ -93,7 +99,8 @@ public:
 	}
 
 protected:
-	void AddChild(OChunk* c);
+	void WriteChunkHeader(unsigned int nid, unsigned int nsize);
+	void WriteData(const void* pd, size_t nsize);
 
 public: // reading 
 